@@ -13,6 +13,7 @@
 #include "Type.h"
 #include "Util.h"
 #include "Var.h"
+#include "../../t2s/src/SplitStorage.h"
 #include "../../t2s/src/Utilities.h"
 
 namespace Halide {
@@ -2796,14 +2797,28 @@ void CodeGen_C::visit(const For *op) {
 
         for (size_t i = 0; i < closure_args.size(); i++) {
             auto &arg = closure_args[i];
-            stream << get_indent() << "status = clSetKernelArg("
-                   << "kernel[current_kernel], "
-                   << i << ", ";
-            if (arg.is_buffer) {
-                stream << "sizeof(cl_mem), "
-                       << "(void *)&((device_handle *)_halide_buffer_get_device(" << print_name(arg.name + ".buffer") << "))->mem";
+            string split_buffer;
+            int part;
+            if (arg.is_buffer && is_storage_part(arg.name, split_buffer, part)) {
+                // A part of a buffer whose storage is split (See Func::split_storage).
+                stream << get_indent() << "status = halide_opencl_set_kernel_buffer_arg(current_kernel, " << i << ", "
+                       << "halide_opencl_buffer_part(" << print_name(split_buffer + ".buffer") << ", " << part << ")";
+            } else if (arg.is_buffer) {
+                // The runtime records the buffers of the kernel, so that it knows which transfers the kernel depends on.
+                stream << get_indent() << "status = halide_opencl_set_kernel_buffer_arg(current_kernel, " << i << ", "
+                       << "&((device_handle *)_halide_buffer_get_device(" << print_name(arg.name + ".buffer") << "))->mem";
+            } else if (ends_with(arg.name, ".part_shift")) {
+                // The elements per part of a split buffer, defined by the host code right before the kernel launch.
+                stream << get_indent() << "status = clSetKernelArg("
+                       << "kernel[current_kernel], "
+                       << i << ", "
+                       << "sizeof(" << print_type(arg.type) << "), "
+                       << "(void *)&" << print_name(arg.name);
             } else {
-                stream << "sizeof(" << print_type(arg.type) << "), "
+                stream << get_indent() << "status = clSetKernelArg("
+                       << "kernel[current_kernel], "
+                       << i << ", "
+                       << "sizeof(" << print_type(arg.type) << "), "
                        << "(void *)&" << arg.name;
             }
             stream << ");\n"
@@ -3017,6 +3032,12 @@ void CodeGen_C::visit(const Evaluate *op) {
     if (auto call = op->value.as<Call>()) {
         if (call->is_intrinsic(Call::overlay) || call->is_intrinsic(Call::overlay_switch))
             has_overlay = true;
+        // The pipelining directives of a loop are for the device code generators only
+        if (call->is_intrinsic(Call::annotate) && !call->args.empty()) {
+            const StringImm *kind = call->args[0].as<StringImm>();
+            if (kind && kind->value == "Pipeline")
+                return;
+        }
     }
     string id = print_expr(op->value);
     if (!has_overlay) {
@@ -3,6 +3,7 @@
 
 #include "Simplify.h"
 #include "IROperator.h"
+#include "IRVisitor.h"
 #include "CodeGen_CM_Dev.h"
 #include "Substitute.h"
 
@@ -67,6 +68,21 @@ string simt_intrinsic(const string &name) {
     internal_error << "simt_intrinsic called on bad variable name: " << name << "\n";
     return "";
 }
+
+// The total bytes of the SLM buffers allocated in a statement
+class SLMSize : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Allocate *op) override {
+        if (op->memory_type == MemoryType::GPUShared) {
+            bytes += op->constant_allocation_size() * op->type.bytes();
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    int32_t bytes = 0;
+};
 }  // namespace
 
 string CodeGen_CM_Dev::CodeGen_CM_C::print_vector_op(const string& tmpl, char prefix) {
@@ -439,6 +455,26 @@ void CodeGen_CM_Dev::CodeGen_CM_C::visit(const Load *op) {
         }
         return;
     }
+    if (alloc.memory_type == MemoryType::GPUShared) {
+        // Read a dense vector from SLM by messages of at most 16 elements
+        auto ramp = op->index.as<Ramp>();
+        user_assert(ramp && is_one(ramp->stride))
+            << "Only a dense vector can be read from SLM buffer " << op->name << "\n";
+        string result = unique_name('_');
+        stream << get_vector_declaration(op->type, result);
+        for (int i = 0; i < ramp->lanes; i += 16) {
+            int lanes = std::min(16, ramp->lanes - i);
+            user_assert(lanes == 8 || lanes == 16)
+                << "The size of a vector read from SLM buffer " << op->name << " must be a multiple of 8\n";
+            string offsets = print_vector_op(get_vector_init_tmpl(UInt(32).with_lanes(lanes), "0", "1"));
+            string base = print_expr(simplify(ramp->base + i));
+            string chunk = unique_name('_');
+            stream << replace_all(get_slm_read_tmpl(op->type.with_lanes(lanes), op->name, base, offsets), "$ID$", chunk);
+            stream << get_indent() << get_vector_select(result, to_string(i), lanes, 1) << " = " << chunk << ";\n";
+        }
+        id = result;
+        return;
+    }
     // If we're loading a contiguous ramp into a vector, use block read instead.
     bool is_continuous = strided_ramp_base(op->index).defined();
     if (is_continuous) {
@@ -512,6 +548,25 @@ void CodeGen_CM_Dev::CodeGen_CM_C::visit(const Store *op) {
         }
         return;
     }
+    if (alloc.memory_type == MemoryType::GPUShared) {
+        // Write a dense vector to SLM by messages of at most 16 elements
+        auto ramp = op->index.as<Ramp>();
+        user_assert(ramp && is_one(ramp->stride))
+            << "Only a dense vector can be written to SLM buffer " << op->name << "\n";
+        string src = unique_name('_');
+        stream << get_vector_declaration(t, src);
+        stream << get_indent() << src << " = " << value << ";\n";
+        for (int i = 0; i < ramp->lanes; i += 16) {
+            int lanes = std::min(16, ramp->lanes - i);
+            user_assert(lanes == 8 || lanes == 16)
+                << "The size of a vector written to SLM buffer " << op->name << " must be a multiple of 8\n";
+            string offsets = print_vector_op(get_vector_init_tmpl(UInt(32).with_lanes(lanes), "0", "1"));
+            string base = print_expr(simplify(ramp->base + i));
+            string chunk = get_vector_select(src, to_string(i), lanes, 1);
+            stream << replace_all(get_slm_write_tmpl(t.with_lanes(lanes), op->name, base, offsets), "$ID$", chunk);
+        }
+        return;
+    }
     bool is_continuous = strided_ramp_base(op->index).defined()
                         || strided_ramp_base(op->index, -1).defined();
     if (is_continuous) {
@@ -579,12 +634,20 @@ void CodeGen_CM_Dev::CodeGen_CM_C::visit(const Allocate *op) {
         allocations.push(op->name, alloc);
         open_scope();
 
-        int32_t size = op->constant_allocation_size();
+        int32_t size = op->constant_allocation_size() * op->type.bytes();
         internal_assert(size % 4 == 0);
-        stream << get_indent() << "cm_slm_init(" << size << ");\n";
+        bool outermost = !in_slm;
+        if (outermost) {
+            // SLM is initialized only once in a kernel, with the total size of all its SLM buffers
+            SLMSize nested;
+            op->body.accept(&nested);
+            stream << get_indent() << "cm_slm_init(" << size + nested.bytes << ");\n";
+        }
         stream << get_indent() << "unsigned int " << print_name(op->name)
                                << " = cm_slm_alloc(" << size << ");\n";
+        in_slm = true;
         op->body.accept(this);
+        in_slm = !outermost;
 
         close_scope("alloc " + print_name(op->name));
         // Should have been freed internally
@@ -65,6 +65,7 @@ protected:
     private:
         size_t trick_size = 0;
         bool in_buffer = false;
+        bool in_slm = false;
         string get_vector_element(const string &name,
                                   const string &id_index);
         string get_vector_init_tmpl(Type t,
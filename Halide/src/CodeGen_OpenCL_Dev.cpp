@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <functional>
 #include <sstream>
 #include <fstream>
 
@@ -13,7 +14,12 @@
 #include "IROperator.h"
 #include "Simplify.h"
 #include "Substitute.h"
+#include "ThreadPool.h"
+#include "../../t2s/src/BitstreamCache.h"
+#include "../../t2s/src/CompileJobs.h"
 #include "../../t2s/src/DebugPrint.h"
+#include "../../t2s/src/LowPrecision.h"
+#include "../../t2s/src/MemoryBanking.h"
 #include "../../t2s/src/Utilities.h"
 
 namespace Halide {
@@ -45,7 +51,8 @@ bool CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::is_standard_opencl_type(Type type) {
     bool standard_bits = false;
     bool standard_lanes = false;
     if (type.is_float()) {
-        if ((bits == 16 && target.has_feature(Target::CLHalf)) ||
+        // A 16-bit float is half, or ushort if stored as bits
+        if ((bits == 16 && (target.has_feature(Target::CLHalf) || is_float16_stored_as_bits(type, target))) ||
             (bits == 32) || (bits == 64)) {
             standard_bits = true;
         }
@@ -75,9 +82,16 @@ string CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::print_type(Type type, AppendSpaceIf
         oss << type_name;
     } else if (type.is_float()) {
         if (type.bits() == 16) {
-            user_assert(target.has_feature(Target::CLHalf))
-                << "OpenCL kernel uses half type, but CLHalf target flag not enabled\n";
-            oss << "half";
+            if (is_float16_stored_as_bits(type, target)) {
+                // Stored as the 16 bits, and converted to float for arithmetic
+                oss << "ushort";
+            } else {
+                user_assert(!type.is_bfloat())
+                    << "OpenCL kernel uses bfloat16 type, which is supported only on Intel FPGAs\n";
+                user_assert(target.has_feature(Target::CLHalf))
+                    << "OpenCL kernel uses half type, but CLHalf target flag not enabled\n";
+                oss << "half";
+            }
         } else if (type.bits() == 32) {
             oss << "float";
         } else if (type.bits() == 64) {
@@ -326,11 +340,32 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const For *loop) {
                 CodeGen_C::visit(loop);
             }
         } else {
+            print_loop_pipelining(loop);
             CodeGen_C::visit(loop);
         }
     }
 }
 
+// Print the pipelining directives of a loop, if any, as pragmas right before the loop.
+void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::print_loop_pipelining(const For *loop) {
+    auto p = loop_pipelining.find(loop->name);
+    if (p == loop_pipelining.end()) {
+        return;
+    }
+    // Print the bounds first, so that nothing is printed between the pragmas and the loop.
+    print_expr(loop->min);
+    print_expr(loop->extent);
+    const char *pragmas[] = {"ii", "speculated_iterations", "loop_coalesce", "max_concurrency"};
+    internal_assert(p->second.size() == 4);
+    for (size_t i = 0; i < p->second.size(); i++) {
+        const int64_t *value = as_const_int(p->second[i]);
+        internal_assert(value);
+        if (*value >= 0) {
+            stream << get_indent() << "#pragma " << pragmas[i] << " " << *value << "\n";
+        }
+    }
+}
+
 void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::CheckConditionalChannelAccess::visit(const IfThenElse *op) {
     bool old_cond = in_if_then_else;
     in_if_then_else = true;
@@ -864,11 +899,7 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Call *op) {
         // Do not directly print to stream: there might have been a cached value useable.
         ostringstream rhs;
         rhs << print_name(buffer_name);
-        for(size_t i = 0; i < op->args.size(); i++) {
-            rhs << "[";
-            rhs << print_expr(op->args[i]);
-            rhs << "]";
-        }
+        rhs << print_buffer_indices(op->name, op->args);
         print_assignment(op->type, rhs.str());
     } else if (ends_with(op->name, ".temp")) {
         std::string name = op->name;
@@ -1159,7 +1190,26 @@ string CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::print_extern_call(const Call *op) {
 }
 
 void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Load *op) {
-    user_assert(is_one(op->predicate)) << "Predicated load is not supported inside OpenCL kernel.\n";
+    if (!is_one(op->predicate)) {
+        // A predicate uniform across the lanes, like that of a load from a part of a split buffer (See
+        // split_storage), guards the load, so that nothing is loaded when it is false.
+        Expr predicate = op->predicate;
+        if (const Broadcast *b = predicate.as<Broadcast>()) {
+            predicate = b->value;
+        }
+        user_assert(predicate.type().is_scalar()) << "Predicated load is not supported inside OpenCL kernel.\n";
+        string id_predicate = print_expr(predicate);
+        string id_value = unique_name('_');
+        stream << get_indent() << print_type(op->type) << " " << id_value << ";\n";
+        stream << get_indent() << "if (" << id_predicate << ")\n";
+        open_scope();
+        string id_load = print_expr(Load::make(op->type, op->name, op->index, op->image, op->param,
+                                               const_true(op->type.lanes()), op->alignment));
+        stream << get_indent() << id_value << " = " << id_load << ";\n";
+        close_scope("");
+        id = id_value;
+        return;
+    }
 
     // If we're loading a contiguous ramp into a vector, use vload instead.
     Expr ramp_base = strided_ramp_base(op->index);
@@ -1470,9 +1520,10 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const GE *op) {
 }
 
 void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Cast *op) {
-    if (!target.has_feature(Target::CLHalf) &&
-        ((op->type.is_float() && op->type.bits() < 32) ||
-         (op->value.type().is_float() && op->value.type().bits() < 32))) {
+    if (is_float16_stored_as_bits(op->type, target) || is_float16_stored_as_bits(op->value.type(), target) ||
+        (!target.has_feature(Target::CLHalf) &&
+         ((op->type.is_float() && op->type.bits() < 32) ||
+          (op->value.type().is_float() && op->value.type().bits() < 32)))) {
         Expr equiv = lower_float16_cast(op);
         equiv.accept(this);
         return;
@@ -1712,7 +1763,89 @@ void CodeGen_OpenCL_Dev::add_kernel(Stmt s,
 
     // TODO: do we have to uniquify these names, or can we trust that they are safe?
     cur_kernel_name = name;
-    clc.add_kernel(s, name, args);
+    if (device_codegen_threads() <= 1) {
+        clc.add_kernel(s, name, args);
+        return;
+    }
+    // The kernels are independent of each other. Emit them all together when the source is needed.
+    kernels.push_back({s, name, args});
+}
+
+size_t CodeGen_OpenCL_Dev::device_codegen_threads() {
+    string threads_env = get_env_variable("HL_DEVICE_CODEGEN_THREADS");
+    return threads_env.empty() ? ThreadPool<void>::num_processors_online() : (size_t)std::atoi(threads_env.c_str());
+}
+
+string CodeGen_OpenCL_Dev::emit_kernel(const Kernel &kernel) {
+    ostringstream stream;
+    CodeGen_OpenCL_C printer(stream, clc.get_target());
+    // Discard the preamble printed on construction.
+    stream.str("");
+    printer.inherit_module_state(clc);
+    printer.add_kernel(kernel.stmt, kernel.name, kernel.args);
+    return stream.str();
+}
+
+void CodeGen_OpenCL_Dev::emit_kernels_in_parallel(size_t threads, std::function<void(size_t)> emit) {
+    vector<std::exception_ptr> errors(kernels.size());
+    {
+        ThreadPool<void> pool(threads);
+        vector<std::future<void>> done;
+        for (size_t i = 0; i < kernels.size(); i++) {
+            done.push_back(pool.async([i, &emit, &errors]() {
+#ifdef WITH_EXCEPTIONS
+                try {
+                    emit(i);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+#else
+                emit(i);
+#endif
+            }));
+        }
+        for (auto &d : done) {
+            d.wait();
+        }
+    }
+    // Report the error of the first kernel that failed, as if the kernels were emitted one by one.
+    for (auto &e : errors) {
+        if (e) {
+            kernels.clear();
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+void CodeGen_OpenCL_Dev::emit_kernels() {
+    if (kernels.empty()) {
+        return;
+    }
+    size_t threads = std::min(device_codegen_threads(), kernels.size());
+    debug(2) << "Emitting " << kernels.size() << " OpenCL kernels with " << threads << " threads\n";
+    // Emit every kernel once, naming its temporaries with placeholders numbered by counters of its own.
+    vector<string> sources(kernels.size());
+    vector<ScopedUniqueNames::Counters> counts(kernels.size());
+    auto emit = [this, &sources, &counts](size_t i) {
+        ScopedUniqueNames names;
+        sources[i] = emit_kernel(kernels[i]);
+        counts[i] = names.counts();
+    };
+    if (threads <= 1) {
+        for (size_t i = 0; i < kernels.size(); i++) {
+            emit(i);
+        }
+    } else {
+        emit_kernels_in_parallel(threads, emit);
+    }
+    // Take the numbers of the names from the process-wide counters in the order of the kernels, as if the
+    // kernels were emitted one after another when they were added. The host code generated in between names
+    // its values with prefixes other than those of the temporaries of a kernel ('_' and 'V'), so the numbers
+    // are those the kernels take with HL_DEVICE_CODEGEN_THREADS=1. The names are unique in any case.
+    for (size_t i = 0; i < kernels.size(); i++) {
+        src_stream << ScopedUniqueNames::renumber(sources[i], reserve_unique_names(counts[i]));
+    }
+    kernels.clear();
 }
 
 namespace {
@@ -1867,8 +2000,10 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::add_kernel(Stmt s,
             args[i].type.is_float() &&
             args[i].type.bits() < 32) {
             stream << " const " << print_type(args[i].type)
-                   << " " << print_name(args[i].name)
-                   << " = half_from_bits(" << print_name(args[i].name + "_bits") << ");\n";
+                   << " " << print_name(args[i].name) << " = "
+                   << (is_float16_stored_as_bits(args[i].type, target) ? "" : "half_from_bits(")
+                   << print_name(args[i].name + "_bits")
+                   << (is_float16_stored_as_bits(args[i].type, target) ? "" : ")") << ";\n";
         }
     }
 
@@ -1900,6 +2035,7 @@ void CodeGen_OpenCL_Dev::init_module() {
     // wipe the internal kernel source
     src_stream.str("");
     src_stream.clear();
+    kernels.clear();
 
     const Target &target = clc.get_target();
 
@@ -2260,6 +2396,7 @@ __kernel void scheduler() {
 }
 
 vector<char> CodeGen_OpenCL_Dev::compile_to_src() {
+    emit_kernels();
     const Target &target = clc.get_target();
     if (target.has_feature(Target::IntelFPGA)) {
         compile_to_aocx(src_stream);
@@ -2278,6 +2415,7 @@ string CodeGen_OpenCL_Dev::get_current_kernel_name() {
 }
 
 void CodeGen_OpenCL_Dev::dump() {
+    emit_kernels();
     std::cerr << src_stream.str() << std::endl;
 }
 
@@ -2307,13 +2445,25 @@ void CodeGen_OpenCL_Dev::compile_to_aocx(std::ostringstream &src_stream) {
         return;
     }
 
+    // A previous compile of the bitstream in this process, if still running, would overwrite the files below.
+    CompileJobs &jobs = CompileJobs::get();
+    jobs.wait(bitstream_file);
+
     // Bitstream was generated ahead of time. Check the file exists.
-    // Note that we do not check if the aocx file is really good or up to date with the
-    // source code. So if you want to regenerate the aocx file, delete it before invoking Halide.
+    // If the bitstream was compiled or fetched with the cache, we know whether it is up to date
+    // with the source code. Otherwise, we do not check, so if you want to regenerate the aocx file,
+    // delete it before invoking Halide.
+    BitstreamCache cache(src_stream.str());
     std::ifstream file(bitstream_file, std::ios::in);
     if (file.good()) {
-        user_warning << "Bitstream " << bitstream_file << " exists. No re-compilation.\n";
-        return;
+        if (jobs.interrupted(bitstream_file)) {
+            user_warning << "Bitstream " << bitstream_file << " exists, but its compilation was interrupted.\n";
+        } else if (!cache.is_stale(bitstream_file)) {
+            user_warning << "Bitstream " << bitstream_file << " exists. No re-compilation.\n";
+            return;
+        } else {
+            user_warning << "Bitstream " << bitstream_file << " exists, but is out of date with the source code, AOC_OPTION or board.\n";
+        }
     }
 
     // Create the source file
@@ -2342,13 +2492,28 @@ void CodeGen_OpenCL_Dev::compile_to_aocx(std::ostringstream &src_stream) {
         }
     }
 
-    // Compile the OpenCL file into a bitstream.
+    // Reuse the bitstream compiled from the same source, unless the programmer has just modified the source.
+    std::vector<char> cl_contents = read_entire_file(cl_name);
+    bool modified = (std::string(cl_contents.begin(), cl_contents.end()) != src_stream.str() + "\n");
+    if (!modified && cache.fetch(bitstream_file)) {
+        return;
+    }
+
+    // Compile the OpenCL file into a bitstream, in the background if COMPILE_JOBS is set.
     std::stringstream command;
     char *aoc_option = getenv("AOC_OPTION");
     command << "aoc " << ((aoc_option == NULL) ? "" : aoc_option) << " -g " << cl_name << " -o " << bitstream_file;
     debug(4) << "Compiling for bitstream: " << command.str() << "\n";
-    int ret = system(command.str().c_str());
-    user_assert(ret != -1) << "Failed in compiling " << cl_name;
+    cache.forget(bitstream_file);
+    std::shared_future<int> job = jobs.submit(command.str(), bitstream_file, [cache, modified, bitstream_file](int ret) {
+        if (ret == 0 && !modified && file_exists(bitstream_file)) {
+            cache.store(bitstream_file);
+        }
+    });
+    // A JIT-compiled pipeline loads the bitstream right after this.
+    if (!jobs.asynchronous() || clc.get_target().has_feature(Target::JIT)) {
+        user_assert(job.get() != -1) << "Failed in compiling " << cl_name;
+    }
 }
 
 void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::print_global_data_structures_before_kernel(const Stmt *op) {
@@ -2434,6 +2599,13 @@ bool CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::is_irregular(Region &bounds) {
     return irregular_bounds;
 }
 
+void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::inherit_module_state(const CodeGen_OpenCL_C &module) {
+    shift_regs_allocates = module.shift_regs_allocates;
+    shift_regs_bounds = module.shift_regs_bounds;
+    space_vars = module.space_vars;
+    loop_pipelining = module.loop_pipelining;
+}
+
 void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::gather_shift_regs_allocates(const Stmt *op) {
     GatherShiftRegsAllocates gatherer(this, shift_regs_allocates, shift_regs_bounds, space_vars);
     op->accept(&gatherer);
@@ -2491,6 +2663,9 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::GatherShiftRegsAllocates::visit(const
         std::string reg_name = op->args[1].as<StringImm>()->value;
         std::vector<Expr> vars(op->args.begin() + 2, op->args.end());
         space_vars[reg_name] = vars;
+    } else if (op->is_intrinsic(Call::annotate) && op->args[0].as<StringImm>()->value == "Pipeline") {
+        std::string loop_name = op->args[1].as<StringImm>()->value;
+        parent->loop_pipelining[loop_name] = std::vector<Expr>(op->args.begin() + 2, op->args.end());
     } else {
         IRVisitor::visit(op);
     }
@@ -2611,21 +2786,23 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Realize *op) {
         }
         print_stmt(op->body);
     } else if(ends_with(op->name,".ibuffer")){
+        // Bank the buffer so that the unrolled accesses to it hit distinct banks.
+        MemoryBanks banks = bank_memory(op);
+        buffer_dims[op->name] = banks.dims;
         std::string string_bound = "" ;
-        std::vector<std::string> access_exprs;
-        for (Range b : op->bounds) {
-            access_exprs.push_back(print_expr(b.extent));
-        }
-        for (std::string ae : access_exprs) {
-            string_bound += "[" + ae + "]";
+        for (auto &extent : banks.extents) {
+            string_bound += "[" + print_expr(extent) + "]";
         }
         for(size_t i=0;i<op->types.size();i++) {
             std::string name = op->name.substr(0, op->name.length()-std::string(".ibuffer").size());
             string buffer_name = name + '.' + std::to_string(i) + ".ibuffer";
+            int width = bank_width(op->types[i]);
             stream << get_indent() << print_type(op->types[i]) << " ";
-            stream << "__attribute__((memory, numbanks("
-                   << access_exprs.back()
-                   << "), singlepump, numwriteports(1), numreadports(1))) "
+            stream << "__attribute__((memory, numbanks(" << banks.banks << "), ";
+            if (width > 0) {
+                stream << "bankwidth(" << width << "), ";
+            }
+            stream << "singlepump, numwriteports(1), numreadports(1))) "
                    << print_name(buffer_name) << string_bound << ";\n";
         }
         print_stmt(op->body);
@@ -2638,23 +2815,28 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Realize *op) {
     }
 }
 
+string CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::print_buffer_indices(const string &buffer, const vector<Expr> &args) {
+    vector<string> indices;
+    for (auto &a : args) {
+        indices.push_back(print_expr(a));
+    }
+    auto dims = buffer_dims.find(buffer);
+    internal_assert(dims != buffer_dims.end() && dims->second.size() == args.size());
+    string s;
+    for (int d : dims->second) {
+        s += "[" + indices[d] + "]";
+    }
+    return s;
+}
+
 void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Provide *op){
     if (ends_with(op->name, ".ibuffer")) {
         internal_assert(op->values.size() == 1);
         string id_value = print_expr(op->values[0]);
         std::string name = op->name.substr(0, op->name.length()-std::string(".ibuffer").size());
-        std::vector<std::string> access_exprs;
-        for(size_t i = 0; i < op->args.size(); i++) {
-            access_exprs.push_back(print_expr(op->args[i]));
-        }
+        string indices = print_buffer_indices(op->name, op->args);
         string buffer_name = name + '.' + std::to_string(0) + ".ibuffer";
-        stream << get_indent() << print_name(buffer_name);
-        for(size_t i = 0; i < op->args.size(); i++) {
-            stream << "[";
-            stream << access_exprs[i];
-            stream << "]";
-        }
-        stream << " = " << id_value << ";\n";
+        stream << get_indent() << print_name(buffer_name) << indices << " = " << id_value << ";\n";
         cache.clear();
     } else if (ends_with(op->name, ".temp")) {
         internal_assert(op->values.size() == 1);
@@ -5,6 +5,7 @@
  * Defines the code-generator for producing OpenCL C kernel code
  */
 
+#include <functional>
 #include <sstream>
 
 #include "CodeGen_C.h"
@@ -64,6 +65,8 @@ protected:
                         const std::vector<DeviceArgument> &args);
         void print_global_data_structures_before_kernel(const Stmt *op);
         void gather_shift_regs_allocates(const Stmt *op);
+        // Take the shift registers and the pipelining directives gathered for the module by another printer.
+        void inherit_module_state(const CodeGen_OpenCL_C &module);
 
     protected:
         using CodeGen_C::visit;
@@ -158,6 +161,10 @@ protected:
         std::map<std::string, std::vector<std::string>> shift_regs_allocates; // For all shift regs
         std::map<std::string, size_t> shift_regs_bounds; // Only for shift regs whose types are nonstandard_vectors
         std::map<std::string, std::vector<Expr>> space_vars; // For shift regs with irregular bounds
+        std::map<std::string, std::vector<Expr>> loop_pipelining; // For loops with pipelining directives
+        void print_loop_pipelining(const For *loop);
+        std::map<std::string, std::vector<int>> buffer_dims; // For on-chip buffers: the dimensions in the order declared
+        std::string print_buffer_indices(const std::string &buffer, const std::vector<Expr> &args);
         // For saving the pointer args streamed from scehduler
         std::map<std::string, std::string> pointer_args;
 
@@ -195,6 +202,25 @@ protected:
     std::string cur_kernel_name;
     CodeGen_OpenCL_C clc;
 
+    // Kernels added, but not emitted into src_stream yet. With HL_DEVICE_CODEGEN_THREADS=1, a kernel is
+    // emitted by clc when it is added, and none is deferred.
+    struct Kernel {
+        Stmt stmt;
+        std::string name;
+        std::vector<DeviceArgument> args;
+    };
+    std::vector<Kernel> kernels;
+
+    // The number of threads to emit the kernels with: HL_DEVICE_CODEGEN_THREADS, or by default, as many as the cores.
+    static size_t device_codegen_threads();
+    // Emit the kernels added, concurrently, each into a stream of its own. The streams are appended to
+    // src_stream in the order the kernels were added, and the temporaries are renumbered as if the kernels
+    // were emitted one after another, so that the source is the same with any number of threads.
+    void emit_kernels();
+    std::string emit_kernel(const Kernel &kernel);
+    // Call emit(i) for every kernel i on a pool of threads, and rethrow the error of the first kernel that failed.
+    void emit_kernels_in_parallel(size_t threads, std::function<void(size_t)> emit);
+
 private:
     // Methods only for generating OpenCL code for Intel FPGAs
     void compile_to_aocx(std::ostringstream &src_stream);
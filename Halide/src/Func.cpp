@@ -2667,6 +2667,76 @@ Func &Func::gpu_store(const vector<Expr> &args, size_t sz) {
     return *this;
 }
 
+Func &Func::split_storage(int parts) {
+    user_assert(parts >= 1) << "The buffer of " << name() << " cannot be split into " << parts << " parts\n";
+    invalidate_cache();
+    func.storage_parts(parts);
+    return *this;
+}
+
+Func &Func::burst(int bits) {
+    user_assert(bits >= 0 && (bits & (bits - 1)) == 0)
+        << "The burst of " << name() << " must be a power of 2 bits, but is " << bits << "\n";
+    invalidate_cache();
+    func.burst_bits(bits);
+    return *this;
+}
+
+Func &Func::relay() {
+    user_assert(func.place() == Place::Device)
+        << "Only a device Func can relay its output, but " << name() << " is on the host\n";
+    invalidate_cache();
+    func.relay(true);
+    return *this;
+}
+
+namespace {
+
+// Read the inputs of UREs by tile: replace the loop variable with the tile in the args of every call to an image.
+class GatherTiles : public IRMutator {
+    using IRMutator::visit;
+    const string &var;
+    Expr tile;
+
+    Expr visit(const Call *op) override {
+        bool input = op->call_type == Call::Image ||
+                     (op->call_type == Call::Halide && op->func.defined() &&
+                      Function(op->func).definition().schedule().is_param_func());
+        if (!input || !expr_uses_var(Expr(op), var)) {
+            return IRMutator::visit(op);
+        }
+        vector<Expr> args;
+        for (auto &a : op->args) {
+            args.push_back(substitute(var, tile, a));
+        }
+        gathered = true;
+        return Call::make(op->type, op->name, args, op->call_type, op->func, op->value_index, op->image, op->param);
+    }
+
+public:
+    GatherTiles(const string &var, Expr tile) : var(var), tile(tile) {}
+
+    bool gathered = false;
+};
+
+}  // namespace
+
+Func &Func::sparse(Var k, Expr tile, Expr tiles) {
+    user_assert(!func.definition().schedule().is_merged())
+        << "Func " << name() << " is merged into other UREs. Call sparse() on the UREs they are merged into\n";
+    user_assert(tile.type().is_int() || tile.type().is_uint())
+        << "The tile of loop " << k.name() << " of " << name() << " must be an integer, but is " << tile.type() << "\n";
+    invalidate_cache();
+    GatherTiles gatherer(k.name(), clamp(cast<int>(tile), 0, tiles - 1));
+    func.mutate(&gatherer);
+    for (auto f : func.definition().schedule().merged_ures()) {
+        f.function().mutate(&gatherer);
+    }
+    user_assert(gatherer.gathered)
+        << "No input of " << name() << " is read along loop " << k.name() << ", which thus cannot skip empty tiles\n";
+    return *this;
+}
+
 Func &Func::late_fuse(Func f, Var var) {
     invalidate_cache();
 
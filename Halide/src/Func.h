@@ -2858,6 +2858,62 @@ public:
 
     /* Set the minimum depth of the output channel. This interface works only if this Func writes its output to a channel. */
    void min_depth(int min_depth) { func.min_depth(min_depth); }
+
+    /** Allow the buffer of this Func, when it lives in device DRAM, to be split into up to the given number of
+     * device allocations. The runtime splits a buffer larger than a single allocation can be (2^32 - 1 bytes)
+     * into parts of a power-of-2 size, and the kernels accessing the buffer take every part as a separate
+     * argument, selecting the part by the high bits of the index. A buffer over 2^31 bytes needs the
+     * large_buffers target feature. Only the AOT OpenCL flow supports it.
+     */
+    Func &split_storage(int parts);
+
+    /** Coalesce the accesses of the device kernels to the buffer of this Func, when it lives in device DRAM, into
+     * bursts of the given bits, e.g. 512 bits for the memory interface of most boards. A kernel that loads (stores)
+     * a vector from (to) consecutive addresses in consecutive iterations of its innermost loop instead loads (stores)
+     * one wide word every few iterations, and hands the vectors over to (from) the rest of the loop from a register
+     * buffer. The vector width of the channels, and thus the compute design, is not changed. 0 disables coalescing.
+     * If the storage of the Func is split (See split_storage), a burst is made no wider than its start is known to
+     * be aligned, so that it stays within a part of the buffer.
+     */
+    Func &burst(int bits = 512);
+
+    /** Relay the output of this device Func to its consumer on the device through an on-chip buffer. The kernel of
+     * this Func stores its output into the buffer, in the order it produces the output, and sends the buffered output
+     * in the order the consumer reads it. The consumer may thus traverse the output in a different order and layout
+     * than it is produced, e.g. the next layer of a network reading the output of this layer without a round trip
+     * through DRAM. If the outermost loops of this Func and of the consumer iterate alike, and every iteration of them
+     * produces the tile of the output that the consumer reads in the same iteration, the output is sent tile by tile
+     * through a double buffer, and the consumer starts after the first tile. Otherwise, the whole output is stored
+     * before it is sent. The buffer must fit on chip, and the bounds of a tile must be constant.
+     */
+    Func &relay();
+
+    /** Iterate the reduction loop k of these UREs only over the non-empty tiles of a block-sparse input. Iteration k
+     * reads the inputs of the UREs at tile \p tile, instead of tile k, where \p tile is usually a call to an index of
+     * the non-empty tiles, built on the host by nonzero_tiles(), and is clamped into [0, \p tiles). The bounds of k are
+     * thus the slots of the index, not the tiles of the inputs, and a slot past the non-empty tiles of a row refers to
+     * an empty tile, which adds nothing to the reduction. Call it on the UREs after merge_ures(), and before isolating
+     * the inputs: the index is then read by the host serializers only, which send only the non-empty tiles, and the
+     * loaders, feeders and the systolic array take time and bandwidth in proportion to the non-empty tiles.
+     */
+    Func &sparse(Var k, Expr tile, Expr tiles);
+
+    /** Pipelining directives of loop \p loop of this device Func, which the offline compiler of an FPGA takes as
+     * hints, emitted as loop pragmas in OpenCL, or as loop attributes in oneAPI. If the loop is flattened with other
+     * loops, the directives apply to the flattened loop. */
+    // @{
+    /** Launch an iteration every \p ii cycles. A warning is given if a recurrence through a shift register in the
+     * loop takes more floating-point operations than \p ii cycles can complete. */
+    Func &ii(VarOrRVar loop, int ii);
+    /** Launch at most \p iterations iterations before the exit condition of the loop is known. 0 disables
+     * speculation, which saves the area of a loop with an expensive exit condition. */
+    Func &speculated_iterations(VarOrRVar loop, int iterations);
+    /** Coalesce the loop with its inner loops into a single loop, \p levels levels deep counting the loop itself. */
+    Func &loop_coalesce(VarOrRVar loop, int levels);
+    /** Keep at most \p concurrency iterations of the loop in flight, e.g. 1 to serialize a feeder or a drainer
+     * whose private memory would otherwise be replicated for every concurrent iteration. 0 means unlimited. */
+    Func &max_concurrency(VarOrRVar loop, int concurrency);
+    // @}
 };
 
 namespace Internal {
@@ -98,6 +98,18 @@ struct FunctionContents {
     // This value is 0 by default.
     int min_depth;
 
+    // The number of device allocations the buffer of this function may be split into, each addressed by a separate
+    // kernel argument. The buffer is split only if it is too big for a single allocation. 1 by default.
+    int storage_parts = 1;
+
+    // The width in bits of the bursts into which the device kernels coalesce their accesses to the buffer of this
+    // function. 0 by default, i.e. no coalescing.
+    int burst_bits = 0;
+
+    // The output of this function is relayed to its consumer on the device through an on-chip buffer, which lets
+    // the consumer read the output in another order. False by default.
+    bool relay = false;
+
     // Function-specific schedule. This schedule is applied to all stages
     // within the function.
     FuncSchedule func_schedule;
@@ -433,6 +445,9 @@ void Function::deep_copy(FunctionPtr copy, DeepCopyMap &copied_map) const {
     copy->isolated_operands_as_producer = contents->isolated_operands_as_producer;
     copy->isolated_from_as_consumer = contents->isolated_from_as_consumer;
     copy->min_depth = contents->min_depth;
+    copy->storage_parts = contents->storage_parts;
+    copy->burst_bits = contents->burst_bits;
+    copy->relay = contents->relay;
     copy->output_types = contents->output_types;
     copy->decl_args = contents->decl_args;
     copy->debug_file = contents->debug_file;
@@ -925,6 +940,30 @@ int Function::min_depth() const {
     return contents->min_depth;
 }
 
+void Function::storage_parts(int parts) {
+    contents->storage_parts = parts;
+}
+
+int Function::storage_parts() const {
+    return contents->storage_parts;
+}
+
+void Function::burst_bits(int bits) {
+    contents->burst_bits = bits;
+}
+
+int Function::burst_bits() const {
+    return contents->burst_bits;
+}
+
+void Function::relay(bool relay) {
+    contents->relay = relay;
+}
+
+bool Function::relay() const {
+    return contents->relay;
+}
+
 int Function::dimensions() const {
     return args().size();
 }
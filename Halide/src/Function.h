@@ -423,6 +423,24 @@ public:
    /* Get the minimum depth of the output channel. Meaningful only if this function writes its output to a channel. */
    int min_depth() const;
 
+   /* Set the max number of device allocations the buffer of this function may be split into. */
+   void storage_parts(int parts);
+
+   /* Get the max number of device allocations the buffer of this function may be split into. 1 by default. */
+   int storage_parts() const;
+
+   /* Set the width in bits of the bursts into which the device kernels coalesce their accesses to the buffer of this function. */
+   void burst_bits(int bits);
+
+   /* Get the width in bits of the bursts into which the device kernels coalesce their accesses to the buffer of this function. 0 by default. */
+   int burst_bits() const;
+
+   /* Set if the output of this function is relayed to its consumer on the device through an on-chip buffer. */
+   void relay(bool relay);
+
+   /* Get if the output of this function is relayed to its consumer on the device through an on-chip buffer. False by default. */
+   bool relay() const;
+
 };
 
 /** Deep copy an entire Function DAG. */
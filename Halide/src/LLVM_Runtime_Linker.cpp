@@ -147,6 +147,7 @@ DECLARE_CPP_INITMOD(qurt_threads_tsan)
 DECLARE_CPP_INITMOD(qurt_yield)
 DECLARE_CPP_INITMOD(runtime_api)
 DECLARE_CPP_INITMOD(ssp)
+DECLARE_CPP_INITMOD(t2s_channels)
 DECLARE_CPP_INITMOD(to_string)
 DECLARE_CPP_INITMOD(trace_helper)
 DECLARE_CPP_INITMOD(tracing)
@@ -1047,6 +1048,9 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 user_assert(t.os != Target::WebAssemblyRuntime) << "The profiler cannot be used in a threadless environment.";
                 modules.push_back(get_initmod_profiler_inlined(c, bits_64, debug));
             }
+            if (t.has_feature(Target::SpatialOnCPU)) {
+                modules.push_back(get_initmod_t2s_channels(c, bits_64, debug));
+            }
             if (t.arch == Target::WebAssembly) {
                 modules.push_back(get_initmod_wasm_math_ll(c));
             }
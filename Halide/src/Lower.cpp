@@ -73,6 +73,9 @@
 
 // T2S related
 #include "../../t2s/src/AutorunKernels.h"
+#include "../../t2s/src/BurstAccess.h"
+#include "../../t2s/src/ChannelCheck.h"
+#include "../../t2s/src/ChannelDepth.h"
 #include "../../t2s/src/ChannelPromotion.h"
 #include "../../t2s/src/CheckRecursiveCalls.h"
 #include "../../t2s/src/ComputeLoopBounds.h"
@@ -82,15 +85,22 @@
 #include "../../t2s/src/FlattenLoops.h"
 #include "../../t2s/src/Gather.h"
 #include "../../t2s/src/LateFuse.h"
+#include "../../t2s/src/LoopPipelining.h"
 #include "../../t2s/src/LoopRemoval.h"
+#include "../../t2s/src/LowPrecision.h"
+#include "../../t2s/src/LoweringProfiler.h"
 #include "../../t2s/src/MemorySchedule.h"
 #include "../../t2s/src/MinimizeShregs.h"
 #include "../../t2s/src/NoIfSimplify.h"
 #include "../../t2s/src/Overlay.h"
 #include "../../t2s/src/PatternMatcher.h"
 #include "../../t2s/src/Place.h"
+#include "../../t2s/src/RelayStreams.h"
+#include "../../t2s/src/ResourceEstimate.h"
 #include "../../t2s/src/ScatterAndBuffer.h"
 #include "../../t2s/src/SpaceTimeTransform.h"
+#include "../../t2s/src/SpatialOnCPU.h"
+#include "../../t2s/src/SplitStorage.h"
 #include "../../t2s/src/ScatterAndBuffer.h"
 
 namespace Halide {
@@ -109,6 +119,9 @@ Module lower(const vector<Function> &output_funcs,
              const vector<Stmt> &requirements,
              bool trace_pipeline,
              const vector<IRMutator *> &custom_passes) {
+    // Profile the passes if HL_LOWER_PROFILE is set.
+    LoweringProfiler profiler(pipeline_name);
+
     std::vector<std::string> namespaces;
     std::string simple_pipeline_name = extract_namespaces(pipeline_name, namespaces);
     Module result_module(simple_pipeline_name, t);
@@ -150,6 +163,7 @@ Module lower(const vector<Function> &output_funcs,
     simplify_specializations(env);
 
     debug(1) << "Creating initial loop nests...\n";
+    profiler.start_pass("Creating initial loop nests");
     bool any_memoized = false;
     Stmt s = schedule_functions(outputs, fused_groups, env, t, any_memoized);
     debug(2) << "Lowering after creating initial loop nests:\n"
@@ -159,16 +173,19 @@ Module lower(const vector<Function> &output_funcs,
     LoopBounds global_bounds = compute_global_loop_bounds(s);
 
     debug(1) << "Applying space time transformation...\n";
+    profiler.start_pass("Applying space time transformation", s);
     std::map<std::string, RegBound > reg_size_map;
     s = apply_space_time_transform(s, env, t, reg_size_map);
     debug(2) << "Lowering after applying space time transformation:\n" << s << "\n\n";
 
     debug(1) << "Fixing calls' args that correspond to loops marked as removed ...\n";
+    profiler.start_pass("Fixing calls' args that correspond to loops marked as removed", s);
     s = fix_call_args_for_removed_loops(s, env);
     debug(2) << "Lowering after fixing calls' args that correspond to loops marked as removed:\n" << s << "\n\n";
 
     if (any_memoized) {
         debug(1) << "Injecting memoization...\n";
+        profiler.start_pass("Injecting memoization", s);
         s = inject_memoization(s, env, pipeline_name, outputs);
         debug(2) << "Lowering after injecting memoization:\n"
                  << s << '\n';
@@ -177,14 +194,17 @@ Module lower(const vector<Function> &output_funcs,
     }
 
     debug(1) << "Injecting tracing...\n";
+    profiler.start_pass("Injecting tracing", s);
     s = inject_tracing(s, pipeline_name, trace_pipeline, env, outputs, t);
     debug(2) << "Lowering after injecting tracing:\n"
              << s << '\n';
 
     debug(1) << "Adding checks for recursice calls\n";
+    profiler.start_pass("Adding checks for recursice calls", s);
     check_recursive_calls(env);
 
     debug(1) << "Adding checks for parameters\n";
+    profiler.start_pass("Adding checks for parameters", s);
     s = add_parameter_checks(requirements, s, t);
     debug(2) << "Lowering after injecting parameter checks:\n"
              << s << '\n';
@@ -192,11 +212,13 @@ Module lower(const vector<Function> &output_funcs,
     // Compute the maximum and minimum possible value of each
     // function. Used in later bounds inference passes.
     debug(1) << "Computing bounds of each function's value\n";
+    profiler.start_pass("Computing bounds of each function's value", s);
     FuncValueBounds func_bounds = compute_function_value_bounds(order, env);
 
     // The checks will be in terms of the symbols defined by bounds
     // inference.
     debug(1) << "Adding checks for images\n";
+    profiler.start_pass("Adding checks for images", s);
     s = add_image_checks(s, outputs, t, order, env, func_bounds);
     debug(2) << "Lowering after injecting image checks:\n"
              << s << '\n';
@@ -205,6 +227,7 @@ Module lower(const vector<Function> &output_funcs,
     // can't simplify statements from here until we fix them up. (We
     // can still simplify Exprs).
     debug(1) << "Performing computation bounds inference...\n";
+    profiler.start_pass("Performing computation bounds inference", s);
     s = bounds_inference(s, outputs, order, fused_groups, env, func_bounds, t);
     debug(2) << "Lowering after computation bounds inference:\n"
              << s << '\n';
@@ -213,74 +236,103 @@ Module lower(const vector<Function> &output_funcs,
     // after this point. This lets later passes assume syntactic
     // equivalence means semantic equivalence.
     debug(1) << "Uniquifying variable names...\n";
+    profiler.start_pass("Uniquifying variable names", s);
     s = uniquify_variable_names(s);
     debug(2) << "Lowering after uniquifying variable names:\n"
              << s << "\n\n";
 
     debug(1) << "Partitioning loops to simplify boundary conditions...\n";
+    profiler.start_pass("Partitioning loops to simplify boundary conditions", s);
     s = partition_loops(s);
     debug(2) << "Lowering after partitioning loops :\n"
              << s << "\n\n";
 
     debug(1) << "Simplifying IfThenElse but keeping unit loops...\n";
+    profiler.start_pass("Simplifying IfThenElse but keeping unit loops", s);
     s = no_if_simplify(s, true);
     debug(2) << "Lowering after simplifying IfThenElse but keeping unit loops:\n" << s << "\n\n";
 
     debug(1) << "Removing extern loops...\n";
+    profiler.start_pass("Removing extern loops", s);
     s = remove_extern_loops(s);
     debug(2) << "Lowering after removing extern loops:\n"
              << s << '\n';
 
     debug(1) << "Performing sliding window optimization...\n";
+    profiler.start_pass("Performing sliding window optimization", s);
     s = sliding_window(s, env);
     debug(2) << "Lowering after sliding window:\n"
              << s << '\n';
 
     debug(1) << "Simplifying correlated differences...\n";
+    profiler.start_pass("Simplifying correlated differences", s);
     s = simplify_correlated_differences(s);
     debug(2) << "Lowering after simplifying correlated differences:\n"
              << s << '\n';
 
     debug(1) << "Performing allocation bounds inference...\n";
+    profiler.start_pass("Performing allocation bounds inference", s);
     s = allocation_bounds_inference(s, env, func_bounds);
     debug(2) << "Lowering after allocation bounds inference:\n"
              << s << '\n';
 
     debug(1) << "Removing code that depends on undef values...\n";
+    profiler.start_pass("Removing code that depends on undef values", s);
     s = remove_undef(s);
     debug(2) << "Lowering after removing code that depends on undef values:\n"
              << s << "\n\n";
 
     debug(1) << "Placing device functions...\n";
+    profiler.start_pass("Placing device functions", s);
     s = place_device_functions(s, env, t);
     debug(2) << "Lowering after placing device functions:\n" << s << "\n\n";
 
+    debug(1) << "Relaying streams through on-chip buffers...\n";
+    profiler.start_pass("Relaying streams through on-chip buffers", s);
+    s = relay_streams(s, env);
+    debug(2) << "Lowering after relaying streams through on-chip buffers:\n" << s << "\n\n";
+
     debug(1) << "Replacing references with channels and shift registers...\n";
+    profiler.start_pass("Replacing references with channels and shift registers", s);
     s = replace_references_with_channels(s, env, global_bounds);
     s = replace_references_with_shift_registers(s, env, reg_size_map);
     debug(2) << "Lowering after replacing references with channels and shift registers:\n" << s << "\n\n";
 
+    debug(1) << "Inferring channel depths...\n";
+    profiler.start_pass("Inferring channel depths", s);
+    s = infer_channel_depths(s, env);
+    debug(2) << "Lowering after inferring channel depths:\n" << s << "\n\n";
+
     debug(1) << "Simplifying IfThenElse without keeping unit loops...\n";
+    profiler.start_pass("Simplifying IfThenElse without keeping unit loops", s);
     s = no_if_simplify(s, false);
     debug(2) << "Lowering after simplifying IfThenElse without keeping unit loops:\n" << s << "\n\n";
 
-    if (t.has_feature(Target::IntelFPGA)) {
+    // When a spatial design runs on the CPU, keep its shift registers, channels and loops as they are, and skip
+    // the optimizations that are specific to the FPGA hardware.
+    bool fpga_hardware = t.has_feature(Target::IntelFPGA) && !t.has_feature(Target::SpatialOnCPU);
+
+    if (fpga_hardware) {
         debug(1) << "Minimizing shift registers...\n";
+        profiler.start_pass("Minimizing shift registers", s);
         s = minimize_shift_registers(s, env);
         debug(2) << "Lowering after minimizing shift registers:\n" << s << "\n\n";
     }
 
     debug(1) << "Performing storage folding optimization...\n";
+    profiler.start_pass("Performing storage folding optimization", s);
     s = storage_folding(s, env);
     debug(2) << "Lowering after storage folding:\n"
              << s << '\n';
 
     debug(1) << "Injecting debug_to_file calls...\n";
+    profiler.start_pass("Injecting debug_to_file calls", s);
     s = debug_to_file(s, outputs, env);
     debug(2) << "Lowering after injecting debug_to_file calls:\n"
              << s << '\n';
 
     debug(1) << "Injecting prefetches...\n";
+    profiler.start_pass("Injecting prefetches", s);
     s = inject_prefetch(s, env);
     debug(2) << "Lowering after injecting prefetches:\n"
              << s << "\n\n";
@@ -292,6 +344,7 @@ Module lower(const vector<Function> &output_funcs,
 
     if (!t.features_any_of({ Target::IntelFPGA, Target::IntelGPU })) {
         debug(1) << "Forking asynchronous producers...\n";
+        profiler.start_pass("Forking asynchronous producers", s);
         s = fork_async_producers(s, env);
         debug(2) << "Lowering after forking asynchronous producers:\n"
                  << s << '\n';
@@ -300,6 +353,7 @@ Module lower(const vector<Function> &output_funcs,
     }
 
     debug(1) << "Destructuring tuple-valued realizations...\n";
+    profiler.start_pass("Destructuring tuple-valued realizations", s);
     s = split_tuples(s, env);
     debug(2) << "Lowering after destructuring tuple-valued realizations:\n"
              << s << "\n\n";
@@ -310,39 +364,46 @@ Module lower(const vector<Function> &output_funcs,
         t.has_feature(Target::OpenGLCompute) ||
         t.has_feature(Target::OpenGL)) {
         debug(1) << "Canonicalizing GPU var names...\n";
+        profiler.start_pass("Canonicalizing GPU var names", s);
         s = canonicalize_gpu_vars(s);
         debug(2) << "Lowering after canonicalizing GPU var names:\n"
                  << s << '\n';
     }
 
     debug(1) << "Late fuse...\n";
+    profiler.start_pass("Late fuse", s);
     s = do_late_fuse(s, env);
     debug(2) << "Lowering after late fuse:\n"
              << s << "\n\n";
 
     debug(1) << "Performing storage flattening...\n";
+    profiler.start_pass("Performing storage flattening", s);
     s = storage_flattening(s, outputs, env, t);
     debug(2) << "Lowering after storage flattening:\n"
              << s << "\n\n";
 
     if (t.has_feature(Target::IntelGPU)) {
         debug(1) << "Applying memory schedule...\n";
+        profiler.start_pass("Applying memory schedule", s);
         s = do_memory_schedule(s, env);
         debug(2) << "Lowering after memory schedule:\n" << s << "\n\n";
     }
 
     debug(1) << "Adding atomic mutex allocation...\n";
+    profiler.start_pass("Adding atomic mutex allocation", s);
     s = add_atomic_mutex(s, env);
     debug(2) << "Lowering after adding atomic mutex allocation:\n"
              << s << "\n\n";
 
     debug(1) << "Unpacking buffer arguments...\n";
+    profiler.start_pass("Unpacking buffer arguments", s);
     s = unpack_buffers(s);
     debug(2) << "Lowering after unpacking buffer arguments...\n"
              << s << "\n\n";
 
     if (any_memoized) {
         debug(1) << "Rewriting memoized allocations...\n";
+        profiler.start_pass("Rewriting memoized allocations", s);
         s = rewrite_memoized_allocations(s, env);
         debug(2) << "Lowering after rewriting memoized allocations:\n"
                  << s << "\n\n";
@@ -356,16 +417,19 @@ Module lower(const vector<Function> &output_funcs,
         t.has_feature(Target::HexagonDma) ||
         (t.arch != Target::Hexagon && (t.features_any_of({Target::HVX_64, Target::HVX_128})))) {
         debug(1) << "Selecting a GPU API for GPU loops...\n";
+        profiler.start_pass("Selecting a GPU API for GPU loops", s);
         s = select_gpu_api(s, t);
         debug(2) << "Lowering after selecting a GPU API:\n"
                  << s << "\n\n";
 
         debug(1) << "Injecting host <-> dev buffer copies...\n";
+        profiler.start_pass("Injecting host <-> dev buffer copies", s);
         s = inject_host_dev_buffer_copies(s, t, env);
         debug(2) << "Lowering after injecting host <-> dev buffer copies:\n"
                  << s << "\n\n";
 
         debug(1) << "Selecting a GPU API for extern stages...\n";
+        profiler.start_pass("Selecting a GPU API for extern stages", s);
         s = select_gpu_api(s, t);
         debug(2) << "Lowering after selecting a GPU API for extern stages:\n"
                  << s << "\n\n";
@@ -373,48 +437,56 @@ Module lower(const vector<Function> &output_funcs,
         // Always mark buffers host dirty. Buffers will otherwise not be correctly copied for
         // other pipelines with device feature enabled.
         debug(1) << "Injecting host <-> dev buffer copies...\n";
+        profiler.start_pass("Injecting host <-> dev buffer copies", s);
         s = inject_host_dev_buffer_copies(s, t, env);
         debug(2) << "Lowering after injecting host <-> dev buffer copies:\n"
                     << s << "\n\n";
     }
 
     map<string, Place> funcs_using_mem_channels;
-    if (t.has_feature(Target::IntelFPGA)) {
+    if (fpga_hardware) {
         debug(1) << "Replacing references with mem channels...\n";
+        profiler.start_pass("Replacing references with mem channels", s);
         s = replace_references_with_mem_channels(s, env, funcs_using_mem_channels);
         debug(2) << "Lowering after replacing references with mem channels:\n" << s << "\n\n";
     }
 
     if (t.has_feature(Target::OpenGL)) {
         debug(1) << "Injecting OpenGL texture intrinsics...\n";
+        profiler.start_pass("Injecting OpenGL texture intrinsics", s);
         s = inject_opengl_intrinsics(s);
         debug(2) << "Lowering after OpenGL intrinsics:\n"
                  << s << "\n\n";
     }
 
     debug(1) << "Second simplification...\n";
+    profiler.start_pass("Second simplification", s);
     s = simplify(s);
     s = unify_duplicate_lets(s);
     debug(2) << "Lowering after second simplifcation:\n"
              << s << "\n\n";
 
     debug(1) << "Reduce prefetch dimension...\n";
+    profiler.start_pass("Reduce prefetch dimension", s);
     s = reduce_prefetch_dimension(s, t);
     debug(2) << "Lowering after reduce prefetch dimension:\n"
              << s << "\n";
 
     debug(1) << "Simplifying correlated differences...\n";
+    profiler.start_pass("Simplifying correlated differences", s);
     s = simplify_correlated_differences(s);
     debug(2) << "Lowering after simplifying correlated differences:\n"
              << s << '\n';
 
     if (t.has_feature(Target::IntelFPGA)) {
         debug(1) << "Devectorize unsuitable loops...\n";
+        profiler.start_pass("Devectorize unsuitable loops", s);
         s = devectorize(s);
         debug(2) << "Lowering after devectorizing unsuitable loops:\n" << s << "\n\n";
     }
 
     debug(1) << "Vectorizing...\n";
+    profiler.start_pass("Vectorizing", s);
     s = vectorize_loops(s, t);
     debug(2) << "Lowering after vectorizing:\n"
              << s << "\n\n";
@@ -422,16 +494,21 @@ Module lower(const vector<Function> &output_funcs,
     debug(2) << "Lowering after simplify after vectorizing:\n"
              << s << "\n\n";
 
-    debug(1) << "Combining channels ...\n";
-    s = combine_channels(s);
-    debug(2) << "Lowering after combining channels:\n" << s << "\n\n";
+    if (!t.has_feature(Target::SpatialOnCPU)) {
+        debug(1) << "Combining channels ...\n";
+        profiler.start_pass("Combining channels", s);
+        s = combine_channels(s);
+        debug(2) << "Lowering after combining channels:\n" << s << "\n\n";
+    }
 
     debug(1) << "Trimming loops to the region over which they do something...\n";
+    profiler.start_pass("Trimming loops to the region over which they do something", s);
     s = trim_no_ops(s);
     debug(2) << "Lowering after loop trimming:\n"
              << s << "\n\n";
 
     debug(1) << "Remove Lets and LetStmts in funcs with buffering or scattering...\n";
+    profiler.start_pass("Remove Lets and LetStmts in funcs with buffering or scattering", s);
     {
         std::set<string> funcs;
         for(auto entry : env){
@@ -446,16 +523,19 @@ Module lower(const vector<Function> &output_funcs,
     debug(2) << "Lowering after removing Lets and LetStmts in funcs with buffering or scattering:\n" << s <<"\n\n";
 
     debug(1) << "Scattering and buffering...\n";
+    profiler.start_pass("Scattering and buffering", s);
     s = simplify(scatter_buffer(s,env));
     debug(2) << "Lowering after Scattering and buffering:\n"
              << s << "\n\n";
 
     debug(1) << "Gathering...\n";
+    profiler.start_pass("Gathering", s);
     s = simplify(gather_data(s, env));
     debug(2) << "Lowering after Gathering:\n"
              << s << "\n\n";
 
     debug(1) << "Unrolling...\n";
+    profiler.start_pass("Unrolling", s);
     s = unroll_loops(s, env);
     s = simplify(s);
     debug(2) << "Lowering after unrolling:\n"
@@ -464,6 +544,7 @@ Module lower(const vector<Function> &output_funcs,
     if (t.has_gpu_feature() ||
         t.has_feature(Target::OpenGLCompute)) {
         debug(1) << "Injecting per-block gpu synchronization...\n";
+        profiler.start_pass("Injecting per-block gpu synchronization", s);
         s = fuse_gpu_thread_loops(s);
         debug(2) << "Lowering after injecting per-block gpu synchronization:\n"
                  << s << "\n\n";
@@ -477,6 +558,7 @@ Module lower(const vector<Function> &output_funcs,
 
 
     debug(1) << "Partitioning loops to simplify boundary conditions...\n";
+    profiler.start_pass("Partitioning loops to simplify boundary conditions", s);
     s = partition_loops(s);
     s = simplify(s);
     debug(2) << "Lowering after partitioning loops:\n"
@@ -484,6 +566,7 @@ Module lower(const vector<Function> &output_funcs,
 
     if (!t.has_feature(Target::IntelFPGA)) {
         debug(1) << "Injecting early frees...\n";
+        profiler.start_pass("Injecting early frees", s);
         s = inject_early_frees(s);
         debug(2) << "Lowering after injecting early frees:\n"
                  << s << "\n\n";
@@ -494,23 +577,27 @@ Module lower(const vector<Function> &output_funcs,
 
     if (t.has_feature(Target::FuzzFloatStores)) {
         debug(1) << "Fuzzing floating point stores...\n";
+        profiler.start_pass("Fuzzing floating point stores", s);
         s = fuzz_float_stores(s);
         debug(2) << "Lowering after fuzzing floating point stores:\n"
                  << s << "\n\n";
     }
 
     debug(1) << "Simplifying correlated differences...\n";
+    profiler.start_pass("Simplifying correlated differences", s);
     s = simplify_correlated_differences(s);
     debug(2) << "Lowering after simplifying correlated differences:\n"
              << s << '\n';
 
     debug(1) << "Bounding small allocations...\n";
+    profiler.start_pass("Bounding small allocations", s);
     s = bound_small_allocations(s);
     debug(2) << "Lowering after bounding small allocations:\n"
              << s << "\n\n";
 
     if (t.has_feature(Target::Profile)) {
         debug(1) << "Injecting profiling...\n";
+        profiler.start_pass("Injecting profiling", s);
         s = inject_profiling(s, pipeline_name);
         debug(2) << "Lowering after injecting profiling:\n"
                  << s << "\n\n";
@@ -518,44 +605,52 @@ Module lower(const vector<Function> &output_funcs,
 
     if (t.has_feature(Target::CUDA)) {
         debug(1) << "Injecting warp shuffles...\n";
+        profiler.start_pass("Injecting warp shuffles", s);
         s = lower_warp_shuffles(s);
         debug(2) << "Lowering after injecting warp shuffles:\n"
                  << s << "\n\n";
     }
     debug(1) << "CSE...\n";
+    profiler.start_pass("CSE", s);
     s = common_subexpression_elimination(s);
     debug(2) << "Lowering after CSE:\n"
              << s << "\n\n";
 
     debug(1) << "Matching compute patterns...\n";
+    profiler.start_pass("Matching compute patterns", s);
     s = match_patterns(s);
     debug(2) << "Lowering after matching patterns:\n"
              << s <<"\n\n";
 
     if (t.has_feature(Target::OpenGL)) {
         debug(1) << "Detecting varying attributes...\n";
+        profiler.start_pass("Detecting varying attributes", s);
         s = find_linear_expressions(s);
         debug(2) << "Lowering after detecting varying attributes:\n"
                  << s << "\n\n";
 
         debug(1) << "Moving varying attribute expressions out of the shader...\n";
+        profiler.start_pass("Moving varying attribute expressions out of the shader", s);
         s = setup_gpu_vertex_buffer(s);
         debug(2) << "Lowering after removing varying attributes:\n"
                  << s << "\n\n";
     }
 
-    if (t.has_feature(Target::IntelFPGA)) {
+    if (fpga_hardware) {
         debug(1) << "Inserting FPGA register calls\n";
+        profiler.start_pass("Inserting FPGA register calls", s);
         s = insert_fpga_reg(s, env);
         debug(2) << "Lowering after inserting FPGA register calls:\n"
                  << s << "\n\n";
     }
 
     debug(1) << "Lowering unsafe promises...\n";
+    profiler.start_pass("Lowering unsafe promises", s);
     s = lower_unsafe_promises(s, t);
     debug(2) << "Lowering after lowering unsafe promises:\n"
              << s << "\n\n";
 
+    profiler.start_pass("Final simplification", s);
     s = remove_dead_allocations(s);
     s = simplify(s);
     // we don't need this for code generation
@@ -563,38 +658,95 @@ Module lower(const vector<Function> &output_funcs,
     debug(1) << "Lowering after final simplification:\n"
              << s << "\n\n";
 
+    if (fpga_hardware) {
+        debug(1) << "Lowering low-precision arithmetic...\n";
+        profiler.start_pass("Lowering low-precision arithmetic", s);
+        s = lower_low_precision(s, t);
+        debug(2) << "Lowering after lowering low-precision arithmetic:\n"
+                 << s << "\n\n";
+    }
+
+    if (fpga_hardware && !t.has_feature(Target::OneAPI)) {
+        debug(1) << "Coalescing DRAM accesses into bursts...\n";
+        profiler.start_pass("Coalescing DRAM accesses into bursts", s);
+        s = coalesce_bursts(s, env);
+        debug(2) << "Lowering after coalescing DRAM accesses into bursts:\n"
+                 << s << "\n\n";
+    }
+
     debug(1) << "Replace memory channel with references...\n";
+    profiler.start_pass("Replace memory channel with references", s);
     s = replace_mem_channels(s, env, funcs_using_mem_channels);
     debug(2) << "Lowering after replacing memory channels:\n"
              << s << "\n\n";
 
-    debug(1) << "Promoting channels...\n";
-    s = channel_promotion(s);
-    debug(2) << "Lowering after channel promotion:\n"
-             << s << "\n\n";
+    if (!t.has_feature(Target::SpatialOnCPU)) {
+        debug(1) << "Promoting channels...\n";
+        profiler.start_pass("Promoting channels", s);
+        s = channel_promotion(s);
+        debug(2) << "Lowering after channel promotion:\n"
+                 << s << "\n\n";
+    }
+
+    if (t.has_feature(Target::IntelFPGA)) {
+        debug(1) << "Checking channels for deadlocks...\n";
+        profiler.start_pass("Checking channels for deadlocks", s);
+        check_channels(s);
+    }
+
+    if (fpga_hardware) {
+        debug(1) << "Estimating resources...\n";
+        profiler.start_pass("Estimating resources", s);
+        estimate_resources(s, env);
+    }
 
     // For overlay, we don't need to flatten task loops.
     char *overlay_num = getenv("HL_OVERLAY_NUM");
-    if (t.has_feature(Target::IntelFPGA) && overlay_num == NULL) {
+    if (fpga_hardware && overlay_num == NULL) {
         debug(1) << "Flatten the loops...\n";
+        profiler.start_pass("Flatten the loops", s);
         s = simplify(flatten_loops(s, env));
         debug(2) << "Lowering after loop flattening:\n" << s << "\n\n";
     }
 
     if (getenv("DISABLE_AUTORUN") == NULL) {
-        if (t.has_feature(Target::IntelFPGA)) {
+        if (fpga_hardware) {
             debug(1) << "Making device funcs as autorun ...\n";
+            profiler.start_pass("Making device funcs as autorun", s);
             s = autorun_kernels(s, env);
             debug(2) << "Lowering after making device funcs as autorun:\n" << s << "\n\n";
         }
     }
 
+    if (fpga_hardware) {
+        debug(1) << "Annotating loops with pipelining directives...\n";
+        profiler.start_pass("Annotating loops with pipelining directives", s);
+        s = annotate_loop_pipelining(s, env);
+        debug(2) << "Lowering after annotating loops with pipelining directives:\n" << s << "\n\n";
+    }
+
+    if (fpga_hardware && !t.has_feature(Target::OneAPI)) {
+        debug(1) << "Addressing split storage...\n";
+        profiler.start_pass("Addressing split storage", s);
+        s = split_storage(s, env);
+        debug(2) << "Lowering after addressing split storage:\n" << s << "\n\n";
+    }
+
     debug(1) << "Creating overlay scheduler...\n";
+    profiler.start_pass("Creating overlay scheduler", s);
     s = simplify(create_overlay_schedule(s, env));
     debug(2) << "Lowering after creating overlay scheduler:\n" << s << "\n\n";
 
+    if (t.has_feature(Target::SpatialOnCPU)) {
+        debug(1) << "Lowering the spatial design for the CPU...\n";
+        profiler.start_pass("Lowering the spatial design for the CPU", s);
+        s = simplify(lower_spatial_design_on_cpu(s));
+        debug(2) << "Lowering after lowering the spatial design for the CPU:\n" << s << "\n\n";
+    }
+
     if (t.arch != Target::Hexagon && (t.features_any_of({Target::HVX_64, Target::HVX_128}))) {
         debug(1) << "Splitting off Hexagon offload...\n";
+        profiler.start_pass("Splitting off Hexagon offload", s);
         s = inject_hexagon_rpc(s, t, result_module);
         debug(2) << "Lowering after splitting off Hexagon offload:\n"
                  << s << '\n';
@@ -606,12 +758,15 @@ Module lower(const vector<Function> &output_funcs,
     if (!custom_passes.empty()) {
         for (size_t i = 0; i < custom_passes.size(); i++) {
             debug(1) << "Running custom lowering pass " << i << "...\n";
+            profiler.start_pass("Running custom lowering pass " + std::to_string(i), s);
             s = custom_passes[i]->mutate(s);
             debug(1) << "Lowering after custom pass " << i << ":\n"
                      << s << "\n\n";
         }
     }
 
+    profiler.finish(s);
+
     vector<Argument> public_args = args;
     for (const auto &out : outputs) {
         for (Parameter buf : out.output_buffers()) {
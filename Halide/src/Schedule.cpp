@@ -289,6 +289,7 @@ struct StageScheduleContents {
     std::vector<ScatterItem> scatter_params;
     std::vector<GatherItem> gather_params;
     std::vector<BufferItem> buffer_params;
+    std::vector<PipelineItem> pipeline_params;
     std::vector<CmdQueueItem> cmd_params;
     std::vector<std::string> remove_params;
     StoreParams store_params;
@@ -525,6 +526,7 @@ StageSchedule StageSchedule::get_copy() const {
     copy.contents->store_params = contents->store_params;
     copy.contents->scatter_params = contents->scatter_params;
     copy.contents->buffer_params = contents->buffer_params; 
+    copy.contents->pipeline_params = contents->pipeline_params;
     copy.contents->gather_params = contents->gather_params; 
     copy.contents->remove_params = contents->remove_params; 
     copy.contents->cmd_params = contents->cmd_params;
@@ -689,6 +691,14 @@ std::vector<BufferItem> &StageSchedule::buffer_params() {
     return contents->buffer_params;
 }
 
+const std::vector<PipelineItem> &StageSchedule::pipeline_params() const {
+    return contents->pipeline_params;
+}
+
+std::vector<PipelineItem> &StageSchedule::pipeline_params() {
+    return contents->pipeline_params;
+}
+
 const std::vector<CmdQueueItem> &StageSchedule::cmd_params() const {
     return contents->cmd_params;
 }
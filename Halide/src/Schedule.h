@@ -529,6 +529,17 @@ public:
                 func_name(_func_name),loop_name(_loop_name),strategy(_strategy),read_strategy(_read_strategy){}
 };
 
+/** Record the pipelining directives of a loop. A directive that is not specified is -1. */
+class PipelineItem {
+public:
+    std::string loop_name;
+    int ii = -1;                        // Initiation interval
+    int speculated_iterations = -1;     // Iterations launched before the exit condition is known
+    int loop_coalesce = -1;             // Levels of the loop nest to coalesce, counting the loop itself
+    int max_concurrency = -1;           // Iterations in flight at a time
+    PipelineItem(std::string _loop_name) : loop_name(_loop_name) {}
+};
+
 class CmdQueueItem {
 public:
     int queueNo;                           // command queue index
@@ -791,6 +802,14 @@ public:
     std::vector<GatherItem> &gather_params();
     // @}
     
+    /**
+     * pipelining directives of loops
+     */
+    // @{
+    const std::vector<PipelineItem> &pipeline_params() const;
+    std::vector<PipelineItem> &pipeline_params();
+    // @}
+
     /**
      * specifying the command queue
      */
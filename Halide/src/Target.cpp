@@ -373,7 +373,8 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"sve2", Target::SVE2},
     {"intel_fpga", Target::IntelFPGA},
     {"intel_gpu", Target::IntelGPU},
-    {"enable_synthesis", Target::EnableSynthesis}
+    {"enable_synthesis", Target::EnableSynthesis},
+    {"spatial_on_cpu", Target::SpatialOnCPU}
     // NOTE: When adding features to this map, be sure to update
     // PyEnums.cpp and halide.cmake as well.
 };
@@ -691,6 +692,10 @@ void Target::set_feature(Feature f, bool value) {
         // Enabling generating OpenCL OneAPI code for IntelFPGAs w/ CodeGen_OneAPI_Dev.h/.cpp
         // NOTE, the IntelFPGA must be set before the OneAPI is set
         features.set(Target::OpenCL, false);
+    } else if (f == Target::SpatialOnCPU && value) {
+        // Run the device funcs as threads on the host, communicating through channels in host memory.
+        // NOTE, the IntelFPGA must be set before the SpatialOnCPU is set
+        features.set(Target::OpenCL, false);
     }
 }
 
@@ -116,8 +116,72 @@ int unique_count(size_t h) {
     h = h & (num_unique_name_counters - 1);
     return unique_name_counters[h]++;
 }
+
+// The innermost ScopedUniqueNames alive on this thread, if any.
+thread_local ScopedUniqueNames *scoped_unique_names = nullptr;
+
+// A placeholder is the prefix, the marker, and the number in the scope padded to a fixed width. The marker is
+// made of digits, so that the placeholder survives being printed as a C identifier (See c_print_name), and the
+// marker and the number together are longer than any number unique_name(char) returns.
+const char *const placeholder_marker = "999999999";
+const size_t placeholder_marker_size = 9;
+const size_t placeholder_number_size = 9;
 }  // namespace
 
+ScopedUniqueNames::ScopedUniqueNames()
+    : counters(256, 0), enclosing(scoped_unique_names) {
+    scoped_unique_names = this;
+}
+
+ScopedUniqueNames::~ScopedUniqueNames() {
+    internal_assert(scoped_unique_names == this);
+    scoped_unique_names = enclosing;
+}
+
+string ScopedUniqueNames::next(char prefix) {
+    string number = std::to_string(counters[(unsigned char)prefix]++);
+    internal_assert(number.size() <= placeholder_number_size);
+    return prefix + (placeholder_marker + string(placeholder_number_size - number.size(), '0') + number);
+}
+
+string ScopedUniqueNames::renumber(const string &text, const Counters &first) {
+    internal_assert(first.size() == 256);
+    const size_t size = placeholder_marker_size + placeholder_number_size;
+    string result;
+    result.reserve(text.size());
+    size_t copied = 0;
+    size_t pos = text.find(placeholder_marker);
+    while (pos != string::npos) {
+        // A placeholder follows a prefix that is not a digit, and is not followed by a digit.
+        bool is_placeholder = pos > 0 && pos + size <= text.size() && !isdigit(text[pos - 1]) &&
+                              (pos + size == text.size() || !isdigit(text[pos + size]));
+        for (size_t i = pos + placeholder_marker_size; is_placeholder && i < pos + size; i++) {
+            is_placeholder = isdigit(text[i]);
+        }
+        if (!is_placeholder) {
+            pos = text.find(placeholder_marker, pos + 1);
+            continue;
+        }
+        int number = std::atoi(text.substr(pos + placeholder_marker_size, placeholder_number_size).c_str());
+        result.append(text, copied, pos - copied);
+        result += std::to_string(first[(unsigned char)text[pos - 1]] + number);
+        copied = pos + size;
+        pos = text.find(placeholder_marker, copied);
+    }
+    result.append(text, copied, string::npos);
+    return result;
+}
+
+ScopedUniqueNames::Counters reserve_unique_names(const ScopedUniqueNames::Counters &count) {
+    internal_assert(count.size() == 256);
+    // The counter of prefix p is unique_name_counters[p], as in unique_name(char).
+    ScopedUniqueNames::Counters first(256);
+    for (size_t p = 0; p < count.size(); p++) {
+        first[p] = unique_name_counters[p].fetch_add(count[p]);
+    }
+    return first;
+}
+
 // There are three possible families of names returned by the methods below:
 // 1) char pattern: (char that isn't '$') + number (e.g. v234)
 // 2) string pattern: (string without '$') + '$' + number (e.g. fr#nk82$42)
@@ -128,6 +192,9 @@ int unique_count(size_t h) {
 
 string unique_name(char prefix) {
     if (prefix == '$') prefix = '_';
+    if (scoped_unique_names) {
+        return scoped_unique_names->next(prefix);
+    }
     return prefix + std::to_string(unique_count((size_t)(prefix)));
 }
 
@@ -149,6 +149,47 @@ std::string unique_name(char prefix);
 std::string unique_name(const std::string &prefix);
 // @}
 
+/** While an object of this class is alive, unique_name(char) on the
+ * thread that created it returns placeholders, numbered by counters of
+ * its own. Once the numbers that the names should have are known,
+ * e.g. taken from the process-wide counters with
+ * reserve_unique_names(), renumber() replaces the placeholders in the
+ * text generated with the names. This lets independent pieces of
+ * generated code, such as device kernels, be generated concurrently
+ * and still be named as if they were generated one after another. */
+class ScopedUniqueNames {
+public:
+    /** A counter per prefix, indexed by the prefix */
+    typedef std::vector<int> Counters;
+
+private:
+    Counters counters;
+    ScopedUniqueNames *enclosing;
+
+public:
+    ScopedUniqueNames();
+    ~ScopedUniqueNames();
+    ScopedUniqueNames(const ScopedUniqueNames &) = delete;
+    ScopedUniqueNames &operator=(const ScopedUniqueNames &) = delete;
+
+    /** The placeholder of the next name of the prefix. */
+    std::string next(char prefix);
+
+    /** How many names of each prefix have been returned. */
+    const Counters &counts() const {
+        return counters;
+    }
+
+    /** Replace the placeholders in the text with the names they stand
+     * for, numbering the names of every prefix p from first[p]. */
+    static std::string renumber(const std::string &text, const Counters &first);
+};
+
+/** Take count[p] consecutive numbers of unique_name(p) from the
+ * process-wide counters, for every prefix p, as if that many names
+ * were made. Return the first number taken of every prefix. */
+ScopedUniqueNames::Counters reserve_unique_names(const ScopedUniqueNames::Counters &count);
+
 /** Test if the first string starts with the second string */
 bool starts_with(const std::string &str, const std::string &prefix);
 
@@ -326,12 +326,113 @@ struct device_handle {
 // Also used as a linked-list to keep track of all the different
 // modules that are attached to a context in order to release them all
 // when then context is released.
+// The value last bound to an argument of a cached kernel. Arguments wider than
+// the value slot are never cached, and are always rebound.
+struct kernel_arg_binding {
+    uint64_t value;
+    size_t size;
+    bool bound;
+};
+
+// A kernel object created from the program of a module, kept alive across
+// launches, together with the arguments last bound to it.
+struct kernel_state {
+    char *entry_name;
+    cl_kernel kernel;
+    int num_args;
+    kernel_arg_binding *args;
+    kernel_state *next;
+};
+
 struct module_state {
     cl_program program;
+    kernel_state *kernels;
+    // Scratch space for the sub-buffers created for the cropped arguments of a launch.
+    cl_mem *sub_buffers;
+    int sub_buffers_capacity;
     module_state *next;
 };
 WEAK module_state *state_list = NULL;
 
+// Find the kernel object for entry_name in the module, or create and cache it.
+WEAK kernel_state *find_or_create_kernel(void *user_context, module_state *state, const char *entry_name,
+                                         int num_args, cl_int *err) {
+    for (kernel_state *k = state->kernels; k; k = k->next) {
+        if (strcmp(k->entry_name, entry_name) == 0) {
+            halide_assert(user_context, k->num_args == num_args);
+            *err = CL_SUCCESS;
+            return k;
+        }
+    }
+
+    debug(user_context) << "    clCreateKernel " << entry_name << " -> ";
+    cl_kernel f = clCreateKernel(state->program, entry_name, err);
+    if (*err != CL_SUCCESS) {
+        debug(user_context) << get_opencl_error_name(*err) << "\n";
+        error(user_context) << "CL: clCreateKernel " << entry_name << " failed: "
+                            << get_opencl_error_name(*err) << "\n";
+        return NULL;
+    }
+    debug(user_context) << (void *)f << "\n";
+
+    size_t name_size = strlen(entry_name) + 1;
+    kernel_state *k = (kernel_state *)malloc(sizeof(kernel_state));
+    char *name = (char *)malloc(name_size);
+    kernel_arg_binding *args = (kernel_arg_binding *)malloc(sizeof(kernel_arg_binding) * (num_args > 0 ? num_args : 1));
+    if (k == NULL || name == NULL || args == NULL) {
+        free(k);
+        free(name);
+        free(args);
+        clReleaseKernel(f);
+        *err = halide_error_code_out_of_memory;
+        return NULL;
+    }
+    memcpy(name, entry_name, name_size);
+    memset(args, 0, sizeof(kernel_arg_binding) * (num_args > 0 ? num_args : 1));
+    k->entry_name = name;
+    k->kernel = f;
+    k->num_args = num_args;
+    k->args = args;
+    k->next = state->kernels;
+    state->kernels = k;
+    return k;
+}
+
+// Release the cached kernel objects of a module. This must happen before its
+// program is released.
+WEAK void release_kernels(void *user_context, module_state *state) {
+    kernel_state *k = state->kernels;
+    while (k) {
+        kernel_state *next = k->next;
+        debug(user_context) << "    clReleaseKernel " << (void *)k->kernel << "\n";
+        cl_int err = clReleaseKernel(k->kernel);
+        halide_assert(user_context, err == CL_SUCCESS);
+        free(k->entry_name);
+        free(k->args);
+        free(k);
+        k = next;
+    }
+    state->kernels = NULL;
+    free(state->sub_buffers);
+    state->sub_buffers = NULL;
+    state->sub_buffers_capacity = 0;
+}
+
+// A released memory object may be handed out again by the OpenCL
+// implementation under the same handle, so forget every binding of it.
+WEAK void forget_kernel_arg_bindings(cl_mem mem) {
+    for (module_state *state = state_list; state; state = state->next) {
+        for (kernel_state *k = state->kernels; k; k = k->next) {
+            for (int i = 0; i < k->num_args; i++) {
+                kernel_arg_binding &b = k->args[i];
+                if (b.bound && b.size == sizeof(cl_mem) && memcmp(&b.value, &mem, sizeof(cl_mem)) == 0) {
+                    b.bound = false;
+                }
+            }
+        }
+    }
+}
+
 WEAK bool validate_device_pointer(void *user_context, halide_buffer_t* buf, size_t size=0) {
     if (buf->device == 0) {
         return true;
@@ -678,6 +779,7 @@ WEAK int halide_opencl_device_free(void *user_context, halide_buffer_t* buf) {
     #endif
 
     halide_assert(user_context, validate_device_pointer(user_context, buf));
+    forget_kernel_arg_bindings(dev_ptr);
     debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
     cl_int result = clReleaseMemObject((cl_mem)dev_ptr);
     // If clReleaseMemObject fails, it is unlikely to succeed in a later call, so
@@ -816,6 +918,9 @@ WEAK int halide_opencl_initialize_kernels(void *user_context, void **state_ptr,
     if (!(*state)) {
         *state = (module_state*)malloc(sizeof(module_state));
         (*state)->program = NULL;
+        (*state)->kernels = NULL;
+        (*state)->sub_buffers = NULL;
+        (*state)->sub_buffers_capacity = 0;
         (*state)->next = state_list;
         state_list = *state;
     }
@@ -988,6 +1093,7 @@ WEAK int halide_opencl_device_release(void *user_context) {
         // object.
         module_state *state = state_list;
         while (state) {
+            release_kernels(user_context, state);
             if (state->program) {
                 debug(user_context) << "    clReleaseProgram " << state->program << "\n";
                 err = clReleaseProgram(state->program);
@@ -1285,24 +1391,31 @@ WEAK int halide_opencl_run(void *user_context,
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
-    // Create kernel object for entry_name from the program for this module.
-    halide_assert(user_context, state_ptr);
-    cl_program program = ((module_state*)state_ptr)->program;
+    // Count the args, and the sub buffers needed for crops.
+    int num_args = 0;
+    int sub_buffers_needed = 0;
+    while (arg_sizes[num_args] != 0) {
+        if (arg_is_buffer[num_args] &&
+            ((device_handle *)((halide_buffer_t *)args[num_args])->device)->offset != 0) {
+            sub_buffers_needed++;
+        }
+        num_args++;
+    }
 
-    halide_assert(user_context, program);
-    debug(user_context) << "    clCreateKernel " << entry_name << " -> ";
-    cl_kernel f = clCreateKernel(program, entry_name, &err);
-    if (err != CL_SUCCESS) {
-        debug(user_context) << get_opencl_error_name(err) << "\n";
-        error(user_context) << "CL: clCreateKernel " << entry_name << " failed: "
-                            << get_opencl_error_name(err) << "\n";
+    // Look up the kernel object for entry_name in the program for this module.
+    // It is created at the first launch, and kept until the module is released.
+    halide_assert(user_context, state_ptr);
+    module_state *state = (module_state*)state_ptr;
+    halide_assert(user_context, state->program);
+    kernel_state *kernel = find_or_create_kernel(user_context, state, entry_name, num_args, &err);
+    if (kernel == NULL) {
         return err;
-    } else {
-        #ifdef DEBUG_RUNTIME
-        uint64_t t_create_kernel = halide_current_time_ns(user_context);
-        debug(user_context) << "    Time: " << (t_create_kernel - t_before) / 1.0e6 << " ms\n";
-        #endif
     }
+    cl_kernel f = kernel->kernel;
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_create_kernel = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_create_kernel - t_before) / 1.0e6 << " ms\n";
+    #endif
 
     // Pack dims
     size_t global_dim[3] = {(size_t) blocksX*threadsX,  (size_t) blocksY*threadsY, (size_t) blocksZ*threadsZ};
@@ -1311,24 +1424,19 @@ WEAK int halide_opencl_run(void *user_context,
     // Set args
     int i = 0;
 
-    // Count sub buffers needed for crops.
-    int sub_buffers_needed = 0;
-    while (arg_sizes[i] != 0) {
-        if (arg_is_buffer[i] &&
-            ((device_handle *)((halide_buffer_t *)args[i])->device)->offset != 0) {
-            sub_buffers_needed++;
-        }
-        i += 1;
-    }
-    cl_mem *sub_buffers = NULL;
-    int sub_buffers_saved = 0;
-    if (sub_buffers_needed > 0) {
-        sub_buffers = (cl_mem *)malloc(sizeof(cl_mem) * sub_buffers_needed);
-        if (sub_buffers == NULL) {
+    // The sub buffers live only until the kernel is enqueued. The space to
+    // track them is reused across launches.
+    if (sub_buffers_needed > state->sub_buffers_capacity) {
+        cl_mem *grown = (cl_mem *)malloc(sizeof(cl_mem) * sub_buffers_needed);
+        if (grown == NULL) {
             return halide_error_code_out_of_memory;
         }
-        memset(sub_buffers, 0, sizeof(cl_mem) * sub_buffers_needed);
+        free(state->sub_buffers);
+        state->sub_buffers = grown;
+        state->sub_buffers_capacity = sub_buffers_needed;
     }
+    cl_mem *sub_buffers = state->sub_buffers;
+    int sub_buffers_saved = 0;
 
 #if 0 // Get kernel info. For debugging purpose only
     {
@@ -1393,10 +1501,17 @@ WEAK int halide_opencl_run(void *user_context,
                             << arg_is_buffer[i] << "\n";
         void *this_arg = args[i];
         cl_int err = CL_SUCCESS;
+        kernel_arg_binding &binding = kernel->args[i];
+
+        // The bytes to bind, and whether they may be cached for the next launch.
+        const void *value = this_arg;
+        size_t value_size = arg_sizes[i];
+        bool cacheable = value_size <= sizeof(binding.value);
+        cl_mem mem = NULL;
 
         if (arg_is_buffer[i]) {
             halide_assert(user_context, arg_sizes[i] == sizeof(uint64_t));
-            cl_mem mem = ((device_handle *)((halide_buffer_t *)this_arg)->device)->mem;
+            mem = ((device_handle *)((halide_buffer_t *)this_arg)->device)->mem;
 
             #ifdef HAVE_OPENCL_12
             uint64_t offset = ((device_handle *)((halide_buffer_t *)this_arg)->device)->offset;
@@ -1407,14 +1522,30 @@ WEAK int halide_opencl_run(void *user_context,
                 // span the crop.
                 mem = clCreateSubBuffer(mem, CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &region, &err);
                 sub_buffers[sub_buffers_saved++] = mem;
+                // The sub-buffer is released after the launch, so it is never reused.
+                cacheable = false;
             }
             #endif
             if (err == CL_SUCCESS) {
                 debug(user_context) << "Mapped dev handle is: " << (void *)mem << "\n";
-                err = clSetKernelArg(f, i, sizeof(mem), &mem);
             }
-        } else {
-            err = clSetKernelArg(f, i, arg_sizes[i], this_arg);
+            value = &mem;
+            value_size = sizeof(mem);
+        }
+
+        if (err == CL_SUCCESS) {
+            if (cacheable && binding.bound && binding.size == value_size &&
+                memcmp(&binding.value, value, value_size) == 0) {
+                debug(user_context) << "    Kernel arg " << i << " unchanged\n";
+            } else {
+                err = clSetKernelArg(f, i, value_size, value);
+                binding.bound = (err == CL_SUCCESS) && cacheable;
+                if (binding.bound) {
+                    binding.value = 0;
+                    memcpy(&binding.value, value, value_size);
+                    binding.size = value_size;
+                }
+            }
         }
 
         if (err != CL_SUCCESS) {
@@ -1423,7 +1554,6 @@ WEAK int halide_opencl_run(void *user_context,
             for (int sub_buf_index = 0; sub_buf_index < sub_buffers_saved; sub_buf_index++) {
                 clReleaseMemObject(sub_buffers[sub_buf_index]);
             }
-            free(sub_buffers);
             return err;
         }
         i++;
@@ -1458,7 +1588,6 @@ WEAK int halide_opencl_run(void *user_context,
     for (int sub_buf_index = 0; sub_buf_index < sub_buffers_saved; sub_buf_index++) {
         clReleaseMemObject(sub_buffers[sub_buf_index]);
     }
-    free(sub_buffers);
 
     if (err != CL_SUCCESS) {
         error(user_context) << "CL: clEnqueueNDRangeKernel failed: "
@@ -1466,10 +1595,6 @@ WEAK int halide_opencl_run(void *user_context,
         return err;
     }
 
-    debug(user_context) << "    Releasing kernel " << (void *)f << "\n";
-    clReleaseKernel(f);
-    debug(user_context) << "    clReleaseKernel finished" << (void *)f << "\n";
-
     #ifdef OCL_MULTI_CMD_Q
     err = clFlush(ctx.cmd_queue);
     if (err != CL_SUCCESS) {
@@ -0,0 +1,127 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_internal.h"
+
+// Channels of a spatial design that runs on the host CPU (Target::SpatialOnCPU).
+//
+// A channel array is a set of independent single-producer, single-consumer FIFOs.
+// The data slots themselves live in an ordinary Halide allocation owned by the
+// generated code; this module only owns the head/tail counters of every FIFO and
+// tells the generated code which slot to access. A FIFO of depth D has D + 1 slots:
+// the reader keeps the slot it has just read until its next read, so that the
+// generated code can load the value after the slot index has been handed out.
+
+namespace Halide { namespace Runtime { namespace Internal { namespace T2S {
+
+struct fifo_t {
+    // Number of values ever written. Owned by the writer.
+    volatile uint64_t tail;
+    // Number of values ever released by the reader. Owned by the reader.
+    volatile uint64_t head;
+    // Whether the reader still holds the slot at head.
+    uint64_t holding;
+    // Pad to a cache line so that FIFOs of the same array do not false share.
+    uint64_t padding[5];
+};
+
+struct channel_t {
+    int num_fifos;
+    int num_slots;
+    fifo_t fifos[1];
+};
+
+// Spin a bit before giving up the time slice: most waits in a systolic design
+// are short, but a design may have many more kernels than hardware threads.
+// This module is inlined into the pipeline, so only the public runtime API is
+// used here.
+__attribute__((always_inline)) void backoff(int &spins) {
+    if (++spins > 64) {
+        halide_sleep_ms(NULL, 0);
+        spins = 0;
+    }
+}
+
+}}}}  // namespace Halide::Runtime::Internal::T2S
+
+using namespace Halide::Runtime::Internal::T2S;
+
+extern "C" {
+
+WEAK void *halide_t2s_channel_create(void *user_context, int num_fifos, int depth) {
+    if (num_fifos < 1 || depth < 1) {
+        error(user_context) << "t2s channel: invalid shape (" << num_fifos << " fifos of depth " << depth << ")\n";
+        return NULL;
+    }
+    size_t size = sizeof(channel_t) + (num_fifos - 1) * sizeof(fifo_t);
+    channel_t *ch = (channel_t *)halide_malloc(user_context, size);
+    if (ch == NULL) {
+        error(user_context) << "t2s channel: out of memory\n";
+        return NULL;
+    }
+    memset(ch, 0, size);
+    ch->num_fifos = num_fifos;
+    ch->num_slots = depth + 1;
+    return ch;
+}
+
+WEAK int halide_t2s_channel_destroy(void *user_context, void *channel) {
+    halide_free(user_context, channel);
+    return 0;
+}
+
+// Writer: wait for a free slot of the FIFO and return its index. The value must be
+// stored into the slot before halide_t2s_channel_commit() is called.
+WEAK int halide_t2s_channel_reserve(void *channel, int fifo) {
+    channel_t *ch = (channel_t *)channel;
+    fifo_t *f = &ch->fifos[fifo];
+    uint64_t tail = f->tail;
+    int spins = 0;
+    while (tail - __atomic_load_n(&f->head, __ATOMIC_ACQUIRE) >= (uint64_t)ch->num_slots) {
+        backoff(spins);
+    }
+    return (int)(tail % ch->num_slots);
+}
+
+// Writer: publish the value stored into the slot returned by the last reserve.
+WEAK int halide_t2s_channel_commit(void *channel, int fifo) {
+    channel_t *ch = (channel_t *)channel;
+    fifo_t *f = &ch->fifos[fifo];
+    __atomic_store_n(&f->tail, f->tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Reader: release the slot of the previous read, wait for the next value and return
+// the index of its slot.
+WEAK int halide_t2s_channel_pop(void *channel, int fifo) {
+    channel_t *ch = (channel_t *)channel;
+    fifo_t *f = &ch->fifos[fifo];
+    uint64_t head = f->head;
+    if (f->holding) {
+        head++;
+        __atomic_store_n(&f->head, head, __ATOMIC_RELEASE);
+    }
+    int spins = 0;
+    while (__atomic_load_n(&f->tail, __ATOMIC_ACQUIRE) == head) {
+        backoff(spins);
+    }
+    f->holding = 1;
+    return (int)(head % ch->num_slots);
+}
+
+// Make sure the thread pool can run all the kernels of a design at the same time:
+// a kernel blocks on its channels until its neighbors make progress. The thread pool
+// has at most 256 threads (MAX_THREADS in thread_pool_common.h), and silently caps
+// the number asked for, with which the design would deadlock.
+WEAK int halide_t2s_reserve_threads(void *user_context, int num_kernels) {
+    if (num_kernels > 256) {
+        error(user_context) << "t2s: " << num_kernels << " kernels cannot run at the same time on a thread pool of at most 256 threads\n";
+        return halide_error_code_generic_error;
+    }
+    int old = halide_set_num_threads(num_kernels);
+    if (old > num_kernels) {
+        halide_set_num_threads(old);
+    }
+    return 0;
+}
+
+}  // extern "C"
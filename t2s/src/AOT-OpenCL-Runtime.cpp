@@ -18,10 +18,19 @@
 *******************************************************************************/
 #include "AOT-OpenCL-Runtime.h"
 #include "SharedUtilsInC.h"
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
 
 #define WEAK __attribute__((weak))
 #define ACL_ALIGNMENT 64
 
+// Place a buffer on DDR bank 1 with manual partitioning. Bank n is (n * CL_CHANNEL_1_INTELFPGA).
+#ifndef CL_CHANNEL_1_INTELFPGA
+#define CL_CHANNEL_1_INTELFPGA (1 << 16)
+#endif
+
 extern int MAX_DEVICES;
 extern int NUM_QUEUES_TO_CREATE;
 extern int NUM_KERNELS_TO_CREATE;
@@ -35,6 +44,317 @@ extern const char *kernel_name[];
 
 using namespace aocl_utils;
 
+// Asynchronous host/device transfers, enabled by the environment variable HL_ASYNC_TRANSFER.
+// A host-to-device copy is enqueued without blocking, and every kernel waits only for the copies
+// into its own buffer arguments, so a loader starts as soon as its input has landed. A device-to-host
+// copy waits only for the kernels having the buffer as an argument, so the readback overlaps with
+// the tail of the other kernels.
+static bool async_transfer() {
+    static int enabled = -1;
+    if (enabled < 0) {
+        enabled = (getenv("HL_ASYNC_TRANSFER") != NULL) ? 1 : 0;
+    }
+    return enabled == 1;
+}
+
+static std::vector<std::vector<cl_mem>> kernel_buffers; // Buffer arguments of every kernel
+static std::map<cl_mem, cl_event>       pending_writes; // Host-to-device copies that might not have finished
+static std::vector<cl_event>            kernel_events;  // Kernels that might not have finished
+
+static void wait_for_pending_writes() {
+    for (auto &w : pending_writes) {
+        status = clWaitForEvents(1, &w.second);
+        CHECK(status);
+        clReleaseEvent(w.second);
+    }
+    pending_writes.clear();
+}
+
+// The events of the kernels that have the buffer as an argument.
+static std::vector<cl_event> events_of_kernels_using(cl_mem mem) {
+    std::vector<cl_event> events;
+    for (size_t i = 0; i < kernel_events.size() && i < kernel_buffers.size(); i++) {
+        if (std::find(kernel_buffers[i].begin(), kernel_buffers[i].end(), mem) != kernel_buffers[i].end()) {
+            events.push_back(kernel_events[i]);
+        }
+    }
+    return events;
+}
+
+// A timeline of the kernels and the host<->device copies, enabled by the environment variable HL_TIMELINE=<file>.
+// The file is in the Chrome trace-event format (open it in chrome://tracing or ui.perfetto.dev), with a track for
+// every command queue. A kernel or copy is shown from its start to its end, and its queued, submit, start and end
+// timestamps, in nanoseconds since the earliest one, are in its arguments. The file is rewritten whenever the kernels
+// finish, and at exit.
+struct timeline_event {
+    std::string name;
+    const char *category; // "kernel" or "copy"
+    int         queue;
+    size_t      bytes;    // For a copy
+    cl_event    event;
+    cl_ulong    queued, submit, start, end;
+};
+static std::vector<timeline_event> timeline;
+static size_t                      timeline_resolved = 0; // The events before it have their timestamps
+
+static const char *timeline_file() {
+    static const char *file = getenv("HL_TIMELINE");
+    return file;
+}
+
+// Where to return the event of a command, if the timeline is enabled.
+static cl_event *timeline_event_of(cl_event *event) {
+    *event = NULL;
+    return (timeline_file() == NULL) ? NULL : event;
+}
+
+static void write_timeline();
+
+// Record a command into the timeline. The timeline keeps its own reference to the event.
+static void timeline_add(const std::string &name, const char *category, int queue, size_t bytes, cl_event event) {
+    if (timeline_file() == NULL || event == NULL) {
+        return;
+    }
+    if (timeline.empty()) {
+        atexit(write_timeline);
+    }
+    clRetainEvent(event);
+    timeline.push_back(timeline_event{name, category, queue, bytes, event, 0, 0, 0, 0});
+}
+
+// Record a copy on the current queue into the timeline, and release the event.
+static void timeline_add_copy(const char *direction, size_t bytes, cl_event event) {
+    if (event != NULL) {
+        timeline_add(direction, "copy", current_kernel, bytes, event);
+        clReleaseEvent(event);
+    }
+}
+
+static void write_timeline() {
+    if (timeline_file() == NULL || timeline.empty()) {
+        return;
+    }
+    for (; timeline_resolved < timeline.size(); timeline_resolved++) {
+        timeline_event &e = timeline[timeline_resolved];
+        clWaitForEvents(1, &e.event);
+        clGetEventProfilingInfo(e.event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &e.queued, NULL);
+        clGetEventProfilingInfo(e.event, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &e.submit, NULL);
+        clGetEventProfilingInfo(e.event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &e.start, NULL);
+        clGetEventProfilingInfo(e.event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &e.end, NULL);
+        clReleaseEvent(e.event);
+        e.event = NULL;
+    }
+
+    FILE *fp = fopen(timeline_file(), "w");
+    if (fp == NULL) {
+        DPRINTF("Failed to open %s (HL_TIMELINE) for writing.\n", timeline_file());
+        return;
+    }
+    cl_ulong origin = timeline[0].queued;
+    int max_queue = 0;
+    for (auto &e : timeline) {
+        origin = std::min(origin, e.queued);
+        max_queue = std::max(max_queue, e.queue);
+    }
+    fprintf(fp, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    fprintf(fp, "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": {\"name\": \"OpenCL device\"}}");
+    for (int q = 0; q <= max_queue; q++) {
+        const char *queue_name = (q < NUM_KERNELS_TO_CREATE) ? kernel_name[q] : "read back";
+        fprintf(fp, ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, \"args\": {\"name\": \"queue %d: %s\"}}",
+                q, q, queue_name);
+    }
+    for (auto &e : timeline) {
+        fprintf(fp, ",\n  {\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, "
+                "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"queued\": %llu, \"submit\": %llu, \"start\": %llu, \"end\": %llu",
+                e.name.c_str(), e.category, e.queue, (e.start - origin) / 1000.0, (e.end - e.start) / 1000.0,
+                (unsigned long long)(e.queued - origin), (unsigned long long)(e.submit - origin),
+                (unsigned long long)(e.start - origin), (unsigned long long)(e.end - origin));
+        if (e.bytes > 0) {
+            fprintf(fp, ", \"bytes\": %llu", (unsigned long long)e.bytes);
+        }
+        fprintf(fp, "}}");
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+}
+
+// A session keeps the program and kernels loaded, and the buffers of the pipeline resident on the device
+// across invocations (See halide_opencl_session_begin/end in AOT-OpenCL-Runtime.h).
+static cl_program loaded_program = NULL;
+static bool       session_active = false;
+
+// Pools of device buffers (cl_mem with its device_handle) and aligned host buffers. A freed buffer is kept in the
+// pool of its size class, and reused by the next allocation of the same class, usually by the next invocation of
+// the pipeline. The bytes kept idle in either pool are bounded by a high-water mark, given by the environment
+// variable HL_POOL_HIGH_WATER_MARK in bytes, with an optional K, M or G suffix. Default: 1G. 0 disables pooling.
+// In a session, freed buffers are always kept. Set HL_POOL_STATS to print the statistics of the pools at exit.
+struct buffer_pool {
+    const char *name;
+    std::map<size_t, std::vector<void *>> idle; // Size class -> idle buffers
+    uint64_t idle_bytes;
+    uint64_t peak_idle_bytes;
+    uint64_t allocations;
+    uint64_t hits;
+    uint64_t evictions;                         // Buffers freed due to the high-water mark
+};
+static buffer_pool device_pool = {"device", {}, 0, 0, 0, 0, 0};
+static buffer_pool host_pool   = {"host", {}, 0, 0, 0, 0, 0};
+
+static void print_pool_stats_at_exit() {
+    halide_opencl_print_pool_stats(NULL);
+}
+
+static uint64_t pool_high_water_mark() {
+    static int64_t mark = -1;
+    if (mark < 0) {
+        mark = 1LL << 30;
+        const char *env = getenv("HL_POOL_HIGH_WATER_MARK");
+        if (env != NULL) {
+            char *suffix = NULL;
+            mark = strtoll(env, &suffix, 10);
+            switch (*suffix) {
+                case 'G': case 'g': mark <<= 10; // Fall through
+                case 'M': case 'm': mark <<= 10; // Fall through
+                case 'K': case 'k': mark <<= 10;
+            }
+            if (mark < 0) {
+                mark = 0;
+            }
+        }
+        if (getenv("HL_POOL_STATS") != NULL) {
+            atexit(print_pool_stats_at_exit);
+        }
+    }
+    return (uint64_t)mark;
+}
+
+// Round a size up to a multiple of 1/4 of the power of 2 below it, so that a buffer wastes at most 25%.
+// The smallest class is 4KB.
+static size_t size_class(size_t size) {
+    if (size <= 4096) {
+        return 4096;
+    }
+    size_t p = 4096;
+    while (p * 2 < size) {
+        p *= 2;
+    }
+    size_t step = p / 4;
+    size_t c = (size + step - 1) / step * step;
+    // Do not round beyond the limit of a device buffer.
+    return (c > (static_cast<uint64_t>(1) << 32) - 1) ? size : c;
+}
+
+static void *pool_take(buffer_pool &pool, size_t c) {
+    pool.allocations++;
+    auto it = pool.idle.find(c);
+    if (it == pool.idle.end() || it->second.empty()) {
+        return NULL;
+    }
+    void *p = it->second.back();
+    it->second.pop_back();
+    pool.idle_bytes -= c;
+    pool.hits++;
+    return p;
+}
+
+// Keep a freed buffer in the pool. Return false if the pool is full, and the buffer should be freed instead.
+static bool pool_give(buffer_pool &pool, size_t c, void *p) {
+    if (!session_active && pool.idle_bytes + c > pool_high_water_mark()) {
+        pool.evictions++;
+        return false;
+    }
+    pool.idle[c].push_back(p);
+    pool.idle_bytes += c;
+    pool.peak_idle_bytes = std::max(pool.peak_idle_bytes, pool.idle_bytes);
+    return true;
+}
+
+static void release_device_handle(void *p) {
+    clReleaseMemObject(((device_handle *)p)->mem);
+    free(p);
+}
+
+static void pool_clear(buffer_pool &pool, void (*release)(void *)) {
+    for (auto &i : pool.idle) {
+        for (auto p : i.second) {
+            release(p);
+        }
+    }
+    pool.idle.clear();
+    pool.idle_bytes = 0;
+}
+
+// Buffers split into several device allocations, for the kernels compiled with Func::split_storage. A buffer that the
+// host code has declared splittable (See halide_opencl_buffer_allow_split) is split if it is larger than a device
+// allocation can be (2^32 - 1 bytes), or than $HL_BUFFER_PART_BYTES if set, into
+// parts of $HL_BUFFER_PART_BYTES (default: 2^31) bytes, rounded down to a power of 2. Every part is allocated in full.
+// With $HL_BUFFER_PART_BANKS set to n, part i is placed on memory bank (i % n) + 1, which needs the bitstream compiled
+// with -no-interleaving=default in AOC_OPTION.
+struct split_buffer {
+    size_t              part_bytes;
+    std::vector<cl_mem> parts;
+};
+static std::map<device_handle *, split_buffer> split_buffers;
+
+// The buffers declared splittable, with the max parts the kernels address, until they are allocated on the device.
+static std::map<const struct halide_buffer_t *, int> splittable_buffers;
+
+static uint64_t env_to_uint64(const char *name) {
+    const char *env = getenv(name);
+    return (env == NULL) ? 0 : strtoull(env, NULL, 10);
+}
+
+// The bytes in a part, if a buffer of the given bytes needs splitting, or 0 otherwise.
+static size_t part_bytes_of(uint64_t total_bytes) {
+    const uint64_t max_bytes = (static_cast<uint64_t>(1) << 32) - 1;
+    uint64_t bytes = env_to_uint64("HL_BUFFER_PART_BYTES");
+    if (total_bytes <= max_bytes && (bytes == 0 || total_bytes <= bytes)) {
+        return 0;
+    }
+    if (bytes == 0 || bytes > max_bytes) {
+        bytes = static_cast<uint64_t>(1) << 31;
+    }
+    // A part holds whole vectors.
+    size_t part_bytes = 4096;
+    while (part_bytes * 2 <= bytes) {
+        part_bytes *= 2;
+    }
+    return part_bytes;
+}
+
+static device_handle *malloc_split_buffer(uint64_t total_bytes, size_t part_bytes) {
+    device_handle *dev_handle = (device_handle *)malloc(sizeof(device_handle));
+    if (dev_handle == NULL) {
+        return NULL;
+    }
+    size_t num_parts = (total_bytes + part_bytes - 1) / part_bytes;
+    uint64_t banks = env_to_uint64("HL_BUFFER_PART_BANKS");
+    split_buffer &split = split_buffers[dev_handle];
+    split.part_bytes = part_bytes;
+    for (size_t i = 0; i < num_parts; i++) {
+        cl_mem_flags flags = CL_MEM_READ_WRITE;
+        if (banks > 0) {
+            flags |= CL_CHANNEL_1_INTELFPGA * ((i % banks) + 1);
+        }
+        cl_mem part = clCreateBuffer(context, flags, part_bytes, NULL, &status);
+        CHECK(status);
+        split.parts.push_back(part);
+    }
+    std::cout << "CL: " << total_bytes << " bytes are allocated on the device in " << num_parts << " parts of "
+              << part_bytes << " bytes\n";
+    dev_handle->mem = split.parts[0];
+    dev_handle->offset = 0;
+    return dev_handle;
+}
+
+static split_buffer *split_buffer_of(const struct halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return NULL;
+    }
+    auto it = split_buffers.find((device_handle *)buf->device);
+    return (it == split_buffers.end()) ? NULL : &it->second;
+}
+
 void cleanup() {
 }
 
@@ -88,11 +408,28 @@ WEAK int halide_device_malloc(void *user_context, struct halide_buffer_t *buf,
         }
     }
     uint64_t total_bytes = (highest_index + 1  - lowest_index) * buf->type.bytes();
-    if (total_bytes > (static_cast<uint64_t>(1) << 32) - 1) {
+
+    // Only a buffer addressed by the kernels as split can be split into parts. Any other buffer must fit in a single
+    // device allocation.
+    int max_parts = 0;
+    auto splittable = splittable_buffers.find(buf);
+    if (splittable != splittable_buffers.end()) {
+        max_parts = splittable->second;
+        splittable_buffers.erase(splittable);
+    }
+    size_t part_bytes = (max_parts > 1) ? part_bytes_of(total_bytes) : 0;
+    if (part_bytes == 0 && total_bytes > (static_cast<uint64_t>(1) << 32) - 1) {
         std::cout << "CL: halide_opencl_device_malloc failed: "
                   << total_bytes << " bytes are requested to allocate on the device. The size exceeds 2^32 - 1.\n";
         assert(false);
     }
+    if (part_bytes > 0 && (total_bytes + part_bytes - 1) / part_bytes > (uint64_t)max_parts) {
+        std::cout << "CL: halide_opencl_device_malloc failed: "
+                  << total_bytes << " bytes are requested to allocate on the device in parts of " << part_bytes
+                  << " bytes, but the kernels are compiled for at most " << max_parts << " parts. "
+                  << "Increase the parts in split_storage(), or $HL_BUFFER_PART_BYTES.\n";
+        assert(false);
+    }
 
     if (buf->device) {
         return 0;
@@ -102,12 +439,29 @@ WEAK int halide_device_malloc(void *user_context, struct halide_buffer_t *buf,
         assert(buf->dim[i].stride >= 0);
     }
 
-    device_handle *dev_handle = (device_handle *)malloc(sizeof(device_handle));
+    // A splittable buffer beyond the limit of a device allocation is split into parts.
+    if (part_bytes > 0) {
+        device_handle *dev_handle = malloc_split_buffer(total_bytes, part_bytes);
+        if (dev_handle == NULL) {
+            return CL_OUT_OF_HOST_MEMORY;
+        }
+        buf->device = (uint64_t)dev_handle;
+        return 0;
+    }
+
+    size_t c = size_class(size);
+    device_handle *dev_handle = (device_handle *)pool_take(device_pool, c);
+    if (dev_handle != NULL) {
+        buf->device = (uint64_t)dev_handle;
+        return 0;
+    }
+
+    dev_handle = (device_handle *)malloc(sizeof(device_handle));
     if (dev_handle == NULL) {
         return CL_OUT_OF_HOST_MEMORY;
     }
 
-    cl_mem dev_ptr = clCreateBuffer(context, CL_MEM_READ_WRITE, size, NULL, &status);
+    cl_mem dev_ptr = clCreateBuffer(context, CL_MEM_READ_WRITE, c, NULL, &status);
     CHECK(status);
     dev_handle->mem = dev_ptr;
     dev_handle->offset = 0;
@@ -116,161 +470,173 @@ WEAK int halide_device_malloc(void *user_context, struct halide_buffer_t *buf,
     return 0;
 }
 
-WEAK int32_t halide_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf,
-                                       const halide_device_interface_t *device_interface) {
-    size_t size = buf->size_in_bytes();
-    assert(size != 0);
-    buf->host = (uint8_t *)halide_malloc(user_context, size);
-    if (buf->host == NULL) {
-        return CL_OUT_OF_HOST_MEMORY;
+// Set up the platform, context, command queues, program and kernels from the bitstream $BITSTREAM.
+static int32_t load_program() {
+    cl_uint numPlatforms = 0;
+    cl_platform_id platform;
+
+    const char *name = getenv("INTEL_FPGA_OCL_PLATFORM_NAME");
+    platform = findPlatform(name);
+    if(platform == NULL) {
+        DPRINTF("ERROR: Unable to find Intel(R) FPGA OpenCL platform\n");
+        return -1;
     }
 
-    if (context == NULL) {
-        cl_uint numPlatforms = 0;
-        cl_platform_id platform;
-
-        const char *name = getenv("INTEL_FPGA_OCL_PLATFORM_NAME");
-        platform = findPlatform(name);
-        if(platform == NULL) {
-            DPRINTF("ERROR: Unable to find Intel(R) FPGA OpenCL platform\n");
-            return -1;
+    cl_uint numDevices = 0;
+    cl_device_id *devices = NULL;
+    // Device info
+    char buffer[4096];
+    unsigned int buf_uint;
+    int device_found = 0;
+
+    printf("Initializing IDs\n");
+    status = clGetDeviceIDs(platform,
+                    CL_DEVICE_TYPE_ALL,
+                    0,
+                    NULL,
+                    &numDevices);
+
+    if(status == CL_SUCCESS){
+        clGetPlatformInfo(platform,
+                        CL_PLATFORM_VENDOR,
+                        4096,
+                        buffer,
+                        NULL);
+
+        if(strstr(buffer, "Intel(R)") != NULL){
+                device_found = 1;
         }
-
-        cl_uint numDevices = 0;
-        cl_device_id *devices = NULL;
-        // Device info
-        char buffer[4096];
-        unsigned int buf_uint;
-        int device_found = 0;
-
-        printf("Initializing IDs\n");
-        status = clGetDeviceIDs(platform,
-                        CL_DEVICE_TYPE_ALL,
-                        0,
-                        NULL,
-                        &numDevices);
-
-        if(status == CL_SUCCESS){
-            clGetPlatformInfo(platform,
-                            CL_PLATFORM_VENDOR,
-                            4096,
-                            buffer,
+        printf("%s\n", buffer);
+
+        if(device_found){
+            // Allocate enough space for each device
+            devices = (cl_device_id*)
+            acl_aligned_malloc (numDevices * sizeof(cl_device_id));
+
+            // Fill in devices with clGetDeviceIDs()
+            status = clGetDeviceIDs(platform,
+                            CL_DEVICE_TYPE_ALL,
+                            numDevices,
+                            devices,
                             NULL);
-
-            if(strstr(buffer, "Intel(R)") != NULL){
-                    device_found = 1;
-            }
-            printf("%s\n", buffer);
-
-            if(device_found){
-                // Allocate enough space for each device
-                devices = (cl_device_id*)
-                acl_aligned_malloc (numDevices * sizeof(cl_device_id));
-
-                // Fill in devices with clGetDeviceIDs()
-                status = clGetDeviceIDs(platform,
-                                CL_DEVICE_TYPE_ALL,
-                                numDevices,
-                                devices,
-                                NULL);
-            }
-        }
-
-        if (!device_found) {
-            DPRINTF("failed to find a OpenCL device\n");
-            exit(-1);
         }
+    }
 
-        DPRINTF("Total number of devices: %d\n", numDevices);
+    if (!device_found) {
+        DPRINTF("failed to find a OpenCL device\n");
+        exit(-1);
+    }
 
-        context = clCreateContext(
-            NULL,
-            1,
-            devices,
-            NULL,
-            NULL,
-            &status);
-        CHECK(status);
+    DPRINTF("Total number of devices: %d\n", numDevices);
 
-        // Create a command queue using clCreateCommandQueue(),
-        // and associate it with the device you want to execute on
-        for (int i = 0; i < NUM_QUEUES_TO_CREATE; i++) {
-            //fDPRINTF(stdout,"cmdQueue i = %d\n", i);
-            cmdQueue[i] = clCreateCommandQueue(
-                context,
-                devices[0],
-                CL_QUEUE_PROFILING_ENABLE,
-                &status);
-            CHECK(status);
-        }
+    context = clCreateContext(
+        NULL,
+        1,
+        devices,
+        NULL,
+        NULL,
+        &status);
+    CHECK(status);
 
-        //fDPRINTF(stdout,"cmdQueue i = %d, a queue for reading the C buffer\n", i);
-        cmdQueue[NUM_QUEUES_TO_CREATE] = clCreateCommandQueue(
+    // Create a command queue using clCreateCommandQueue(),
+    // and associate it with the device you want to execute on
+    for (int i = 0; i < NUM_QUEUES_TO_CREATE; i++) {
+        //fDPRINTF(stdout,"cmdQueue i = %d\n", i);
+        cmdQueue[i] = clCreateCommandQueue(
             context,
             devices[0],
             CL_QUEUE_PROFILING_ENABLE,
             &status);
         CHECK(status);
+    }
 
-        DPRINTF("\n===== Host-CPU setting up OpenCL program and kernels ======\n\n");
+    //fDPRINTF(stdout,"cmdQueue i = %d, a queue for reading the C buffer\n", i);
+    cmdQueue[NUM_QUEUES_TO_CREATE] = clCreateCommandQueue(
+        context,
+        devices[0],
+        CL_QUEUE_PROFILING_ENABLE,
+        &status);
+    CHECK(status);
 
-        cl_program program;
+    DPRINTF("\n===== Host-CPU setting up OpenCL program and kernels ======\n\n");
 
-        size_t binary_length;
-        const unsigned char *binary;
+    size_t binary_length;
+    const unsigned char *binary;
 
-        fflush(stdout);
-        // create the program using binary already compiled offline using aoc (i.e. the .aocx file)
-        char *aocx_file = getenv("BITSTREAM");
-        FILE *fp = fopen(aocx_file, "rb");
+    fflush(stdout);
+    // create the program using binary already compiled offline using aoc (i.e. the .aocx file)
+    char *aocx_file = getenv("BITSTREAM");
+    FILE *fp = fopen(aocx_file, "rb");
 
-        if (fp == NULL) {
-            DPRINTF("Failed to open the AOCX file (fopen).\n");
-            return -1;
-        }
+    if (fp == NULL) {
+        DPRINTF("Failed to open the AOCX file (fopen).\n");
+        return -1;
+    }
 
-        fseek(fp, 0, SEEK_END);
-        binary_length = ftell(fp);
-        binary = (unsigned char *)malloc(sizeof(unsigned char) * binary_length);
-        assert(binary && "Malloc failed");
-        rewind(fp);
+    fseek(fp, 0, SEEK_END);
+    binary_length = ftell(fp);
+    binary = (unsigned char *)malloc(sizeof(unsigned char) * binary_length);
+    assert(binary && "Malloc failed");
+    rewind(fp);
 
-        if (fread((void *)binary, binary_length, 1, fp) == 0) {
-            DPRINTF("Failed to read from the AOCX file (fread).\n");
-            return -1;
-        }
-        fclose(fp);
+    if (fread((void *)binary, binary_length, 1, fp) == 0) {
+        DPRINTF("Failed to read from the AOCX file (fread).\n");
+        return -1;
+    }
+    fclose(fp);
 
-        DPRINTF("Create program with binary\n");
-        // Create a program using clCreateProgramWithBinary()
-        program = clCreateProgramWithBinary(
-            context,
-            1,
-            devices,
-            &binary_length,
-            (const unsigned char **)&binary,
-            &status,
-            NULL);
+    DPRINTF("Create program with binary\n");
+    // Create a program using clCreateProgramWithBinary()
+    loaded_program = clCreateProgramWithBinary(
+        context,
+        1,
+        devices,
+        &binary_length,
+        (const unsigned char **)&binary,
+        &status,
+        NULL);
+    CHECK(status);
+    free((void *)binary);
+
+    //----------------------------------------------
+    // Create the kernel
+    //----------------------------------------------
+
+    status = clBuildProgram(loaded_program, 0, NULL, NULL, NULL, NULL);
+    if (status != CL_SUCCESS) {
+        char log[128 * 1024] = {0};
+        clGetProgramBuildInfo(loaded_program, devices[0], CL_PROGRAM_BUILD_LOG, 128 * 1024, log, NULL);
+        DPRINTF("%s\n", log);
         CHECK(status);
+    }
 
-        //----------------------------------------------
-        // Create the kernel
-        //----------------------------------------------
+    for (int j = 0; j < NUM_KERNELS_TO_CREATE; j++) {
+        DPRINTF("Creating kernel[%d]: %s\n", j, kernel_name[j]);
+        kernel[j] = clCreateKernel(loaded_program, (const char *)kernel_name[j], &status);
+        CHECK(status);
+    }
+    DPRINTF("All kernels created\n");
+    return 0;
+}
 
-        status = clBuildProgram(program, 0, NULL, NULL, NULL, NULL);
-        if (status != CL_SUCCESS) {
-            char log[128 * 1024] = {0};
-            clGetProgramBuildInfo(program, devices[0], CL_PROGRAM_BUILD_LOG, 128 * 1024, log, NULL);
-            DPRINTF("%s\n", log);
-            CHECK(status);
+WEAK int32_t halide_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf,
+                                       const halide_device_interface_t *device_interface) {
+    size_t size = buf->size_in_bytes();
+    assert(size != 0);
+    size_t c = size_class(size);
+    buf->host = (uint8_t *)pool_take(host_pool, c);
+    if (buf->host == NULL) {
+        buf->host = (uint8_t *)acl_aligned_malloc(c);
+        if (buf->host == NULL) {
+            return CL_OUT_OF_HOST_MEMORY;
         }
+    }
 
-        for (int j = 0; j < NUM_KERNELS_TO_CREATE; j++) {
-            DPRINTF("Creating kernel[%d]: %s\n", j, kernel_name[j]);
-            kernel[j] = clCreateKernel(program, (const char *)kernel_name[j], &status);
-            CHECK(status);
+    if (context == NULL) {
+        int32_t ret = load_program();
+        if (ret != 0) {
+            return ret;
         }
-        DPRINTF("All kernels created\n");
     }
 
     return halide_device_malloc(user_context, buf, device_interface);
@@ -279,14 +645,30 @@ WEAK int32_t halide_device_and_host_malloc(void *user_context, struct halide_buf
 /** Free host and device memory associated with a buffer_t. */
 WEAK int32_t halide_device_and_host_free(void *user_context, void *obj) {
     struct halide_buffer_t *buf = (struct halide_buffer_t *)obj;
-    cl_mem dev_ptr = ((device_handle *)buf->device)->mem;
-    assert(((device_handle *)buf->device)->offset == 0);
-    cl_int result = clReleaseMemObject((cl_mem)dev_ptr);
-    free((device_handle *)buf->device);
-    buf->device = 0;
+    // Keep the buffers for the next invocation, if the pools are not full.
+    size_t c = size_class(buf->size_in_bytes());
+    cl_int result = CL_SUCCESS;
+    if (split_buffer *split = split_buffer_of(buf)) {
+        // Too big to keep in the pool.
+        for (auto part : split->parts) {
+            clReleaseMemObject(part);
+        }
+        split_buffers.erase((device_handle *)buf->device);
+        free((device_handle *)buf->device);
+        buf->device = 0;
+    } else if (buf->device) {
+        assert(((device_handle *)buf->device)->offset == 0);
+        if (!pool_give(device_pool, c, (void *)buf->device)) {
+            result = clReleaseMemObject(((device_handle *)buf->device)->mem);
+            free((device_handle *)buf->device);
+        }
+        buf->device = 0;
+    }
 
     if (buf->host) {
-        halide_free(user_context, buf->host);
+        if (!pool_give(host_pool, c, buf->host)) {
+            acl_aligned_free(buf->host);
+        }
         buf->host = NULL;
     }
     buf->set_host_dirty(false);
@@ -297,6 +679,17 @@ WEAK int32_t halide_device_and_host_free(void *user_context, void *obj) {
 WEAK void halide_device_and_host_free_as_destructor(void *user_context, void *obj) {
 }
 
+WEAK int32_t halide_opencl_session_begin(void *user_context) {
+    if (context == NULL) {
+        int32_t ret = load_program();
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    session_active = true;
+    return 0;
+}
+
 // Return execution time in nanoseconds, as well as the start and end time in nanoseconds
 double compute_kernel_execution_time(cl_event &event, double &start_d, double &end_d) {
     cl_ulong start, end;
@@ -309,43 +702,10 @@ double compute_kernel_execution_time(cl_event &event, double &start_d, double &e
     return (double)(end-start);
 }
 
-WEAK int32_t halide_opencl_wait_for_kernels_finish(void *user_context) {
-    // Define the number of threads that will be created
-    // as well as the number of work groups
-    size_t globalWorkSize[1];
-    size_t localWorkSize[1];
-
-    //----------------------------------------------
-    // Enqueue the kernel for execution
-    //----------------------------------------------
-
-    // all kernels are always tasks
-    globalWorkSize[0] = 1;
-    localWorkSize[0] = 1;
-
-    cl_event kernel_exec_event[NUM_KERNELS_TO_CREATE];
-
-    DPRINTF("\n===== Host-CPU enqeuing the OpenCL kernels to the FPGA device ======\n\n");
-    for (int i = 0; i < NUM_KERNELS_TO_CREATE; i++) {
-        // Alternatively, can use clEnqueueTaskKernel
-        DPRINTF("clEnqueueNDRangeKernel[%d]: %s!\n", i, kernel_name[i]);
-        status = clEnqueueNDRangeKernel(
-            cmdQueue[i],
-            kernel[i],
-            1,
-            NULL,
-            globalWorkSize,
-            localWorkSize,
-            0,
-            NULL,
-            &kernel_exec_event[i]);
-        CHECK(status);
-    }
-    DPRINTF("\n");
-    DPRINTF(" *** FPGA execution started!\n");
-    for (int i = 0; i < NUM_KERNELS_TO_CREATE; i++) {
-        status = clFlush(cmdQueue[i]);
-        CHECK(status);
+// Wait for all the kernels to finish, and record their execution time.
+static int finish_kernels() {
+    if (kernel_events.empty()) {
+        return 0;
     }
 
     for (int i = 0; i < NUM_QUEUES_TO_CREATE; i++) {
@@ -357,12 +717,20 @@ WEAK int32_t halide_opencl_wait_for_kernels_finish(void *user_context) {
     DPRINTF(" *** FPGA execution finished!\n");
     DPRINTF("\n");
 
+    for (int i = 0; i < NUM_KERNELS_TO_CREATE; i++) {
+        timeline_add(kernel_name[i], "kernel", i, 0, kernel_events[i]);
+    }
+    write_timeline();
+
     double k_start_time[NUM_KERNELS_TO_CREATE];
     double k_end_time[NUM_KERNELS_TO_CREATE];
     double k_exec_time[NUM_KERNELS_TO_CREATE];
     for (int i = 0; i < NUM_KERNELS_TO_CREATE; i++) {
-        k_exec_time[i] = compute_kernel_execution_time(kernel_exec_event[i], k_start_time[i], k_end_time[i]);
+        k_exec_time[i] = compute_kernel_execution_time(kernel_events[i], k_start_time[i], k_end_time[i]);
+        clReleaseEvent(kernel_events[i]);
     }
+    kernel_events.clear();
+    kernel_buffers.clear();
 
     double k_earliest_start_time = k_start_time[0];
     double k_latest_end_time = k_end_time[0];
@@ -393,30 +761,222 @@ WEAK int32_t halide_opencl_wait_for_kernels_finish(void *user_context) {
     return 0;
 }
 
+WEAK int32_t halide_opencl_wait_for_kernels_finish(void *user_context) {
+    // Define the number of threads that will be created
+    // as well as the number of work groups
+    size_t globalWorkSize[1];
+    size_t localWorkSize[1];
+
+    //----------------------------------------------
+    // Enqueue the kernel for execution
+    //----------------------------------------------
+
+    // all kernels are always tasks
+    globalWorkSize[0] = 1;
+    localWorkSize[0] = 1;
+
+    // The previous launch might be still running if transfers are asynchronous.
+    finish_kernels();
+    kernel_events.resize(NUM_KERNELS_TO_CREATE);
+
+    DPRINTF("\n===== Host-CPU enqeuing the OpenCL kernels to the FPGA device ======\n\n");
+    for (int i = 0; i < NUM_KERNELS_TO_CREATE; i++) {
+        // With asynchronous transfers, a kernel waits for the copies into its buffer arguments.
+        std::vector<cl_event> inputs_ready;
+        if (async_transfer() && i < (int)kernel_buffers.size()) {
+            for (auto mem : kernel_buffers[i]) {
+                if (pending_writes.find(mem) != pending_writes.end()) {
+                    inputs_ready.push_back(pending_writes[mem]);
+                }
+            }
+        }
+        // Alternatively, can use clEnqueueTaskKernel
+        DPRINTF("clEnqueueNDRangeKernel[%d]: %s!\n", i, kernel_name[i]);
+        status = clEnqueueNDRangeKernel(
+            cmdQueue[i],
+            kernel[i],
+            1,
+            NULL,
+            globalWorkSize,
+            localWorkSize,
+            inputs_ready.size(),
+            inputs_ready.empty() ? NULL : inputs_ready.data(),
+            &kernel_events[i]);
+        CHECK(status);
+    }
+    DPRINTF("\n");
+    DPRINTF(" *** FPGA execution started!\n");
+    for (int i = 0; i < NUM_KERNELS_TO_CREATE; i++) {
+        status = clFlush(cmdQueue[i]);
+        CHECK(status);
+    }
+
+    if (async_transfer()) {
+        // Let the kernels run. Wait only for the copies, after which the host memory can be freed or reused.
+        // The kernels are finished after the output is copied back to the host (See halide_opencl_buffer_copy).
+        wait_for_pending_writes();
+        return 0;
+    }
+    return finish_kernels();
+}
+
+WEAK int32_t halide_opencl_session_end(void *user_context) {
+    if (!session_active) {
+        return 0;
+    }
+    finish_kernels();
+    write_timeline();
+    session_active = false;
+    // The device buffers belong to the context released below.
+    halide_opencl_pool_release(user_context);
+
+    // Unload the program. The next invocation, or session, loads it again.
+    for (int j = 0; j < NUM_KERNELS_TO_CREATE; j++) {
+        clReleaseKernel(kernel[j]);
+    }
+    clReleaseProgram(loaded_program);
+    loaded_program = NULL;
+    for (int i = 0; i <= NUM_QUEUES_TO_CREATE; i++) {
+        clReleaseCommandQueue(cmdQueue[i]);
+    }
+    clReleaseContext(context);
+    context = NULL;
+    return 0;
+}
+
 WEAK void halide_device_host_nop_free(void *user_context, void *obj) {
 }
 
+WEAK int32_t halide_opencl_pool_release(void *user_context) {
+    pool_clear(device_pool, release_device_handle);
+    pool_clear(host_pool, acl_aligned_free);
+    return 0;
+}
+
+WEAK void halide_opencl_get_pool_stats(struct halide_opencl_pool_stats_t *stats) {
+    const buffer_pool *pools[2] = {&device_pool, &host_pool};
+    halide_opencl_pool_stats_t::pool_stats *results[2] = {&stats->device, &stats->host};
+    for (int i = 0; i < 2; i++) {
+        results[i]->allocations     = pools[i]->allocations;
+        results[i]->hits            = pools[i]->hits;
+        results[i]->evictions       = pools[i]->evictions;
+        results[i]->idle_bytes      = pools[i]->idle_bytes;
+        results[i]->peak_idle_bytes = pools[i]->peak_idle_bytes;
+    }
+    stats->high_water_mark = pool_high_water_mark();
+}
+
+WEAK void halide_opencl_print_pool_stats(void *user_context) {
+    for (const buffer_pool *pool : {&device_pool, &host_pool}) {
+        printf("Pool of %s buffers: %llu allocations, %llu hits, %llu evictions, %llu bytes idle, %llu bytes idle at peak\n",
+               pool->name, (unsigned long long)pool->allocations, (unsigned long long)pool->hits,
+               (unsigned long long)pool->evictions, (unsigned long long)pool->idle_bytes,
+               (unsigned long long)pool->peak_idle_bytes);
+    }
+    printf("Pool high-water mark: %llu bytes\n", (unsigned long long)pool_high_water_mark());
+    fflush(stdout);
+}
+
+// Copy a buffer split into parts from, or to, the host, part by part. The copies are synchronous.
+static int copy_split_buffer(struct halide_buffer_t *src, struct halide_buffer_t *dst, bool from_host, bool to_host) {
+    if (from_host == to_host) {
+        std::cout << "halide_opencl_buffer_copy: copying a buffer split into parts from device to device is not supported.\n";
+        return -1;
+    }
+    // Wait for the kernels possibly using the buffer.
+    finish_kernels();
+    split_buffer *split = split_buffer_of(from_host ? dst : src);
+    size_t bytes = src->size_in_bytes();
+    std::cout << "Command queue " << current_kernel << ": copying " << bytes << " bytes data from "
+              << (from_host ? "host to device" : "device to host") << " in " << split->parts.size() << " parts. ";
+    for (size_t i = 0; i < split->parts.size() && i * split->part_bytes < bytes; i++) {
+        size_t offset = i * split->part_bytes;
+        size_t part_bytes = std::min(split->part_bytes, bytes - offset);
+        cl_event copied;
+        if (from_host) {
+            status = clEnqueueWriteBuffer(cmdQueue[current_kernel], split->parts[i], CL_TRUE, 0, part_bytes,
+                                          (void *)(src->host + offset), 0, NULL, timeline_event_of(&copied));
+        } else {
+            status = clEnqueueReadBuffer(cmdQueue[current_kernel], split->parts[i], CL_TRUE, 0, part_bytes,
+                                         (void *)(dst->host + offset), 0, NULL, timeline_event_of(&copied));
+        }
+        CHECK(status);
+        timeline_add_copy(from_host ? "host->device" : "device->host", part_bytes, copied);
+    }
+    std::cout << "Done.\n";
+    return 0;
+}
+
 WEAK int halide_opencl_buffer_copy(void *user_context, struct halide_buffer_t *src,
                                    struct halide_buffer_t *dst, bool to_host) {
     bool from_host = (src->device == 0) ||
                      (src->host_dirty() && src->host != NULL);
-    if (!from_host && to_host) {
+    if (split_buffer_of(src) != NULL || split_buffer_of(dst) != NULL) {
+        return copy_split_buffer(src, dst, from_host, to_host);
+    }
+    if (async_transfer() && !kernel_events.empty() && !(!from_host && to_host)) {
+        // Any other transfer starts a new launch of the kernels.
+        finish_kernels();
+    }
+    if (!from_host && to_host && async_transfer() && !kernel_events.empty()) {
+        // Read back as soon as the kernels writing the buffer finish, while the other kernels might still be running.
+        cl_mem mem = ((device_handle *)src->device)->mem;
+        std::vector<cl_event> written = events_of_kernels_using(mem);
+        if (written.empty()) {
+            written = kernel_events;
+        }
+        std::cout << "Command queue " << current_kernel << ": copying " << src->size_in_bytes() << " bytes data from device to host after "
+                  << written.size() << " kernel(s) finish. ";
+        cl_event copied;
+        status = clEnqueueReadBuffer(cmdQueue[current_kernel], mem,
+                                     CL_TRUE, 0, src->size_in_bytes(), (void *)(dst->host),
+                                     written.size(), written.data(), timeline_event_of(&copied));
+        CHECK(status);
+        timeline_add_copy("device->host", src->size_in_bytes(), copied);
+        std::cout << "Done.\n";
+        finish_kernels();
+    } else if (from_host && !to_host && async_transfer()) {
+        std::cout << "Command queue " << current_kernel << ": copying " << src->size_in_bytes() << " bytes data from host to device asynchronously.\n";
+        cl_mem mem = ((device_handle *)dst->device)->mem;
+        if (pending_writes.find(mem) != pending_writes.end()) {
+            // Keep the copies into the same buffer in order.
+            status = clWaitForEvents(1, &pending_writes[mem]);
+            CHECK(status);
+            clReleaseEvent(pending_writes[mem]);
+            pending_writes.erase(mem);
+        }
+        cl_event written;
+        status = clEnqueueWriteBuffer(cmdQueue[current_kernel], mem,
+                                      CL_FALSE, 0, src->size_in_bytes(), (void *)(src->host),
+                                      0, NULL, &written);
+        CHECK(status);
+        status = clFlush(cmdQueue[current_kernel]);
+        CHECK(status);
+        timeline_add("host->device", "copy", current_kernel, src->size_in_bytes(), written);
+        pending_writes[mem] = written;
+    } else if (!from_host && to_host) {
         std::cout << "Command queue " << current_kernel << ": copying " << src->size_in_bytes() << " bytes data from device to host. ";
+        cl_event copied;
         status = clEnqueueReadBuffer(cmdQueue[current_kernel], ((device_handle *)src->device)->mem,
                                      CL_TRUE, 0, src->size_in_bytes(), (void *)(dst->host),
-                                     0, NULL, NULL);
+                                     0, NULL, timeline_event_of(&copied));
+        timeline_add_copy("device->host", src->size_in_bytes(), copied);
         std::cout << "Done.\n";
     } else if (from_host && !to_host) {
         std::cout << "Command queue " << current_kernel << ": copying " << src->size_in_bytes() << " bytes data from host to device. ";
+        cl_event copied;
         status = clEnqueueWriteBuffer(cmdQueue[current_kernel], ((device_handle *)dst->device)->mem,
                                       CL_TRUE, 0, src->size_in_bytes(), (void *)(src->host),
-                                      0, NULL, NULL);
+                                      0, NULL, timeline_event_of(&copied));
+        timeline_add_copy("host->device", src->size_in_bytes(), copied);
         std::cout << "Done.\n";
     } else if (!from_host && !to_host) {
         std::cout << "Command queue " << current_kernel << ": copying " << src->size_in_bytes() << " bytes data from device to device. ";
+        cl_event copied;
         status = clEnqueueCopyBuffer(cmdQueue[current_kernel], ((device_handle *)src->device)->mem, ((device_handle *)dst->device)->mem,
                                      0, 0,
-                                     src->size_in_bytes(), 0, NULL, NULL);
+                                     src->size_in_bytes(), 0, NULL, timeline_event_of(&copied));
+        timeline_add_copy("device->device", src->size_in_bytes(), copied);
         std::cout << "Done.\n";
     } else if (dst->host != src->host) {
         std::cout << "Copying " << src->size_in_bytes() << " bytes data from host to host. ";
@@ -428,6 +988,54 @@ WEAK int halide_opencl_buffer_copy(void *user_context, struct halide_buffer_t *s
     return 0;
 }
 
+WEAK int32_t halide_opencl_set_kernel_buffer_arg(int kernel_index, cl_uint arg_index, cl_mem *mem) {
+    if (async_transfer() && !kernel_events.empty()) {
+        // Setting the arguments of a kernel starts a new launch of the kernels.
+        finish_kernels();
+    }
+    if ((int)kernel_buffers.size() <= kernel_index) {
+        kernel_buffers.resize(kernel_index + 1);
+    }
+    kernel_buffers[kernel_index].push_back(*mem);
+    return clSetKernelArg(kernel[kernel_index], arg_index, sizeof(cl_mem), (void *)mem);
+}
+
+WEAK int32_t halide_opencl_buffer_allow_split(struct halide_buffer_t *buf, int32_t parts) {
+    splittable_buffers[buf] = parts;
+    return 0;
+}
+
+WEAK cl_mem *halide_opencl_buffer_part(struct halide_buffer_t *buf, int part) {
+    split_buffer *split = split_buffer_of(buf);
+    if (split == NULL || part >= (int)split->parts.size()) {
+        // Any part not used by the buffer is an alias of the first part.
+        return &((device_handle *)buf->device)->mem;
+    }
+    return &split->parts[part];
+}
+
+WEAK int32_t halide_opencl_buffer_part_shift(struct halide_buffer_t *buf, int32_t elem_bytes, int32_t parts) {
+    split_buffer *split = split_buffer_of(buf);
+    uint64_t elems;
+    if (split == NULL) {
+        // The whole buffer is in the first part.
+        elems = buf->size_in_bytes() / elem_bytes;
+    } else {
+        if ((int32_t)split->parts.size() > parts) {
+            printf("The buffer is split into %d parts on the device, but the kernels are compiled for at most %d parts. "
+                   "Increase the parts in split_storage(), or $HL_BUFFER_PART_BYTES.\n",
+                   (int)split->parts.size(), parts);
+            exit(1);
+        }
+        elems = split->part_bytes / elem_bytes;
+    }
+    int32_t shift = 0;
+    while ((static_cast<uint64_t>(1) << shift) < elems) {
+        shift++;
+    }
+    return shift;
+}
+
 WEAK int halide_copy_to_device(void *user_context, struct halide_buffer_t *buf,
                                const struct halide_device_interface_t *device_interface) {
     return halide_opencl_buffer_copy(user_context, buf, buf, false);
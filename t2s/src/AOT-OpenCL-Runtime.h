@@ -1491,6 +1491,7 @@ typedef enum halide_target_feature_t {
     halide_target_feature_intel_fpga, ///< Enable Intel FPGAs
     halide_target_feature_intel_gpu, ///< Enable Intel Graphics
     halide_target_feature_enable_synthesis, ///< Enable synthesizing binaries. Currently used only for Intel FPGAs.
+    halide_target_feature_spatial_on_cpu, ///< Run the device funcs of a spatial design as concurrent threads on the host CPU.
     halide_target_feature_end ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
@@ -2423,6 +2424,46 @@ extern int32_t halide_device_and_host_free(void *, void *);
 extern int32_t halide_device_and_host_malloc(void *, struct halide_buffer_t *, struct halide_device_interface_t const *);
 extern struct halide_device_interface_t const *halide_opencl_device_interface();
 extern int32_t halide_opencl_wait_for_kernels_finish(void *);
+extern int32_t halide_opencl_set_kernel_buffer_arg(int, cl_uint, cl_mem *);
+
+// A buffer too big for a single device allocation is split into parts of a power-of-2 size (See Func::split_storage).
+// halide_opencl_buffer_allow_split declares a buffer splittable into at most the given parts before it is allocated,
+// as only such a buffer is addressed by the kernels as split. halide_opencl_buffer_part returns a part of a buffer,
+// and halide_opencl_buffer_part_shift the number of elements in a part, in log2, after checking that the buffer has
+// no more parts than the kernels are compiled for.
+extern int32_t halide_opencl_buffer_allow_split(struct halide_buffer_t *buf, int32_t parts);
+extern cl_mem *halide_opencl_buffer_part(struct halide_buffer_t *buf, int part);
+extern int32_t halide_opencl_buffer_part_shift(struct halide_buffer_t *buf, int32_t elem_bytes, int32_t parts);
+
+// A session for invoking a pipeline repeatedly. halide_opencl_session_begin loads the bitstream $BITSTREAM,
+// and creates the context, command queues and kernels, once. Within the session, the buffers the pipeline
+// allocates on the host and device are not freed after an invocation, but reused by the next invocation,
+// so that an invocation only binds its arguments and enqueues the kernels:
+//     halide_opencl_session_begin(NULL);
+//     for (...) {
+//         pipeline(inputs..., output);
+//     }
+//     halide_opencl_session_end(NULL);
+// halide_opencl_session_end waits for the kernels, and releases the buffers, kernels, program and context.
+extern int32_t halide_opencl_session_begin(void *user_context);
+extern int32_t halide_opencl_session_end(void *user_context);
+
+// Freed host and device buffers are kept in pools by size class, and reused by later allocations. The idle bytes
+// in either pool are bounded by $HL_POOL_HIGH_WATER_MARK (in bytes, with an optional K, M or G suffix; default: 1G).
+// halide_opencl_pool_release frees all the idle buffers.
+struct halide_opencl_pool_stats_t {
+    struct pool_stats {
+        uint64_t allocations;     // Allocations requested
+        uint64_t hits;            // Allocations served by an idle buffer in the pool
+        uint64_t evictions;       // Freed buffers not kept, as the pool reached the high-water mark
+        uint64_t idle_bytes;      // Bytes of the idle buffers in the pool now
+        uint64_t peak_idle_bytes;
+    } device, host;
+    uint64_t high_water_mark;
+};
+extern int32_t halide_opencl_pool_release(void *user_context);
+extern void halide_opencl_get_pool_stats(struct halide_opencl_pool_stats_t *stats);
+extern void halide_opencl_print_pool_stats(void *user_context);
 extern void halide_device_and_host_free_as_destructor(void *, void *);
 extern void halide_device_host_nop_free(void *, void *);
 
@@ -0,0 +1,177 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "../../Halide/src/Debug.h"
+#include "../../Halide/src/Error.h"
+#include "../../Halide/src/Util.h"
+#include "./BitstreamCache.h"
+#include "./Utilities.h"
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+
+namespace {
+
+bool read_file(const string &name, string &contents) {
+    std::ifstream fp(name, std::ios::in | std::ios::binary);
+    if (!fp) {
+        return false;
+    }
+    std::ostringstream ss;
+    ss << fp.rdbuf();
+    contents = ss.str();
+    return true;
+}
+
+// Write a file as a whole: write a temporary file first and then rename it, so that
+// another process sharing the cache never sees a partial file.
+bool write_file(const string &name, const string &contents) {
+    string temp = name + ".tmp";
+    {
+        std::ofstream fp(temp, std::ios::out | std::ios::binary);
+        if (!fp) {
+            return false;
+        }
+        fp << contents;
+        if (!fp.good()) {
+            return false;
+        }
+    }
+    return std::rename(temp.c_str(), name.c_str()) == 0;
+}
+
+bool copy_file(const string &from, const string &to) {
+    std::ifstream in(from, std::ios::in | std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    string temp = to + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::out | std::ios::binary);
+        if (!out) {
+            return false;
+        }
+        out << in.rdbuf();
+        if (!out.good()) {
+            return false;
+        }
+    }
+    return std::rename(temp.c_str(), to.c_str()) == 0;
+}
+
+string key_file_of(const string &bitstream_file) {
+    return bitstream_file.substr(0, bitstream_file.size() - string(".aocx").size()) + ".key";
+}
+
+} // namespace
+
+BitstreamCache::BitstreamCache(const string &source) : source(source) {
+    char *cache_dir = getenv("BITSTREAM_CACHE");
+    if (cache_dir != NULL && string(cache_dir) == "off") {
+        return;
+    }
+    if (cache_dir != NULL) {
+        dir = cache_dir;
+    } else if (getenv("HOME") != NULL) {
+        dir = string(getenv("HOME")) + "/tmp/bitstream_cache";
+    } else {
+        return;
+    }
+
+    char *aoc_option = getenv("AOC_OPTION");
+    string options = (aoc_option == NULL) ? "" : aoc_option;
+    string board;
+    for (const auto &opt : split_string(options, " ")) {
+        if (starts_with(opt, "-board=")) {
+            board = opt.substr(string("-board=").size());
+        }
+    }
+    if (board.empty() && getenv("FPGA_BOARD") != NULL) {
+        board = getenv("FPGA_BOARD");
+    }
+    key = "AOC_OPTION=" + options + "\nboard=" + board + "\n";
+    hash = hash_to_hex(source + '\0' + key);
+}
+
+bool BitstreamCache::is_stale(const string &bitstream_file) const {
+    string recorded;
+    if (!enabled() || !read_file(key_file_of(bitstream_file), recorded)) {
+        // Unknown origin, e.g. a bitstream generated ahead of time. Trust it.
+        return false;
+    }
+    return recorded != hash;
+}
+
+bool BitstreamCache::fetch(const string &bitstream_file) const {
+    if (!enabled()) {
+        return false;
+    }
+    // Compare the contents, not only the hash, to rule out any collision.
+    string cached_source, cached_key;
+    bool hit = read_file(entry_dir() + "/a.cl", cached_source) && cached_source == source &&
+               read_file(entry_dir() + "/key.txt", cached_key) && cached_key == key &&
+               copy_file(entry_dir() + "/a.aocx", bitstream_file);
+    log(hit ? "hit" : "miss", bitstream_file);
+    if (hit) {
+        write_file(key_file_of(bitstream_file), hash);
+        user_warning << "Bitstream " << bitstream_file << " is fetched from cache " << entry_dir() << ". No re-compilation.\n";
+    }
+    return hit;
+}
+
+void BitstreamCache::forget(const string &bitstream_file) const {
+    // Regardless of whether the cache is enabled: a key left from before would vouch for a bitstream compiled from
+    // another source. Without a key, the bitstream would be trusted as generated ahead of time, so leave a mark.
+    string key_file = key_file_of(bitstream_file);
+    std::remove(key_file.c_str());
+    write_file(key_file, "compiling");
+}
+
+void BitstreamCache::store(const string &bitstream_file) const {
+    if (!enabled()) {
+        return;
+    }
+    // The cache is only an optimization: if anything fails, the bitstream is simply not cached.
+    bool stored = make_dirs(entry_dir()) &&
+                  copy_file(bitstream_file, entry_dir() + "/a.aocx") &&
+                  write_file(entry_dir() + "/key.txt", key) &&
+                  write_file(entry_dir() + "/a.cl", source);
+    log(stored ? "store" : "store-failed", bitstream_file);
+    write_file(key_file_of(bitstream_file), hash);
+    debug(1) << "Bitstream " << bitstream_file << (stored ? " is stored into cache " : " cannot be stored into cache ")
+             << entry_dir() << "\n";
+}
+
+void BitstreamCache::log(const string &event, const string &bitstream_file) const {
+    if (!make_dirs(dir)) {
+        return;
+    }
+    std::ofstream fp(dir + "/log.txt", std::ios::out | std::ios::app);
+    if (fp) {
+        fp << (long long)std::time(NULL) << " " << event << " " << hash << " " << bitstream_file << "\n";
+    }
+}
+
+}
+}
@@ -0,0 +1,75 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_BITSTREAM_CACHE_H
+#define T2S_BITSTREAM_CACHE_H
+
+/** \file
+ *
+ * Defines a content-addressed cache of FPGA bitstreams, so that an unchanged design is not synthesized again.
+ *
+ */
+
+#include <string>
+
+namespace Halide {
+namespace Internal {
+
+/* A bitstream is identified by a hash of the source code, the AOC_OPTION flags and the board. Every entry of the cache
+ * is a sub-directory of the cache directory, named by the hash, with the source, the key and the bitstream. Every
+ * lookup appends a hit or miss record to log.txt in the cache directory.
+ * Environment variables:
+ *   BITSTREAM_CACHE: the cache directory. Default: $HOME/tmp/bitstream_cache. Set it to "off" to disable the cache.
+ *   AOC_OPTION:      the options for aoc. The board is the one given by -board=, or $FPGA_BOARD if no -board= is given.
+ * A bitstream compiled or fetched with the cache has a companion file (.aocx replaced with .key) recording the hash,
+ * which tells if an existing bitstream is out of date. While the bitstream is being compiled, or if it is compiled
+ * from a source modified by hand (See WAIT), the companion file records no hash, and the bitstream is out of date.
+ */
+class BitstreamCache {
+public:
+    BitstreamCache(const std::string &source);
+
+    bool enabled() const { return !dir.empty(); }
+
+    // The bitstream file is known to be compiled from a different source, AOC_OPTION or board.
+    bool is_stale(const std::string &bitstream_file) const;
+
+    // On a hit, copy the cached bitstream to the bitstream file and return true.
+    bool fetch(const std::string &bitstream_file) const;
+
+    // The bitstream file is about to be compiled: replace its hash with a mark that matches no hash, so that the
+    // bitstream is taken as stale until it is successfully compiled from the source and stored.
+    void forget(const std::string &bitstream_file) const;
+
+    // Save the bitstream file just compiled from the source.
+    void store(const std::string &bitstream_file) const;
+
+private:
+    std::string dir;     // The cache directory. Empty if the cache is disabled.
+    std::string source;
+    std::string key;     // The options and the board, in text
+    std::string hash;    // The hash of the source and key, in hex
+
+    std::string entry_dir() const { return dir + "/" + hash; }
+    void log(const std::string &event, const std::string &bitstream_file) const;
+};
+
+}
+}
+
+#endif
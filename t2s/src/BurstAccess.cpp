@@ -0,0 +1,325 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "../../Halide/src/IRMutator.h"
+#include "../../Halide/src/IROperator.h"
+#include "../../Halide/src/ModulusRemainder.h"
+#include "../../Halide/src/Scope.h"
+#include "../../Halide/src/Simplify.h"
+#include "../../Halide/src/Substitute.h"
+#include "../../Halide/src/Util.h"
+#include "./BurstAccess.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// An access to a buffer in the body of a loop.
+struct Access {
+    const Load *load = nullptr;
+    const Store *store = nullptr;
+    Expr base;          // The base of the ramp index, with the lets in the loop body substituted
+    bool coalescable = true;
+};
+
+// Collect the accesses to the buffers to coalesce in the body of an innermost loop.
+class CollectAccesses : public IRVisitor {
+    using IRVisitor::visit;
+    const map<string, int> &bursts;
+    vector<std::pair<string, Expr>> lets;   // Lets in the loop body enclosing the current node, outermost first
+    int conditional = 0;                    // Depth of conditionals enclosing the current node
+
+    Expr substitute_lets(Expr e) const {
+        for (auto l = lets.rbegin(); l != lets.rend(); l++) {
+            e = substitute(l->first, l->second, e);
+        }
+        return e;
+    }
+
+    void record(const string &name, const Expr &index, const Expr &predicate, Access &a) {
+        const Ramp *ramp = index.as<Ramp>();
+        if (conditional > 0 || !is_one(predicate) || !ramp || !is_one(ramp->stride) ||
+            a.load || a.store) {
+            a.coalescable = false;
+            return;
+        }
+        a.base = substitute_lets(ramp->base);
+        if (!is_pure(a.base)) {
+            a.coalescable = false;
+        }
+    }
+
+public:
+    CollectAccesses(const map<string, int> &bursts) : bursts(bursts) {}
+
+    map<string, Access> accesses;
+
+    void visit(const Load *op) override {
+        IRVisitor::visit(op);
+        if (bursts.count(op->name)) {
+            Access &a = accesses[op->name];
+            record(op->name, op->index, op->predicate, a);
+            a.load = op;
+        }
+    }
+
+    void visit(const Store *op) override {
+        IRVisitor::visit(op);
+        if (bursts.count(op->name)) {
+            Access &a = accesses[op->name];
+            record(op->name, op->index, op->predicate, a);
+            a.store = op;
+        }
+    }
+
+    void visit(const Let *op) override {
+        op->value.accept(this);
+        lets.push_back({op->name, op->value});
+        op->body.accept(this);
+        lets.pop_back();
+    }
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        lets.push_back({op->name, op->value});
+        op->body.accept(this);
+        lets.pop_back();
+    }
+
+    void visit(const Select *op) override {
+        op->condition.accept(this);
+        conditional++;
+        op->true_value.accept(this);
+        op->false_value.accept(this);
+        conditional--;
+    }
+
+    void visit(const IfThenElse *op) override {
+        op->condition.accept(this);
+        conditional++;
+        op->then_case.accept(this);
+        if (op->else_case.defined()) {
+            op->else_case.accept(this);
+        }
+        conditional--;
+    }
+};
+
+class ContainsLoop : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        found = true;
+    }
+
+public:
+    bool found = false;
+};
+
+// An access coalesced into bursts.
+struct Burst {
+    string buffer;      // The buffer in DRAM
+    string registers;   // The register buffer holding a burst
+    Access access;
+    Type type;          // The type of the access
+    int vectors;        // The accesses in a burst
+    Expr offset;        // The offset of the access in the register buffer
+};
+
+// Redirect the coalesced loads and stores to their register buffers.
+class RedirectToBursts : public IRMutator {
+    using IRMutator::visit;
+    const vector<Burst> &bursts;
+
+    Expr visit(const Load *op) override {
+        for (auto &b : bursts) {
+            if (op == b.access.load) {
+                return Load::make(op->type, b.registers, Ramp::make(b.offset, 1, b.type.lanes()), Buffer<>(),
+                                  Parameter(), const_true(b.type.lanes()), ModulusRemainder());
+            }
+        }
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Store *op) override {
+        for (auto &b : bursts) {
+            if (op == b.access.store) {
+                return Store::make(b.registers, mutate(op->value), Ramp::make(b.offset, 1, b.type.lanes()),
+                                   Parameter(), const_true(b.type.lanes()), ModulusRemainder());
+            }
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    RedirectToBursts(const vector<Burst> &bursts) : bursts(bursts) {}
+};
+
+class CoalesceBursts : public IRMutator {
+    using IRMutator::visit;
+    const map<string, int> &burst_bits;
+    const map<string, int> &storage_parts;  // Buffer -> max number of parts, for the buffers whose storage is split
+    Scope<ModulusRemainder> alignment;      // Alignment of the variables defined by the enclosing lets
+
+    // Is a burst of the given lanes from the base within a part of a split buffer? As in split_storage(), the
+    // lanes must be a power of 2, the burst must fit in 4096 bytes, and the base must be a multiple of the lanes.
+    bool in_one_part(Expr base, int lanes, int elem_bytes) {
+        if ((lanes & (lanes - 1)) != 0 || lanes * elem_bytes > 4096) {
+            return false;
+        }
+        ModulusRemainder mod_rem = modulus_remainder(base, alignment);
+        return mod_rem.modulus % lanes == 0 && mod_rem.remainder % lanes == 0;
+    }
+
+    // The vectors of an access in a burst, or 1 if the access cannot be coalesced.
+    int vectors_per_burst(const For *op, const string &name, const Access &a) {
+        if (!a.coalescable) {
+            return 1;
+        }
+        Type t = a.load ? a.load->type : a.store->value.type();
+        int vectors = burst_bits.at(name) / (t.bits() * t.lanes());
+        const int64_t *extent = as_const_int(op->extent);
+        if (vectors < 2 || !extent) {
+            return 1;
+        }
+        while (vectors > 1 && *extent % vectors != 0) {
+            vectors /= 2;
+        }
+        // The next iteration must access the vector right after this one.
+        Expr next = substitute(op->name, Variable::make(Int(32), op->name) + 1, a.base);
+        if (!is_const(simplify(next - a.base), t.lanes())) {
+            return 1;
+        }
+        if (storage_parts.count(name)) {
+            // A burst starts every few iterations from the first one. Make it no wider than its start is known to be
+            // aligned, so that it is within a part of the buffer, and split_storage() accesses the part directly.
+            Expr start = simplify(substitute(op->name, op->min, a.base));
+            while (vectors > 1 && !in_one_part(start, vectors * t.lanes(), t.bytes())) {
+                vectors /= 2;
+            }
+        }
+        return vectors;
+    }
+
+    Expr visit(const Let *op) override {
+        ScopedBinding<ModulusRemainder> bind(op->value.type() == Int(32), alignment, op->name,
+                                             modulus_remainder(op->value, alignment));
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        ScopedBinding<ModulusRemainder> bind(op->value.type() == Int(32), alignment, op->name,
+                                             modulus_remainder(op->value, alignment));
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const For *op) override {
+        ContainsLoop inner;
+        op->body.accept(&inner);
+        if (inner.found || op->for_type != ForType::Serial) {
+            return IRMutator::visit(op);
+        }
+        CollectAccesses collector(burst_bits);
+        op->body.accept(&collector);
+
+        Expr loop_var = Variable::make(Int(32), op->name);
+        vector<Burst> bursts;
+        for (auto &entry : collector.accesses) {
+            const Access &a = entry.second;
+            int vectors = vectors_per_burst(op, entry.first, a);
+            if (vectors > 1) {
+                Type t = a.load ? a.load->type : a.store->value.type();
+                Expr offset = simplify((loop_var - op->min) % vectors * t.lanes());
+                bursts.push_back({entry.first, unique_name(entry.first + ".burst"), a, t, vectors, offset});
+                debug(3) << "Coalesce the accesses to " << entry.first << " in loop " << op->name
+                         << " into bursts of " << vectors << " x " << t << "\n";
+            }
+        }
+        if (bursts.empty()) {
+            return op;
+        }
+
+        Stmt body = RedirectToBursts(bursts).mutate(op->body);
+        for (auto &b : bursts) {
+            int wide_lanes = b.type.lanes() * b.vectors;
+            Type wide = b.type.with_lanes(wide_lanes);
+            Expr position = simplify((loop_var - op->min) % b.vectors);
+            Expr whole = Ramp::make(0, 1, wide_lanes);
+            if (b.access.load) {
+                // Load a burst before its first vector is used.
+                Expr load = Load::make(wide, b.buffer, Ramp::make(b.access.base, 1, wide_lanes), b.access.load->image,
+                                       b.access.load->param, const_true(wide_lanes), ModulusRemainder());
+                Stmt fill = Store::make(b.registers, load, whole, Parameter(), const_true(wide_lanes),
+                                        ModulusRemainder());
+                body = Block::make(IfThenElse::make(position == 0, fill), body);
+            } else {
+                // Store a burst after its last vector is collected.
+                Expr first = simplify(substitute(op->name, loop_var - (b.vectors - 1), b.access.base));
+                Expr value = Load::make(wide, b.registers, whole, Buffer<>(), Parameter(), const_true(wide_lanes),
+                                        ModulusRemainder());
+                Stmt drain = Store::make(b.buffer, value, Ramp::make(first, 1, wide_lanes), b.access.store->param,
+                                         const_true(wide_lanes), ModulusRemainder());
+                body = Block::make(body, IfThenElse::make(position == b.vectors - 1, drain));
+            }
+        }
+        Stmt s = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        for (auto &b : bursts) {
+            s = Block::make(s, Free::make(b.registers));
+            s = Allocate::make(b.registers, b.type.element_of(), MemoryType::Register,
+                               {b.type.lanes() * b.vectors}, const_true(), s);
+        }
+        return s;
+    }
+
+public:
+    CoalesceBursts(const map<string, int> &burst_bits, const map<string, int> &storage_parts)
+        : burst_bits(burst_bits), storage_parts(storage_parts) {}
+};
+
+} // namespace
+
+Stmt coalesce_bursts(Stmt s, const map<string, Function> &env) {
+    map<string, int> bursts;
+    map<string, int> storage_parts;
+    for (auto &e : env) {
+        const Function &f = e.second;
+        if (f.burst_bits() <= 0) {
+            continue;
+        }
+        for (int i = 0; i < f.outputs(); i++) {
+            string buffer = f.outputs() == 1 ? f.name() : f.name() + "." + std::to_string(i);
+            bursts[buffer] = f.burst_bits();
+            if (f.storage_parts() > 1) {
+                storage_parts[buffer] = f.storage_parts();
+            }
+        }
+    }
+    if (bursts.empty()) {
+        return s;
+    }
+    CoalesceBursts coalescer(bursts, storage_parts);
+    return coalescer.mutate(s);
+}
+
+}
+}
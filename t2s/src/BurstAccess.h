@@ -0,0 +1,55 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_BURST_ACCESS_H
+#define T2S_BURST_ACCESS_H
+
+/** \file
+ *
+ * Defines a pass to coalesce the DRAM accesses of device kernels into bursts of the memory interface (See Func::burst).
+ */
+
+#include "../../Halide/src/Function.h"
+#include "../../Halide/src/IR.h"
+#include <map>
+
+namespace Halide {
+namespace Internal {
+
+/* For every buffer whose accesses are to be coalesced into bursts of B bits, look for the innermost serial loop of a
+ * kernel that loads (stores) a vector of E elements of T from (to) the buffer, unconditionally, at consecutive addresses
+ * in consecutive iterations of the loop, like a loader (unloader) reading (writing) the data serialized by the host:
+ *     for (l, min, extent)
+ *         write_channel("loader.channel", buffer[ramp(base(l), 1, E)])
+ * The loop accesses R = B / (E * bits(T)) vectors per burst, R being limited to a power of 2 dividing the extent:
+ *     allocate buffer.burst[E * R] in registers
+ *     for (l, min, extent)
+ *         if ((l - min) % R == 0)
+ *             buffer.burst[ramp(0, 1, E * R)] = buffer[ramp(base(l), 1, E * R)]
+ *         write_channel("loader.channel", buffer.burst[ramp((l - min) % R * E, 1, E)])
+ * A store is collected into the register buffer likewise, and written after the last vector of a burst. The vector
+ * width of the channels is not changed, so the wide word is adapted to the compute design over the channel.
+ * If the storage of the buffer is split, R is further limited so that E * R is a power of 2 that provably divides
+ * the base of the first burst, base(min), and every burst is within a part of the buffer (See split_storage).
+ */
+extern Stmt coalesce_bursts(Stmt s, const std::map<std::string, Function> &env);
+
+}
+}
+
+#endif
@@ -0,0 +1,479 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "../../Halide/src/Debug.h"
+#include "../../Halide/src/Error.h"
+#include "../../Halide/src/ExprUsesVar.h"
+#include "../../Halide/src/IROperator.h"
+#include "../../Halide/src/IRPrinter.h"
+#include "../../Halide/src/IRVisitor.h"
+#include "../../Halide/src/Simplify.h"
+#include "../../Halide/src/Util.h"
+#include "./ChannelCheck.h"
+#include "./Utilities.h"
+#include <algorithm>
+#include <functional>
+#include <sstream>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// A step from the top of the IR down to an access: a Block and which of its two statements, a loop, or a branch.
+struct PathStep {
+    const IRNode *node;
+    int           child;
+    int64_t       extent; // For a serial loop: the constant extent, or -1 if unknown. Otherwise, 1.
+};
+
+struct Access {
+    string           kernel;
+    string           channel;   // The channel with its constant indices, e.g. A.channel[0][3]
+    bool             is_write;
+    bool             guarded;   // Under a condition
+    int64_t          tokens;    // -1 if unknown
+    vector<PathStep> path;
+    string           loop_nest; // For reporting
+};
+
+// The order of the first executions of two accesses in the same kernel.
+enum class Order { Before, After, Unknown };
+
+// Compare the first executions of a and b. If they are ordered by a Block, return the index of the Block in the paths.
+Order compare(const Access &a, const Access &b, size_t &divergence) {
+    size_t i = 0;
+    for (; i < a.path.size() && i < b.path.size(); i++) {
+        if (a.path[i].node != b.path[i].node) {
+            return Order::Unknown;
+        }
+        if (a.path[i].child != b.path[i].child) {
+            divergence = i;
+            if (a.path[i].node->node_type != IRNodeType::Block) {
+                return Order::Unknown; // The two branches of a condition
+            }
+            return (a.path[i].child < b.path[i].child) ? Order::Before : Order::After;
+        }
+    }
+    if (a.path.size() == b.path.size() && !a.is_write && b.is_write) {
+        // In the same statement, e.g. write_channel(B, read_channel(A)): the read is evaluated first.
+        divergence = i;
+        return Order::Before;
+    }
+    return Order::Unknown;
+}
+
+// The tokens a kernel accesses in a burst under the point of divergence. -1 if unknown.
+int64_t burst_below(const Access &a, size_t divergence) {
+    int64_t burst = 1;
+    for (size_t i = divergence + 1; i < a.path.size(); i++) {
+        if (a.path[i].extent < 0) {
+            return -1;
+        }
+        burst *= a.path[i].extent;
+    }
+    return burst;
+}
+
+class CollectAccesses : public IRVisitor {
+    using IRVisitor::visit;
+
+    vector<PathStep>   path;
+    vector<const For*> loops;
+    vector<Expr>       guards;
+
+    // The serial loops of the kernel enclosing the current access, outermost first
+    vector<const For *> kernel_loops(const string &kernel) const {
+        vector<const For *> result;
+        for (int i = (int)loops.size() - 1; i >= 0 && extract_first_token(loops[i]->name) == kernel; i--) {
+            if (loops[i]->for_type != ForType::Unrolled && loops[i]->for_type != ForType::Vectorized) {
+                result.insert(result.begin(), loops[i]);
+            }
+        }
+        return result;
+    }
+
+    // Tokens of the current access. Every condition must pin a loop of the kernel to a single value.
+    int64_t count_tokens(const vector<const For *> &loops_of_kernel) const {
+        set<string> pinned;
+        for (const auto &g : guards) {
+            for (const auto &c : break_logic_into_conjunction(g)) {
+                const EQ *eq = c.as<EQ>();
+                const Variable *var = eq ? eq->a.as<Variable>() : NULL;
+                Expr other = eq ? eq->b : Expr();
+                if (eq && !var) {
+                    var = eq->b.as<Variable>();
+                    other = eq->a;
+                }
+                bool ok = (var != NULL);
+                for (auto l : loops_of_kernel) {
+                    ok = ok && !expr_uses_var(other, l->name);
+                }
+                bool is_loop = false;
+                for (auto l : loops_of_kernel) {
+                    is_loop = is_loop || (var && l->name == var->name);
+                }
+                if (!ok || !is_loop) {
+                    return -1;
+                }
+                pinned.insert(var->name);
+            }
+        }
+        int64_t tokens = 1;
+        for (auto l : loops_of_kernel) {
+            if (pinned.count(l->name) > 0) {
+                continue;
+            }
+            const int64_t *extent = as_const_int(simplify(l->extent));
+            if (extent == NULL) {
+                return -1;
+            }
+            tokens *= *extent;
+        }
+        return tokens;
+    }
+
+    void record(const Call *op, bool is_write) {
+        const StringImm *name = op->args[0].as<StringImm>();
+        internal_assert(name);
+        Access a;
+        a.kernel = loops.empty() ? "" : extract_first_token(loops.back()->name);
+        a.channel = name->value;
+        // A write has the value as its second argument, and the indices follow.
+        for (size_t i = is_write ? 2 : 1; i < op->args.size(); i++) {
+            const int64_t *index = as_const_int(op->args[i]);
+            a.channel += "[" + (index ? std::to_string(*index) : string("*")) + "]";
+        }
+        a.is_write = is_write;
+        a.guarded = !guards.empty();
+        vector<const For *> loops_of_kernel = kernel_loops(a.kernel);
+        a.tokens = count_tokens(loops_of_kernel);
+        a.path = path;
+        std::ostringstream nest;
+        for (auto l : loops_of_kernel) {
+            nest << "for " << l->name << " in [" << l->min << ", " << l->min << " + " << l->extent << ") ";
+        }
+        for (const auto &g : guards) {
+            nest << "if (" << g << ") ";
+        }
+        a.loop_nest = nest.str();
+        accesses.push_back(a);
+    }
+
+public:
+    vector<Access>       accesses;
+    map<string, int64_t> depths;       // Channel (without indices) -> depth, if constant
+    set<string>          non_blocking; // Channels accessed without blocking, which are not checked
+
+    void visit(const Realize *op) override {
+        string name = ends_with(op->name, ".array") ? remove_postfix(op->name, ".array") : op->name;
+        if (ends_with(name, ".channel") && !op->bounds.empty()) {
+            const int64_t *depth = as_const_int(op->bounds.back().extent);
+            if (depth) {
+                depths[name] = *depth;
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Block *op) override {
+        path.push_back(PathStep{op, 0, 1});
+        op->first.accept(this);
+        path.back().child = 1;
+        op->rest.accept(this);
+        path.pop_back();
+    }
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        int64_t extent = 1;
+        if (op->for_type != ForType::Unrolled && op->for_type != ForType::Vectorized) {
+            const int64_t *e = as_const_int(simplify(op->extent));
+            extent = e ? *e : -1;
+        }
+        path.push_back(PathStep{op, 0, extent});
+        loops.push_back(op);
+        op->body.accept(this);
+        loops.pop_back();
+        path.pop_back();
+    }
+
+    void visit(const IfThenElse *op) override {
+        op->condition.accept(this);
+        path.push_back(PathStep{op, 0, 1});
+        guards.push_back(op->condition);
+        op->then_case.accept(this);
+        guards.pop_back();
+        if (op->else_case.defined()) {
+            path.back().child = 1;
+            guards.push_back(!op->condition);
+            op->else_case.accept(this);
+            guards.pop_back();
+        }
+        path.pop_back();
+    }
+
+    void visit(const Select *op) override {
+        op->condition.accept(this);
+        guards.push_back(op->condition);
+        op->true_value.accept(this);
+        guards.pop_back();
+        guards.push_back(!op->condition);
+        op->false_value.accept(this);
+        guards.pop_back();
+    }
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->is_intrinsic(Call::write_channel) || op->is_intrinsic(Call::read_channel)) {
+            record(op, op->is_intrinsic(Call::write_channel));
+        } else if (op->is_intrinsic(Call::write_channel_nb) || op->is_intrinsic(Call::read_channel_nb)) {
+            const StringImm *name = op->args[0].as<StringImm>();
+            internal_assert(name);
+            non_blocking.insert(name->value);
+        }
+    }
+};
+
+class ChannelChecker {
+    const CollectAccesses &c;
+    vector<string>         issues;
+
+    // Accesses of every channel, by the kernels writing and reading it
+    map<string, vector<const Access *>> writes, reads;
+
+    bool checked(const Access &a) const {
+        return !a.kernel.empty() && c.non_blocking.count(a.channel.substr(0, a.channel.find('['))) == 0;
+    }
+
+    int64_t depth_of(const string &channel) const {
+        auto d = c.depths.find(channel.substr(0, channel.find('[')));
+        return (d == c.depths.end()) ? -1 : d->second;
+    }
+
+    static string where(const Access &a) {
+        return "\t" + a.kernel + ": " + a.loop_nest + (a.is_write ? "write " : "read ") + a.channel + "\n";
+    }
+
+    void check_counts() {
+        set<string> channels;
+        for (const auto &w : writes) channels.insert(w.first);
+        for (const auto &r : reads) channels.insert(r.first);
+        for (const auto &ch : channels) {
+            auto w = writes.find(ch);
+            auto r = reads.find(ch);
+            if (w == writes.end() || r == reads.end()) {
+                const Access &a = (w == writes.end()) ? *r->second[0] : *w->second[0];
+                issues.push_back("Channel " + ch + (a.is_write ? " is written but never read" : " is read but never written") +
+                                 ", which blocks kernel " + a.kernel + ":\n" + where(a));
+                continue;
+            }
+            int64_t written = 0, read = 0;
+            for (auto a : w->second) {
+                written = (written < 0 || a->tokens < 0) ? -1 : written + a->tokens;
+            }
+            for (auto a : r->second) {
+                read = (read < 0 || a->tokens < 0) ? -1 : read + a->tokens;
+            }
+            if (written >= 0 && read >= 0 && written != read) {
+                string msg = "Channel " + ch + " has " + std::to_string(written) + " tokens written but " +
+                             std::to_string(read) + " tokens read:\n";
+                for (auto a : w->second) msg += where(*a);
+                for (auto a : r->second) msg += where(*a);
+                issues.push_back(msg);
+            }
+        }
+    }
+
+    void check_orders() {
+        set<std::pair<string, string>> reported;
+        for (const auto &wx : writes) {
+            for (const auto &wy : writes) {
+                const string &x = wx.first, &y = wy.first;
+                if (x == y || reads.count(x) == 0 || reads.count(y) == 0 || reported.count({x, y}) > 0) {
+                    continue;
+                }
+                for (auto ax : wx.second) {
+                    for (auto ay : wy.second) {
+                        size_t div_p = 0;
+                        if (ax->kernel != ay->kernel || compare(*ax, *ay, div_p) != Order::Before) {
+                            continue;
+                        }
+                        int64_t burst = burst_below(*ax, div_p);
+                        int64_t depth = depth_of(x);
+                        if (burst >= 0 && burst <= depth) {
+                            continue;
+                        }
+                        for (auto rx : reads.at(x)) {
+                            for (auto ry : reads.at(y)) {
+                                size_t div_c = 0;
+                                if (rx->kernel != ry->kernel || reported.count({x, y}) > 0 ||
+                                    compare(*ry, *rx, div_c) != Order::Before) {
+                                    continue;
+                                }
+                                reported.insert({x, y});
+                                issues.push_back("Potential deadlock: kernel " + ax->kernel + " writes " +
+                                                 ((burst < 0) ? string("an unknown number of") : std::to_string(burst)) +
+                                                 " tokens into " + x + " before writing " + y + ", but kernel " +
+                                                 rx->kernel + " reads " + y + " before " + x + ", and " + x +
+                                                 " has depth " + std::to_string(std::max(depth, (int64_t)0)) + ":\n" +
+                                                 where(*ax) + where(*ay) + where(*ry) + where(*rx));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Does the kernel read one of the channels before every write into one of the other channels?
+    bool reads_before_writes(const string &kernel, const vector<string> &in, const vector<string> &out,
+                             vector<const Access *> &witnesses) const {
+        for (const auto &o : out) {
+            for (auto w : writes.at(o)) {
+                if (w->kernel != kernel) {
+                    continue;
+                }
+                const Access *before = NULL;
+                for (const auto &i : in) {
+                    for (auto r : reads.at(i)) {
+                        size_t div = 0;
+                        if (r->kernel == kernel && !r->guarded && compare(*r, *w, div) == Order::Before) {
+                            before = r;
+                        }
+                    }
+                }
+                if (before == NULL) {
+                    return false;
+                }
+                witnesses.push_back(before);
+                witnesses.push_back(w);
+            }
+        }
+        return true;
+    }
+
+    void check_cycles() {
+        // The channels from a kernel to another
+        map<string, map<string, vector<string>>> edges;
+        for (const auto &w : writes) {
+            if (reads.count(w.first) == 0) {
+                continue;
+            }
+            for (auto a : w.second) {
+                for (auto r : reads.at(w.first)) {
+                    if (r->kernel != a->kernel) {
+                        auto &chs = edges[a->kernel][r->kernel];
+                        if (std::find(chs.begin(), chs.end(), w.first) == chs.end()) {
+                            chs.push_back(w.first);
+                        }
+                    }
+                }
+            }
+        }
+        // Enumerate the simple cycles, each from its smallest kernel. The graphs are small.
+        const size_t max_cycles = 64;
+        size_t found = 0;
+        vector<string> stack;
+        std::function<void(const string &)> dfs = [&](const string &k) {
+            if (found >= max_cycles || edges.count(k) == 0) {
+                return;
+            }
+            for (const auto &e : edges.at(k)) {
+                const string &next = e.first;
+                if (next == stack[0]) {
+                    found++;
+                    check_cycle(stack, edges);
+                } else if (next > stack[0] && std::find(stack.begin(), stack.end(), next) == stack.end()) {
+                    stack.push_back(next);
+                    dfs(next);
+                    stack.pop_back();
+                }
+            }
+        };
+        for (const auto &e : edges) {
+            stack = {e.first};
+            dfs(e.first);
+        }
+    }
+
+    void check_cycle(const vector<string> &cycle, map<string, map<string, vector<string>>> &edges) {
+        vector<const Access *> witnesses;
+        size_t n = cycle.size();
+        for (size_t i = 0; i < n; i++) {
+            const string &prev = cycle[(i + n - 1) % n], &k = cycle[i], &next = cycle[(i + 1) % n];
+            if (!reads_before_writes(k, edges[prev][k], edges[k][next], witnesses)) {
+                return;
+            }
+        }
+        string kernels;
+        for (const auto &k : cycle) {
+            kernels += k + " -> ";
+        }
+        string msg = "Deadlock: in the cycle of kernels " + kernels + cycle[0] +
+                     ", every kernel reads from its predecessor before writing into its successor:\n";
+        for (auto a : witnesses) {
+            msg += where(*a);
+        }
+        issues.push_back(msg);
+    }
+
+public:
+    ChannelChecker(const CollectAccesses &c) : c(c) {
+        for (const auto &a : c.accesses) {
+            if (checked(a)) {
+                (a.is_write ? writes : reads)[a.channel].push_back(&a);
+            }
+        }
+    }
+
+    const vector<string> &check() {
+        check_counts();
+        check_orders();
+        check_cycles();
+        return issues;
+    }
+};
+
+} // namespace
+
+void check_channels(const Stmt &s) {
+    char *setting = getenv("HL_CHANNEL_CHECK");
+    if (setting != NULL && string(setting) == "off") {
+        return;
+    }
+    CollectAccesses collector;
+    s.accept(&collector);
+    ChannelChecker checker(collector);
+    const vector<string> &issues = checker.check();
+    for (const auto &issue : issues) {
+        user_warning << issue;
+    }
+    debug(1) << "Checked " << collector.accesses.size() << " channel accesses: " << issues.size() << " issues\n";
+    user_assert(issues.empty() || setting == NULL || string(setting) != "error")
+        << issues.size() << " issues with channels (HL_CHANNEL_CHECK=error)\n";
+}
+
+}
+}
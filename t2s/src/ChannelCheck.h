@@ -0,0 +1,51 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_CHANNEL_CHECK_H
+#define T2S_CHANNEL_CHECK_H
+
+/** \file
+ *
+ * Defines an analysis of the channel graph that warns of deadlocks at compile time.
+ *
+ */
+
+#include "../../Halide/src/IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/* Check the read/write orders and counts of the channels between the kernels, after the channels are combined and
+ * promoted. A channel of a channel array (i.e. with constant indices) is checked on its own. For every channel:
+ *  1. Count mismatch: the tokens written and read differ, or the channel is only written or only read. The tokens of
+ *     an access are the product of the extents of its serial loops, divided by the extent of any loop pinned by a
+ *     condition like k == K - 1. An access under any other condition has an unknown count, and is not checked.
+ *  2. Order inversion: a kernel writes a burst of tokens into channel X and then writes channel Y, while the kernel
+ *     reading both reads Y before X. If the burst exceeds the depth of X, both kernels wait for each other.
+ *  3. Cycle: every kernel in a cycle of the channel graph reads from its predecessor before it writes into its
+ *     successor, and nothing initially is in the channels.
+ * Every issue is reported as a warning, with the loop nests of the accesses causing it.
+ * Environment variable HL_CHANNEL_CHECK: set to "off" to disable the check, or "error" to fail the compilation
+ * if there is any issue.
+ */
+extern void check_channels(const Stmt &s);
+
+}
+}
+
+#endif
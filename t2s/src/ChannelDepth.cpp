@@ -0,0 +1,329 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "../../Halide/src/Debug.h"
+#include "../../Halide/src/Error.h"
+#include "../../Halide/src/ExprUsesVar.h"
+#include "../../Halide/src/IRMutator.h"
+#include "../../Halide/src/IROperator.h"
+#include "../../Halide/src/IRVisitor.h"
+#include "../../Halide/src/Simplify.h"
+#include "../../Halide/src/Util.h"
+#include "./ChannelDepth.h"
+#include "./Utilities.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The tokens a channel buffers for a side stalled by the device memory, and for the latency of the pipelines otherwise.
+const int64_t memory_latency_slack   = 64;
+const int64_t pipeline_latency_slack = 16;
+
+// No channel is made deeper than this.
+const int64_t max_inferred_depth = 1 << 16;
+
+// How a kernel accesses a channel.
+struct ChannelSide {
+    string  func;           // The function whose loops enclose the access
+    bool    known = false;  // All the serial loops around the access have constant extents
+    int64_t burst = 1;      // The consecutive iterations accessing the channel
+    int64_t period = 1;     // Every period iterations, there is a burst
+    int64_t tokens = -1;    // The tokens through a channel of the channel array, if known
+
+    string shape() const {
+        if (!known) {
+            return "?";
+        }
+        return std::to_string(burst) + "/" + std::to_string(period);
+    }
+};
+
+struct ChannelInfo {
+    ChannelSide writer, reader;
+    bool        has_writer = false, has_reader = false;
+};
+
+// The name of the function producing a channel named like "A.channel", or "A.1.channel" for a value of a tuple.
+string func_of_channel(const string &channel, const map<string, Function> &env) {
+    string name = remove_postfix(channel, ".channel");
+    if (env.find(name) == env.end()) {
+        size_t dot = name.rfind('.');
+        if (dot != string::npos && env.find(name.substr(0, dot)) != env.end()) {
+            name = name.substr(0, dot);
+        }
+    }
+    return name;
+}
+
+class CollectChannelAccesses : public IRVisitor {
+    using IRVisitor::visit;
+
+    struct Loop {
+        string  name;
+        Expr    extent;
+        ForType for_type;
+    };
+
+    const map<string, Function> &env;
+    vector<Loop>                 loops;  // The loops enclosing the current IR
+    vector<Expr>                 guards; // The conditions enclosing the current IR
+
+    string current_func() const {
+        return loops.empty() ? "" : extract_first_token(loops.back().name);
+    }
+
+    // Is the loop gating a burst, i.e. the current IR is executed only for one value of the loop?
+    bool is_gating(const string &loop) const {
+        for (const auto &g : guards) {
+            for (const auto &c : break_logic_into_conjunction(g)) {
+                if (c.as<EQ>() && expr_uses_var(c, loop)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Only the serial loops of the same function count: an unrolled or vectorized loop indexes the channel array.
+    ChannelSide side_of_current_access() const {
+        ChannelSide side;
+        side.func = current_func();
+        side.known = true;
+        int64_t inner = 1, tokens = 1;
+        bool gated = false;
+        for (int i = (int)loops.size() - 1; i >= 0; i--) {
+            const Loop &l = loops[i];
+            if (extract_first_token(l.name) != side.func) {
+                break;
+            }
+            if (l.for_type == ForType::Unrolled || l.for_type == ForType::Vectorized) {
+                continue;
+            }
+            const int64_t *extent = as_const_int(simplify(l.extent));
+            if (extent == NULL) {
+                side.known = false;
+                break;
+            }
+            tokens *= *extent;
+            if (!gated && is_gating(l.name)) {
+                gated = true;
+                side.burst = inner;
+                side.period = inner * (*extent);
+            }
+            inner *= *extent;
+        }
+        if (side.known) {
+            side.tokens = tokens;
+        }
+        return side;
+    }
+
+    void record(const string &channel, bool is_write) {
+        ChannelInfo &info = channels[channel];
+        ChannelSide side = side_of_current_access();
+        ChannelSide &old = is_write ? info.writer : info.reader;
+        bool &has = is_write ? info.has_writer : info.has_reader;
+        if (!has) {
+            old = side;
+            has = true;
+        } else if (old.known && side.known) {
+            // Several accesses of the same channel, e.g. in both branches of a condition: keep the burstier one.
+            if (side.burst > old.burst) {
+                old.burst = side.burst;
+                old.period = side.period;
+            }
+        } else {
+            old.known = false;
+        }
+    }
+
+public:
+    CollectChannelAccesses(const map<string, Function> &env) : env(env) {}
+
+    map<string, ChannelInfo> channels;
+    set<string>              memory_funcs; // Functions loading from or storing into the device memory
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        loops.push_back(Loop{op->name, op->extent, op->for_type});
+        op->body.accept(this);
+        loops.pop_back();
+    }
+
+    void visit(const IfThenElse *op) override {
+        op->condition.accept(this);
+        guards.push_back(op->condition);
+        op->then_case.accept(this);
+        guards.pop_back();
+        if (op->else_case.defined()) {
+            guards.push_back(!op->condition);
+            op->else_case.accept(this);
+            guards.pop_back();
+        }
+    }
+
+    void visit(const Select *op) override {
+        op->condition.accept(this);
+        guards.push_back(op->condition);
+        op->true_value.accept(this);
+        guards.pop_back();
+        guards.push_back(!op->condition);
+        op->false_value.accept(this);
+        guards.pop_back();
+    }
+
+    void visit(const Provide *op) override {
+        // What is left to be provided by a function in its own loops is stored into its buffer in the memory.
+        if (op->name == current_func()) {
+            memory_funcs.insert(op->name);
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        if (op->is_intrinsic(Call::write_channel) || op->is_intrinsic(Call::read_channel)) {
+            const StringImm *channel = op->args[0].as<StringImm>();
+            internal_assert(channel);
+            record(channel->value, op->is_intrinsic(Call::write_channel));
+        } else if (!loops.empty()) {
+            Function func;
+            if (op->call_type == Call::Image ||
+                (op->call_type == Call::Halide && function_is_in_environment(op->name, env, func) &&
+                 func.place() != Place::Device)) {
+                memory_funcs.insert(current_func());
+            }
+        }
+        IRVisitor::visit(op);
+    }
+};
+
+class AssignChannelDepths : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, Function>    &env;
+    const CollectChannelAccesses   &accesses;
+    std::ostringstream              report;
+
+    // The tokens the channel buffers when the reader is between its bursts, or the writer is between its bursts.
+    int64_t burst_depth(const ChannelSide &w, const ChannelSide &r) const {
+        if (!w.known || !r.known || (w.burst == r.burst && w.period == r.period)) {
+            return 0;
+        }
+        double writer_rate = (double)w.burst / w.period;
+        double reader_rate = (double)r.burst / r.period;
+        int64_t written_while_reader_idle = (int64_t)std::ceil((r.period - r.burst) * writer_rate);
+        int64_t read_while_writer_idle = (int64_t)std::ceil((w.period - w.burst) * reader_rate);
+        return std::min(std::max(w.burst, r.burst), std::max(written_while_reader_idle, read_while_writer_idle));
+    }
+
+    Stmt visit(const Realize *op) override {
+        Stmt body = mutate(op->body);
+        auto info = accesses.channels.find(op->name);
+        if (!ends_with(op->name, ".channel") || info == accesses.channels.end() || !info->second.has_writer) {
+            return Realize::make(op->name, op->types, op->memory_type, op->bounds, op->condition, body);
+        }
+        const ChannelSide &w = info->second.writer;
+        const ChannelSide &r = info->second.reader;
+        string func_name = func_of_channel(op->name, env);
+        bool memory = accesses.memory_funcs.count(w.func) > 0 ||
+                      (info->second.has_reader && accesses.memory_funcs.count(r.func) > 0);
+
+        int64_t depth = burst_depth(w, r) + (memory ? memory_latency_slack : pipeline_latency_slack);
+        depth = closest_power_of_two((uint32_t)std::min(depth, max_inferred_depth));
+        if (w.tokens > 0) {
+            depth = std::min(depth, w.tokens);
+        }
+
+        // A depth already declared, by min_depth() of the producer or by an earlier pass, is kept.
+        Region bounds = op->bounds;
+        int64_t given = 0;
+        const int64_t *declared = as_const_int(bounds.back().extent);
+        auto func = env.find(func_name);
+        if (declared != NULL && *declared > 0) {
+            given = *declared;
+        } else if (func != env.end()) {
+            given = func->second.min_depth();
+        }
+        if (given == 0) {
+            bounds.back() = Range(0, (int)depth);
+        }
+
+        report << std::left << std::setw(32) << op->name
+               << std::setw(24) << w.func << std::setw(14) << w.shape()
+               << std::setw(24) << (info->second.has_reader ? r.func : "") << std::setw(14) << r.shape()
+               << std::setw(8) << (memory ? "memory" : "")
+               << std::setw(10) << depth
+               << (given == 0 ? std::to_string(depth) : std::to_string(given) + " (given)") << "\n";
+        debug(1) << "Depth of " << op->name << ": " << bounds.back().extent
+                 << ((given == 0) ? " (inferred)\n" : " (given)\n");
+        return Realize::make(op->name, op->types, op->memory_type, bounds, op->condition, body);
+    }
+
+public:
+    AssignChannelDepths(const map<string, Function> &env, const CollectChannelAccesses &accesses) :
+        env(env), accesses(accesses) {}
+
+    void write_report() const {
+        char *file = getenv("HL_CHANNEL_DEPTH_REPORT");
+        if (file == NULL || report.str().empty()) {
+            return;
+        }
+        std::ofstream fp(file, std::ios::out);
+        user_assert(fp) << "Failed to open " << file << " (HL_CHANNEL_DEPTH_REPORT) for writing the channel depths\n";
+        // A burst/period of 1/1 means streaming.
+        fp << std::left << std::setw(32) << "channel"
+           << std::setw(24) << "writer" << std::setw(14) << "burst/period"
+           << std::setw(24) << "reader" << std::setw(14) << "burst/period"
+           << std::setw(8) << "memory" << std::setw(10) << "inferred" << "assigned\n";
+        fp << report.str();
+    }
+};
+
+} // namespace
+
+Stmt infer_channel_depths(Stmt s, const map<string, Function> &env) {
+    char *setting = getenv("HL_CHANNEL_DEPTH");
+    if (setting != NULL && string(setting) == "off") {
+        return s;
+    }
+    CollectChannelAccesses accesses(env);
+    s.accept(&accesses);
+    if (accesses.channels.empty()) {
+        return s;
+    }
+    AssignChannelDepths assigner(env, accesses);
+    s = assigner.mutate(s);
+    assigner.write_report();
+    return s;
+}
+
+}
+}
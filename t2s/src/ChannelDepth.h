@@ -0,0 +1,58 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_CHANNEL_DEPTH_H
+#define T2S_CHANNEL_DEPTH_H
+
+/** \file
+ *
+ * Defines a pass to infer the depths of the channels whose depths are not given by the user with min_depth().
+ *
+ */
+
+#include "../../Halide/src/Function.h"
+#include "../../Halide/src/IR.h"
+#include <map>
+
+namespace Halide {
+namespace Internal {
+
+/* Infer the depth of every channel realized by replace_references_with_channels(), if the producer of the channel has
+ * no min_depth() (or FIFO()) specified. A depth specified by the user, or already declared for the channel by an
+ * earlier pass, is kept as it is.
+ *
+ * The depth covers two mismatches between the writer and the reader of a channel:
+ *  1. Burst: a side guarded by a condition on a loop, e.g. a drainer writing only when k == K - 1, accesses the channel
+ *     in bursts of B consecutive iterations once every P iterations; a side without such a guard streams (B = P = 1).
+ *     When the two sides have different bursts, the channel buffers the tokens written while the reader is between its
+ *     bursts, and vice versa, up to the larger burst.
+ *  2. Latency: a side that also loads from or stores into the device memory may stall for the memory latency. The
+ *     channel buffers the tokens for that time. Otherwise, a small slack covers the latency of the pipelines.
+ * The depth is rounded up to a power of 2, and is no larger than the total number of tokens through the channel, if
+ * that number is known.
+ *
+ * Environment variables:
+ *   HL_CHANNEL_DEPTH:        set to "off" to disable the inference.
+ *   HL_CHANNEL_DEPTH_REPORT: a file to write a report of the channels and their depths into.
+ */
+extern Stmt infer_channel_depths(Stmt s, const std::map<std::string, Function> &env);
+
+}
+}
+
+#endif
@@ -14,7 +14,11 @@
 #include "../../Halide/src/IROperator.h"
 #include "../../Halide/src/Simplify.h"
 #include "../../Halide/src/Substitute.h"
+#include "BitstreamCache.h"
+#include "CompileJobs.h"
 #include "DebugPrint.h"
+#include "LowPrecision.h"
+#include "MemoryBanking.h"
 #include "Utilities.h"
 
 namespace Halide {
@@ -91,13 +95,25 @@ void CodeGen_OneAPI_Dev::compile_to_aocx_oneapi(std::ostringstream &src_stream)
     }
 
 
+    // A previous compile of the bitstream in this process, if still running, would overwrite the files below.
+    CompileJobs &jobs = CompileJobs::get();
+    jobs.wait(bitstream_file);
+
     // Bitstream was generated ahead of time. Check the file exists.
-    // Note that we do not check if the aocx file is really good or up to date with the
-    // source code. So if you want to regenerate the aocx file, delete it before invoking Halide.
+    // If the bitstream was compiled or fetched with the cache, we know whether it is up to date
+    // with the source code. Otherwise, we do not check, so if you want to regenerate the aocx file,
+    // delete it before invoking Halide.
+    BitstreamCache cache(src_stream.str());
     std::ifstream file(bitstream_file, std::ios::in);
     if (file.good()) {
-        user_warning << "Bitstream " << bitstream_file << " exists. No re-compilation.\n";
-        return;
+        if (jobs.interrupted(bitstream_file)) {
+            user_warning << "Bitstream " << bitstream_file << " exists, but its compilation was interrupted.\n";
+        } else if (!cache.is_stale(bitstream_file)) {
+            user_warning << "Bitstream " << bitstream_file << " exists. No re-compilation.\n";
+            return;
+        } else {
+            user_warning << "Bitstream " << bitstream_file << " exists, but is out of date with the source code, AOC_OPTION or board.\n";
+        }
     }
 
     // Create the source file
@@ -126,13 +142,28 @@ void CodeGen_OneAPI_Dev::compile_to_aocx_oneapi(std::ostringstream &src_stream)
         }
     }
 
-    // Compile the OpenCL file into a bitstream.
+    // Reuse the bitstream compiled from the same source, unless the programmer has just modified the source.
+    std::vector<char> cl_contents = read_entire_file(cl_name);
+    bool modified = (std::string(cl_contents.begin(), cl_contents.end()) != src_stream.str() + "\n");
+    if (!modified && cache.fetch(bitstream_file)) {
+        return;
+    }
+
+    // Compile the OpenCL file into a bitstream, in the background if COMPILE_JOBS is set.
     std::stringstream command;
     char *aoc_option = getenv("AOC_OPTION");
     command << "aoc " << ((aoc_option == NULL) ? "" : aoc_option) << " -g " << cl_name << " -o " << bitstream_file;
     debug(4) << "Compiling for bitstream: " << command.str() << "\n";
-    int ret = system(command.str().c_str());
-    user_assert(ret != -1) << "Failed in compiling " << cl_name;
+    cache.forget(bitstream_file);
+    std::shared_future<int> job = jobs.submit(command.str(), bitstream_file, [cache, modified, bitstream_file](int ret) {
+        if (ret == 0 && !modified && file_exists(bitstream_file)) {
+            cache.store(bitstream_file);
+        }
+    });
+    // A JIT-compiled pipeline loads the bitstream right after this.
+    if (!jobs.asynchronous() || one_clc.get_target().has_feature(Target::JIT)) {
+        user_assert(job.get() != -1) << "Failed in compiling " << cl_name;
+    }
 }
 
 string CodeGen_OneAPI_Dev::get_current_kernel_name() {
@@ -169,8 +200,68 @@ void CodeGen_OneAPI_Dev::init_module() {
     src_stream_oneapi << "#include <sycl/ext/intel/fpga_extensions.hpp>\n";
     src_stream_oneapi << "#include \"dpc_common.hpp\"\n";
     src_stream_oneapi << "#include \"pipe_array.hpp\"\n";
+    src_stream_oneapi << "#include <algorithm>\n";
+    src_stream_oneapi << "#include <cstdio>\n";
+    src_stream_oneapi << "#include <cstdlib>\n";
+    src_stream_oneapi << "#include <string>\n";
+    src_stream_oneapi << "#include <tuple>\n";
+    src_stream_oneapi << "#include <vector>\n";
     src_stream_oneapi << "using namespace sycl;\n\n";
 
+    // The timeline of the kernels and copies, in the same format as written by the OpenCL runtime (AOT-OpenCL-Runtime.cpp)
+    // when HL_TIMELINE is set. SYCL has no timestamp for when a command is queued, so it is reported as when submitted.
+    src_stream_oneapi << R"(// The name, bytes and event of a copy between the host and the device
+typedef std::tuple<std::string, size_t, sycl::event> oneapi_copy_event;
+
+// Write the kernels and copies into the Chrome trace-event file named by HL_TIMELINE, if set.
+inline void oneapi_write_timeline(const std::vector<std::string> &kernel_names, const std::vector<sycl::event> &kernel_events,
+                                  const std::vector<oneapi_copy_event> &copy_events) {
+    const char *file = getenv("HL_TIMELINE");
+    if (file == NULL || (kernel_events.empty() && copy_events.empty())) return;
+    struct timeline_event {
+        std::string name;
+        const char *category;
+        size_t track, bytes;
+        unsigned long long submit, start, end;
+    };
+    std::vector<timeline_event> timeline;
+    for (size_t i = 0; i < kernel_events.size() + copy_events.size(); i++) {
+        bool is_kernel = i < kernel_events.size();
+        const sycl::event &e = is_kernel ? kernel_events[i] : std::get<2>(copy_events[i - kernel_events.size()]);
+        timeline.push_back(timeline_event{is_kernel ? kernel_names[i] : std::get<0>(copy_events[i - kernel_events.size()]),
+                                          is_kernel ? "kernel" : "copy", is_kernel ? i : kernel_events.size(),
+                                          is_kernel ? 0 : std::get<1>(copy_events[i - kernel_events.size()]),
+                                          e.get_profiling_info<sycl::info::event_profiling::command_submit>(),
+                                          e.get_profiling_info<sycl::info::event_profiling::command_start>(),
+                                          e.get_profiling_info<sycl::info::event_profiling::command_end>()});
+    }
+    unsigned long long origin = timeline[0].submit;
+    for (auto &e : timeline) origin = std::min(origin, e.submit);
+    FILE *fp = fopen(file, "w");
+    if (fp == NULL) {
+        std::cout << "Failed to open " << file << " (HL_TIMELINE) for writing.\n";
+        return;
+    }
+    fprintf(fp, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    fprintf(fp, "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": {\"name\": \"oneAPI device\"}}");
+    for (size_t i = 0; i <= kernel_events.size(); i++) {
+        fprintf(fp, ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                (int)i, (i < kernel_events.size()) ? ("kernel " + std::to_string(i) + ": " + kernel_names[i]).c_str() : "copies");
+    }
+    for (auto &e : timeline) {
+        fprintf(fp, ",\n  {\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, "
+                "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"queued\": %llu, \"submit\": %llu, \"start\": %llu, \"end\": %llu",
+                e.name.c_str(), e.category, (int)e.track, (e.start - origin) / 1000.0, (e.end - e.start) / 1000.0,
+                e.submit - origin, e.submit - origin, e.start - origin, e.end - origin);
+        if (e.bytes > 0) fprintf(fp, ", \"bytes\": %llu", (unsigned long long)e.bytes);
+        fprintf(fp, "}}");
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+}
+
+)";
+
     // (TODO) Comment Not Needed sections for OneAPI Raw Code Generator as it does not currently have a runtime 
 
     src_stream_oneapi << "#pragma OPENCL FP_CONTRACT ON\n";
@@ -663,7 +754,8 @@ bool CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::is_standard_opencl_type(Type type) {
     bool standard_bits = false;
     bool standard_lanes = false;
     if (type.is_float()) {
-        if ((bits == 16 && target.has_feature(Target::CLHalf)) ||
+        // A 16-bit float is half, or ushort if stored as bits
+        if ((bits == 16 && (target.has_feature(Target::CLHalf) || is_float16_stored_as_bits(type, target))) ||
             (bits == 32) || (bits == 64)) {
             standard_bits = true;
         }
@@ -806,9 +898,16 @@ string CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::print_type(Type type, AppendSpaceIf
         oss << type_name;
     } else if (type.is_float()) {
         if (type.bits() == 16) {
-            user_assert(target.has_feature(Target::CLHalf))
-                << "OpenCL kernel uses half type, but CLHalf target flag not enabled\n";
-            oss << "half";
+            if (is_float16_stored_as_bits(type, target)) {
+                // Stored as the 16 bits, and converted to float for arithmetic
+                oss << "ushort";
+            } else {
+                user_assert(!type.is_bfloat())
+                    << "OpenCL kernel uses bfloat16 type, which is supported only on Intel FPGAs\n";
+                user_assert(target.has_feature(Target::CLHalf))
+                    << "OpenCL kernel uses half type, but CLHalf target flag not enabled\n";
+                oss << "half";
+            }
         } else if (type.bits() == 32) {
             oss << "float";
         } else if (type.bits() == 64) {
@@ -1038,11 +1137,32 @@ void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::visit(const For *loop) {
                 CodeGen_C::visit(loop);
             }
         } else {
+            print_loop_pipelining(loop);
             CodeGen_C::visit(loop);
         }
     }
 }
 
+// Print the pipelining directives of a loop, if any, as attributes right before the loop.
+void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::print_loop_pipelining(const For *loop) {
+    auto p = loop_pipelining.find(loop->name);
+    if (p == loop_pipelining.end()) {
+        return;
+    }
+    // Print the bounds first, so that nothing is printed between the attributes and the loop.
+    print_expr(loop->min);
+    print_expr(loop->extent);
+    const char *attributes[] = {"initiation_interval", "speculated_iterations", "loop_coalesce", "max_concurrency"};
+    internal_assert(p->second.size() == 4);
+    for (size_t i = 0; i < p->second.size(); i++) {
+        const int64_t *value = as_const_int(p->second[i]);
+        internal_assert(value);
+        if (*value >= 0) {
+            stream << get_indent() << "[[intel::" << attributes[i] << "(" << *value << ")]]\n";
+        }
+    }
+}
+
 void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::CheckConditionalChannelAccess::visit(const IfThenElse *op) {
     bool old_cond = in_if_then_else;
     in_if_then_else = true;
@@ -1603,11 +1723,7 @@ void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::visit(const Call *op) {
         // Do not directly print to stream: there might have been a cached value useable.
         ostringstream rhs;
         rhs << print_name(buffer_name);
-        for(size_t i = 0; i < op->args.size(); i++) {
-            rhs << "[";
-            rhs << print_expr(op->args[i]);
-            rhs << "]";
-        }
+        rhs << print_buffer_indices(op->name, op->args);
         print_assignment(op->type, rhs.str());
     } else if (ends_with(op->name, ".temp")) {
         std::string name = op->name;
@@ -2389,9 +2505,10 @@ void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::visit(const GE *op) {
 }
 
 void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::visit(const Cast *op) {
-    if (!target.has_feature(Target::CLHalf) &&
-        ((op->type.is_float() && op->type.bits() < 32) ||
-         (op->value.type().is_float() && op->value.type().bits() < 32))) {
+    if (is_float16_stored_as_bits(op->type, target) || is_float16_stored_as_bits(op->value.type(), target) ||
+        (!target.has_feature(Target::CLHalf) &&
+         ((op->type.is_float() && op->type.bits() < 32) ||
+          (op->value.type().is_float() && op->value.type().bits() < 32)))) {
         Expr equiv = lower_float16_cast(op);
         equiv.accept(this);
         return;
@@ -2711,11 +2828,15 @@ void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::add_kernel(Stmt s,
                 if (args[i].is_buffer) {
                     // e.g. q_device.submit([&](handler& h) { h.memcpy(_I_serializer_device, _I_serializer_host,  _deserializer->size_in_bytes() ); }).wait();
                     stream << get_indent() << "std::cout << \"// host->device memcpy\\n\";\n";
-                    stream << get_indent() << "q_" << name << ".submit([&](handler& h){ h.memcpy( " 
+                    // Keep the event for the timeline
+                    stream << get_indent() << "oneapi_copy_events.emplace_back(\"host->device\", "
+                            << print_name(args[i].name) << "_size, "
+                            << "q_" << name << ".submit([&](handler& h){ h.memcpy( "
                             << print_name(args[i].name) << "_device, "   // dst
                             <<  print_name(args[i].name) << "_host, "    // src
                             <<  print_name(args[i].name) << "_size"      // size
-                            <<  " ); }).wait();\n\n";
+                            <<  " ); }));\n";
+                    stream << get_indent() << "std::get<2>(oneapi_copy_events.back()).wait();\n\n";
                 }
             }
         }
@@ -2785,6 +2906,7 @@ void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::add_kernel(Stmt s,
         //###################### q.submit start here
         stream << get_indent() << "// " << name << "\n";
         stream << get_indent() << "std::cout << \"// kernel " << name << "\\n\";\n";
+        stream << get_indent() << "oneapi_kernel_names.push_back(\"" << name << "\");\n";
         stream << get_indent() << "oneapi_kernel_events.push_back( " << "q_" << name << ".submit([&](sycl::handler &h){\n";
         indent += 2;
 
@@ -2795,8 +2917,10 @@ void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::add_kernel(Stmt s,
                 args[i].type.is_float() &&
                 args[i].type.bits() < 32) {
                 stream << " const " << print_type(args[i].type)
-                    << " " << print_name(args[i].name)
-                    << " = half_from_bits(" << print_name(args[i].name + "_bits") << ");\n";
+                    << " " << print_name(args[i].name) << " = "
+                    << (is_float16_stored_as_bits(args[i].type, target) ? "" : "half_from_bits(")
+                    << print_name(args[i].name + "_bits")
+                    << (is_float16_stored_as_bits(args[i].type, target) ? "" : ")") << ";\n";
             }
         }
 
@@ -2850,11 +2974,15 @@ void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::add_kernel(Stmt s,
                     // e.g. q_device.submit([&](handler& h) { h.memcpy(_I_serializer_device, _I_serializer_host,  _deserializer->size_in_bytes() ); }).wait();
                     stream << "\n\n";
                     stream << get_indent() << "std::cout << \"// device->host memcpy\\n\";\n";
-                    stream << get_indent() << "q_" << name << ".submit([&](handler& h){ h.memcpy( " 
+                    // Keep the event for the timeline
+                    stream << get_indent() << "oneapi_copy_events.emplace_back(\"device->host\", "
+                            << print_name(args[i].name) << "_size, "
+                            << "q_" << name << ".submit([&](handler& h){ h.memcpy( "
                             << print_name(args[i].name) << "_host, "            // dst
                             << print_name(args[i].name) << "_device, "          // src
                             << print_name(args[i].name) << "_size"              // size
-                            <<  " ); }).wait();\n";
+                            <<  " ); }));\n";
+                    stream << get_indent() << "std::get<2>(oneapi_copy_events.back()).wait();\n";
                 }
             }
         }
@@ -2991,6 +3119,7 @@ void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::add_kernel(Stmt s,
         // Emit OneAPI queue device submit tasks
         stream << get_indent() << "// " << name << "\n";
         // stream << get_indent() << "sycl::event "<< name << "_event = q_device.submit([&](sycl::handler &h){\n";
+        stream << get_indent() << "oneapi_kernel_names.push_back(\"" << name << "\");\n";
         stream << get_indent() << "oneapi_kernel_events.push_back( \n";
         stream <<get_indent() <<  "q_device.submit([&](sycl::handler &h){\n";
         indent += 2;
@@ -3004,8 +3133,10 @@ void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::add_kernel(Stmt s,
                 args[i].type.is_float() &&
                 args[i].type.bits() < 32) {
                 stream << " const " << print_type(args[i].type)
-                    << " " << print_name(args[i].name)
-                    << " = half_from_bits(" << print_name(args[i].name + "_bits") << ");\n";
+                    << " " << print_name(args[i].name) << " = "
+                    << (is_float16_stored_as_bits(args[i].type, target) ? "" : "half_from_bits(")
+                    << print_name(args[i].name + "_bits")
+                    << (is_float16_stored_as_bits(args[i].type, target) ? "" : ")") << ";\n";
             }
         }
 
@@ -3573,6 +3704,8 @@ void CodeGen_OneAPI_Dev::EmitOneAPIFunc::compile(const LoweredFunc &f){
 
     // Initalize elements for kernel such as sycl event's vector
     stream << get_indent() << "std::vector<sycl::event> oneapi_kernel_events;\n";
+    stream << get_indent() << "std::vector<std::string> oneapi_kernel_names;\n";
+    stream << get_indent() << "std::vector<oneapi_copy_event> oneapi_copy_events;\n";
     stream << get_indent() << "std::cout << \"// creating device queues\\n\";\n";
     stream << get_indent() << "sycl::queue q_host( sycl::host_selector{}, dpc_common::exception_handler, sycl::property::queue::enable_profiling());\n";
     stream << get_indent() << "sycl::queue q_device(deviceSelector, dpc_common::exception_handler, sycl::property::queue::enable_profiling() );\n";
@@ -3592,6 +3725,7 @@ void CodeGen_OneAPI_Dev::EmitOneAPIFunc::compile(const LoweredFunc &f){
 
     // Make sure all kernels are finished
     stream << get_indent() << "for(unsigned int i = 0; i < oneapi_kernel_events.size(); i++){ oneapi_kernel_events.at(i).wait(); };\n";
+    stream << get_indent() << "oneapi_write_timeline(oneapi_kernel_names, oneapi_kernel_events, oneapi_copy_events);\n";
 
 
     // Return execution time of the kernels. 
@@ -3699,6 +3833,7 @@ void CodeGen_OneAPI_Dev::EmitOneAPIFunc::create_kernel_wrapper(const std::string
         }
 
         if(is_run_on_device){
+            stream << get_indent() << "oneapi_kernel_names.push_back(\"" << name << "\");\n";
             stream << get_indent() << "oneapi_kernel_events.push_back( " << q_device_name << ".submit([&](sycl::handler &h){\n";
             indent += 2;
             stream << get_indent() << "h.single_task<class " + name + "_class>([=](){\n";
@@ -3920,6 +4055,7 @@ void CodeGen_OneAPI_Dev::EmitOneAPIFunc::visit(const For *loop){
                             CodeGen_C::visit(loop);
                         }
                     } else {
+                        print_loop_pipelining(loop);
                         CodeGen_C::visit(loop);
                     }
                 }
@@ -4550,9 +4686,16 @@ std::string CodeGen_OneAPI_Dev::EmitOneAPIFunc::print_type(Type type, AppendSpac
             oss << type_name;
         } else if (type.is_float()) {
             if (type.bits() == 16) {
-                user_assert(target.has_feature(Target::CLHalf))
-                    << "OpenCL kernel uses half type, but CLHalf target flag not enabled\n";
-                oss << "half";
+                if (is_float16_stored_as_bits(type, target)) {
+                    // Stored as the 16 bits, and converted to float for arithmetic
+                    oss << "ushort";
+                } else {
+                    user_assert(!type.is_bfloat())
+                        << "OpenCL kernel uses bfloat16 type, which is supported only on Intel FPGAs\n";
+                    user_assert(target.has_feature(Target::CLHalf))
+                        << "OpenCL kernel uses half type, but CLHalf target flag not enabled\n";
+                    oss << "half";
+                }
             } else if (type.bits() == 32) {
                 oss << "float";
             } else if (type.bits() == 64) {
@@ -4771,6 +4914,9 @@ void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::GatherShiftRegsAllocates::visit(const
         std::string reg_name = op->args[1].as<StringImm>()->value;
         std::vector<Expr> vars(op->args.begin() + 2, op->args.end());
         space_vars[reg_name] = vars;
+    } else if (op->is_intrinsic(Call::annotate) && op->args[0].as<StringImm>()->value == "Pipeline") {
+        std::string loop_name = op->args[1].as<StringImm>()->value;
+        parent->loop_pipelining[loop_name] = std::vector<Expr>(op->args.begin() + 2, op->args.end());
     } else {
         IRVisitor::visit(op);
     }
@@ -4891,25 +5037,30 @@ void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::visit(const Realize *op) {
         }
         print_stmt(op->body);
     } else if(ends_with(op->name,".ibuffer")){
+        // Bank the buffer so that the unrolled accesses to it hit distinct banks.
+        MemoryBanks banks = bank_memory(op);
+        buffer_dims[op->name] = banks.dims;
         std::string string_bound = "" ;
-        std::vector<std::string> access_exprs;
-        for (Range b : op->bounds) {
-            access_exprs.push_back(print_expr(b.extent));
-        }
-        for (std::string ae : access_exprs) {
-            string_bound += "[" + ae + "]";
+        for (auto &extent : banks.extents) {
+            string_bound += "[" + print_expr(extent) + "]";
         }
         for(size_t i=0;i<op->types.size();i++) {
             std::string name = op->name.substr(0, op->name.length()-std::string(".ibuffer").size());
             string buffer_name = name + '.' + std::to_string(i) + ".ibuffer";
+            int width = bank_width(op->types[i]);
             stream << get_indent() << "// " << print_type(op->types[i]) << " ";
-            stream << "__attribute__((memory, numbanks("
-                   << access_exprs.back()
-                   << "), singlepump, numwriteports(1), numreadports(1))) "
+            stream << "__attribute__((memory, numbanks(" << banks.banks << "), ";
+            if (width > 0) {
+                stream << "bankwidth(" << width << "), ";
+            }
+            stream << "singlepump, numwriteports(1), numreadports(1))) "
                    << print_name(buffer_name) << string_bound << ";\n";
             stream <<  get_indent() << "[[intel::fpga_memory(), "
-                   << "intel::numbanks(" << access_exprs.back() << "), "
-                   << "intel::singlepump, intel::simple_dual_port]] " <<  print_type(op->types[i])  << " "
+                   << "intel::numbanks(" << banks.banks << "), ";
+            if (width > 0) {
+                stream << "intel::bankwidth(" << width << "), ";
+            }
+            stream << "intel::singlepump, intel::simple_dual_port]] " <<  print_type(op->types[i])  << " "
                    << print_name(buffer_name) << string_bound << ";\n";
         }
         print_stmt(op->body);
@@ -4922,23 +5073,28 @@ void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::visit(const Realize *op) {
     }
 }
 
+string CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::print_buffer_indices(const string &buffer, const vector<Expr> &args) {
+    vector<string> indices;
+    for (auto &a : args) {
+        indices.push_back(print_expr(a));
+    }
+    auto dims = buffer_dims.find(buffer);
+    internal_assert(dims != buffer_dims.end() && dims->second.size() == args.size());
+    string s;
+    for (int d : dims->second) {
+        s += "[" + indices[d] + "]";
+    }
+    return s;
+}
+
 void CodeGen_OneAPI_Dev::CodeGen_OneAPI_C::visit(const Provide *op){
     if (ends_with(op->name, ".ibuffer")) {
         internal_assert(op->values.size() == 1);
         string id_value = print_expr(op->values[0]);
         std::string name = op->name.substr(0, op->name.length()-std::string(".ibuffer").size());
-        std::vector<std::string> access_exprs;
-        for(size_t i = 0; i < op->args.size(); i++) {
-            access_exprs.push_back(print_expr(op->args[i]));
-        }
+        string indices = print_buffer_indices(op->name, op->args);
         string buffer_name = name + '.' + std::to_string(0) + ".ibuffer";
-        stream << get_indent() << print_name(buffer_name);
-        for(size_t i = 0; i < op->args.size(); i++) {
-            stream << "[";
-            stream << access_exprs[i];
-            stream << "]";
-        }
-        stream << " = " << id_value << ";\n";
+        stream << get_indent() << print_name(buffer_name) << indices << " = " << id_value << ";\n";
         cache.clear();
     } else if (ends_with(op->name, ".temp")) {
         internal_assert(op->values.size() == 1);
@@ -176,6 +176,10 @@ protected:
         std::map<std::string, std::vector<std::string>> shift_regs_allocates; // For all shift regs
         std::map<std::string, size_t> shift_regs_bounds; // Only for shift regs whose types are nonstandard_vectors
         std::map<std::string, std::vector<Expr>> space_vars; // For shift regs with irregular bounds
+        std::map<std::string, std::vector<Expr>> loop_pipelining; // For loops with pipelining directives
+        void print_loop_pipelining(const For *loop);
+        std::map<std::string, std::vector<int>> buffer_dims; // For on-chip buffers: the dimensions in the order declared
+        std::string print_buffer_indices(const std::string &buffer, const std::vector<Expr> &args);
         // For saving the pointer args streamed from scehduler
         std::map<std::string, std::string> pointer_args;
         std::vector<DeviceArgument> buffer_args;
@@ -362,10 +366,14 @@ protected:
                     dst = "(((device_handle*)" + buffer_name + "->device)->mem)";
                     src = buffer_name + "->host";
                 }
-                rhs << "q_device.submit([&](handler& h){ h.memcpy("
+                // Keep the event for the timeline
+                rhs << "oneapi_copy_events.emplace_back(\"" << (to_host ? "device->host" : "host->device") << "\", "
+                    << buffer_name << "->size_in_bytes(), "
+                    << "q_device.submit([&](handler& h){ h.memcpy("
                     << "(void *)" << dst << ", " // dst
                     << "(void *)" << src << ", " // src
-                    << buffer_name << "->size_in_bytes() ); }).wait()"; // size
+                    << buffer_name << "->size_in_bytes() ); })); "; // size
+                rhs << "std::get<2>(oneapi_copy_events.back()).wait()";
                 return rhs.str();
             }
 
@@ -0,0 +1,350 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "../../Halide/src/Debug.h"
+#include "../../Halide/src/Error.h"
+#include "../../Halide/src/Util.h"
+#include "./CompileJobs.h"
+#include "./Utilities.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+string current_dir() {
+    char buf[4096];
+    return getcwd(buf, sizeof(buf)) ? string(buf) : string(".");
+}
+
+string absolute_path(const string &file) {
+    return starts_with(file, "/") ? file : current_dir() + "/" + file;
+}
+
+int env_int(const char *name) {
+    char *value = getenv(name);
+    return (value == NULL) ? 0 : std::atoi(value);
+}
+
+string host_name() {
+    char buf[256];
+    if (gethostname(buf, sizeof(buf)) != 0) {
+        return "";
+    }
+    buf[sizeof(buf) - 1] = '\0';
+    return string(buf);
+}
+
+// A job state file has a line "<field> <value>" for each of the fields bitstream, dir, command, host, pid and status,
+// where host and pid identify the process that owns the job.
+map<string, string> read_state(const string &state_file) {
+    map<string, string> fields;
+    std::ifstream fp(state_file, std::ios::in);
+    string line;
+    while (std::getline(fp, line)) {
+        size_t space = line.find(' ');
+        if (space != string::npos) {
+            fields[line.substr(0, space)] = line.substr(space + 1);
+        }
+    }
+    return fields;
+}
+
+// Is the process owning the job still alive? A process on another host cannot be checked, and is taken as alive.
+bool owner_alive(const map<string, string> &fields) {
+    auto host = fields.find("host");
+    auto pid = fields.find("pid");
+    if (host == fields.end() || pid == fields.end()) {
+        return false;
+    }
+    if (host->second != host_name()) {
+        return true;
+    }
+    pid_t owner = (pid_t)std::atol(pid->second.c_str());
+    return owner > 0 && (owner == getpid() || kill(owner, 0) == 0 || errno == EPERM);
+}
+
+// Was the job queued or running when the process owning it died?
+bool interrupted_state(const map<string, string> &fields) {
+    auto status = fields.find("status");
+    return status != fields.end() && (status->second == "queued" || status->second == "running") &&
+           !owner_alive(fields);
+}
+
+string quoted(const string &s) {
+    return "'" + replace_all(s, "'", "'\\''") + "'";
+}
+
+} // namespace
+
+CompileJobs &CompileJobs::get() {
+    static CompileJobs jobs;
+    return jobs;
+}
+
+CompileJobs::CompileJobs() {
+    max_jobs = env_int("COMPILE_JOBS");
+    memory = env_int("COMPILE_JOB_MEMORY");
+    timeout = env_int("COMPILE_JOB_TIMEOUT");
+    char *jobs_dir = getenv("COMPILE_JOBS_DIR");
+    if (jobs_dir != NULL) {
+        dir = jobs_dir;
+    } else if (getenv("HOME") != NULL) {
+        dir = string(getenv("HOME")) + "/tmp/compile_jobs";
+    }
+}
+
+void CompileJobs::wait_at_exit() {
+    CompileJobs::get().shutdown();
+}
+
+void CompileJobs::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!queue.empty()) {
+            debug(1) << "Waiting for " << queue.size() << " queued device compiles before exiting\n";
+        }
+    }
+    wait_all();
+    vector<std::thread> finished;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shutting_down = true;
+        wakeup.notify_all();
+        finished.swap(workers);
+    }
+    for (auto &w : finished) {
+        w.join();
+    }
+}
+
+string CompileJobs::state_file_of(const string &bitstream_file) const {
+    return dir + "/" + hash_to_hex(bitstream_file) + ".job";
+}
+
+void CompileJobs::record(const Job &job, const string &status) const {
+    if (dir.empty()) {
+        return;
+    }
+    string state_file = state_file_of(job.bitstream_file);
+    if (!asynchronous()) {
+        // A job running in the foreground dies with the process, like a compile without the job manager. Drop any
+        // state left by a background job before.
+        std::remove(state_file.c_str());
+        return;
+    }
+    // The states are only for resuming: if anything fails, the job is simply not resumable.
+    if (!make_dirs(dir)) {
+        return;
+    }
+    string temp = state_file + ".tmp";
+    {
+        std::ofstream fp(temp, std::ios::out);
+        if (!fp) {
+            return;
+        }
+        fp << "bitstream " << job.bitstream_file << "\n"
+           << "dir " << job.dir << "\n"
+           << "command " << job.command << "\n"
+           << "host " << host_name() << "\n"
+           << "pid " << getpid() << "\n"
+           << "status " << status << "\n";
+    }
+    std::rename(temp.c_str(), state_file.c_str());
+}
+
+void CompileJobs::run(Job &job) {
+    record(job, "running");
+    string shell = "cd " + quoted(job.dir) + " && ";
+    if (memory > 0) {
+        shell += "ulimit -v " + std::to_string((long long)memory * 1024) + " && ";
+    }
+    if (timeout > 0) {
+        shell += "timeout " + std::to_string(timeout) + " ";
+    }
+    shell += job.command;
+    if (asynchronous()) {
+        string log_file = job.bitstream_file + ".log";
+        shell = "(" + shell + ") > " + quoted(log_file) + " 2>&1";
+        debug(1) << "Compiling " << job.bitstream_file << " in the background. Log: " << log_file << "\n";
+    }
+    int ret = system(shell.c_str());
+    ret = (ret != -1 && WIFEXITED(ret)) ? WEXITSTATUS(ret) : -1;
+    record(job, "done " + std::to_string(ret));
+    if (job.on_finish) {
+#ifdef WITH_EXCEPTIONS
+        // The compile has finished anyway. A failing callback must not take down the worker, or leave the job
+        // unfinished to those waiting for it.
+        try {
+            job.on_finish(ret);
+        } catch (const std::exception &e) {
+            user_warning << "Failed in finishing the compile of " << job.bitstream_file << ": " << e.what() << "\n";
+        } catch (...) {
+            user_warning << "Failed in finishing the compile of " << job.bitstream_file << "\n";
+        }
+#else
+        job.on_finish(ret);
+#endif
+    }
+    job.promise.set_value(ret);
+}
+
+void CompileJobs::worker() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        if (queue.empty()) {
+            if (shutting_down) {
+                return;
+            }
+            wakeup.wait(lock);
+            continue;
+        }
+        std::shared_ptr<Job> job = queue.front();
+        queue.pop_front();
+        lock.unlock();
+        run(*job);
+        lock.lock();
+    }
+}
+
+std::shared_future<int> CompileJobs::submit(const string &command, const string &bitstream_file,
+                                            std::function<void(int)> on_finish) {
+    return submit(command, current_dir(), absolute_path(bitstream_file), on_finish);
+}
+
+std::shared_future<int> CompileJobs::submit(const string &command, const string &dir,
+                                            const string &bitstream_file, std::function<void(int)> on_finish) {
+    auto job = std::make_shared<Job>();
+    job->command = command;
+    job->dir = dir;
+    job->bitstream_file = bitstream_file;
+    job->on_finish = on_finish;
+    job->status = job->promise.get_future().share();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    auto previous = latest.find(job->bitstream_file);
+    if (previous != latest.end() && previous->second->command == command &&
+        previous->second->status.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return previous->second->status;
+    }
+    latest[job->bitstream_file] = job;
+    record(*job, "queued");
+    if (!asynchronous()) {
+        lock.unlock();
+        run(*job);
+        return job->status;
+    }
+    queue.push_back(job);
+    if ((int)workers.size() < max_jobs) {
+        if (!exit_handler_registered) {
+            // Registered after this object is constructed, the handler runs before this object is destroyed.
+            std::atexit(wait_at_exit);
+            exit_handler_registered = true;
+        }
+        workers.emplace_back([this] { worker(); });
+    }
+    wakeup.notify_one();
+    return job->status;
+}
+
+bool CompileJobs::interrupted(const string &bitstream_file) const {
+    return !dir.empty() && interrupted_state(read_state(state_file_of(absolute_path(bitstream_file))));
+}
+
+std::shared_future<int> CompileJobs::future_of(const string &bitstream_file) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto job = latest.find(absolute_path(bitstream_file));
+    return (job == latest.end()) ? std::shared_future<int>() : job->second->status;
+}
+
+void CompileJobs::wait(const string &bitstream_file) {
+    std::shared_future<int> status = future_of(bitstream_file);
+    if (status.valid()) {
+        status.wait();
+    }
+}
+
+int CompileJobs::wait_all() {
+    vector<std::shared_future<int>> statuses;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &j : latest) {
+            statuses.push_back(j.second->status);
+        }
+    }
+    int failed = 0;
+    for (auto &s : statuses) {
+        if (s.get() != 0) {
+            failed++;
+        }
+    }
+    return failed;
+}
+
+vector<std::shared_future<int>> CompileJobs::resume() {
+    vector<std::shared_future<int>> statuses;
+    DIR *d = dir.empty() ? NULL : opendir(dir.c_str());
+    if (d == NULL) {
+        return statuses;
+    }
+    vector<map<string, string>> jobs;
+    while (struct dirent *entry = readdir(d)) {
+        string name = entry->d_name;
+        if (ends_with(name, ".job")) {
+            map<string, string> fields = read_state(dir + "/" + name);
+            if (interrupted_state(fields) && fields.count("bitstream") && fields.count("dir") && fields.count("command")) {
+                jobs.push_back(fields);
+            }
+        }
+    }
+    closedir(d);
+    for (auto &fields : jobs) {
+        user_warning << "Resuming the compile of " << fields["bitstream"] << "\n";
+        statuses.push_back(submit(fields["command"], fields["dir"], fields["bitstream"], nullptr));
+    }
+    return statuses;
+}
+
+}
+
+std::shared_future<int> device_compile(const std::string &bitstream_file) {
+    return Internal::CompileJobs::get().future_of(bitstream_file);
+}
+
+int wait_for_device_compiles() {
+    return Internal::CompileJobs::get().wait_all();
+}
+
+std::vector<std::shared_future<int>> resume_device_compiles() {
+    return Internal::CompileJobs::get().resume();
+}
+
+}
@@ -0,0 +1,132 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_COMPILE_JOBS_H
+#define T2S_COMPILE_JOBS_H
+
+/** \file
+ *
+ * Defines a manager of device compiles (aoc or dpcpp), which runs them in the background, so that a generator can go
+ * on with the next design while the previous ones are being synthesized.
+ */
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Halide {
+
+/** The exit status of the latest device compile of a bitstream file in this process, available when the compile
+ * finishes. The future is invalid if the bitstream file has never been compiled in this process. */
+std::shared_future<int> device_compile(const std::string &bitstream_file);
+
+/** Wait for all the device compiles queued in this process to finish. Return the number of the failed ones. */
+int wait_for_device_compiles();
+
+/** Queue again the device compiles that are recorded as unfinished in COMPILE_JOBS_DIR by a process that is no longer
+ * alive, i.e. those interrupted together with the process that queued them. Return the futures of their exit
+ * statuses. */
+std::vector<std::shared_future<int>> resume_device_compiles();
+
+namespace Internal {
+
+/* Every device compile is a job, which is queued, then running, then done with an exit status. A job runs in the
+ * directory it was queued in. A job in the background has its state recorded in a file in the job directory, named
+ * by a hash of the bitstream file, together with the host and pid of the process owning it, so that a sweep of
+ * designs interrupted in the middle can resume: if the job is recorded as queued or running, but its process is dead,
+ * the bitstream is not trusted, and the job can be queued again by resume_device_compiles(). The job of a process
+ * still alive, e.g. another generator sharing the job directory, is left alone. A process on another host is taken
+ * as alive.
+ * Environment variables:
+ *   COMPILE_JOBS:        the max number of device compiles running concurrently in the background. If it is not set,
+ *                        a device compile blocks the generator, with its output to the console, as before.
+ *   COMPILE_JOB_MEMORY:  the max virtual memory of a device compile, in MB. Default: unlimited.
+ *   COMPILE_JOB_TIMEOUT: the max time of a device compile, in seconds. Default: unlimited.
+ *   COMPILE_JOBS_DIR:    the job directory. Default: $HOME/tmp/compile_jobs.
+ * The output of a device compile in the background is streamed into a log file (the bitstream file plus .log), which
+ * can be watched with "tail -f" while the compile is running. Before exiting, the process waits for all its jobs, in
+ * a handler registered with atexit() when the first background job is queued.
+ */
+class CompileJobs {
+public:
+    static CompileJobs &get();
+
+    bool asynchronous() const { return max_jobs > 0; }
+
+    // Queue a command that compiles a bitstream file. After the command exits, on_finish is called with the exit
+    // status (-1 if the command cannot run or is killed). If the same command is already queued or running for the
+    // file, its future is returned instead of queuing another job. Without COMPILE_JOBS, the command runs right away.
+    std::shared_future<int> submit(const std::string &command, const std::string &bitstream_file,
+                                   std::function<void(int)> on_finish = nullptr);
+
+    // The compile of the bitstream file was queued or running when its process died.
+    bool interrupted(const std::string &bitstream_file) const;
+
+    // Wait for the job of the bitstream file in this process, if any, to finish.
+    void wait(const std::string &bitstream_file);
+
+    std::shared_future<int> future_of(const std::string &bitstream_file);
+    int wait_all();
+    std::vector<std::shared_future<int>> resume();
+
+private:
+    struct Job {
+        std::string command;
+        std::string dir;                    // The directory to run the command in
+        std::string bitstream_file;         // Absolute
+        std::function<void(int)> on_finish;
+        std::promise<int> promise;
+        std::shared_future<int> status;
+    };
+
+    int max_jobs = 0;
+    int memory = 0;                         // In MB
+    int timeout = 0;                        // In seconds
+    std::string dir;                        // The job directory. Empty if the job states are not recorded.
+
+    std::mutex mutex;                       // Protects the fields below
+    std::condition_variable wakeup;
+    std::deque<std::shared_ptr<Job>> queue;
+    std::map<std::string, std::shared_ptr<Job>> latest;     // The latest job of every bitstream file
+    std::vector<std::thread> workers;
+    bool shutting_down = false;
+    bool exit_handler_registered = false;
+
+    CompileJobs();
+    std::shared_future<int> submit(const std::string &command, const std::string &dir,
+                                   const std::string &bitstream_file, std::function<void(int)> on_finish);
+    void worker();
+    void run(Job &job);
+    // Wait for all the jobs, and stop the workers. Called at exit, if any worker has been started.
+    void shutdown();
+    static void wait_at_exit();
+    std::string state_file_of(const std::string &bitstream_file) const;
+    void record(const Job &job, const std::string &status) const;
+};
+
+}
+}
+
+#endif
@@ -27,6 +27,7 @@
 #include "../../Halide/src/Substitute.h"
 #include "../../Halide/src/FindCalls.h"
 #include "../../Halide/src/CSE.h"
+#include "../../Halide/src/ExprUsesVar.h"
 #include "Simplify.h"
 #include "InjectHostDevBufferCopies.h"
 #include "DebugPrint.h"
@@ -292,6 +293,161 @@ class ConstLoopFlattening : public IRMutator {
     }
 };
 
+/* A perfect nest of serial loops whose bounds depend on the enclosing loops of the nest, i.e. a triangular or
+ * trapezoidal iteration space, like
+ *   for (i, 0, N)
+ *     for (j, i, N - i)
+ *       body
+ * is flattened into a single loop over exactly the points of the space, N * (N + 1) / 2 in this case, instead of
+ * a nest whose inner loop is entered and drained for every i:
+ *   i.flat = 0, j.flat = 0
+ *   for (i.j, 0, N * (N + 1) / 2)
+ *     i = i.flat, j = j.flat
+ *     body
+ *     if (j < N - 1) j.flat = j + 1
+ *     else i.flat = i + 1, j.flat = i + 1
+ * The loop variables are advanced like an odometer, without division or modulo. The points of the space are counted
+ * at compile time, so the outermost loop must have constant bounds, and the bounds of the inner loops must be constant
+ * for every point of the enclosing loops. A nest with an empty inner range for some point is not flattened.
+ */
+class FlattenTriangularLoops : public IRMutator {
+    using IRMutator::visit;
+
+    struct Loop {
+        std::string name;
+        Expr min, extent;
+    };
+    std::vector<Loop> loops;
+    int64_t points;
+    int64_t ranges;
+    const int64_t max_ranges = 1 << 20;     // Stop counting the points of a huge space
+
+    // Count the points of loops[level..], with the enclosing loops at the given values.
+    bool count(size_t level, std::map<std::string, Expr> &values) {
+        if (++ranges > max_ranges) {
+            return false;
+        }
+        const int64_t *min = as_const_int(simplify(substitute(values, loops[level].min)));
+        const int64_t *extent = as_const_int(simplify(substitute(values, loops[level].extent)));
+        if (!min || !extent || *extent <= 0) {
+            return false;
+        }
+        if (level == loops.size() - 1) {
+            points += *extent;
+            return true;
+        }
+        for (int64_t v = *min; v < *min + *extent; v++) {
+            values[loops[level].name] = (int)v;
+            if (!count(level + 1, values)) {
+                return false;
+            }
+        }
+        values.erase(loops[level].name);
+        return true;
+    }
+
+    Expr counter(size_t level) {
+        return Load::make(Int(32), loops[level].name + ".flat", 0, Buffer<>(), Parameter(), const_true(), ModulusRemainder());
+    }
+
+    Stmt set_counter(size_t level, Expr value) {
+        return Store::make(loops[level].name + ".flat", value, 0, Parameter(), const_true(), ModulusRemainder());
+    }
+
+    // Advance the loop variables from the current point to the next one.
+    Stmt advance() {
+        Stmt s;
+        for (int m = 0; m < (int)loops.size(); m++) {
+            // Loop m moves on, and the loops inside restart
+            std::map<std::string, Expr> next;
+            next[loops[m].name] = Variable::make(Int(32), loops[m].name) + 1;
+            std::vector<Stmt> updates = { set_counter(m, next[loops[m].name]) };
+            for (size_t l = m + 1; l < loops.size(); l++) {
+                next[loops[l].name] = simplify(substitute(next, loops[l].min));
+                updates.push_back(set_counter(l, next[loops[l].name]));
+            }
+            Stmt update = Block::make(updates);
+            if (!s.defined()) {
+                s = update;
+            } else {
+                Expr last = simplify(loops[m].min + loops[m].extent - 1);
+                s = IfThenElse::make(Variable::make(Int(32), loops[m].name) < last, update, s);
+            }
+        }
+        return s;
+    }
+
+    Stmt visit(const For* op) override {
+        if (op->for_type != ForType::Serial || ends_with(op->name, ".infinite") || !is_const(op->min) || !is_const(op->extent)) {
+            return IRMutator::visit(op);
+        }
+        loops = { {op->name, op->min, op->extent} };
+        Stmt body = op->body;
+        bool triangular = false;
+        const For *cop = body.as<For>();
+        while (cop && cop->for_type == ForType::Serial && !ends_with(cop->name, ".infinite")) {
+            for (auto &l : loops) {
+                if (expr_uses_var(cop->min, l.name) || expr_uses_var(cop->extent, l.name)) {
+                    triangular = true;
+                }
+            }
+            loops.push_back({cop->name, cop->min, cop->extent});
+            body = cop->body;
+            cop = body.as<For>();
+        }
+        std::map<std::string, Expr> values;
+        points = 0;
+        ranges = 0;
+        if (!triangular || !count(0, values) || points > INT32_MAX) {
+            return IRMutator::visit(op);
+        }
+        // The body may contain other nests to flatten
+        std::vector<Loop> nest = loops;
+        int64_t total = points;
+        body = mutate(body);
+        loops = nest;
+        points = total;
+
+        std::string name = op->name;
+        for (size_t l = 1; l < loops.size(); l++) {
+            name = name + "." + extract_after_tokens(loops[l].name, 2);
+        }
+        debug(4) << "Flatten the triangular loop " << name << " of " << points << " points\n";
+        body = Block::make(body, advance());
+        for (int l = loops.size() - 1; l >= 0; l--) {
+            body = LetStmt::make(loops[l].name, counter(l), body);
+        }
+        Stmt s = For::make(name, 0, (int)points, op->for_type, op->device_api, body);
+
+        // Start from the first point of the space
+        std::vector<Stmt> inits;
+        for (size_t l = 0; l < loops.size(); l++) {
+            values[loops[l].name] = simplify(substitute(values, loops[l].min));
+            inits.push_back(set_counter(l, values[loops[l].name]));
+        }
+        inits.push_back(s);
+        s = Block::make(inits);
+        for (auto &l : loops) {
+            s = Block::make(s, Free::make(l.name + ".flat"));
+            s = Allocate::make(l.name + ".flat", Int(32), MemoryType::Register, {1}, const_true(), s);
+        }
+        return s;
+    }
+};
+
+class TriangularLoopFlattening : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const For* op) override {
+        if (op->device_api == DeviceAPI::OpenCL || op->device_api == DeviceAPI::OneAPI) {
+            // Flatten the loops in the device kernel
+            FlattenTriangularLoops fl;
+            return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, fl.mutate(op->body));
+        }
+        return IRMutator::visit(op);
+    }
+};
+
 typedef struct DynamicForLoopContainer {
     std::string name;
     Expr extent;
@@ -1064,6 +1220,10 @@ Stmt replace_mem_channels(Stmt s, const std::map<std::string, Function> &env, co
 }
 
 Stmt flatten_loops(Stmt s, const std::map<std::string, Function> &env) {
+    TriangularLoopFlattening tlf;
+    s = tlf.mutate(s);
+    debug(2) << "IR after triangular loop flattening ...\n\n" << s << "\n";
+
     ConstLoopFlattening clf;
     s = clf.mutate(s);
     debug(2) << "IR after const loop flattening ...\n\n" << s << "\n";
@@ -0,0 +1,312 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include <algorithm>
+#include "../../Halide/src/Func.h"
+#include "../../Halide/src/IRMutator.h"
+#include "../../Halide/src/IROperator.h"
+#include "../../Halide/src/Util.h"
+#include "./LoopPipelining.h"
+
+namespace Halide {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+Internal::PipelineItem &pipeline_item(Internal::Function &func, const string &loop) {
+    user_assert(func.place() == Place::Device)
+        << "Only the loops of a device Func can be given pipelining directives, but " << func.name() << " is on the host\n";
+    vector<Internal::PipelineItem> &items = func.definition().schedule().pipeline_params();
+    for (auto &item : items) {
+        if (item.loop_name == loop) {
+            return item;
+        }
+    }
+    items.push_back(Internal::PipelineItem(loop));
+    return items.back();
+}
+
+} // namespace
+
+Func &Func::ii(VarOrRVar loop, int ii) {
+    user_assert(ii >= 1) << "The initiation interval of loop " << loop.name() << " of Func " << name()
+                         << " must be at least 1, but is " << ii << "\n";
+    invalidate_cache();
+    pipeline_item(func, loop.name()).ii = ii;
+    return *this;
+}
+
+Func &Func::speculated_iterations(VarOrRVar loop, int iterations) {
+    user_assert(iterations >= 0) << "The speculated iterations of loop " << loop.name() << " of Func " << name()
+                                 << " must not be negative, but are " << iterations << "\n";
+    invalidate_cache();
+    pipeline_item(func, loop.name()).speculated_iterations = iterations;
+    return *this;
+}
+
+Func &Func::loop_coalesce(VarOrRVar loop, int levels) {
+    user_assert(levels >= 1) << "The levels of loop " << loop.name() << " of Func " << name()
+                             << " to coalesce must be at least 1, but are " << levels << "\n";
+    invalidate_cache();
+    pipeline_item(func, loop.name()).loop_coalesce = levels;
+    return *this;
+}
+
+Func &Func::max_concurrency(VarOrRVar loop, int concurrency) {
+    user_assert(concurrency >= 0) << "The max concurrency of loop " << loop.name() << " of Func " << name()
+                                  << " must not be negative, but is " << concurrency << "\n";
+    invalidate_cache();
+    pipeline_item(func, loop.name()).max_concurrency = concurrency;
+    return *this;
+}
+
+namespace Internal {
+
+namespace {
+
+// The pipelining directives of a loop of a function.
+struct Directive {
+    string func;
+    string prefix;      // The prefix of the loops of the function, e.g. func.s0.
+    PipelineItem item;
+    bool applied = false;
+    Directive(const string &func, const PipelineItem &item) : func(func), prefix(func + ".s0."), item(item) {}
+};
+
+// The most floating-point operations on a path from a read of a shift register to the root of an expression, or -1
+// if the expression does not read the register.
+class FloatOpsAfterRead : public IRVisitor {
+    using IRVisitor::visit;
+    const string &reg;
+    map<string, Expr> &lets;
+    map<string, int> &let_ops;      // The result for the value of a let, computed once
+    int ops = 0;                    // Floating-point operations enclosing the current node
+
+    template<typename T>
+    void visit_arithmetic(const T *op) {
+        int is_float = op->type.is_float() ? 1 : 0;
+        ops += is_float;
+        IRVisitor::visit(op);
+        ops -= is_float;
+    }
+
+    void visit(const Add *op) override {
+        visit_arithmetic(op);
+    }
+
+    void visit(const Sub *op) override {
+        visit_arithmetic(op);
+    }
+
+    void visit(const Mul *op) override {
+        visit_arithmetic(op);
+    }
+
+    void visit(const Div *op) override {
+        visit_arithmetic(op);
+    }
+
+    void visit(const Call *op) override {
+        if (op->is_intrinsic(Call::read_shift_reg) && op->args[0].as<StringImm>()->value == reg) {
+            result = std::max(result, ops);
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Variable *op) override {
+        auto l = lets.find(op->name);
+        if (l == lets.end()) {
+            return;
+        }
+        if (!let_ops.count(op->name)) {
+            let_ops[op->name] = -1;
+            FloatOpsAfterRead value(reg, lets, let_ops);
+            l->second.accept(&value);
+            let_ops[op->name] = value.result;
+        }
+        if (let_ops[op->name] >= 0) {
+            result = std::max(result, ops + let_ops[op->name]);
+        }
+    }
+
+    void visit(const Let *op) override {
+        op->value.accept(this);
+        lets[op->name] = op->value;
+        op->body.accept(this);
+        lets.erase(op->name);
+        let_ops.erase(op->name);
+    }
+
+public:
+    FloatOpsAfterRead(const string &reg, map<string, Expr> &lets, map<string, int> &let_ops) :
+        reg(reg), lets(lets), let_ops(let_ops) {}
+
+    int result = -1;
+};
+
+// Find the recurrences through shift registers in an iteration of a loop: the writes to a shift register whose value
+// depends on a read of the same register. Inner serial loops carry their own recurrences, and are skipped.
+class FindShiftRegRecurrences : public IRVisitor {
+    using IRVisitor::visit;
+    map<string, Expr> lets;
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        lets[op->name] = op->value;
+        op->body.accept(this);
+        lets.erase(op->name);
+    }
+
+    void visit(const For *op) override {
+        if (op->for_type != ForType::Serial) {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->is_intrinsic(Call::write_shift_reg)) {
+            const string &reg = op->args[0].as<StringImm>()->value;
+            map<string, int> let_ops;
+            FloatOpsAfterRead finder(reg, lets, let_ops);
+            op->args.back().accept(&finder);
+            if (finder.result > 0 && finder.result > float_ops[reg]) {
+                float_ops[reg] = finder.result;
+            }
+        }
+    }
+
+public:
+    map<string, int> float_ops;     // Shift register -> floating-point operations on its recurrence
+};
+
+class AnnotatePipelining : public IRMutator {
+    using IRMutator::visit;
+    vector<Directive> &directives;
+    int in_kernel = 0;
+
+    // If the loop is the loop of the directive, or a flattened loop that includes it
+    static bool covers(const string &loop, const Directive &d) {
+        if (!starts_with(loop, d.prefix)) {
+            return false;
+        }
+        vector<string> vars = split_string(loop.substr(d.prefix.size()), ".");
+        return std::find(vars.begin(), vars.end(), d.item.loop_name) != vars.end();
+    }
+
+    static void merge(int &to, int from, const char *directive, const string &loop) {
+        if (from < 0) {
+            return;
+        }
+        if (to >= 0 && to != from) {
+            user_warning << "Loop " << loop << " is given " << directive << " " << to << " and " << from
+                         << " by the loops flattened into it. " << to << " is taken\n";
+            return;
+        }
+        to = from;
+    }
+
+    void check_ii(const For *op, int ii) {
+        FindShiftRegRecurrences finder;
+        op->body.accept(&finder);
+        for (auto &r : finder.float_ops) {
+            if (r.second > ii) {
+                user_warning << "Loop " << op->name << " is to launch an iteration every " << ii << " cycles, but the "
+                             << "value written into shift register " << r.first << " depends on the register through "
+                             << r.second << " floating-point operations, which may take more cycles than that if the "
+                             << "loop carries the dependence\n";
+            }
+        }
+    }
+
+    Stmt visit(const For *op) override {
+        bool kernel = ends_with(op->name, ".run_on_device");
+        in_kernel += kernel;
+        Stmt s = IRMutator::visit(op);
+        in_kernel -= kernel;
+        if (kernel || in_kernel == 0 || ends_with(op->name, ".infinite")) {
+            return s;
+        }
+
+        PipelineItem item(op->name);
+        bool found = false;
+        for (auto &d : directives) {
+            if (covers(op->name, d)) {
+                found = true;
+                d.applied = true;
+                merge(item.ii, d.item.ii, "ii", op->name);
+                merge(item.speculated_iterations, d.item.speculated_iterations, "speculated_iterations", op->name);
+                merge(item.loop_coalesce, d.item.loop_coalesce, "loop_coalesce", op->name);
+                merge(item.max_concurrency, d.item.max_concurrency, "max_concurrency", op->name);
+            }
+        }
+        if (!found) {
+            return s;
+        }
+        if (op->for_type != ForType::Serial) {
+            user_warning << "Loop " << op->name << " is given pipelining directives, but is not a serial loop. "
+                         << "The directives are ignored\n";
+            return s;
+        }
+        if (item.ii > 0) {
+            check_ii(op, item.ii);
+        }
+        debug(3) << "Pipelining directives of loop " << op->name << ": ii " << item.ii
+                 << ", speculated_iterations " << item.speculated_iterations
+                 << ", loop_coalesce " << item.loop_coalesce
+                 << ", max_concurrency " << item.max_concurrency << "\n";
+        Expr annotation = Call::make(Int(32), Call::annotate,
+                                     {StringImm::make("Pipeline"), StringImm::make(op->name), item.ii,
+                                      item.speculated_iterations, item.loop_coalesce, item.max_concurrency},
+                                     Call::Intrinsic);
+        return Block::make(Evaluate::make(annotation), s);
+    }
+
+public:
+    AnnotatePipelining(vector<Directive> &directives) : directives(directives) {}
+};
+
+} // namespace
+
+Stmt annotate_loop_pipelining(Stmt s, const map<string, Function> &env) {
+    vector<Directive> directives;
+    for (auto &e : env) {
+        for (auto &item : e.second.definition().schedule().pipeline_params()) {
+            directives.push_back(Directive(e.first, item));
+        }
+    }
+    if (directives.empty()) {
+        return s;
+    }
+    AnnotatePipelining annotator(directives);
+    s = annotator.mutate(s);
+    for (auto &d : directives) {
+        if (!d.applied) {
+            user_warning << "Loop " << d.item.loop_name << " of Func " << d.func << " is given pipelining directives, "
+                         << "but is not found in the device code, e.g. it is removed or unrolled. "
+                         << "The directives are ignored\n";
+        }
+    }
+    return s;
+}
+
+}
+}
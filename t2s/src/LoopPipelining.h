@@ -0,0 +1,49 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_LOOP_PIPELINING_H
+#define T2S_LOOP_PIPELINING_H
+
+/** \file
+ *
+ * Defines a pass to pass the pipelining directives of loops (See Func::ii() etc.) to the code generators of FPGAs.
+ */
+
+#include "../../Halide/src/Function.h"
+#include "../../Halide/src/IR.h"
+#include <map>
+
+namespace Halide {
+namespace Internal {
+
+/* For every loop with pipelining directives in a device kernel, an annotation is inserted right before the loop:
+ *     annotate("Pipeline", loop name, ii, speculated_iterations, loop_coalesce, max_concurrency)
+ *     for (loop, ...)
+ * where a directive not specified is -1. The code generators gather the annotations, and emit the directives as
+ * pragmas or attributes of the loop. A loop flattened with other loops, named like func.s0.k.j.i for loops k, j and
+ * i, takes the directives of all of them. If the initiation interval of a loop is specified, the recurrences through
+ * shift registers in the loop are checked against it, and a warning is given if a recurrence takes more
+ * floating-point operations than the interval.
+ * This pass must be run after flattening loops, so that the annotations name the loops as generated.
+ */
+extern Stmt annotate_loop_pipelining(Stmt s, const std::map<std::string, Function> &env);
+
+}
+}
+
+#endif
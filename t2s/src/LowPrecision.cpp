@@ -0,0 +1,143 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "../../Halide/src/Float16.h"
+#include "../../Halide/src/IRMutator.h"
+#include "../../Halide/src/IROperator.h"
+#include "../../Halide/src/Util.h"
+#include "./LowPrecision.h"
+
+namespace Halide {
+namespace Internal {
+
+bool is_float16_stored_as_bits(const Type &t, const Target &target) {
+    // Only the FPGA targets lower the arithmetic on such values (See lower_low_precision). Other targets still need
+    // CLHalf for float16.
+    if (!target.has_feature(Target::IntelFPGA) || target.has_feature(Target::SpatialOnCPU)) {
+        return false;
+    }
+    return t.is_bfloat() || (t.is_float() && t.bits() == 16 && !target.has_feature(Target::CLHalf));
+}
+
+namespace {
+
+class LowerLowPrecision : public IRMutator {
+    using IRMutator::visit;
+
+    const Target &target;
+
+    bool emulated(const Type &t) const {
+        return is_float16_stored_as_bits(t, target);
+    }
+
+    Expr to_float32(const Expr &e) const {
+        return Cast::make(Float(32, e.type().lanes()), e);
+    }
+
+    // Compute a binary operator on 16-bit floats in float32.
+    template<typename T>
+    Expr visit_binary(const T *op) {
+        Expr a = mutate(op->a);
+        Expr b = mutate(op->b);
+        if (!emulated(a.type())) {
+            return (a.same_as(op->a) && b.same_as(op->b)) ? Expr(op) : T::make(a, b);
+        }
+        Expr result = T::make(to_float32(a), to_float32(b));
+        return result.type().is_bool() ? result : Cast::make(op->type, result);
+    }
+
+    // The 8-bit integer that an operand is extended from, if any.
+    Expr narrow_operand(const Expr &e) const {
+        const Cast *c = e.as<Cast>();
+        if (c && c->value.type().is_int_or_uint() && c->value.type().bits() <= 8) {
+            return c->value;
+        }
+        return Expr();
+    }
+
+    Expr visit(const FloatImm *op) override {
+        if (!emulated(op->type)) {
+            return op;
+        }
+        uint16_t bits = op->type.is_bfloat() ? bfloat16_t(op->value).to_bits() : float16_t(op->value).to_bits();
+        return reinterpret(op->type, make_const(UInt(16), bits));
+    }
+
+    Expr visit(const Mul *op) override {
+        if (emulated(op->type)) {
+            return visit_binary(op);
+        }
+        Expr a = narrow_operand(op->a);
+        Expr b = narrow_operand(op->b);
+        if (op->type.is_int_or_uint() && op->type.bits() > 16 && a.defined() && b.defined()) {
+            int lanes = op->type.lanes();
+            Type narrow = (a.type().is_uint() && b.type().is_uint()) ? UInt(16, lanes) : Int(16, lanes);
+            return Cast::make(op->type, Mul::make(Cast::make(narrow, mutate(a)), Cast::make(narrow, mutate(b))));
+        }
+        return IRMutator::visit(op);
+    }
+
+    // Math functions on 16-bit floats: abs, and the "_f16" externs like sqrt_f16, are computed
+    // by their float32 versions. A Select needs nothing here: it only moves the bits, and its
+    // condition is lowered by the comparisons below.
+    Expr visit(const Call *op) override {
+        bool any_emulated = emulated(op->type);
+        for (auto &arg : op->args) {
+            any_emulated = any_emulated || emulated(arg.type());
+        }
+        bool is_f16_math = op->is_intrinsic(Call::abs) ||
+                           (op->call_type == Call::PureExtern && ends_with(op->name, "_f16"));
+        if (!any_emulated || !is_f16_math) {
+            return IRMutator::visit(op);
+        }
+        std::vector<Expr> args;
+        for (auto &arg : op->args) {
+            Expr a = mutate(arg);
+            args.push_back(emulated(a.type()) ? to_float32(a) : a);
+        }
+        Type type = emulated(op->type) ? Float(32, op->type.lanes()) : op->type;
+        std::string name = op->is_intrinsic(Call::abs) ? op->name : op->name.substr(0, op->name.size() - 4) + "_f32";
+        Expr result = Call::make(type, name, args, op->call_type);
+        return emulated(op->type) ? Cast::make(op->type, result) : result;
+    }
+
+    Expr visit(const Add *op) override { return visit_binary(op); }
+    Expr visit(const Sub *op) override { return visit_binary(op); }
+    Expr visit(const Div *op) override { return visit_binary(op); }
+    Expr visit(const Mod *op) override { return visit_binary(op); }
+    Expr visit(const Min *op) override { return visit_binary(op); }
+    Expr visit(const Max *op) override { return visit_binary(op); }
+    Expr visit(const EQ *op) override { return visit_binary(op); }
+    Expr visit(const NE *op) override { return visit_binary(op); }
+    Expr visit(const LT *op) override { return visit_binary(op); }
+    Expr visit(const LE *op) override { return visit_binary(op); }
+    Expr visit(const GT *op) override { return visit_binary(op); }
+    Expr visit(const GE *op) override { return visit_binary(op); }
+
+public:
+    LowerLowPrecision(const Target &target) : target(target) {}
+};
+
+} // namespace
+
+Stmt lower_low_precision(Stmt s, const Target &target) {
+    return LowerLowPrecision(target).mutate(s);
+}
+
+}
+}
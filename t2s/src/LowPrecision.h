@@ -0,0 +1,55 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_LOW_PRECISION_H
+#define T2S_LOW_PRECISION_H
+
+/** \file
+ *
+ * Defines a pass to lower the arithmetic of narrow types (int8, float16, bfloat16) for FPGAs.
+ *
+ */
+
+#include "../../Halide/src/IR.h"
+#include "../../Halide/src/Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/* A 16-bit float that the OpenCL/oneAPI codegen keeps as its 16 bits (ushort), and converts to float32 with bit
+ * operations when computing: on an FPGA target, every bfloat16, and every float16 if the target has no CLHalf.
+ * Elsewhere, float16 needs CLHalf as before, and bfloat16 is rejected.
+ */
+extern bool is_float16_stored_as_bits(const Type &t, const Target &target);
+
+/* Lower the arithmetic of narrow types for FPGAs:
+ *  1. Arithmetic on a 16-bit float stored as bits (see above) is done in float32: the operands are cast to float32,
+ *     and the result is cast back. A mixed-precision URE like
+ *         C(P) = select(..., 0, C(P_k_minus_1)) + f32(A(P)) * f32(B(P)) // A, B bfloat16, C float32
+ *     is not changed, and maps to a hardened float32 DSP.
+ *  2. A product of two integers extended from 8 bits, e.g. i32(A(P)) * i32(B(P)) with A and B int8, is done in 16 bits
+ *     and then extended. The product is exact, and the multiplier fits in half of a DSP (an 18x19 multiplier), so that
+ *     two such multiplies are packed into one DSP. This matters especially for vectors, which OpenCL does not promote
+ *     to int.
+ */
+extern Stmt lower_low_precision(Stmt s, const Target &target);
+
+}
+}
+
+#endif
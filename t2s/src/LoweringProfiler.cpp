@@ -0,0 +1,169 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "../../Halide/src/Debug.h"
+#include "../../Halide/src/Error.h"
+#include "../../Halide/src/IRVisitor.h"
+#include "./LoweringProfiler.h"
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <sys/resource.h>
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+
+namespace {
+
+// Count the unique nodes in the IR.
+class CountIRNodes : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+    std::set<const IRNode *> counted;
+
+public:
+    int count = 0;
+
+    void include(const Expr &e) override {
+        if (counted.insert(e.get()).second) {
+            count++;
+        }
+        IRGraphVisitor::include(e);
+    }
+
+    void include(const Stmt &s) override {
+        if (counted.insert(s.get()).second) {
+            count++;
+        }
+        IRGraphVisitor::include(s);
+    }
+};
+
+int count_ir_nodes(const Stmt &s) {
+    if (!s.defined()) {
+        return -1;
+    }
+    CountIRNodes counter;
+    counter.include(s);
+    return counter.count;
+}
+
+// The peak resident set size of this process so far, in KB.
+long peak_rss_kb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return usage.ru_maxrss;
+}
+
+string json_string(const string &str) {
+    std::ostringstream s;
+    s << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            s << '\\' << c;
+        } else if (c == '\n') {
+            s << "\\n";
+        } else if ((unsigned char)c < 0x20) {
+            s << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+        } else {
+            s << c;
+        }
+    }
+    s << '"';
+    return s.str();
+}
+
+} // namespace
+
+LoweringProfiler::LoweringProfiler(const string &pipeline_name) : pipeline_name(pipeline_name), in_pass(false) {
+    char *profile = getenv("HL_LOWER_PROFILE");
+    if (profile != NULL) {
+        file_name = profile;
+    }
+}
+
+void LoweringProfiler::start_pass(const string &pass_name, const Stmt &s) {
+    if (!enabled()) {
+        return;
+    }
+    end_pass(s);
+    in_pass = true;
+    name = pass_name;
+    start_ir_nodes = count_ir_nodes(s);
+    start_peak_rss_kb = peak_rss_kb();
+    // Start timing after counting the nodes, which is not part of the pass.
+    start_time = Clock::now();
+}
+
+void LoweringProfiler::end_pass(const Stmt &s) {
+    if (!in_pass) {
+        return;
+    }
+    double time_ms = std::chrono::duration<double, std::milli>(Clock::now() - start_time).count();
+    long rss_delta = peak_rss_kb() - start_peak_rss_kb;
+    passes.push_back(Pass{name, time_ms, rss_delta, start_ir_nodes, count_ir_nodes(s)});
+    in_pass = false;
+}
+
+void LoweringProfiler::finish(const Stmt &s) {
+    if (!enabled()) {
+        return;
+    }
+    end_pass(s);
+
+    double total_ms = 0;
+    for (const auto &p : passes) {
+        total_ms += p.time_ms;
+    }
+    std::ostringstream record;
+    record << std::fixed << std::setprecision(3);
+    record << "{\"pipeline\": " << json_string(pipeline_name)
+           << ", \"total_time_ms\": " << total_ms
+           << ", \"peak_rss_kb\": " << peak_rss_kb()
+           << ", \"passes\": [";
+    for (size_t i = 0; i < passes.size(); i++) {
+        const Pass &p = passes[i];
+        record << (i > 0 ? ", " : "")
+               << "{\"name\": " << json_string(p.name)
+               << ", \"time_ms\": " << p.time_ms
+               << ", \"peak_rss_delta_kb\": " << p.peak_rss_delta_kb
+               << ", \"ir_nodes_before\": " << p.ir_nodes_before
+               << ", \"ir_nodes_after\": " << p.ir_nodes_after
+               << "}";
+    }
+    record << "]}\n";
+
+    // The first profile written by this process replaces the file, and the others are appended to it.
+    static std::mutex file_mutex;
+    static bool file_started = false;
+    std::lock_guard<std::mutex> lock(file_mutex);
+    std::ofstream fp(file_name, file_started ? std::ios::app : std::ios::trunc);
+    user_assert(fp) << "Failed to open " << file_name << " (HL_LOWER_PROFILE) for writing the lowering profile\n";
+    fp << record.str();
+    fp.close();
+    file_started = true;
+    debug(1) << "Lowering profile of " << pipeline_name << " is appended to " << file_name << "\n";
+}
+
+}
+}
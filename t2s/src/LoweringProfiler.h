@@ -0,0 +1,87 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_LOWERING_PROFILER_H
+#define T2S_LOWERING_PROFILER_H
+
+/** \file
+ *
+ * Defines a profiler of the passes in lowering, enabled by the environment variable HL_LOWER_PROFILE.
+ *
+ */
+
+#include "../../Halide/src/IR.h"
+#include <chrono>
+
+namespace Halide {
+namespace Internal {
+
+/* Record the wall time, the increase of the peak resident set size (RSS) and the IR size before and after every
+ * lowering pass, and write them into the file named by the environment variable HL_LOWER_PROFILE. The IR size is the
+ * number of unique IR nodes. The file has a line for every pipeline lowered by the process, in the order the pipelines
+ * are lowered, and every line is a JSON record of the pipeline and its passes (JSON Lines). If HL_LOWER_PROFILE is not
+ * set, the profiler does nothing.
+ * Usage:
+ *     LoweringProfiler profiler(pipeline_name);
+ *     profiler.start_pass("pass 1", s);
+ *     s = pass1(s);
+ *     profiler.start_pass("pass 2", s); // End pass 1, and start pass 2
+ *     s = pass2(s);
+ *     profiler.finish(s);               // End pass 2, and write a line of the file
+ */
+class LoweringProfiler {
+public:
+    LoweringProfiler(const std::string &pipeline_name);
+
+    bool enabled() const { return !file_name.empty(); }
+
+    // End the current pass, if any, and start a new pass. The IR before the new pass is s, if defined.
+    void start_pass(const std::string &name, const Stmt &s = Stmt());
+
+    // End the current pass, if any, and write out the profile of the pipeline.
+    void finish(const Stmt &s);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Pass {
+        std::string name;
+        double      time_ms;
+        long        peak_rss_delta_kb;
+        int         ir_nodes_before;  // -1 if unknown
+        int         ir_nodes_after;
+    };
+
+    std::string       file_name;
+    std::string       pipeline_name;
+    std::vector<Pass> passes;
+
+    // About the current pass
+    bool              in_pass;
+    std::string       name;
+    Clock::time_point start_time;
+    long              start_peak_rss_kb;
+    int               start_ir_nodes;
+
+    void end_pass(const Stmt &s);
+};
+
+}
+}
+
+#endif
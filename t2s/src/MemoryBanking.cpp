@@ -0,0 +1,187 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "../../Halide/src/ExprUsesVar.h"
+#include "../../Halide/src/IRVisitor.h"
+#include "../../Halide/src/Scope.h"
+#include "./MemoryBanking.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// Find the dimensions of a buffer indexed by unrolled loops.
+class FindUnrolledDims : public IRVisitor {
+    using IRVisitor::visit;
+    const string &buffer;
+    Scope<> unrolled;           // Unrolled loops, and the lets depending on them
+
+    template<typename LetOrLetStmt>
+    void visit_let(const LetOrLetStmt *op) {
+        op->value.accept(this);
+        if (expr_uses_vars(op->value, unrolled)) {
+            unrolled.push(op->name);
+            op->body.accept(this);
+            unrolled.pop(op->name);
+        } else {
+            op->body.accept(this);
+        }
+    }
+
+    void record(const vector<Expr> &args) {
+        internal_assert(args.size() == banked.size());
+        for (size_t i = 0; i < args.size(); i++) {
+            if (expr_uses_vars(args[i], unrolled)) {
+                banked[i] = true;
+            }
+        }
+    }
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        if (op->for_type == ForType::Unrolled) {
+            unrolled.push(op->name);
+            op->body.accept(this);
+            unrolled.pop(op->name);
+        } else {
+            op->body.accept(this);
+        }
+    }
+
+    void visit(const Let *op) override {
+        visit_let(op);
+    }
+
+    void visit(const LetStmt *op) override {
+        visit_let(op);
+    }
+
+    void visit(const Provide *op) override {
+        IRVisitor::visit(op);
+        if (op->name == buffer) {
+            record(op->args);
+        }
+    }
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->name == buffer) {
+            record(op->args);
+        }
+    }
+
+public:
+    FindUnrolledDims(const string &buffer, size_t dims) : buffer(buffer), banked(dims, false) {}
+
+    vector<bool> banked;
+};
+
+int power_of_two_ceiling(int n) {
+    int p = 1;
+    while (p < n) {
+        p *= 2;
+    }
+    return p;
+}
+
+// Banking costs a crossbar between the banks and the accesses, which grows with the number of banks.
+const int max_banks = 32;
+
+// Padding the banked dimensions to powers of 2 may at most double the size of a buffer.
+const int max_padding = 2;
+
+} // namespace
+
+MemoryBanks bank_memory(const Realize *buffer) {
+    size_t num_dims = buffer->bounds.size();
+    MemoryBanks layout;
+    vector<int> extents;
+    for (auto &b : buffer->bounds) {
+        const IntImm *extent = b.extent.as<IntImm>();
+        if (!extent) {
+            // The padding cannot be decided. Leave the buffer unbanked.
+            debug(4) << "Buffer " << buffer->name << " has non-constant extents, and is not banked\n";
+            for (size_t i = 0; i < num_dims; i++) {
+                layout.dims.push_back(i);
+                layout.extents.push_back(buffer->bounds[i].extent);
+            }
+            return layout;
+        }
+        extents.push_back((int)extent->value);
+    }
+
+    FindUnrolledDims finder(buffer->name, num_dims);
+    buffer->body.accept(&finder);
+
+    // Bank the dimensions from the innermost, as long as the banks and the padding are within the limits.
+    vector<bool> banked = finder.banked;
+    int64_t size = 1;
+    for (int e : extents) {
+        size *= e;
+    }
+    int64_t padded_size = size;
+    for (size_t i = num_dims; i-- > 0;) {
+        if (!banked[i]) {
+            continue;
+        }
+        int extent = power_of_two_ceiling(extents[i]);
+        int64_t new_size = padded_size / extents[i] * extent;
+        if (layout.banks * extent > max_banks || new_size > max_padding * size) {
+            banked[i] = false;
+            continue;
+        }
+        padded_size = new_size;
+        layout.banks *= extent;
+    }
+
+    for (size_t i = 0; i < num_dims; i++) {
+        if (!banked[i]) {
+            layout.dims.push_back(i);
+            layout.extents.push_back(extents[i]);
+        }
+    }
+    for (size_t i = 0; i < num_dims; i++) {
+        if (banked[i]) {
+            layout.dims.push_back(i);
+            layout.extents.push_back(power_of_two_ceiling(extents[i]));
+        }
+    }
+    debug(4) << "Buffer " << buffer->name << " is declared with dimensions";
+    for (size_t i = 0; i < num_dims; i++) {
+        debug(4) << " " << layout.dims[i] << "[" << layout.extents[i] << "]";
+    }
+    debug(4) << " in " << layout.banks << " banks\n";
+    return layout;
+}
+
+int bank_width(const Type &t) {
+    if (t.is_generated_struct()) {
+        return 0;
+    }
+    // A vector of 3 elements takes the space of 4.
+    int bytes = t.bytes() * power_of_two_ceiling(t.lanes());
+    return (bytes & (bytes - 1)) == 0 ? bytes : 0;
+}
+
+}
+}
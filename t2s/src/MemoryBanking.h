@@ -0,0 +1,62 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_MEMORY_BANKING_H
+#define T2S_MEMORY_BANKING_H
+
+/** \file
+ *
+ * Defines an analysis to bank an on-chip buffer so that its unrolled accesses are free of conflicts.
+ */
+
+#include "../../Halide/src/IR.h"
+#include <vector>
+
+namespace Halide {
+namespace Internal {
+
+/** The layout of a banked on-chip buffer. */
+struct MemoryBanks {
+    std::vector<int> dims;      // The dimensions of the buffer in the order declared, outermost first
+    std::vector<Expr> extents;  // The extents of the declared dimensions
+    int banks;                  // The number of banks
+    MemoryBanks() : banks(1) {}
+};
+
+/* Bank an on-chip buffer (e.g. a double buffer inserted by Func::buffer()) by its accesses. A dimension of the buffer
+ * is banked if it is indexed by an unrolled loop in any access, directly or through lets. The banked dimensions are
+ * moved to be the innermost ones, with their extents rounded up to powers of 2:
+ *     realize B[i][u][j]                      declared as  B[i][j][u']
+ *       unrolled for (u, 0, 5)                  with numbanks(8), bankwidth(sizeof(element))
+ *         ... B[i][u][j] ...                    ... B[i][j][u] ...
+ * The unrolled iterations of an access differ only in the banked dimensions, and thus in the lowest bits of the word
+ * address, which are exactly the bits a compiler selects a bank with by default. So every unrolled iteration of an
+ * access hits a bank of its own, without arbitration. Code generators declare the buffer with the layout, and index
+ * the buffer with the arguments of the accesses in the order of the declared dimensions.
+ * The dimensions are banked from the innermost one, as long as the buffer has at most 32 banks, and the padding at
+ * most doubles its size. The other dimensions stay unbanked. A buffer with non-constant extents is not banked at all.
+ */
+extern MemoryBanks bank_memory(const Realize *buffer);
+
+/** The width in bytes of a bank holding elements of the given type, or 0 if the width is better left to the compiler. */
+extern int bank_width(const Type &t);
+
+}
+}
+
+#endif
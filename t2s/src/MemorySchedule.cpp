@@ -18,6 +18,7 @@
 *******************************************************************************/
 #include <list>
 #include "../../Halide/src/CSE.h"
+#include "../../Halide/src/ExprUsesVar.h"
 #include "../../Halide/src/IR.h"
 #include "../../Halide/src/IREquality.h"
 #include "../../Halide/src/IRMutator.h"
@@ -140,6 +141,12 @@ inline string addr_name(const string &buf, const string &type,
 inline string buf_name(string name = "") {
     return name + "_buf";
 }
+inline string slm_name(string name = "") {
+    return name + "_slm";
+}
+inline string stage_name(string name = "") {
+    return name + "_stage";
+}
 
 int space_loop_extents() {
     int sz = 1;
@@ -1120,18 +1127,189 @@ public:
     }
 };
 
+// Collect the GPU thread loops (from outer to inner)
+class GPUThreadLoopCollector : public IRVisitor
+{
+public:
+    vector<const For *> thread_loops;
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        if (op->for_type == ForType::GPUThread) {
+            thread_loops.push_back(op);
+        }
+        op->body.accept(this);
+    }
+};
+
 class GPUBufferInserter : public IRMutator
 {
 public:
-    GPUBufferInserter(const map<string, Function>& _env)
-        : env(_env) {}
+    GPUBufferInserter(const map<string, Function>& _env, const vector<const For *> &_thread_loops)
+        : env(_env), thread_loops(_thread_loops) {}
 
 private:
     bool in_kernel = false;
     const map<string, Function> &env;
+    const vector<const For *> &thread_loops;
     vector<string> alloc_buf;
     using IRMutator::visit;
 
+    // A buffer in SLM is shared by the threads along the thread loops that its address does not depend on.
+    // The threads sharing a tile are distinguished by their rank, and the tiles of a work-group by their group.
+    struct SLMLayout {
+        Expr rank = 0;
+        int sharers = 1;
+        Expr group = 0;
+        int groups = 1;
+        int tile = 0;                       // the elements of a tile
+    };
+    // A piece of a tile that is loaded by one thread
+    struct SLMPiece {
+        int ext_0, rows;
+        int off_0, off_1;
+        int acc;                            // the offset of the piece in the tile
+    };
+
+    SLMLayout get_slm_layout(string name) {
+        const auto &info = gpu_bufs[name];
+        SLMLayout layout;
+        for (auto loop : thread_loops) {
+            const int64_t *ext = as_const_int(simplify(loop->extent));
+            user_assert(ext)
+                << "The extent of GPU thread loop " << loop->name << " must be constant to share "
+                << name << " in SLM\n";
+            Expr var = make_var(loop->name) - loop->min;
+            if (expr_uses_var(info.iter_loop.addr, loop->name)) {
+                layout.group = layout.group * (int)*ext + var;
+                layout.groups *= (int)*ext;
+            } else {
+                layout.rank = layout.rank * (int)*ext + var;
+                layout.sharers *= (int)*ext;
+            }
+        }
+        layout.rank = simplify(layout.rank);
+        layout.group = simplify(layout.group);
+        for (auto &in : info.load_inst) {
+            layout.tile += in.ext_0 * in.ext_1;
+        }
+        int bytes = image_param[name].type().bytes();
+        user_assert(2 * layout.groups * layout.tile * bytes <= 65536)
+            << "The double-buffered tiles of " << name << " take " << 2 * layout.groups * layout.tile * bytes
+            << " bytes, more than the 64KB of SLM of a work-group\n";
+        return layout;
+    }
+
+    // Split the load instructions into pieces, one for each of the threads sharing a tile if possible.
+    // An instruction is split along its rows.
+    vector<SLMPiece> split_load_insts(string name, int sharers) {
+        const auto &load_inst = gpu_bufs[name].load_inst;
+        int parts_wanted = std::max(1, sharers / (int)load_inst.size());
+        vector<SLMPiece> pieces;
+        int acc_size = 0;
+        for (auto &in : load_inst) {
+            int parts = std::min(parts_wanted, in.ext_1);
+            while (in.ext_1 % parts != 0) {
+                parts--;
+            }
+            int rows = in.ext_1 / parts;
+            for (int p = 0; p < parts; p++) {
+                pieces.push_back({ in.ext_0, rows, in.off_0, in.off_1 + p * rows, acc_size + p * rows * in.ext_0 });
+            }
+            acc_size += in.ext_0 * in.ext_1;
+        }
+        return pieces;
+    }
+
+    int stage_size(string name, int sharers) {
+        int size = 0;
+        for (auto &p : split_load_insts(name, sharers)) {
+            size = std::max(size, p.ext_0 * p.rows);
+        }
+        // Register buffers are allocated in dwords
+        return (size + 3) / 4 * 4;
+    }
+
+    // The threads sharing a tile take turns to load the pieces of the tile into registers and write them into SLM:
+    //   if (rank == piece % sharers) {
+    //     cm_load_2d(X, addr_0 + off_0, addr_1 + off_1, X_stage, ...)
+    //     X_slm[base + acc, ...] = X_stage[0, ...]
+    //   }
+    Stmt make_slm_load_insts(string name, const SLMLayout &layout, const vector<Expr> &addrs, Expr base) {
+        // Eliminate _im suffix
+        auto pos = name.find("_im");
+        internal_assert(pos != name.npos);
+        string image = name.substr(0, pos);
+        Type type = image_param[name].type();
+
+        Expr image_var = Variable::make(Handle(), image);
+        Expr stage_var = Variable::make(Handle(), stage_name(name));
+        vector<SLMPiece> pieces = split_load_insts(name, layout.sharers);
+        Stmt block;
+        for (size_t i = 0; i < pieces.size(); i++) {
+            const auto &p = pieces[i];
+            int size = p.ext_0 * p.rows;
+            Expr whole = Ramp::make(0, 1, size);
+            vector<Expr> call_args = { image_var, simplify(addrs[0] + p.off_0), simplify(addrs[1] + p.off_1),
+                                       stage_var, whole, p.ext_0, p.rows };
+            Stmt load = Evaluate::make(Call::make(type, Call::cm_load_2d, call_args, Call::Intrinsic));
+            Expr staged = Load::make(type.with_lanes(size), stage_name(name), whole,
+                                     Buffer<>(), Parameter(), const_true(size), ModulusRemainder());
+            Stmt write = Store::make(slm_name(name), staged, Ramp::make(simplify(base + p.acc), 1, size),
+                                     Parameter(), const_true(size), ModulusRemainder());
+            Stmt piece = Block::make(load, write);
+            if (layout.sharers > 1) {
+                piece = IfThenElse::make(layout.rank == (int)(i % layout.sharers), piece);
+            }
+            block = !block.defined() ? piece : Block::make(block, piece);
+        }
+        return block;
+    }
+
+    // Double-buffer the tiles in SLM: while computing with the tile in one half of X_slm,
+    // the threads load the tile of the next iteration into the other half.
+    // Transform the IR like this:
+    // X_slm[half 0] = tile(min)                   // prologue, inserted above loop n
+    // barrier
+    // for (n, min, extent) {
+    //   X_buf = X_slm[half (n - min) % 2]
+    //   if (n + 1 < min + extent) {
+    //     X_slm[half (n - min + 1) % 2] = tile(n + 1)
+    //   }
+    //   barrier
+    //   ...
+    // }
+    Stmt make_slm_pipeline(string name, const For *op, Stmt body, Stmt &prologue) {
+        const auto &info = gpu_bufs[name];
+        SLMLayout layout = get_slm_layout(name);
+        Type type = image_param[name].type();
+        auto addrs = info.iter_loop.addr.as<Shuffle>()->vectors;
+        auto addrs_at = [&](Expr iter) {
+            vector<Expr> ret;
+            for (auto &a : addrs) {
+                ret.push_back(simplify(substitute(op->name, iter, a)));
+            }
+            return ret;
+        };
+        auto tile_base = [&](Expr half) {
+            return simplify(half * (layout.groups * layout.tile) + layout.group * layout.tile);
+        };
+        Stmt barrier = Evaluate::make(Call::make(Int(32), Call::gpu_thread_barrier,
+                                                 vector<Expr>(), Call::Intrinsic));
+
+        prologue = Block::make(make_slm_load_insts(name, layout, addrs_at(op->min), tile_base(0)), barrier);
+
+        Expr iter = make_var(op->name);
+        Expr half = (iter - op->min) % 2;
+        Expr whole = Ramp::make(0, 1, layout.tile);
+        Expr read = Load::make(type.with_lanes(layout.tile), slm_name(name), Ramp::make(tile_base(half), 1, layout.tile),
+                               Buffer<>(), Parameter(), const_true(layout.tile), ModulusRemainder());
+        Stmt fill = Store::make(buf_name(name), read, whole, Parameter(), const_true(layout.tile), ModulusRemainder());
+        Stmt next = make_slm_load_insts(name, layout, addrs_at(iter + 1), tile_base(1 - half));
+        Stmt prefetch = IfThenElse::make(iter + 1 < op->min + op->extent, next);
+        return Block::make({ fill, prefetch, barrier, body });
+    }
+
     Stmt make_load_inst(string name, bool is_init, size_t len,
                         Expr load_offs, Expr store_idx) {
         // Eliminate _im suffix
@@ -1287,6 +1465,8 @@ private:
         Stmt body = mutate(op->body);
         // True at the beginning of a kernel (the first GPU loop)
         in_kernel = (in_kernel==false && op->for_type==ForType::GPUThread) ? true : false;
+        // The loads of the first tiles into SLM, which are inserted above this loop
+        vector<Stmt> prologues;
 
         for (auto func : gpu_bufs) {
             string name = func.first;
@@ -1310,8 +1490,14 @@ private:
                 // }
                 // Insert loops enclosing the load instructions
                 // Stmt iter_for = build_enclosing_loops(name, false, op);
-                Stmt iter_for = make_load_insts(name);
-                body = Block::make(iter_for, body);
+                if (info.fp.store_in == MemoryType::GPUShared) {
+                    Stmt prologue;
+                    body = make_slm_pipeline(name, op, body, prologue);
+                    prologues.push_back(prologue);
+                } else {
+                    Stmt iter_for = make_load_insts(name);
+                    body = Block::make(iter_for, body);
+                }
                 // if (sz > 0) {
                 //     Stmt init_for = build_fetch_loops(name, true, op->device_api);
                 //     out_body = out_body.defined() ?Block::make(out_body, init_for) :init_for;
@@ -1334,11 +1520,23 @@ private:
                 for (size_t i = 0; i < info.allocation.size(); i++) {
                     buf_size.push_back(info.allocation[i].extent);
                 }
+                if (info.fp.store_in == MemoryType::GPUShared) {
+                    // The tiles are double buffered in SLM, and each thread reads its tile into registers
+                    SLMLayout layout = get_slm_layout(name);
+                    body = Allocate::make(slm_name(name), image_param[name].type(), MemoryType::GPUShared,
+                                          { 2 * layout.groups * layout.tile }, const_true(), body);
+                    body = Allocate::make(stage_name(name), image_param[name].type(), MemoryType::Register,
+                                          { stage_size(name, layout.sharers) }, const_true(), body);
+                }
+                MemoryType store_in = info.fp.store_in == MemoryType::GPUShared ? MemoryType::Register : info.fp.store_in;
                 body = Allocate::make(buf_name(name), image_param[name].type(),
-                                    info.fp.store_in, buf_size, const_true(), body);
+                                    store_in, buf_size, const_true(), body);
             }
         }
         body = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        for (auto &p : prologues) {
+            body = Block::make(p, body);
+        }
         // if (out_body.defined()) {
         //     body = Block::make(out_body, body);
         // }
@@ -1563,7 +1761,9 @@ Stmt do_prepare_memory_schedule(Stmt s, const map<string, Function> &env, const
 Stmt do_memory_schedule(Stmt s, const map<string, Function> &env) {
     // The loop information is collected before performing space-time transform
     if (!loop_vars.empty()) {
-        GPUBufferInserter gb_inserter(env);
+        GPUThreadLoopCollector thread_lc;
+        s.accept(&thread_lc);
+        GPUBufferInserter gb_inserter(env, thread_lc.thread_loops);
         GPUStoreInserter gs_inserter(env);
         AutoUnroll auto_unroll(env);
         GPUInnerProductMatcher gpu_ipm(env);
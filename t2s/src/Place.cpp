@@ -48,7 +48,15 @@ private:
                 << "Device Func " << op->name << " is expected to have one and only one definition\n";
             Stmt body = mutate(op->body);
             Stmt new_body;
-            if( target.has_feature(Target::OneAPI) ){
+            if (target.has_feature(Target::SpatialOnCPU)) {
+                // The kernel will be dispatched to a thread of the host (See SpatialOnCPU.cpp).
+                new_body = For::make(op->name + ".s0.run_on_device",
+                                        0,
+                                        1,
+                                        ForType::Parallel,
+                                        DeviceAPI::Host,
+                                        body);
+            } else if( target.has_feature(Target::OneAPI) ){
                 new_body = For::make(op->name + ".s0.run_on_device",
                                         0,
                                         1,
@@ -16,6 +16,7 @@
 *
 * SPDX-License-Identifier: BSD-2-Clause-Patent
 *******************************************************************************/
+#include "FindCalls.h"
 #include "IRMutator.h"
 #include "IRVisitor.h"
 #include "Simplify.h"
@@ -183,9 +184,84 @@ void annotate_loop_type(Func func) {
     }
 }
 
+// Is the Func a serializer (a host Func called by a device Func), or a deserializer (a host Func calling a device Func)?
+bool is_host_serializer(const Func &func, const map<string, Func> &env) {
+    if (func.function().place() != Place::Host) {
+        return false;
+    }
+    for (auto &e : env) {
+        const Function &other = e.second.function();
+        if (other.place() != Place::Device) {
+            continue;
+        }
+        if (find_direct_calls(other).count(func.name()) > 0 || find_direct_calls(func.function()).count(other.name()) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The extent of a loop of the Func set by set_bounds, or undefined. Function::get_bounds() is not used, as it would
+// insert undefined bounds for the loop, which later passes take as set.
+Expr bounded_extent(const Function &f, const string &var) {
+    auto bounds = f.arg_min_extents().find(var);
+    return (bounds == f.arg_min_extents().end()) ? Expr() : bounds->second.second;
+}
+
+// A serializer or deserializer only reshuffles data between the host and the device layouts, and is a pure function.
+// Unless the user has scheduled it, run its outermost loop in parallel and vectorize its innermost loop. Only the loops
+// with non-unit extents set by set_bounds count. The innermost loop is vectorized only if its extent is a constant.
+// In AOT host code, the parallel loop is an OpenMP pragma, and the host program must be built with -fopenmp.
+void schedule_host_serializer(Func func, const Target &target) {
+    const Function &f = func.function();
+    const auto &schedule = f.definition().schedule();
+    if (!f.updates().empty() || f.has_extern_definition() || f.has_merged_defs() || !schedule.splits().empty()) {
+        return;
+    }
+    const auto &dims = schedule.dims();
+    for (auto &d : dims) {
+        if (d.for_type != ForType::Serial) {
+            return;
+        }
+    }
+    auto non_unit = [&](const Dim &d) {
+        Expr extent = bounded_extent(f, d.var);
+        return extent.defined() && !is_one(extent);
+    };
+    int outermost = -1, innermost = -1;
+    for (int i = (int)dims.size() - 2; i >= 0 && outermost < 0; i--) {     // The last dim is __outermost
+        if (non_unit(dims[i])) outermost = i;
+    }
+    for (int i = 0; i < (int)dims.size() - 1 && innermost < 0; i++) {
+        if (non_unit(dims[i])) innermost = i;
+    }
+    if (outermost < 0) {
+        return;
+    }
+    Var outer(dims[outermost].var);
+    func.parallel(outer);
+    debug(1) << func.name() << ".parallel(" << outer << ");\n";
+
+    if (innermost == outermost) {
+        return;
+    }
+    Var inner(dims[innermost].var);
+    const int64_t *extent = as_const_int(bounded_extent(f, inner.name()));
+    int natural = target.natural_vector_size(func.output_types()[0]);
+    if (extent != NULL && *extent >= 2 && *extent <= 64) {
+        func.vectorize(inner);
+        debug(1) << func.name() << ".vectorize(" << inner << ");\n";
+    } else if (extent != NULL && natural > 1 && *extent % natural == 0) {
+        func.vectorize(inner, natural);
+        debug(1) << func.name() << ".vectorize(" << inner << ", " << natural << ");\n";
+    }
+}
 
 void t2s_preprocess_before_lower(map<string, Func> &env, const Target &target) {
     debug(4) << "Preprocessing functions in the environment:\n";
+    char *host_schedule = getenv("HL_HOST_SERIALIZER_SCHEDULE");
+    bool schedule_serializers = target.has_feature(Target::IntelFPGA) && !target.has_feature(Target::OneAPI) &&
+                                (host_schedule == NULL || string(host_schedule) != "off");
     for (auto &e : env) {
         auto &func = e.second;
 
@@ -193,6 +269,11 @@ void t2s_preprocess_before_lower(map<string, Func> &env, const Target &target) {
         // calls of the function, later we will fix their args corresponding to the loops.
         convert_removed_loops_to_unit_loops(func);
 
+        // Serializers and deserializers on the host
+        if (schedule_serializers && is_host_serializer(func, env)) {
+            schedule_host_serializer(func, target);
+        }
+
         // GPU-related transform
         if (target.has_feature(Target::IntelGPU)) {
             reorder_gpu_loops(func);
@@ -0,0 +1,465 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "../../Halide/src/Bounds.h"
+#include "../../Halide/src/ExprUsesVar.h"
+#include "../../Halide/src/IREquality.h"
+#include "../../Halide/src/IRMutator.h"
+#include "../../Halide/src/IROperator.h"
+#include "../../Halide/src/Simplify.h"
+#include "../../Halide/src/Substitute.h"
+#include "../../Halide/src/Util.h"
+#include "./RelayStreams.h"
+#include "./ResourceEstimate.h"
+#include "./SystolicDSE.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// A node on the path from the root of the IR to an access: a loop, a let, or a condition that holds on the path.
+struct Frame {
+    const For *loop = nullptr;
+    string let;
+    Expr value;         // The value of the let, or the condition
+};
+
+// Find the write and the read of a function, and the paths to them.
+class FindAccessPaths : public IRVisitor {
+    using IRVisitor::visit;
+    const string &func;
+    vector<Frame> frames;
+    int in_select = 0;
+
+    void push_condition(const Expr &condition) {
+        Frame f;
+        f.value = condition;
+        frames.push_back(f);
+    }
+
+    template<typename LetOrLetStmt>
+    void visit_let(const LetOrLetStmt *op) {
+        op->value.accept(this);
+        Frame f;
+        f.let = op->name;
+        f.value = op->value;
+        frames.push_back(f);
+        op->body.accept(this);
+        frames.pop_back();
+    }
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        Frame f;
+        f.loop = op;
+        frames.push_back(f);
+        op->body.accept(this);
+        frames.pop_back();
+    }
+
+    void visit(const Let *op) override {
+        visit_let(op);
+    }
+
+    void visit(const LetStmt *op) override {
+        visit_let(op);
+    }
+
+    void visit(const IfThenElse *op) override {
+        op->condition.accept(this);
+        push_condition(op->condition);
+        op->then_case.accept(this);
+        frames.pop_back();
+        if (op->else_case.defined()) {
+            push_condition(!op->condition);
+            op->else_case.accept(this);
+            frames.pop_back();
+        }
+    }
+
+    void visit(const Select *op) override {
+        op->condition.accept(this);
+        in_select++;
+        op->true_value.accept(this);
+        op->false_value.accept(this);
+        in_select--;
+    }
+
+    void visit(const Provide *op) override {
+        IRVisitor::visit(op);
+        if (op->name == func) {
+            user_assert(!provide) << "The output of " << func << " is relayed, and thus must be produced only once\n";
+            user_assert(op->values.size() == 1) << "Relaying the output of " << func << ", which has multiple values, "
+                                                << "is not supported\n";
+            provide = op;
+            write_path = frames;
+        }
+    }
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->call_type == Call::Halide && op->name == func) {
+            user_assert(!call) << "The output of " << func << " is relayed, and thus must be read only once\n";
+            user_assert(in_select == 0) << "The output of " << func << " is relayed, and thus must be read "
+                                        << "unconditionally or under an if, but not under a select\n";
+            call = op;
+            read_path = frames;
+        }
+    }
+
+public:
+    FindAccessPaths(const string &func) : func(func) {}
+
+    const Provide *provide = nullptr;
+    const Call *call = nullptr;
+    vector<Frame> write_path;
+    vector<Frame> read_path;
+};
+
+// The first call to a Halide function in an IR, if any.
+class FindHalideCall : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Halide && found.empty()) {
+            found = op->name;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    string found;
+};
+
+// The index of the kernel in a path, or -1 if the path is not on the device.
+int kernel_index(const vector<Frame> &path) {
+    for (int i = (int)path.size() - 1; i >= 0; i--) {
+        if (path[i].loop && ends_with(path[i].loop->name, ".run_on_device")) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool has_frame(const vector<Frame> &path, int end, const Frame &f) {
+    for (int i = 0; i < end; i++) {
+        const Frame &g = path[i];
+        if ((f.loop && g.loop && f.loop->name == g.loop->name) ||
+            (!f.let.empty() && f.let == g.let) ||
+            (!f.loop && f.let.empty() && !g.loop && g.let.empty() && equal(f.value, g.value))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The positions of the loops in a path inside the kernel at the given position, outermost first.
+vector<int> loops_in_kernel(const vector<Frame> &path, int kernel) {
+    vector<int> loops;
+    for (size_t i = kernel + 1; i < path.size(); i++) {
+        if (path[i].loop) {
+            loops.push_back(i);
+        }
+    }
+    return loops;
+}
+
+// The bounds of the args over the loops of a path. The loops in the map are fixed to the given variables.
+vector<Interval> region_of(const vector<Expr> &args, const vector<Frame> &path, const map<string, Expr> &fixed) {
+    Scope<Interval> scope;
+    for (auto &f : path) {
+        if (f.loop) {
+            auto v = fixed.find(f.loop->name);
+            if (v != fixed.end()) {
+                scope.push(f.loop->name, Interval::single_point(v->second));
+                continue;
+            }
+            Interval min = bounds_of_expr_in_scope(substitute(fixed, f.loop->min), scope);
+            Interval extent = bounds_of_expr_in_scope(substitute(fixed, f.loop->extent), scope);
+            if (min.is_bounded() && extent.is_bounded()) {
+                scope.push(f.loop->name, Interval(min.min, min.max + extent.max - 1));
+            } else {
+                scope.push(f.loop->name, Interval::everything());
+            }
+        } else if (!f.let.empty()) {
+            scope.push(f.let, bounds_of_expr_in_scope(substitute(fixed, f.value), scope));
+        }
+    }
+    vector<Interval> region;
+    for (auto &a : args) {
+        Interval b = bounds_of_expr_in_scope(substitute(fixed, a), scope);
+        if (b.is_bounded()) {
+            b.min = simplify(b.min);
+            b.max = simplify(b.max);
+        }
+        region.push_back(b);
+    }
+    return region;
+}
+
+// The constant extent of an interval, or -1.
+int64_t constant_extent(const Interval &b) {
+    if (!b.is_bounded()) {
+        return -1;
+    }
+    const int64_t *extent = as_const_int(simplify(b.max - b.min + 1));
+    return extent ? *extent : -1;
+}
+
+// Store the output of a function into a buffer, and send every tile of the buffer in the body of the tile loop of
+// the function, right after the tile is produced. Without tile loops, the tile is the whole output, sent at the end
+// of the kernel.
+class RelayThroughTile : public IRMutator {
+    using IRMutator::visit;
+    const string &kernel;
+    const string &tile_loop;
+    const Provide *provide;
+    const string &tile;
+    Expr write_address;
+    Stmt relay;
+    int size;
+
+    Stmt visit(const Provide *op) override {
+        if (op == provide) {
+            return Store::make(tile, op->values[0], write_address, Parameter(), const_true(), ModulusRemainder());
+        }
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->name != kernel && op->name != tile_loop) {
+            return IRMutator::visit(op);
+        }
+        Stmt body = mutate(op->body);
+        if (op->name == tile_loop) {
+            body = Block::make(body, relay);
+        }
+        if (op->name == kernel) {
+            body = Block::make(body, Free::make(tile));
+            // An array in the kernel, i.e. on-chip RAM blocks.
+            body = Allocate::make(tile, provide->values[0].type(), MemoryType::Auto, {size}, const_true(), body);
+        }
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+    }
+
+public:
+    RelayThroughTile(const string &kernel, const string &tile_loop, const Provide *provide, const string &tile,
+                     Expr write_address, Stmt relay, int size) :
+        kernel(kernel), tile_loop(tile_loop), provide(provide), tile(tile), write_address(write_address),
+        relay(relay), size(size) {}
+};
+
+Stmt relay_through_tile(Stmt s, const string &func) {
+    FindAccessPaths finder(func);
+    s.accept(&finder);
+    user_assert(finder.provide && finder.call)
+        << "The output of " << func << " is relayed, and thus the function must be computed at root, "
+        << "with a consumer on the device\n";
+    const vector<Frame> &write_path = finder.write_path;
+    const vector<Frame> &read_path = finder.read_path;
+    int kw = kernel_index(write_path);
+    int kr = kernel_index(read_path);
+    user_assert(kw >= 0 && kr >= 0)
+        << "The output of " << func << " is relayed, and thus both the function and its consumer must be on the device\n";
+    const vector<Expr> &write_args = finder.provide->args;
+    const vector<Expr> &read_args = finder.call->args;
+
+    // Find the tile loops: the outermost loops of the function that iterate as the outermost loops of the consumer,
+    // and produce in every iteration exactly the tile that the consumer reads in the same iteration. Take as many
+    // such loops as possible, for the smallest tile. Without such loops, the tile is the whole output.
+    vector<int> write_loops = loops_in_kernel(write_path, kw);
+    vector<int> read_loops = loops_in_kernel(read_path, kr);
+    map<string, Expr> write_fixed, read_fixed;   // A tile loop of either side -> the variable of the function's loop
+    int depth = 0;
+    vector<Interval> region = region_of(write_args, write_path, write_fixed);
+    for (size_t d = 0; d < std::min(write_loops.size(), read_loops.size()); d++) {
+        const For *w = write_path[write_loops[d]].loop;
+        const For *r = read_path[read_loops[d]].loop;
+        if (w->for_type != ForType::Serial || r->for_type != ForType::Serial ||
+            !equal(simplify(w->min), simplify(substitute(read_fixed, r->min))) ||
+            !equal(simplify(w->extent), simplify(substitute(read_fixed, r->extent)))) {
+            break;
+        }
+        // Every tile must be produced, i.e. no condition may skip the body of a tile loop.
+        bool conditional = false;
+        for (int i = kw + 1; i < write_loops[d]; i++) {
+            conditional = conditional || (!write_path[i].loop && write_path[i].let.empty());
+        }
+        if (conditional) {
+            break;
+        }
+        write_fixed[w->name] = Variable::make(Int(32), w->name);
+        read_fixed[r->name] = Variable::make(Int(32), w->name);
+        vector<Interval> written = region_of(write_args, write_path, write_fixed);
+        vector<Interval> read = region_of(read_args, read_path, read_fixed);
+        bool same = true;
+        for (size_t i = 0; i < written.size(); i++) {
+            same = same && constant_extent(written[i]) > 0 && constant_extent(read[i]) == constant_extent(written[i])
+                        && can_prove(written[i].min == read[i].min);
+        }
+        if (same) {
+            depth = d + 1;
+            region = written;
+        }
+    }
+    for (int d = (int)write_loops.size() - 1; d >= depth; d--) {
+        write_fixed.erase(write_path[write_loops[d]].loop->name);
+    }
+    for (int d = (int)read_loops.size() - 1; d >= depth; d--) {
+        read_fixed.erase(read_path[read_loops[d]].loop->name);
+    }
+
+    // The bounds of a tile. The mins are in terms of the tile loops.
+    vector<Expr> mins;
+    vector<int> extents;
+    int64_t size = 1;
+    for (size_t i = 0; i < region.size(); i++) {
+        int64_t extent = constant_extent(region[i]);
+        user_assert(extent > 0)
+            << "The output of " << func << " is relayed through an on-chip buffer, and thus must have constant bounds "
+            << "in every tile, but dimension " << i << " is bounded by " << region[i].min << " and " << region[i].max
+            << "\n";
+        mins.push_back(region[i].min);
+        extents.push_back((int)extent);
+        size *= extent;
+        user_assert(size <= 0x7fffffff) << "The output of " << func << " is too big to be relayed on chip\n";
+    }
+
+    // Double buffer the tiles, so that a tile can be produced while the previous one is sent. The tiles are numbered
+    // by the tile loops, and alternate between the two halves of the buffer.
+    int slots = (depth > 0) ? 2 : 1;
+    user_assert(slots * size <= 0x7fffffff) << "The output of " << func << " is too big to be relayed on chip\n";
+    Expr slot_base = 0;
+    if (depth > 0) {
+        Expr tile_number = 0;
+        for (int d = 0; d < depth; d++) {
+            const For *loop = write_path[write_loops[d]].loop;
+            tile_number = tile_number * loop->extent + (Variable::make(Int(32), loop->name) - loop->min);
+        }
+        slot_base = (tile_number % 2) * (int)size;
+    }
+    Type t = finder.provide->values[0].type();
+    FPGABudget budget = budget_of_board();
+    long long m20ks = m20ks_of_memory(slots * size, t.bits());
+    user_assert(m20ks <= budget.m20ks / 2)
+        << "The output of " << func << " is relayed through an on-chip buffer of " << slots << " x " << size << " x "
+        << t << ", which takes " << m20ks << " RAM blocks, more than half of those of " << budget.name << ". "
+        << "Tile the outermost loops of " << func << " and of its consumer alike, so that every iteration of "
+        << "them produces and reads a smaller tile\n";
+    auto address = [&](const vector<Expr> &args) -> Expr {
+        Expr addr = slot_base;
+        int stride = 1;
+        for (size_t i = 0; i < args.size(); i++) {
+            addr = addr + (args[i] - mins[i]) * stride;
+            stride *= extents[i];
+        }
+        return simplify(addr);
+    };
+
+    // Rename the loops and lets of the consumer's kernel after the function, e.g. c.s0.x to func.relay.x, except the
+    // tile loops, which become the tile loops of the function.
+    const string &consumer_kernel = read_path[kr].loop->name;
+    string consumer_prefix = consumer_kernel.substr(0, consumer_kernel.size() - string("run_on_device").size());
+    string relay_prefix = func + ".relay.";
+    map<string, Expr> renamed = read_fixed;
+    vector<string> new_names(read_path.size());
+    for (size_t i = kr + 1; i < read_path.size(); i++) {
+        const string &name = read_path[i].loop ? read_path[i].loop->name : read_path[i].let;
+        if (name.empty() || read_fixed.count(name)) {
+            continue;
+        }
+        new_names[i] = starts_with(name, consumer_prefix) ? relay_prefix + name.substr(consumer_prefix.size())
+                                                          : relay_prefix + name;
+        renamed[name] = Variable::make(Int(32), new_names[i]);
+    }
+
+    // Replay the read of a tile in the kernel of the function, from the innermost.
+    string tile = func + ".tile";
+    vector<Expr> relay_args;
+    for (auto &a : read_args) {
+        relay_args.push_back(substitute(renamed, a));
+    }
+    Expr value = Load::make(t, tile, address(relay_args), Buffer<>(), Parameter(), const_true(), ModulusRemainder());
+    Stmt relay = Provide::make(func, {value}, relay_args);
+    for (int i = (int)read_path.size() - 1; i > kr; i--) {
+        const Frame &f = read_path[i];
+        if (f.loop) {
+            if (!read_fixed.count(f.loop->name)) {
+                relay = For::make(new_names[i], substitute(renamed, f.loop->min), substitute(renamed, f.loop->extent),
+                                  f.loop->for_type, f.loop->device_api, relay);
+            }
+        } else if (!f.let.empty()) {
+            if (stmt_uses_var(relay, new_names[i])) {
+                Expr v = substitute(renamed, f.value);
+                relay = LetStmt::make(new_names[i], v, relay);
+            }
+        } else {
+            relay = IfThenElse::make(substitute(renamed, f.value), relay);
+        }
+    }
+    // The consumer may be in the scope of some lets and conditions outside the kernels that the function is not in.
+    for (int i = kr - 1; i >= 0; i--) {
+        const Frame &f = read_path[i];
+        if (has_frame(write_path, kw, f)) {
+            continue;
+        }
+        user_assert(!f.loop) << "The output of " << func << " is relayed, and thus its consumer must be computed at "
+                             << "root, not inside loop " << f.loop->name << "\n";
+        if (!f.let.empty()) {
+            if (stmt_uses_var(relay, f.let)) {
+                relay = LetStmt::make(f.let, f.value, relay);
+            }
+        } else {
+            relay = IfThenElse::make(f.value, relay);
+        }
+    }
+    FindHalideCall calls;
+    relay.accept(&calls);
+    user_assert(calls.found.empty())
+        << "The output of " << func << " is relayed, but the consumer reads it depending on function "
+        << calls.found << ", which cannot be replayed in the kernel of " << func << "\n";
+
+    const string &kernel = write_path[kw].loop->name;
+    const string &tile_loop = (depth > 0) ? write_path[write_loops[depth - 1]].loop->name : kernel;
+    debug(3) << "Relay the output of " << func << " in loop " << tile_loop << " through a buffer of " << slots
+             << " x " << size << " x " << t << ":\n"
+             << relay << "\n";
+    RelayThroughTile relayer(kernel, tile_loop, finder.provide, tile, address(write_args), relay,
+                             (int)(slots * size));
+    return relayer.mutate(s);
+}
+
+} // namespace
+
+Stmt relay_streams(Stmt s, const map<string, Function> &env) {
+    for (auto &e : env) {
+        if (e.second.relay()) {
+            s = relay_through_tile(s, e.first);
+        }
+    }
+    return s;
+}
+
+}
+}
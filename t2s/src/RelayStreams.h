@@ -0,0 +1,66 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_RELAY_STREAMS_H
+#define T2S_RELAY_STREAMS_H
+
+/** \file
+ *
+ * Defines a pass to relay the output of a device function to its consumer through an on-chip buffer (See Func::relay).
+ */
+
+#include "../../Halide/src/Function.h"
+#include "../../Halide/src/IR.h"
+#include <map>
+
+namespace Halide {
+namespace Internal {
+
+/* For every device function P whose output is relayed, the kernel of P stores its output into an on-chip buffer instead
+ * of providing it to the consumer C, and sends it in the order C reads it, by replaying the loops, lets and conditions
+ * of C around the read. The output is sent in tiles: the tile loops are the outermost loops of P that iterate as the
+ * outermost loops of C, such that every iteration of them produces exactly the tile that C reads in the same
+ * iteration. With tile loops p and c:
+ *     kernel P                                 kernel C
+ *       for (p, ...)                             for (c, ...)
+ *         for (pp, ...)                            for (cc, ...)
+ *           P(args_p) = value                        if (cond(c, cc))
+ *                                                      ... P(args_c) ...
+ * becomes
+ *     kernel P                                 kernel C (unchanged)
+ *       allocate P.tile[2 * size of a tile]      for (c, ...)
+ *       for (p, ...)                               for (cc, ...)
+ *         for (pp, ...)                              if (cond(c, cc))
+ *           P.tile[addr(args_p)] = value               ... P(args_c) ...
+ *         for (P.relay.cc, ...)
+ *           if (cond(p, P.relay.cc))
+ *             P(args_c(p, P.relay.cc)) = P.tile[addr(args_c(p, P.relay.cc))]
+ * The tiles alternate between the two halves of the buffer, so that C can start as soon as the first tile is
+ * produced, and a tile can be produced while the previous one is sent. Without tile loops, the tile is the whole
+ * output, sent at the end of the kernel of P. The bounds of a tile must be constant, and the buffer must fit in half
+ * of the RAM blocks of the board (See budget_of_board()). The replayed loops are named after P, with the same
+ * suffixes as the loops of C, so that the channel between P and C, created afterwards, is indexed consistently by the
+ * unrolled loops of both sides.
+ * This pass must be run after placing device functions and before replacing references with channels.
+ */
+extern Stmt relay_streams(Stmt s, const std::map<std::string, Function> &env);
+
+}
+}
+
+#endif
@@ -0,0 +1,376 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "../../Halide/src/Debug.h"
+#include "../../Halide/src/Error.h"
+#include "../../Halide/src/IROperator.h"
+#include "../../Halide/src/IRPrinter.h"
+#include "../../Halide/src/IRVisitor.h"
+#include "../../Halide/src/Simplify.h"
+#include "../../Halide/src/Util.h"
+#include "./ResourceEstimate.h"
+#include "./SystolicDSE.h"
+#include "./Utilities.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// A memory of a kernel, or a channel between kernels.
+struct Memory {
+    string  name;
+    string  kind;           // channel, shreg or buffer
+    int64_t words;          // Of every copy
+    int64_t word_bits;
+    int64_t copies;         // For every PE, or every channel of a channel array
+
+    int64_t m20ks() const {
+        return copies * m20ks_of_memory(words, word_bits);
+    }
+    int64_t bits() const {
+        return copies * words * word_bits;
+    }
+};
+
+struct Kernel {
+    double  dsps = 0;
+    int64_t PEs = 1;
+    int64_t cycles = -1;    // Unknown if negative
+};
+
+bool is_replicated(ForType t) {
+    return t == ForType::Unrolled || t == ForType::PragmaUnrolled || t == ForType::DelayUnroll ||
+           t == ForType::Vectorized;
+}
+
+int64_t constant_extent(const Expr &e) {
+    const int64_t *extent = as_const_int(simplify(e));
+    return extent ? *extent : -1;
+}
+
+// The cycles of a pipelined kernel with II=1: a serial loop iterates its body, and sequential statements add up.
+int64_t cycles_of(const Stmt &s) {
+    if (const For *op = s.as<For>()) {
+        int64_t body = cycles_of(op->body);
+        if (is_replicated(op->for_type)) {
+            return body;
+        }
+        int64_t extent = constant_extent(op->extent);
+        return (body < 0 || extent < 0) ? -1 : body * extent;
+    } else if (const Block *op = s.as<Block>()) {
+        int64_t first = cycles_of(op->first), rest = cycles_of(op->rest);
+        return (first < 0 || rest < 0) ? -1 : first + rest;
+    } else if (const IfThenElse *op = s.as<IfThenElse>()) {
+        return std::max(cycles_of(op->then_case), op->else_case.defined() ? cycles_of(op->else_case) : 0);
+    } else if (const LetStmt *op = s.as<LetStmt>()) {
+        return cycles_of(op->body);
+    } else if (const Realize *op = s.as<Realize>()) {
+        return cycles_of(op->body);
+    } else if (const ProducerConsumer *op = s.as<ProducerConsumer>()) {
+        return cycles_of(op->body);
+    } else if (const Allocate *op = s.as<Allocate>()) {
+        return cycles_of(op->body);
+    }
+    return 1;
+}
+
+// The bits an integer operand really has, e.g. 8 for an int8 extended to int32.
+int effective_bits(const Expr &e) {
+    const Cast *c = e.as<Cast>();
+    if (c && c->value.type().is_int_or_uint() && c->value.type().bits() < e.type().bits()) {
+        return effective_bits(c->value);
+    }
+    return e.type().bits();
+}
+
+// The DSPs of an operation. An integer DSP is two 18x19 multipliers, or one 27x27 multiplier, so that two multiplies
+// of up to 18 bits are packed into one DSP.
+double dsps_of(const string &op, Type t, int bits) {
+    if (t.is_float()) {
+        return t.bits() > 32 ? 4 : 1;
+    }
+    if (op != "mul") {
+        return 0;
+    }
+    return bits <= 18 ? 0.5 : bits <= 27 ? 1 : bits <= 36 ? 2 : 4;
+}
+
+class EstimateResources : public IRVisitor {
+    using IRVisitor::visit;
+
+    struct Loop {
+        string  name;
+        int64_t extent;     // -1 if not constant
+        ForType for_type;
+    };
+
+    const map<string, Function> &env;
+    vector<Loop>                 loops;     // The loops enclosing the current IR in the current kernel
+    string                       kernel;    // The function of the current kernel, or empty if not in a kernel
+
+    // The PEs replicating the current IR: the unrolled loops around it.
+    int64_t replication() const {
+        int64_t r = 1;
+        for (const auto &l : loops) {
+            if (is_replicated(l.for_type) && l.extent > 0) {
+                r *= l.extent;
+            }
+        }
+        return r;
+    }
+
+    void record(const string &op, Type t, int bits = 0) {
+        if (kernel.empty()) {
+            return;
+        }
+        int64_t r = replication() * t.lanes();
+        std::ostringstream name;
+        name << t.element_of() << " " << op;
+        ops[name.str()] += r;
+        kernels[kernel].dsps += dsps_of(op, t, bits > 0 ? bits : t.bits()) * r;
+        kernels[kernel].PEs = std::max(kernels[kernel].PEs, replication());
+    }
+
+    // A multiply by a constant is shifts and adds in logic.
+    bool is_dsp_mul(const Expr &e) const {
+        const Mul *op = e.as<Mul>();
+        return op && !is_const(op->a) && !is_const(op->b);
+    }
+
+    void visit_add_or_sub(const string &op, Type t, const Expr &a, const Expr &b) {
+        if (t.is_float() && (is_dsp_mul(a) || is_dsp_mul(b))) {
+            // Fused into a multiply-add
+            const Mul *m = is_dsp_mul(a) ? a.as<Mul>() : b.as<Mul>();
+            record("fma", t);
+            m->a.accept(this);
+            m->b.accept(this);
+            (is_dsp_mul(a) ? b : a).accept(this);
+            return;
+        }
+        record(op, t);
+        a.accept(this);
+        b.accept(this);
+    }
+
+    // The dimensions of a memory replicated by the PEs are its last ones with the extents of the unrolled loops of the
+    // function.
+    void record_memory(const string &name, const string &kind, const vector<Type> &types, const Region &bounds) {
+        int64_t word_bits = 0;
+        for (const auto &t : types) {
+            word_bits += t.bits() * t.lanes();
+        }
+        vector<int64_t> extents;
+        for (const auto &b : bounds) {
+            int64_t e = constant_extent(b.extent);
+            if (e < 0) {
+                debug(2) << "Resource estimate: " << name << " has non-constant bounds, and is not counted\n";
+                return;
+            }
+            extents.push_back(e);
+        }
+        int64_t words = 1, copies = 1;
+        if (kind == "channel") {
+            // The depth is the last bound, and the others index the channel array.
+            words = extents.empty() ? 1 : extents.back();
+            for (size_t i = 0; i + 1 < extents.size(); i++) {
+                copies *= extents[i];
+            }
+        } else {
+            vector<int64_t> unrolled;
+            for (const auto &l : unrolled_loops[extract_first_token(name)]) {
+                unrolled.push_back(l.second);
+            }
+            bool peeling = true;
+            for (auto e = extents.rbegin(); e != extents.rend(); ++e) {
+                auto u = std::find(unrolled.begin(), unrolled.end(), *e);
+                if (peeling && u != unrolled.end()) {
+                    copies *= *e;
+                    unrolled.erase(u);
+                } else {
+                    peeling = peeling && *e == 1;
+                    words *= *e;
+                }
+            }
+        }
+        memories.push_back(Memory{name, kind, words, word_bits, copies});
+    }
+
+    map<string, map<string, int64_t>> unrolled_loops; // Function -> its unrolled loops and their extents
+
+public:
+    EstimateResources(const map<string, Function> &env) : env(env) {}
+
+    map<string, int64_t> ops;       // "float32 mul" etc. -> the number of such operations after replication
+    map<string, Kernel>  kernels;
+    vector<Memory>       memories;
+
+    void visit(const For *op) override {
+        string func = extract_first_token(op->name);
+        bool entering = false;
+        if (kernel.empty()) {
+            Function f;
+            if (!function_is_in_environment(func, env, f) || f.place() != Place::Device) {
+                IRVisitor::visit(op);
+                return;
+            }
+            entering = true;
+            kernel = func;
+            kernels[kernel].cycles = cycles_of(op);
+        }
+        int64_t extent = constant_extent(op->extent);
+        if (is_replicated(op->for_type) && op->for_type != ForType::Vectorized && extent > 1) {
+            unrolled_loops[func][op->name] = extent;
+        }
+        loops.push_back(Loop{op->name, extent, op->for_type});
+        op->body.accept(this);
+        loops.pop_back();
+        if (entering) {
+            kernel.clear();
+        }
+    }
+
+    // A memory is recorded after its body, where the unrolled loops of its function are found.
+    void visit(const Realize *op) override {
+        IRVisitor::visit(op);
+        string name = ends_with(op->name, ".array") ? remove_postfix(op->name, ".array") : op->name;
+        Function f;
+        if (ends_with(name, ".channel")) {
+            record_memory(op->name, "channel", op->types, op->bounds);
+        } else if (!kernel.empty() || (function_is_in_environment(extract_first_token(op->name), env, f) &&
+                                       f.place() == Place::Device)) {
+            record_memory(op->name, ends_with(op->name, ".shreg") ? "shreg" : "buffer", op->types, op->bounds);
+        }
+    }
+
+    void visit(const Mul *op) override {
+        if (is_dsp_mul(op)) {
+            record("mul", op->type, std::max(effective_bits(op->a), effective_bits(op->b)));
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Add *op) override {
+        visit_add_or_sub("add", op->type, op->a, op->b);
+    }
+
+    void visit(const Sub *op) override {
+        visit_add_or_sub("sub", op->type, op->a, op->b);
+    }
+};
+
+string estimate_file() {
+    char *aocx_name = getenv("BITSTREAM");
+    string bitstream_file = (aocx_name != NULL) ? string(aocx_name) : (string(getenv("HOME")) + "/tmp/a.aocx");
+    if (ends_with(bitstream_file, ".aocx")) {
+        bitstream_file = remove_postfix(bitstream_file, ".aocx");
+    }
+    return bitstream_file + ".estimate.txt";
+}
+
+} // namespace
+
+// Stratix 10 if the board name says so, and Arria 10 otherwise.
+FPGABudget budget_of_board() {
+    for (const char *var : {"FPGA_BOARD", "AOC_OPTION"}) {
+        char *value = getenv(var);
+        if (value != NULL && string(value).find("s10") != string::npos) {
+            return FPGABudget::stratix10();
+        }
+    }
+    return FPGABudget::arria10();
+}
+
+void estimate_resources(const Stmt &s, const map<string, Function> &env) {
+    char *setting = getenv("HL_RESOURCE_ESTIMATE");
+    if (setting != NULL && string(setting) == "off") {
+        return;
+    }
+    EstimateResources estimator(env);
+    s.accept(&estimator);
+    if (estimator.kernels.empty()) {
+        return;
+    }
+
+    double dsps = 0;
+    int64_t m20ks = 0, ram_bits = 0, register_bits = 0, cycles = 0;
+    for (const auto &k : estimator.kernels) {
+        dsps += k.second.dsps;
+        cycles = (cycles < 0 || k.second.cycles < 0) ? -1 : std::max(cycles, k.second.cycles);
+    }
+    for (const auto &m : estimator.memories) {
+        m20ks += m.m20ks();
+        (m.m20ks() > 0 ? ram_bits : register_bits) += m.bits();
+    }
+    FPGABudget budget = budget_of_board();
+    int total_dsps = (int)std::ceil(dsps);
+    double fmax = estimate_fmax(budget, total_dsps, (int)m20ks);
+
+    string file = estimate_file();
+    std::ofstream fp(file, std::ios::out);
+    if (!fp) {
+        user_warning << "Failed to open " << file << " for writing the resource estimate\n";
+        return;
+    }
+    fp << "Estimated from the lowered device IR, without synthesis, for " << budget.name << "\n";
+    fp << "DSP blocks: " << total_dsps << " / " << budget.dsps << "\n";
+    fp << "RAM blocks: " << m20ks << " / " << budget.m20ks << "\n";
+    fp << "RAM bits: " << ram_bits << "\n";
+    fp << "Register bits: " << register_bits << "\n";
+    fp << "Kernel fmax: " << std::fixed << std::setprecision(2) << fmax << "\n";
+    if (cycles >= 0) {
+        fp << "Cycles: " << cycles << "\n";
+        fp << "Execution time (ns): " << cycles * 1e3 / fmax << "\n";
+    } else {
+        fp << "Cycles: unknown\n";
+    }
+
+    fp << "\nOperations (after unrolling and vectorization)\n";
+    for (const auto &o : estimator.ops) {
+        fp << "  " << std::left << std::setw(24) << o.first << o.second << "\n";
+    }
+    fp << "\nKernels\n";
+    fp << "  " << std::left << std::setw(32) << "kernel" << std::setw(8) << "PEs" << std::setw(10) << "DSPs"
+       << "cycles\n";
+    for (const auto &k : estimator.kernels) {
+        fp << "  " << std::left << std::setw(32) << k.first << std::setw(8) << k.second.PEs << std::setw(10)
+           << std::setprecision(1) << k.second.dsps
+           << (k.second.cycles >= 0 ? std::to_string(k.second.cycles) : string("unknown")) << "\n";
+    }
+    fp << "\nMemories\n";
+    fp << "  " << std::left << std::setw(32) << "memory" << std::setw(10) << "kind" << std::setw(8) << "copies"
+       << std::setw(10) << "words" << std::setw(10) << "bits" << "M20Ks\n";
+    for (const auto &m : estimator.memories) {
+        fp << "  " << std::left << std::setw(32) << m.name << std::setw(10) << m.kind << std::setw(8) << m.copies
+           << std::setw(10) << m.words << std::setw(10) << m.word_bits << m.m20ks() << "\n";
+    }
+    debug(1) << "Resource estimate in " << file << ": " << total_dsps << " DSPs, " << m20ks << " M20Ks, "
+             << fmax << " MHz\n";
+}
+
+}
+}
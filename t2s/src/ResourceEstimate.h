@@ -0,0 +1,63 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_RESOURCE_ESTIMATE_H
+#define T2S_RESOURCE_ESTIMATE_H
+
+/** \file
+ *
+ * Defines an analysis of the lowered device IR that estimates the resources, fmax and execution time of an FPGA design
+ * without synthesis.
+ *
+ */
+
+#include "../../Halide/src/Function.h"
+#include "../../Halide/src/IR.h"
+#include "./SystolicDSE.h"
+#include <map>
+
+namespace Halide {
+namespace Internal {
+
+/* Estimate the resources of the device kernels from the IR before codegen, in seconds instead of hours of synthesis:
+ *  1. DSPs: every multiply, add and subtract in a kernel, by type, replicated by the unrolled and vectorized loops
+ *     around it. A floating-point multiply-add maps to one hardened DSP. An integer multiply takes half a DSP if its
+ *     operands have up to 18 bits (e.g. int8 extended to int32), and more DSPs for wider operands. An integer add, or
+ *     a multiply by a constant, is in logic.
+ *  2. Memory: the bits of every channel, shift register and buffer of the kernels. A memory is replicated for every PE
+ *     along the unrolled dimensions; every copy of more than a few words is in M20Ks, and in registers otherwise.
+ *  3. Performance: every kernel is assumed to be pipelined with II=1. Its cycles are the trip counts of its serial
+ *     loops, and the design takes the cycles of the slowest kernel. The fmax is degraded from the nominal fmax of the
+ *     board as the device gets full, by the same model as the systolic design-space exploration.
+ * The estimates are written into the report file next to the bitstream, e.g. gemm.estimate.txt for gemm.aocx, with
+ * lines in the style of acl_quartus_report.txt. The roofline utilities DSPs_estimated(), FMax_estimated() and
+ * ExecTime_estimated() read them.
+ * The board is Stratix 10 if environment variable FPGA_BOARD or AOC_OPTION mentions s10, and Arria 10 otherwise.
+ * Environment variable HL_RESOURCE_ESTIMATE: set to "off" to disable the estimation.
+ */
+extern void estimate_resources(const Stmt &s, const std::map<std::string, Function> &env);
+
+/* The budget of the board: Stratix 10 if environment variable FPGA_BOARD or AOC_OPTION mentions s10, and Arria 10
+ * otherwise.
+ */
+extern FPGABudget budget_of_board();
+
+}
+}
+
+#endif
@@ -128,6 +128,54 @@ double ExecTime() {
     return _ret;
 }
 
+// Read the value of the given key from the resource estimate next to the bitstream. The bitstream itself may not
+// exist yet, as the estimate is written before synthesis.
+static double estimated_value(const char *key) {
+    char *env = getenv("BITSTREAM");
+    char *bitstream = (env != NULL) ? concat_simple(env, "") : concat_simple(getenv("HOME"), "/tmp/a.aocx");
+    if (strlen(bitstream) > 5 && strcmp(bitstream + strlen(bitstream) - 5, ".aocx") == 0) {
+        bitstream[strlen(bitstream) - 5] = '\0';
+    }
+    char *estimate_file = concat_simple(bitstream, ".estimate.txt");
+
+    FILE* fp;
+    double _ret = -1;
+
+    char str[STR_SIZE];
+    if ((fp = fopen(estimate_file, "r")) == NULL) {
+        printf("cannot open resource estimate: %s! \n", estimate_file);
+        free(bitstream);
+        free(estimate_file);
+        return -1;
+    }
+    while (fgets(str, STR_SIZE, fp)) {
+        char* pos = strchr(str, ':');
+        if (pos == NULL || (size_t)(pos - str) != strlen(key) || strncmp(str, key, strlen(key)) != 0)
+            continue;
+        if (sscanf(pos + 1, "%lf", &_ret) != 1) {
+            _ret = -1;
+        }
+        break;
+    }
+    fclose(fp);
+    free(bitstream);
+    free(estimate_file);
+    return _ret;
+}
+
+int DSPs_estimated() {
+    return (int)estimated_value("DSP blocks");
+}
+
+double FMax_estimated() {
+    return estimated_value("Kernel fmax");
+}
+
+// Execution time in terms of nanoseconds
+double ExecTime_estimated() {
+    return estimated_value("Execution time (ns)");
+}
+
 void roofline(double mem_bandwidth, double compute_roof, double number_ops, double number_bytes, double exec_time) {
     char command[1000];
     if (exec_time == 0 || compute_roof == 0) {
@@ -26,6 +26,12 @@ double FMax();
 double ExecTime();
 void roofline(double mem_bandwidth, double compute_roof, double number_ops, double number_bytes, double exec_time);
 
+// Predicted numbers from the resource estimate of the compiler (e.g. gemm.estimate.txt for gemm.aocx), which is
+// available right after compilation, without synthesis. Return -1 if there is no such estimate.
+int DSPs_estimated();
+double FMax_estimated();
+double ExecTime_estimated();
+
 // Used for FPGA report generated through DPC++ OneAPI
 int DSPs_oneapi();
 double FMax_oneapi();
@@ -20,6 +20,7 @@
 #include <algorithm>
 
 #include "../../Halide/src/CSE.h"
+#include "../../Halide/src/ExprUsesVar.h"
 #include "../../Halide/src/Func.h"
 #include "../../Halide/src/Function.h"
 #include "../../Halide/src/IR.h"
@@ -343,6 +344,8 @@ class SpaceTimeTransformer : public IRMutator {
     std::map<std::string, bool> used_vars;
     // Check whether in isolated kernels
     bool in_input_or_output{true};
+    // Are the bounds of a source loop dependent on another source loop, e.g. set_bounds(j, k, SIZE - k)?
+    bool triangular{false};
 
     // Helper functions
     bool recalculate_func_referrence_args(std::string func_name, vector<Expr>& args) {
@@ -405,6 +408,55 @@ class SpaceTimeTransformer : public IRMutator {
         return is_zero(time_expr);
     }
 
+    bool is_triangular() const {
+        for (int j : src_var_pos) {
+            if (j < 0) continue;
+            for (int k : src_var_pos) {
+                if (k < 0 || k == j) continue;
+                const string &var = loop_vars[k].as<Variable>()->name;
+                if (expr_uses_var(loop_mins[j], var) || expr_uses_var(loop_extents[j], var)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // The exact range of sum(coeffs[i] * src_var[i]) over a triangular or trapezoidal domain, whose loop bounds are
+    // affine in their enclosing loops. The source loops are eliminated from the innermost one: the extreme of an affine
+    // function over a loop is at one end of the loop, and is again affine in the enclosing loops. Unlike the range over
+    // the bounding box, it contains no time step (or PE) without any iteration. Return false if a bound is not affine.
+    bool linear_range(const vector<int> &coeffs, Expr &min, Expr &extent) const {
+        vector<size_t> order;
+        Expr lo = 0, hi = 0;
+        for (size_t i = 0; i < coeffs.size(); i++) {
+            if (coeffs[i] != 0) {
+                internal_assert(src_var_pos[i] >= 0);
+                lo += coeffs[i] * loop_vars[src_var_pos[i]];
+                hi += coeffs[i] * loop_vars[src_var_pos[i]];
+            }
+            order.push_back(i);
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return src_var_pos[a] < src_var_pos[b]; });
+        for (size_t i : order) {
+            int j = src_var_pos[i];
+            if (j < 0) continue;
+            const string &var = loop_vars[j].as<Variable>()->name;
+            Expr first = loop_mins[j];
+            Expr last = simplify(loop_mins[j] + loop_extents[j] - 1);
+            const int64_t *c_hi = as_const_int(simplify(substitute(var, 1, hi) - substitute(var, 0, hi)));
+            const int64_t *c_lo = as_const_int(simplify(substitute(var, 1, lo) - substitute(var, 0, lo)));
+            if (!c_hi || !c_lo) {
+                return false;
+            }
+            hi = simplify(substitute(var, *c_hi >= 0 ? last : first, hi));
+            lo = simplify(substitute(var, *c_lo >= 0 ? first : last, lo));
+        }
+        min = lo;
+        extent = simplify(hi - lo + 1);
+        return true;
+    }
+
     // Helper Classes
     class LoopInfoCollector : public IRVisitor {
       public:
@@ -587,6 +639,7 @@ class SpaceTimeTransformer : public IRMutator {
                     }
                 }
             }
+            triangular = in_scheduled_stt && is_triangular();
             used_vars.clear();
         }
         return IRMutator::visit(op);
@@ -682,6 +735,9 @@ class SpaceTimeTransformer : public IRMutator {
             }
             min = simplify(min);
             extent = simplify(extent + 1);
+            if (triangular) {
+                linear_range(param.proj_matrix[k], min, extent);
+            }
             new_loop_mins[k] = min;
             new_loop_extents[k] = extent;
             debug(3) << "loop: " << name << "("
@@ -727,6 +783,11 @@ class SpaceTimeTransformer : public IRMutator {
         }
         min = simplify(min);
         extent = simplify(extent + 1);
+        if (triangular) {
+            // Skip the empty wavefronts of the bounding box
+            vector<int> coeffs(param.sch_vector.begin(), param.sch_vector.begin() + num_space_vars + 1);
+            linear_range(coeffs, min, extent);
+        }
         new_loop_mins[num_new_space_vars] = min;
         new_loop_extents[num_new_space_vars] = extent;
         debug(3) << "loop: " << loop_name << "("
@@ -867,7 +928,8 @@ class SpaceTimeTransformer : public IRMutator {
     Stmt process_space_loop(const For *op, Stmt body) {
         // modify the innermost loop body
         SpaceTimeTransformParams &param = param_vector[0];
-        if (param.check_time == SpaceTimeTransform::CheckTime) {
+        // In a triangular domain, the new loops still cover some points out of the domain
+        if (param.check_time == SpaceTimeTransform::CheckTime || triangular) {
             for (size_t k = 0; k <= num_space_vars; k++) {
                 Expr condition = (loop_vars[k] >= loop_mins[k])
                                 && (loop_vars[k] < loop_mins[k] + loop_extents[k]);
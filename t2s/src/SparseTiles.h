@@ -0,0 +1,82 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_SPARSE_TILES_H
+#define T2S_SPARSE_TILES_H
+
+/** \file
+ *
+ * Defines a host utility to index the non-empty tiles of a block-sparse matrix (See Func::sparse).
+ */
+
+#include "../../Halide/src/Buffer.h"
+#include <algorithm>
+#include <vector>
+
+namespace Halide {
+
+/* Index the non-empty tiles of a block-sparse 2-D matrix, tiled by tile_x x tile_y elements, for a reduction along
+ * dim 0 that skips the empty tiles:
+ *     index(s, y) = x of the s-th non-empty tile in row y of tiles, for s < the non-empty tiles of row y, or
+ *                   x of an empty tile in row y of tiles, otherwise.
+ * The extent of dim 0 of the index, i.e. the slots of every row, is the most non-empty tiles of a row, and at least 1.
+ * A row with fewer non-empty tiles is padded with an empty tile, which adds nothing to the reduction, so that every
+ * row takes the same slots, as a systolic array expects. The extents of the matrix must be multiples of the tile.
+ */
+template<typename T>
+Buffer<int> nonzero_tiles(const Buffer<T> &m, int tile_x, int tile_y) {
+    user_assert(m.dimensions() == 2) << "Only the tiles of a 2-D matrix can be indexed\n";
+    user_assert(tile_x > 0 && tile_y > 0 && m.dim(0).extent() % tile_x == 0 && m.dim(1).extent() % tile_y == 0)
+        << "The extents of the matrix, " << m.dim(0).extent() << " x " << m.dim(1).extent()
+        << ", are not multiples of the tile, " << tile_x << " x " << tile_y << "\n";
+    int tiles_x = m.dim(0).extent() / tile_x;
+    int tiles_y = m.dim(1).extent() / tile_y;
+    std::vector<std::vector<int>> nonzero(tiles_y);
+    std::vector<int> zero(tiles_y, -1);
+    for (int ty = 0; ty < tiles_y; ty++) {
+        for (int tx = 0; tx < tiles_x; tx++) {
+            bool empty = true;
+            for (int y = ty * tile_y; empty && y < (ty + 1) * tile_y; y++) {
+                for (int x = tx * tile_x; empty && x < (tx + 1) * tile_x; x++) {
+                    empty = m(x + m.dim(0).min(), y + m.dim(1).min()) == T(0);
+                }
+            }
+            if (empty) {
+                zero[ty] = tx;
+            } else {
+                nonzero[ty].push_back(tx);
+            }
+        }
+    }
+    int slots = 1;
+    for (auto &row : nonzero) {
+        slots = std::max(slots, (int)row.size());
+    }
+    Buffer<int> index(slots, tiles_y);
+    for (int ty = 0; ty < tiles_y; ty++) {
+        for (int s = 0; s < slots; s++) {
+            // A row with fewer non-empty tiles than the slots has an empty tile to pad with
+            index(s, ty) = s < (int)nonzero[ty].size() ? nonzero[ty][s] : zero[ty];
+        }
+    }
+    return index;
+}
+
+}
+
+#endif
@@ -0,0 +1,402 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "../../Halide/src/IRMutator.h"
+#include "../../Halide/src/IROperator.h"
+#include "../../Halide/src/Scope.h"
+#include "../../Halide/src/Simplify.h"
+#include "./DebugPrint.h"
+#include "./SpatialOnCPU.h"
+#include "./Utilities.h"
+#include <set>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The name of the channel array accessed by a read/write_channel, without any suffix after ".channel"
+string channel_array_name(const string &name) {
+    size_t pos = name.rfind(".channel");
+    internal_assert(pos != string::npos) << "Not a channel: " << name << "\n";
+    return name.substr(0, pos + string(".channel").size());
+}
+
+// Flatten the indices of an array in the row-major order, i.e. the last index is the innermost, like in C
+Expr flatten_indices(const vector<Expr> &indices, const vector<Expr> &mins, const vector<Expr> &extents) {
+    internal_assert(indices.size() == mins.size() && indices.size() == extents.size());
+    Expr flat = 0;
+    for (size_t i = 0; i < indices.size(); i++) {
+        flat = flat * extents[i] + (indices[i] - mins[i]);
+    }
+    return flat;
+}
+
+Expr user_context() {
+    return Variable::make(Handle(), "__user_context");
+}
+
+/* Device kernels */
+
+struct Kernel {
+    string       name;     // Name of the run_on_device loop
+    Stmt         body;
+    vector<Stmt> wrappers; // LetStmts and channel Realizes enclosing the kernel, outermost first
+    vector<string> loops;  // Host loops enclosing the kernel
+};
+
+string wrapper_name(const Stmt &wrapper) {
+    if (const LetStmt *l = wrapper.as<LetStmt>()) {
+        return l->name;
+    }
+    const Realize *r = wrapper.as<Realize>();
+    internal_assert(r);
+    return r->name;
+}
+
+Stmt rewrap(const Stmt &wrapper, const Stmt &body) {
+    if (const LetStmt *l = wrapper.as<LetStmt>()) {
+        return LetStmt::make(l->name, l->value, body);
+    }
+    const Realize *r = wrapper.as<Realize>();
+    internal_assert(r);
+    return Realize::make(r->name, r->types, r->memory_type, r->bounds, r->condition, body);
+}
+
+class CollectKernels : public IRVisitor {
+    using IRVisitor::visit;
+    vector<Stmt>   wrappers;
+    vector<string> loops;
+
+public:
+    vector<Kernel> kernels;
+
+private:
+    void visit(const For *op) override {
+        if (ends_with(op->name, ".run_on_device")) {
+            kernels.push_back(Kernel{op->name, op->body, wrappers, loops});
+            return;
+        }
+        loops.push_back(op->name);
+        IRVisitor::visit(op);
+        loops.pop_back();
+    }
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        wrappers.push_back(op);
+        op->body.accept(this);
+        wrappers.pop_back();
+    }
+
+    void visit(const Realize *op) override {
+        if (!ends_with(op->name, ".channel")) {
+            IRVisitor::visit(op);
+            return;
+        }
+        wrappers.push_back(op);
+        op->body.accept(this);
+        wrappers.pop_back();
+    }
+};
+
+// On an FPGA, the host enqueues all the kernels without waiting for any of them, and the kernels run
+// concurrently, talking through channels. Do the same on the CPU: remove the kernels from their places,
+// and launch them all at the place of the last kernel, one parallel task per kernel.
+class DispatchKernels : public IRMutator {
+    using IRMutator::visit;
+    const vector<Kernel> &kernels;
+    size_t                num_seen;
+
+public:
+    DispatchKernels(const vector<Kernel> &kernels) : kernels(kernels), num_seen(0) {}
+
+private:
+    Stmt make_dispatch() {
+        const Kernel &last = kernels.back();
+        set<string> in_scope;
+        for (const auto &w : last.wrappers) {
+            in_scope.insert(wrapper_name(w));
+        }
+
+        // Lets and channels that enclose some kernels but not the last one must enclose the dispatch instead.
+        vector<Stmt> missing;
+        set<string> added;
+        for (const auto &k : kernels) {
+            user_assert(k.loops == last.loops) << "Running on CPU: device kernels " << extract_first_token(k.name)
+                << " and " << extract_first_token(last.name) << " are expected to be enclosed by the same host loops, but are enclosed by "
+                << to_string<string>(k.loops, true) << " and " << to_string<string>(last.loops, true) << " instead.\n";
+            for (const auto &w : k.wrappers) {
+                string name = wrapper_name(w);
+                if (in_scope.find(name) == in_scope.end() && added.find(name) == added.end()) {
+                    missing.push_back(w);
+                    added.insert(name);
+                }
+            }
+        }
+
+        Stmt dispatch;
+        if (kernels.size() == 1) {
+            dispatch = LetStmt::make(last.name, 0, last.body);
+        } else {
+            string id_name = "t2s.kernel.id";
+            Expr id = Variable::make(Int(32), id_name);
+            Stmt chain = LetStmt::make(last.name, 0, last.body);
+            for (int i = (int)kernels.size() - 2; i >= 0; i--) {
+                chain = IfThenElse::make(id == i, LetStmt::make(kernels[i].name, 0, kernels[i].body), chain);
+            }
+            // All the kernels run at the same time, each on a thread of the pool, which has at most 256 threads
+            // (MAX_THREADS in runtime/thread_pool_common.h).
+            user_assert(kernels.size() <= 256) << "Running on CPU: the design has " << kernels.size()
+                << " kernels, but at most 256 kernels can run at the same time.\n";
+            Expr num_kernels = (int)kernels.size();
+            string reserved_name = "t2s.reserve_threads_result";
+            Expr reserved = Variable::make(Int(32), reserved_name);
+            Stmt reserve = LetStmt::make(reserved_name,
+                                         Call::make(Int(32), "halide_t2s_reserve_threads",
+                                                    {user_context(), num_kernels}, Call::Extern),
+                                         AssertStmt::make(reserved == 0, reserved));
+            Stmt loop = For::make(id_name, 0, num_kernels, ForType::Parallel, DeviceAPI::Host, chain);
+            dispatch = Block::make(reserve, loop);
+        }
+        for (auto w = missing.rbegin(); w != missing.rend(); ++w) {
+            dispatch = rewrap(*w, dispatch);
+        }
+        debug(4) << "Dispatch of device kernels on CPU:\n" << dispatch << "\n";
+        return dispatch;
+    }
+
+    Stmt visit(const For *op) override {
+        if (!ends_with(op->name, ".run_on_device")) {
+            return IRMutator::visit(op);
+        }
+        num_seen++;
+        if (num_seen < kernels.size()) {
+            return Evaluate::make(0);
+        }
+        return make_dispatch();
+    }
+};
+
+/* Channels, shift registers and other on-chip storage */
+
+struct Storage {
+    Type         type;    // Type of an element of the storage
+    vector<Expr> mins;    // Mins and extents of the array. For a channel array, excluding the depth
+    vector<Expr> extents;
+    Expr         depth;   // For a channel array only: the depth of every channel
+};
+
+class LowerStorage : public IRMutator {
+    using IRMutator::visit;
+    Scope<Storage> channels;
+    Scope<Storage> arrays;
+
+    Expr element_index(const string &name, const Expr &flat, const Type &storage_type, const Type &access_type) {
+        if (storage_type.is_scalar()) {
+            user_assert(access_type.is_scalar() || flat.type().is_vector()) << "Running on CPU: " << name
+                << " is accessed as a " << access_type << " vector, while its elements are scalars.\n";
+            return flat;
+        }
+        user_assert(access_type.lanes() == storage_type.lanes() && flat.type().is_scalar()) << "Running on CPU: "
+            << name << " is accessed as a " << access_type << ", while its elements are " << storage_type << ".\n";
+        return Ramp::make(flat * storage_type.lanes(), 1, storage_type.lanes());
+    }
+
+    Expr load(const Type &t, const string &name, const Expr &index) {
+        return Load::make(t, name, index, Buffer<>(), Parameter(), const_true(t.lanes()), ModulusRemainder());
+    }
+
+    Stmt store(const string &name, const Expr &value, const Expr &index) {
+        return Store::make(name, value, index, Parameter(), const_true(value.type().lanes()), ModulusRemainder());
+    }
+
+    // The index of the first element of the slot of a channel's FIFO, given the slot returned by the runtime.
+    Expr channel_slot_index(const string &name, const vector<Expr> &indices, const Expr &slot, const Type &access_type) {
+        internal_assert(channels.contains(name)) << "Channel " << name << " is accessed outside of its realization\n";
+        const Storage &st = channels.get(name);
+        user_assert(indices.size() == st.extents.size()) << "Running on CPU: channel " << name << " is accessed with "
+            << indices.size() << " indices, while it has " << st.extents.size() << " dimensions.\n";
+        Expr fifo = flatten_indices(indices, st.mins, st.extents);
+        return element_index(name, fifo * (st.depth + 1) + slot, st.type, access_type);
+    }
+
+    Expr fifo_index(const string &name, const vector<Expr> &indices) {
+        const Storage &st = channels.get(name);
+        return flatten_indices(indices, st.mins, st.extents);
+    }
+
+    Expr array_index(const string &name, const vector<Expr> &indices, const Type &access_type) {
+        internal_assert(arrays.contains(name)) << name << " is accessed outside of its realization\n";
+        const Storage &st = arrays.get(name);
+        user_assert(indices.size() == st.extents.size()) << "Running on CPU: " << name << " is accessed with "
+            << indices.size() << " indices, while it has " << st.extents.size() << " dimensions.\n";
+        return element_index(name, flatten_indices(indices, st.mins, st.extents), st.type, access_type);
+    }
+
+    Stmt visit(const Realize *op) override {
+        user_assert(op->types.size() == 1) << "Running on CPU: " << op->name << " is expected to have a single type.\n";
+        bool is_channel = ends_with(op->name, ".channel");
+        Region bounds = op->bounds;
+        Storage st;
+        st.type = op->types[0];
+        if (is_channel) {
+            // The last dimension of a channel array is the min depth, which is 0 if unspecified. A FIFO needs at least
+            // one slot besides the one held by the reader.
+            internal_assert(!bounds.empty());
+            st.depth = simplify(max(bounds.back().extent, 1));
+            bounds.pop_back();
+        }
+        Expr num_elements = 1;
+        for (const auto &b : bounds) {
+            st.mins.push_back(b.min);
+            st.extents.push_back(b.extent);
+            num_elements = num_elements * b.extent;
+        }
+
+        Stmt body;
+        if (is_channel) {
+            ScopedBinding<Storage> bind(channels, op->name, st);
+            body = mutate(op->body);
+        } else {
+            ScopedBinding<Storage> bind(arrays, op->name, st);
+            body = mutate(op->body);
+        }
+
+        int lanes = st.type.lanes();
+        if (!is_channel) {
+            return Allocate::make(op->name, st.type.element_of(), MemoryType::Auto,
+                                  {simplify(num_elements * lanes)}, mutate(op->condition), body);
+        }
+
+        // Every channel of the array is a FIFO with depth + 1 slots (See runtime/t2s_channels.cpp).
+        Expr fifos = Variable::make(Handle(), op->name + ".fifos");
+        Stmt destroy = Evaluate::make(Call::make(Int(32), "halide_t2s_channel_destroy", {user_context(), fifos}, Call::Extern));
+        body = Block::make(body, destroy);
+        Expr create = Call::make(Handle(), "halide_t2s_channel_create", {user_context(), num_elements, st.depth}, Call::Extern);
+        body = LetStmt::make(op->name + ".fifos", create, body);
+        return Allocate::make(op->name, st.type.element_of(), MemoryType::Heap,
+                              {simplify(num_elements * (st.depth + 1) * lanes)}, const_true(), body);
+    }
+
+    Stmt visit(const Provide *op) override {
+        if (!arrays.contains(op->name)) {
+            return IRMutator::visit(op);
+        }
+        internal_assert(op->values.size() == 1);
+        Expr value = mutate(op->values[0]);
+        vector<Expr> args;
+        for (const auto &a : op->args) {
+            args.push_back(mutate(a));
+        }
+        return store(op->name, value, array_index(op->name, args, value.type()));
+    }
+
+    Stmt visit(const Evaluate *op) override {
+        const Call *call = op->value.as<Call>();
+        if (call && call->is_intrinsic(Call::write_channel)) {
+            // Args: channel name, value, indices of the channel in the channel array
+            string name = channel_array_name(call->args[0].as<StringImm>()->value);
+            Expr value = mutate(call->args[1]);
+            vector<Expr> indices;
+            for (size_t i = 2; i < call->args.size(); i++) {
+                indices.push_back(mutate(call->args[i]));
+            }
+            // Compute the value before asking for a slot, as computing it might need reading other channels.
+            string value_name = unique_name(name + ".value");
+            Expr value_var = Variable::make(value.type(), value_name);
+            Expr fifos = Variable::make(Handle(), name + ".fifos");
+            Expr fifo = fifo_index(name, indices);
+            Expr slot = Call::make(Int(32), "halide_t2s_channel_reserve", {fifos, fifo}, Call::Extern);
+            Stmt write = store(name, value_var, channel_slot_index(name, indices, slot, value.type()));
+            Stmt commit = Evaluate::make(Call::make(Int(32), "halide_t2s_channel_commit", {fifos, fifo}, Call::Extern));
+            return LetStmt::make(value_name, value, Block::make(write, commit));
+        }
+        if (call && call->is_intrinsic(Call::write_shift_reg)) {
+            // Args: register name, indices, value
+            string name = call->args[0].as<StringImm>()->value;
+            vector<Expr> indices;
+            for (size_t i = 1; i < call->args.size() - 1; i++) {
+                indices.push_back(mutate(call->args[i]));
+            }
+            Expr value = mutate(call->args.back());
+            return store(name, value, array_index(name, indices, value.type()));
+        }
+        if (call && call->is_intrinsic(Call::annotate)) {
+            return Evaluate::make(0);
+        }
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->is_intrinsic(Call::read_channel)) {
+            // Args: channel name, indices of the channel in the channel array
+            string name = channel_array_name(op->args[0].as<StringImm>()->value);
+            vector<Expr> indices;
+            for (size_t i = 1; i < op->args.size(); i++) {
+                indices.push_back(mutate(op->args[i]));
+            }
+            Expr fifos = Variable::make(Handle(), name + ".fifos");
+            Expr slot = Call::make(Int(32), "halide_t2s_channel_pop", {fifos, fifo_index(name, indices)}, Call::Extern);
+            return load(op->type, name, channel_slot_index(name, indices, slot, op->type));
+        }
+        if (op->is_intrinsic(Call::read_shift_reg)) {
+            string name = op->args[0].as<StringImm>()->value;
+            vector<Expr> indices;
+            for (size_t i = 1; i < op->args.size(); i++) {
+                indices.push_back(mutate(op->args[i]));
+            }
+            return load(op->type, name, array_index(name, indices, op->type));
+        }
+        user_assert(!op->is_intrinsic(Call::read_channel_nb) && !op->is_intrinsic(Call::write_channel_nb) &&
+                    !op->is_intrinsic(Call::read_mem_channel) && !op->is_intrinsic(Call::write_mem_channel) &&
+                    !op->is_intrinsic(Call::read_array) && !op->is_intrinsic(Call::write_array) &&
+                    !op->is_intrinsic(Call::overlay) && !op->is_intrinsic(Call::overlay_switch))
+            << "Running on CPU: " << op->name << " is not supported yet.\n";
+        internal_assert(!op->is_intrinsic(Call::write_channel) && !op->is_intrinsic(Call::write_shift_reg))
+            << op->name << " is expected to be the value of an Evaluate.\n";
+        if (arrays.contains(op->name) && (op->call_type == Call::Intrinsic || op->call_type == Call::Halide)) {
+            vector<Expr> args;
+            for (const auto &a : op->args) {
+                args.push_back(mutate(a));
+            }
+            return load(op->type, op->name, array_index(op->name, args, op->type));
+        }
+        return IRMutator::visit(op);
+    }
+};
+
+} // namespace
+
+Stmt lower_spatial_design_on_cpu(Stmt s) {
+    CollectKernels collector;
+    s.accept(&collector);
+    if (!collector.kernels.empty()) {
+        s = DispatchKernels(collector.kernels).mutate(s);
+    }
+    s = LowerStorage().mutate(s);
+    return s;
+}
+
+}
+}
@@ -0,0 +1,47 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_SPATIAL_ON_CPU_H
+#define T2S_SPATIAL_ON_CPU_H
+
+/** \file
+ *
+ * Defines a pass to run a spatial design (device funcs, channels and shift registers)
+ * as concurrent threads on the host CPU. Used with Target::SpatialOnCPU.
+ *
+ */
+
+#include "../../Halide/src/IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/* Lower the device kernels of a spatial design for the host CPU:
+ * 1. Every channel array becomes a set of bounded single-producer, single-consumer FIFOs in host memory. A FIFO
+ *    has min_depth slots, and read/write_channel block on the FIFO (runtime module t2s_channels).
+ * 2. Every shift register and other on-chip storage becomes a plain host allocation, accessed as a C array like in
+ *    the OpenCL code.
+ * 3. All the device kernels are launched together in a parallel loop, one task per kernel, with the thread pool
+ *    sized so that every kernel runs on its own thread.
+ */
+extern Stmt lower_spatial_design_on_cpu(Stmt s);
+
+}
+}
+
+#endif
@@ -0,0 +1,267 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "../../Halide/src/IRMutator.h"
+#include "../../Halide/src/IROperator.h"
+#include "../../Halide/src/ModulusRemainder.h"
+#include "../../Halide/src/Scope.h"
+#include "../../Halide/src/Util.h"
+#include "./SplitStorage.h"
+#include <set>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+string storage_part_name(const string &buffer, int part) {
+    return buffer + ".part." + std::to_string(part);
+}
+
+string storage_part_shift_name(const string &buffer) {
+    return buffer + ".part_shift";
+}
+
+bool is_storage_part(const string &name, string &buffer, int &part) {
+    size_t pos = name.rfind(".part.");
+    if (pos == string::npos || pos + 6 >= name.size()) {
+        return false;
+    }
+    string digits = name.substr(pos + 6);
+    for (char c : digits) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+    }
+    buffer = name.substr(0, pos);
+    part = std::stoi(digits);
+    return true;
+}
+
+namespace {
+
+// Rewrite the accesses to the split buffers in a kernel.
+class AccessParts : public IRMutator {
+    using IRMutator::visit;
+    const map<string, int> &parts;  // Buffer -> max number of parts
+
+public:
+    AccessParts(const map<string, int> &parts) : parts(parts) {}
+
+    map<string, int> accessed;  // Split buffer -> bytes of an element
+
+private:
+    Scope<ModulusRemainder> alignment;  // Alignment of the variables defined by the enclosing lets
+
+    // Does a dense vector of the given lanes from the base stay within a part? The runtime makes the elements in a
+    // part a power of 2, of no less than 4096 bytes. So the vector does if its lanes is a power of 2, it fits in
+    // 4096 bytes, and the base is provably a multiple of the lanes.
+    bool in_one_part(Expr base, int lanes, int elem_bytes) {
+        if ((lanes & (lanes - 1)) != 0 || lanes * elem_bytes > 4096) {
+            return false;
+        }
+        ModulusRemainder mod_rem = modulus_remainder(base, alignment);
+        return mod_rem.modulus % lanes == 0 && mod_rem.remainder % lanes == 0;
+    }
+
+    // The part and the index into the part for an index into a split buffer, if all the lanes of the index are in
+    // the same part, i.e. the index is a scalar, or a dense vector within a part. Otherwise, return false.
+    bool part_and_index(const string &name, int elem_bytes, Expr index, Expr &part, Expr &part_index) {
+        Type t = index.type().element_of();
+        Expr shift = cast(t, Variable::make(Int(32), storage_part_shift_name(name)));
+        Expr mask = (make_const(t, 1) << shift) - make_const(t, 1);
+        if (index.type().is_scalar()) {
+            part = index >> shift;
+            part_index = index & mask;
+            return true;
+        }
+        const Ramp *ramp = index.as<Ramp>();
+        if (ramp && is_one(ramp->stride) && ramp->base.type().is_scalar() &&
+            in_one_part(ramp->base, ramp->lanes, elem_bytes)) {
+            part = ramp->base >> shift;
+            part_index = Ramp::make(ramp->base & mask, ramp->stride, ramp->lanes);
+            return true;
+        }
+        return false;
+    }
+
+    // Load from the selected part only: the load from every part is predicated on the part being selected, so
+    // that the parts not selected are not accessed at all. If the lanes may be in different parts, load them one
+    // by one.
+    Expr load_parts(Type type, const string &name, int parts, Expr index, Expr predicate) {
+        Expr part, part_index;
+        if (!part_and_index(name, type.bytes(), index, part, part_index)) {
+            vector<Expr> lanes;
+            for (int i = 0; i < type.lanes(); i++) {
+                lanes.push_back(load_parts(type.element_of(), name, parts, Shuffle::make_extract_element(index, i),
+                                           Shuffle::make_extract_element(predicate, i)));
+            }
+            return Shuffle::make_concat(lanes);
+        }
+        Expr value;
+        for (int i = parts - 1; i >= 0; i--) {
+            Expr selected = (part == make_const(part.type(), i));
+            if (type.is_vector()) {
+                selected = Broadcast::make(selected, type.lanes());
+            }
+            Expr load = Load::make(type, storage_part_name(name, i), part_index, Buffer<>(), Parameter(),
+                                   is_one(predicate) ? selected : (predicate && selected), ModulusRemainder());
+            value = value.defined() ? Select::make(selected, load, value) : load;
+        }
+        return value;
+    }
+
+    Expr visit(const Let *op) override {
+        ScopedBinding<ModulusRemainder> bind(op->value.type() == Int(32), alignment, op->name,
+                                             modulus_remainder(op->value, alignment));
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        ScopedBinding<ModulusRemainder> bind(op->value.type() == Int(32), alignment, op->name,
+                                             modulus_remainder(op->value, alignment));
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Load *op) override {
+        auto p = parts.find(op->name);
+        if (p == parts.end()) {
+            return IRMutator::visit(op);
+        }
+        accessed[op->name] = op->type.bytes();
+        return load_parts(op->type, op->name, p->second, mutate(op->index), mutate(op->predicate));
+    }
+
+    Stmt visit(const Store *op) override {
+        auto p = parts.find(op->name);
+        if (p == parts.end()) {
+            return IRMutator::visit(op);
+        }
+        accessed[op->name] = op->value.type().bytes();
+        Expr value = mutate(op->value);
+        Expr predicate = mutate(op->predicate);
+        Expr part, part_index;
+        user_assert(part_and_index(op->name, op->value.type().bytes(), mutate(op->index), part, part_index))
+            << "Stores into " << op->name << ", whose storage is split, must be scalars, or dense vectors whose "
+            << "lanes is a power of 2 and whose first index is a multiple of the lanes\n";
+        Stmt stmt = Store::make(storage_part_name(op->name, p->second - 1), value, part_index,
+                                Parameter(), predicate, ModulusRemainder());
+        for (int i = p->second - 2; i >= 0; i--) {
+            Stmt store = Store::make(storage_part_name(op->name, i), value, part_index,
+                                     Parameter(), predicate, ModulusRemainder());
+            stmt = IfThenElse::make(part == make_const(part.type(), i), store, stmt);
+        }
+        return stmt;
+    }
+};
+
+class SplitStorage : public IRMutator {
+    using IRMutator::visit;
+    const map<string, int> &parts;
+
+public:
+    SplitStorage(const map<string, int> &parts) : parts(parts) {}
+
+    std::set<string> accessed;  // The split buffers accessed by any kernel
+
+    Stmt visit(const For *op) override {
+        if (!ends_with(op->name, ".run_on_device") || ends_with(op->name, ".autorun.run_on_device")) {
+            return IRMutator::visit(op);
+        }
+        AccessParts access(parts);
+        Stmt body = access.mutate(op->body);
+        if (access.accessed.empty()) {
+            return op;
+        }
+        for (auto &b : access.accessed) {
+            accessed.insert(b.first);
+        }
+        Stmt s = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        // Ask the runtime for the elements per part before launching the kernel.
+        for (auto &b : access.accessed) {
+            Expr buffer = Variable::make(type_of<struct halide_buffer_t *>(), b.first + ".buffer");
+            Expr shift = Call::make(Int(32), "halide_opencl_buffer_part_shift",
+                                    {buffer, b.second, parts.at(b.first)}, Call::Extern);
+            s = LetStmt::make(storage_part_shift_name(b.first), shift, s);
+        }
+        return s;
+    }
+};
+
+// Tell the runtime that a split buffer may be split, right before the buffer is allocated on the device. The runtime
+// rejects any other buffer beyond the limit of a device allocation, as the kernels address it as a single allocation.
+class AllowSplit : public IRMutator {
+    using IRMutator::visit;
+    const map<string, int> &parts;
+    const std::set<string> &accessed;
+
+    Stmt visit(const LetStmt *op) override {
+        Stmt s = IRMutator::visit(op);
+        const Call *call = op->value.as<Call>();
+        if (!call || (call->name != "halide_device_malloc" && call->name != "halide_device_and_host_malloc")) {
+            return s;
+        }
+        const Variable *buffer = call->args[0].as<Variable>();
+        if (!buffer || !ends_with(buffer->name, ".buffer")) {
+            return s;
+        }
+        string name = buffer->name.substr(0, buffer->name.size() - string(".buffer").size());
+        if (!accessed.count(name)) {
+            return s;
+        }
+        Expr allow = Call::make(Int(32), "halide_opencl_buffer_allow_split", {buffer, parts.at(name)}, Call::Extern);
+        return Block::make(Evaluate::make(allow), s);
+    }
+
+public:
+    AllowSplit(const map<string, int> &parts, const std::set<string> &accessed) : parts(parts), accessed(accessed) {}
+};
+
+} // namespace
+
+Stmt split_storage(Stmt s, const map<string, Function> &env) {
+    map<string, int> parts;
+    for (auto &e : env) {
+        const Function &f = e.second;
+        if (f.storage_parts() <= 1) {
+            continue;
+        }
+        if (f.outputs() == 1) {
+            parts[f.name()] = f.storage_parts();
+        } else {
+            for (int i = 0; i < f.outputs(); i++) {
+                parts[f.name() + "." + std::to_string(i)] = f.storage_parts();
+            }
+        }
+    }
+    if (parts.empty()) {
+        return s;
+    }
+    SplitStorage splitter(parts);
+    s = splitter.mutate(s);
+    if (splitter.accessed.empty()) {
+        return s;
+    }
+    AllowSplit allower(parts, splitter.accessed);
+    return allower.mutate(s);
+}
+
+}
+}
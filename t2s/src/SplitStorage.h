@@ -0,0 +1,57 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_SPLIT_STORAGE_H
+#define T2S_SPLIT_STORAGE_H
+
+/** \file
+ *
+ * Defines a pass to address buffers split into several device allocations (See Func::split_storage).
+ */
+
+#include "../../Halide/src/Function.h"
+#include "../../Halide/src/IR.h"
+#include <map>
+
+namespace Halide {
+namespace Internal {
+
+/* For every buffer allowed to be split into P parts, a kernel accessing it takes the P parts as buffer arguments,
+ * named by storage_part_name(), and the log2 of the elements in a part as a scalar argument, named by
+ * storage_part_shift_name(). An access to element i of the buffer is rewritten into an access to element
+ * (i & ((1 << shift) - 1)) of part (i >> shift). A load from a part is predicated on the part being selected, so
+ * that only one part is accessed. A vector access addresses a single part if it is dense and provably aligned to
+ * its lanes; otherwise, a load is split into its lanes, and a store is rejected. On the host, the buffer is declared
+ * splittable to the runtime right before it is allocated on the device, and the shift is got from the runtime before
+ * the kernel is launched.
+ */
+extern Stmt split_storage(Stmt s, const std::map<std::string, Function> &env);
+
+// The name of a part of a split buffer.
+extern std::string storage_part_name(const std::string &buffer, int part);
+
+// The name of the scalar argument telling the elements in every part of a split buffer, in log2.
+extern std::string storage_part_shift_name(const std::string &buffer);
+
+// Is the name that of a part of a split buffer? If so, return the buffer and the part.
+extern bool is_storage_part(const std::string &name, std::string &buffer, int &part);
+
+}
+}
+
+#endif
@@ -16,6 +16,10 @@
 *
 * SPDX-License-Identifier: BSD-2-Clause-Patent
 *******************************************************************************/
+#include "../../Halide/src/ExprUsesVar.h"
+#include "../../Halide/src/IRMutator.h"
+#include "../../Halide/src/Simplify.h"
+#include "../../Halide/src/Substitute.h"
 #include "./DebugPrint.h"
 #include "./Utilities.h"
 #include "./PreprocessBeforeLower.h"
@@ -32,6 +36,7 @@ struct Schain {
     bool is_output;                 // Output chain needs different primitives
     Func outf;                      // The output chain starts from a function
     ImageParam imp;                 // The input chain starts from external input
+    ImageParam stream_to;           // The output chain may stream into the input of the next layer
     vector<Stensor> stensors;
 };
 vector<Schain> schains;
@@ -41,6 +46,20 @@ Stensor &Stensor::scope(Var v) {
     return *this;
 }
 
+Stensor &Stensor::split_storage(int parts) {
+    user_assert(position == DRAM)
+        << "Only a DRAM stensor can split its storage, but " << name << " is not in DRAM\n";
+    storage_parts = parts;
+    return *this;
+}
+
+Stensor &Stensor::burst(int bits) {
+    user_assert(position == DRAM)
+        << "Only a DRAM stensor can coalesce its accesses into bursts, but " << name << " is not in DRAM\n";
+    burst_bits = bits;
+    return *this;
+}
+
 Stensor &Stensor::banks(const vector<Var> &v) {
     if (v.empty()) {
         // By default, this stensor will output a scalar each time.
@@ -96,10 +115,23 @@ Stensor &operator>>(Func &f, Stensor &s) {
     return schains.back().stensors.back();
 }
 
+const ImageParam &operator>>(Stensor &s, const ImageParam &im) {
+    int c = s.schain_idx;
+    user_assert(c >= 0 && schains[c].is_output)
+        << "Only an output path can stream into the input of another layer, but " << s.name << " is not on an output path\n";
+    user_assert(s.name == schains[c].stensors.back().name)
+        << "Stensor " << s.name << " streams into " << im.name() << ", and thus must be the last one on its path\n";
+    user_assert(s.position == SRAM || s.position == REG)
+        << "Stensor " << s.name << " streams into " << im.name() << ", and thus must be on chip (SRAM or REG)\n";
+    schains[c].stream_to = im;
+    return im;
+}
+
 struct FindVars
 {
     Func ure;
     vector<Var> free_vars;      // Variables appeared in the function definition
+    std::set<string> funcs;     // Functions in the environment
 
     int var_index(Var v) {
         for (size_t i = 0; i < free_vars.size(); i++) {
@@ -149,27 +181,84 @@ struct FindVars
         return free_vars[j];
     }
 
+    // The cycles to read a tile of an input below the given scope, and the cycles to write it, i.e. the product of the
+    // extents of the serial loops below the scope, and of those the input depends on. Both are 0 if an extent is not
+    // constant.
+    void tile_cycles(string imp, Var scope, int64_t &reads, int64_t &writes) {
+        auto &used_vars = fuv.used_vars;
+        internal_assert(used_vars.count(imp) > 0);
+        // The dst_vars includes space loops plus one time loop. Space loops are unrolled, and thus take no cycles
+        std::set<string> space_vars;
+        for (auto &p : ure.function().definition().schedule().transform_params()) {
+            space_vars.insert(p.dst_vars.begin(), p.dst_vars.end()-1);
+        }
+        reads = writes = 1;
+        for (Var v : free_vars) {
+            if (v.same_as(scope)) {
+                break;
+            }
+            if (space_vars.count(v.name()) > 0) {
+                continue;
+            }
+            const int64_t *extent = as_const_int(ure.function().get_bounds(v.name()).second);
+            if (!extent) {
+                reads = writes = 0;
+                return;
+            }
+            reads *= *extent;
+            if (used_vars[imp].count(v.name()) > 0) {
+                writes *= *extent;
+            }
+        }
+    }
+
+    // Derive the scope of an SRAM stensor from its outputs: the tile must contain the outputs, and be read more times
+    // than written, so that a double buffer can be filled with the next tile while the current one is read. The
+    // smallest such tile is chosen, with the scope no higher than the limit.
+    Var derive_scope(string imp, const vector<Var> &outs, int limit) {
+        int j = 0;
+        for (auto &v : outs) {
+            j = std::max(j, var_index(v) + 1);
+        }
+        for (; j <= limit; j++) {
+            auto bound = ure.function().get_bounds(free_vars[j].name());
+            if (is_one(bound.second)) {
+                continue;
+            }
+            int64_t reads, writes;
+            tile_cycles(imp, free_vars[j], reads, writes);
+            if (writes > 0 && reads > writes) {
+                return free_vars[j];
+            }
+        }
+        return free_vars[limit];
+    }
+
     // Find variables appeared in the arguments of inputs
     class FindUsedVars : public IRVisitor
     {
-        string image_param;
+        // The images being read, outermost first. An image may be read by tile, with an index of tiles in its args
+        // (See Func::sparse), and the variables in the args of the index are then used by both images.
+        vector<string> image_params;
     public:
         using IRVisitor::visit;
         map<string, std::set<string>> used_vars;
 
         void visit(const Variable *op) override {
-            if (!image_param.empty()) {
+            for (auto &image_param : image_params) {
                 used_vars[image_param].insert(op->name);
             }
         }
 
         void visit(const Call *op) override {
             if (ends_with(op->name, "_im")) {
-                image_param = remove_postfix(op->name, "_im");
+                string image_param = remove_postfix(op->name, "_im");
+                used_vars.insert({image_param, {}});
+                image_params.push_back(image_param);
                 for (size_t i = 0; i < op->args.size(); i++) {
                     op->args[i].accept(this);
                 }
-                image_param.clear();
+                image_params.pop_back();
             }
         }
     } fuv;
@@ -177,6 +266,7 @@ struct FindVars
     FindVars(const map<string, Func> &env) {
         for (auto &p : env) {
             const Func &f = p.second;
+            funcs.insert(p.first);
             f.value().accept(&fuv);
             // UREs have the same iteration space, so we just check the one applied merge_ures
             if (f.function().has_merged_defs()) {
@@ -191,13 +281,149 @@ struct FindVars
     }
 };
 
+// Map the coordinates of an image to the args of the tail of the output path streaming into it. The tail lays out
+// its output as the image, e.g. collector(total_j, total_i), where every dim must linearize some args densely, e.g.
+// total_j = jjj + JJJ * jj + JJJ * JJ * j, from which jjj = d % JJJ, jj = d / JJJ % JJ and j = d / (JJJ * JJ).
+// Without a layout, the coordinates are the args.
+vector<Expr> invert_layout(const Function &tail, const vector<Expr> &layout, const vector<Expr> &coords) {
+    const vector<string> &args = tail.args();
+    if (layout.empty()) {
+        user_assert(coords.size() == args.size())
+            << tail.name() << " has " << args.size() << " dimensions, but the image it streams into has "
+            << coords.size() << ". Specify the layout of its output as the image\n";
+        return coords;
+    }
+    user_assert(layout.size() == coords.size())
+        << "The layout of " << tail.name() << " has " << layout.size() << " dimensions, but the image it streams into has "
+        << coords.size() << "\n";
+
+    vector<Expr> mapped(args.size());
+    for (size_t d = 0; d < layout.size(); d++) {
+        // The args in this dim, from the fastest to the slowest
+        vector<std::pair<int64_t, size_t>> terms;
+        Expr rest = layout[d];
+        for (size_t a = 0; a < args.size(); a++) {
+            if (!expr_uses_var(layout[d], args[a])) {
+                continue;
+            }
+            Expr v = Variable::make(Int(32), args[a]);
+            Expr coeff = simplify(substitute(args[a], v + 1, layout[d]) - layout[d]);
+            const int64_t *c = as_const_int(coeff);
+            user_assert(c && *c > 0)
+                << "Dimension " << layout[d] << " of the layout of " << tail.name() << " is not linear in " << args[a] << "\n";
+            terms.push_back({*c, a});
+            rest = rest - coeff * v;
+        }
+        user_assert(is_zero(simplify(rest)))
+            << "Dimension " << layout[d] << " of the layout of " << tail.name() << " must be linear in its args\n";
+        std::sort(terms.begin(), terms.end());
+        int64_t stride = 1;
+        for (size_t t = 0; t < terms.size(); t++) {
+            const string &arg = args[terms[t].second];
+            auto bounds = tail.get_bounds(arg);
+            const int64_t *extent = bounds.second.defined() ? as_const_int(bounds.second) : nullptr;
+            user_assert(terms[t].first == stride && extent && is_zero(bounds.first))
+                << "Dimension " << layout[d] << " of the layout of " << tail.name() << " must linearize its args "
+                << "densely, with constant bounds starting from 0\n";
+            user_assert(!mapped[terms[t].second].defined())
+                << "Arg " << arg << " of " << tail.name() << " appears in more than one dimension of its layout\n";
+            Expr e = coords[d] / (int)stride;
+            mapped[terms[t].second] = (t + 1 < terms.size()) ? e % (int)*extent : e;
+            stride *= *extent;
+        }
+    }
+    for (size_t a = 0; a < args.size(); a++) {
+        if (!mapped[a].defined()) {
+            // An arg out of the layout must have a single value
+            auto bounds = tail.get_bounds(args[a]);
+            user_assert(bounds.second.defined() && is_one(bounds.second))
+                << "Arg " << args[a] << " of " << tail.name() << " is not in the layout of its output\n";
+            mapped[a] = bounds.first;
+        }
+    }
+    return mapped;
+}
+
+// Replace the calls to an image with the calls to the tail of the output path streaming into it.
+class StreamImage : public IRMutator {
+    using IRMutator::visit;
+    const string &image;
+    const Function &tail;
+    const vector<Expr> &layout;
+
+    Expr visit(const Call *op) override {
+        if (op->call_type == Call::Halide && op->name == image) {
+            vector<Expr> coords;
+            for (auto &a : op->args) {
+                coords.push_back(mutate(a));
+            }
+            replaced = true;
+            return Call::make(tail, invert_layout(tail, layout, coords), op->value_index);
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    StreamImage(const string &image, const Function &tail, const vector<Expr> &layout)
+        : image(image), tail(tail), layout(layout) {}
+
+    bool replaced = false;
+};
+
 class RealizeOnFPGA
 {
     vector<Var> output_array_dims;
     FindVars &fv;
 
-    vector<Func> isolate_producer(Schain &c) {
-        if (c.stensors[0].position != HOST) {
+    // The output chain of another layer that streams into the given input chain, if any
+    int streamed_from(const Schain &c) {
+        for (size_t i = 0; i < schains.size(); i++) {
+            if (schains[i].is_output && schains[i].stream_to.defined()
+                && schains[i].stream_to.name() == c.imp.name()) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // The chain belongs to the layer of the UREs, i.e. the chain outputs a URE or inputs an image read by the UREs
+    bool in_layer(const Schain &c) {
+        return c.is_output ? fv.funcs.count(c.outf.name()) > 0
+                           : fv.fuv.used_vars.count(c.imp.name()) > 0;
+    }
+
+    // Realize the layer whose output chain streams into this layer, and return the tail of the output chain
+    Func realize_upstream(Schain &u) {
+        map<string, Func> env = u.outf.pipeline().compute_environment();
+        FindVars ufv(env);
+        RealizeOnFPGA layer(ufv);
+        Func tail = layer.realize();
+        tail.compute_root();
+        return tail;
+    }
+
+    // The first producer reads the image from the tail of the upstream output chain, instead of from DRAM. The tail
+    // relays its output through an on-chip buffer, transforming the layout and order of the output to how the
+    // producer reads it.
+    void stream(Schain &c, Schain &u, Func tail, Func p) {
+        user_assert(c.stensors[0].position == SRAM || c.stensors[0].position == REG)
+            << "Stensor " << c.stensors[0].name << " reads the stream from " << tail.name()
+            << ", and thus must be on chip (SRAM or REG)\n";
+        user_assert(tail.output_types()[0] == c.imp.type())
+            << tail.name() << " streams " << tail.output_types()[0] << " into " << c.imp.name()
+            << " of " << c.imp.type() << "\n";
+        StreamImage streamer(Func(c.imp).name(), tail.function(), u.stensors.back().dims);
+        p.function().mutate(&streamer);
+        for (auto &f : p.function().definition().schedule().merged_ures()) {
+            f.function().mutate(&streamer);
+        }
+        internal_assert(streamer.replaced);
+        tail.relay();
+        debug(1) << tail.name() << ".relay();\n";
+    }
+
+    vector<Func> isolate_producer(Schain &c, Func upstream) {
+        if (c.stensors[0].position != HOST && !upstream.defined()) {
             // The device stensors needs serialized inputs
             // If the host stensor is not specified, we automatically generate it
             string host_name = c.imp.name() + "_serializer";
@@ -214,6 +440,9 @@ class RealizeOnFPGA
         fv.ure.isolate_producer_chain({c.imp}, producers);
         debug(1) << fv.ure.name() << ".isolate_producer_chain({"
                  << c.imp.name() << "}, " << names_to_string(producers) << ");\n";
+        if (upstream.defined()) {
+            stream(c, schains[streamed_from(c)], upstream, producers[0]);
+        }
         return std::move(producers);
     }
 
@@ -244,7 +473,7 @@ class RealizeOnFPGA
             Func f_dev(s.name, place);
             consumers.push_back(std::move(f_dev));
         }
-        if (c.stensors.back().position != HOST) {
+        if (c.stensors.back().position != HOST && !c.stream_to.defined()) {
             // If the host stensor is not specified, we automatically generate it
             string host_name = c.outf.name() + "_deserializer";
             Stensor s_host(host_name);
@@ -355,11 +584,14 @@ class RealizeOnFPGA
         internal_assert(c.stensors.size() == producers.size());
         for (size_t i = 0; i < c.stensors.size(); i++) {
             Var v_scope = c.stensors[i].v_scope;
-            if (fv.exists(v_scope) && c.stensors[i].position == SRAM) {
+            // The first stensor reading a stream from another layer has no producer in this layer to buffer
+            if (i > 0 && fv.exists(v_scope) && c.stensors[i].position == SRAM) {
+                int64_t reads, writes;
+                fv.tile_cycles(c.imp.name(), v_scope, reads, writes);
                 Func prev = producers[i-1];
                 producers[i].buffer(prev, v_scope);
                 debug(1) << producers[i].name() << ".buffer("
-                         << prev.name() << ", " << v_scope << ");\n";
+                         << prev.name() << ", " << v_scope << "); // 2 x " << writes << " x banks\n";
             }
         }
     }
@@ -405,6 +637,36 @@ class RealizeOnFPGA
         }
     }
 
+    // A DRAM stensor in the input path loads from the buffer of its predecessor on the host, and a DRAM stensor
+    // in the output path stores into its own buffer.
+    void split_storage(Schain &c, vector<Func> &funcs) {
+        internal_assert(c.stensors.size() == funcs.size());
+        for (size_t i = 0; i < c.stensors.size(); i++) {
+            int parts = c.stensors[i].storage_parts;
+            if (parts > 1) {
+                Func f = c.is_output ? funcs[i] : funcs[i-1];
+                f.split_storage(parts);
+                debug(1) << f.name() << ".split_storage("
+                         << parts << ");\n";
+            }
+        }
+    }
+
+    // A DRAM stensor accesses the same buffer as in split_storage(). The accesses are coalesced into bursts of the memory
+    // interface, independent of the vector width of the stensor, which is set by the compute design.
+    void burst(Schain &c, vector<Func> &funcs) {
+        internal_assert(c.stensors.size() == funcs.size());
+        for (size_t i = 0; i < c.stensors.size(); i++) {
+            int bits = c.stensors[i].burst_bits;
+            if (c.stensors[i].position == DRAM && bits > 0) {
+                Func f = c.is_output ? funcs[i] : funcs[i-1];
+                f.burst(bits);
+                debug(1) << f.name() << ".burst("
+                         << bits << ");\n";
+            }
+        }
+    }
+
     // Check if the stensors are inclusive cache
     // Namely, for input chain the scope of consumer cannot be beyond its predecessor,
     // for output chain the scope of consumer cannot below its predecessor
@@ -413,8 +675,16 @@ class RealizeOnFPGA
         if (!c.is_output) {
             // start from the outermost loop
             int i = fv.free_vars.size()-1;
-            for (auto &s: c.stensors) {
+            for (size_t k = 0; k < c.stensors.size(); k++) {
+                auto &s = c.stensors[k];
                 if (!fv.exists(s.v_scope)) {
+                    if (k > 0 && s.position == SRAM) {
+                        // The scope of a double buffer is derived, instead of inherited
+                        s.v_scope = fv.derive_scope(c.imp.name(), s.v_outs, i);
+                        debug(1) << s.name << ".scope(" << s.v_scope << ") is derived from its outputs\n";
+                        i = fv.var_index(s.v_scope);
+                        continue;
+                    }
                     s.v_scope = fv.free_vars[i];
                     continue;
                 }
@@ -452,22 +722,32 @@ public:
     Func realize() {
         Func out;
         for (auto &c: schains) {
+            if (!in_layer(c)) {
+                // The chain is realized with its own layer, if the layer streams into this one
+                continue;
+            }
             check_inclusiveness(c);
             find_banks(c);
             if (!c.is_output) {
+                int u = streamed_from(c);
+                Func upstream = (u >= 0) ? realize_upstream(schains[u]) : Func();
                 vector<Func> producers;
-                producers = isolate_producer(c);
+                producers = isolate_producer(c, upstream);
                 remove(c, producers);
                 scatter(c, producers);
                 buffer(c, producers);
                 vectorize(c, producers);
                 min_depth(c, producers);
+                split_storage(c, producers);
+                burst(c, producers);
             } else {
                 vector<Func> consumers;
                 consumers = isolate_consumer(c);
                 gather(c, consumers);
                 vectorize(c, consumers);
                 min_depth(c, consumers);
+                split_storage(c, consumers);
+                burst(c, consumers);
                 out = consumers.back();
             }
         }
@@ -482,10 +762,13 @@ class RealizeOnGPU
 
     void gpu_fetch(Schain &c) {
         for (auto &s : c.stensors) {
-            // Currently, we realize SRAM with combined registers across threads
-            // The SRAM stensor determines the allocated registers
+            // SRAM is realized with shared local memory: the threads of a work-group cooperatively
+            // load the tiles, which are double buffered, and then read their own tiles into registers
             if (s.position == SRAM) {
-                c.imp.gpu_fetch(s.v_scope, MemoryType::Register, s.v_outs);
+                if (!fv.exists(s.v_scope)) {
+                    s.v_scope = fv.derive_scope(c.imp.name(), s.v_outs, fv.free_vars.size()-1);
+                }
+                c.imp.gpu_fetch(s.v_scope, MemoryType::GPUShared, s.v_outs);
                 debug(1) << c.imp.name() << ".gpu_fetch("
                          << s.v_scope.name() << ", {" << names_to_string(s.v_outs) << "});\n";
             }
@@ -509,6 +792,8 @@ public:
         Func out;
         for (auto &c : schains) {
             // check_correctness(c);
+            user_assert(!c.stream_to.defined())
+                << "Streaming between layers is supported only on FPGAs\n";
             if (!c.is_output) {
                 gpu_fetch(c);
             } else {
@@ -47,6 +47,8 @@ struct Stensor
     vector<Expr> dims;
     int schain_idx = -1;
     int fifo_depth = 0;
+    int storage_parts = 1;
+    int burst_bits = 0;
 
     Stensor(std::string _n, SMemType _p)
         : name(_n), position(_p) {}
@@ -64,6 +66,10 @@ struct Stensor
     Stensor &banks(const std::vector<Var> &banks);
     Stensor &out(const std::vector<Var> &bankwidth_and_banks);
     Stensor &operator()(const std::vector<Expr> &dims);
+    // Allow the DRAM buffer of this stensor to be split into up to the given number of device allocations
+    Stensor &split_storage(int parts);
+    // Coalesce the DRAM accesses of this stensor into bursts of the given bits, e.g. 512. Not coalesced by default.
+    Stensor &burst(int bits = 512);
 
     template<typename... Args>
     HALIDE_NO_USER_CODE_INLINE typename std::enable_if<Internal::all_are_convertible<Expr, Args...>::value, Stensor &>::type
@@ -87,6 +93,8 @@ struct Stensor
     Stensor &operator>>(Stensor &s);
     friend Stensor &operator>>(const ImageParam &im, Stensor &s);
     friend Stensor &operator>>(Func &f, Stensor &s);
+    // Stream the output of this layer from its last on-chip stensor into the input of the next layer, without DRAM
+    friend const ImageParam &operator>>(Stensor &s, const ImageParam &im);
 };
 
 struct FIFO
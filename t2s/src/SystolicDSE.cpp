@@ -0,0 +1,385 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+#include "SystolicDSE.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+// The candidate PEs along a space loop, and the candidate vector widths.
+const long long space_factors[] = {2, 4, 8, 10, 12, 16, 20, 24, 32};
+const long long vector_factors[] = {2, 4, 8, 16, 32};
+
+// An M20K is 512 deep and 40 bits wide in the widest mode.
+const long long m20k_depth = 512;
+const long long m20k_width = 40;
+
+// A memory is in registers if its words are no more than this.
+const long long words_in_registers = 64;
+
+// How much the fmax drops when the device is full.
+const double fmax_degradation = 0.3;
+
+long long ceil_div(long long a, long long b) {
+    return (a + b - 1) / b;
+}
+
+bool uses(const SystolicTensor &t, const string &loop) {
+    return std::find(t.loops.begin(), t.loops.end(), loop) != t.loops.end();
+}
+
+const SystolicLoop *find_loop(const SystolicProblem &problem, const string &name) {
+    for (const auto &l : problem.loops) {
+        if (l.name == name) {
+            return &l;
+        }
+    }
+    return NULL;
+}
+
+long long factor(const map<string, long long> &factors, const string &loop) {
+    auto f = factors.find(loop);
+    return f == factors.end() ? 1 : f->second;
+}
+
+// The M20Ks of a memory of the given words, split into banks of the given width in elements.
+long long m20ks_of(long long words, long long banks, long long width, int bytes_per_element) {
+    return banks * m20ks_of_memory(ceil_div(words, banks * width), width * bytes_per_element * 8);
+}
+
+bool legal(const SystolicProblem &problem, const SystolicDesign &design) {
+    if (design.space_loops.empty() || design.space_loops.size() > 2) {
+        return false;
+    }
+    for (const auto &s : design.space_loops) {
+        if (s == design.vector_loop || find_loop(problem, s) == NULL) {
+            return false;
+        }
+    }
+    if (!design.vector_loop.empty() && find_loop(problem, design.vector_loop) == NULL) {
+        return false;
+    }
+    for (const auto &t : problem.tensors) {
+        if (t.is_output) {
+            // Partial sums flow along a space loop the output does not depend on, which must be a reduction.
+            for (const auto &s : design.space_loops) {
+                if (!uses(t, s) && !find_loop(problem, s)->reduction) {
+                    return false;
+                }
+            }
+        } else if (design.space_loops.size() == 2) {
+            // An input flows along a space loop it does not depend on. Otherwise every PE would need its own feeder.
+            bool flows = false;
+            for (const auto &s : design.space_loops) {
+                flows = flows || !uses(t, s);
+            }
+            if (!flows) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+FPGABudget FPGABudget::arria10() {
+    return FPGABudget{"Arria 10 GX 1150", 1518, 2713, 34.1, 300};
+}
+
+FPGABudget FPGABudget::stratix10() {
+    return FPGABudget{"Stratix 10 GX 2800", 5760, 11721, 76.8, 450};
+}
+
+long long m20ks_of_memory(long long words, long long word_bits) {
+    if (words <= words_in_registers) {
+        return 0;
+    }
+    return ceil_div(word_bits, m20k_width) * ceil_div(words, m20k_depth);
+}
+
+double estimate_fmax(const FPGABudget &budget, int dsps, int m20ks) {
+    double utilization = std::max((double)dsps / budget.dsps, (double)m20ks / budget.m20ks);
+    return budget.fmax_mhz * (1 - fmax_degradation * utilization * utilization);
+}
+
+bool estimate_systolic_design(const SystolicProblem &problem, const FPGABudget &budget, SystolicDesign &design) {
+    if (!legal(problem, design)) {
+        return false;
+    }
+    design.loops.clear();
+    for (const auto &l : problem.loops) {
+        design.loops.push_back(l.name);
+    }
+
+    long long PEs = 1;
+    for (const auto &s : design.space_loops) {
+        PEs *= factor(design.inner, s);
+    }
+    long long vec = design.vector_loop.empty() ? 1 : factor(design.inner, design.vector_loop);
+
+    // The tile, outer trip count and padded extent of every loop
+    map<string, long long> tile, outer;
+    double useful = 1, padded = 1;
+    for (const auto &l : problem.loops) {
+        tile[l.name] = factor(design.inner, l.name) * factor(design.middle, l.name);
+        if (tile[l.name] > l.extent) {
+            return false;
+        }
+        outer[l.name] = ceil_div(l.extent, tile[l.name]);
+        useful *= l.extent;
+        padded *= outer[l.name] * tile[l.name];
+    }
+
+    long long m20ks = 0;
+    double traffic = 0;
+    for (const auto &t : problem.tensors) {
+        double size = 1, reloads = 1;
+        long long tile_words = 1;
+        for (const auto &l : problem.loops) {
+            if (uses(t, l.name)) {
+                size *= outer[l.name] * tile[l.name];
+                tile_words *= tile[l.name];
+            } else {
+                reloads *= outer[l.name];
+            }
+        }
+        if (t.is_output) {
+            // Every PE accumulates its part of the output tile: the space loops are distributed over the PEs.
+            long long words = 1;
+            for (const auto &l : problem.loops) {
+                if (uses(t, l.name)) {
+                    bool space = std::find(design.space_loops.begin(), design.space_loops.end(), l.name) !=
+                                 design.space_loops.end();
+                    words *= space ? factor(design.middle, l.name) : tile[l.name];
+                }
+            }
+            m20ks += PEs * m20ks_of(words, 1, 1, problem.bytes_per_element);
+            traffic += size;
+        } else {
+            // A double-buffered feeder, with a bank for every PE on the edge the tensor enters the array from, and
+            // as wide as the vector if the tensor is vectorized.
+            long long banks = 1;
+            for (const auto &s : design.space_loops) {
+                if (uses(t, s)) {
+                    banks *= factor(design.inner, s);
+                }
+            }
+            long long width = (!design.vector_loop.empty() && uses(t, design.vector_loop)) ? vec : 1;
+            m20ks += m20ks_of(2 * tile_words, banks, width, problem.bytes_per_element);
+            traffic += size * reloads;
+        }
+    }
+
+    design.dsps = (int)std::ceil(PEs * vec * problem.dsps_per_mac);
+    design.m20ks = (int)m20ks;
+    if (design.dsps > budget.dsps || design.m20ks > budget.m20ks) {
+        return false;
+    }
+    design.fmax_mhz = estimate_fmax(budget, design.dsps, design.m20ks);
+    design.compute_time_ms = padded / (PEs * vec) / (design.fmax_mhz * 1e3);
+    design.memory_time_ms = traffic * problem.bytes_per_element / (budget.bandwidth_gbps * 1e6);
+    design.gflops = useful * problem.ops_per_iteration /
+                    (std::max(design.compute_time_ms, design.memory_time_ms) * 1e6);
+    return true;
+}
+
+namespace {
+
+bool better(const SystolicDesign &a, const SystolicDesign &b) {
+    // Differences below 0.01% are noise of the padding.
+    if (std::fabs(a.gflops - b.gflops) > 1e-4 * std::max(a.gflops, b.gflops)) {
+        return a.gflops > b.gflops;
+    }
+    if (a.dsps != b.dsps) {
+        return a.dsps < b.dsps;
+    }
+    return a.m20ks < b.m20ks;
+}
+
+// Grow the middle tiles from 1 by doubling the one that improves the design most, until none does.
+bool climb_middle_tiles(const SystolicProblem &problem, const FPGABudget &budget, SystolicDesign &design) {
+    for (const auto &l : problem.loops) {
+        design.middle[l.name] = 1;
+    }
+    if (!estimate_systolic_design(problem, budget, design)) {
+        return false;
+    }
+    while (true) {
+        SystolicDesign best = design;
+        for (const auto &l : problem.loops) {
+            SystolicDesign next = design;
+            next.middle[l.name] *= 2;
+            if (estimate_systolic_design(problem, budget, next) && better(next, best)) {
+                best = next;
+            }
+        }
+        if (!better(best, design)) {
+            return true;
+        }
+        design = best;
+    }
+}
+
+string upper(const string &s) {
+    string u = s;
+    std::transform(u.begin(), u.end(), u.begin(), ::toupper);
+    return u;
+}
+
+// Loop i is split into i, ii and iii as in the existing designs. A longer name like "co" gets a postfix instead.
+string loop_name(const string &loop, int level) {
+    if (loop.size() == 1) {
+        return string(level, loop[0]);
+    }
+    return loop + (level == 3 ? "_inner" : "_middle");
+}
+
+} // namespace
+
+string SystolicDesign::to_string() const {
+    std::ostringstream s;
+    s << "space(";
+    for (size_t i = 0; i < space_loops.size(); i++) {
+        s << (i > 0 ? ", " : "") << space_loops[i] << "=" << factor(inner, space_loops[i]);
+    }
+    s << ")";
+    if (!vector_loop.empty()) {
+        s << " vector(" << vector_loop << "=" << factor(inner, vector_loop) << ")";
+    }
+    s << " middle(";
+    for (size_t i = 0; i < loops.size(); i++) {
+        s << (i > 0 ? ", " : "") << loops[i] << "=" << factor(middle, loops[i]);
+    }
+    s << ") " << dsps << " DSPs, " << m20ks << " M20Ks, " << std::fixed << std::setprecision(0)
+      << fmax_mhz << " MHz, " << gflops << " GFLOPS" << (memory_bound() ? " (memory bound)" : "");
+    return s.str();
+}
+
+string SystolicDesign::parameters() const {
+    std::ostringstream s;
+    s << "// Generated by the systolic design-space exploration. Estimates: " << dsps << " DSPs, " << m20ks
+      << " M20Ks, " << std::fixed << std::setprecision(0) << fmax_mhz << " MHz, " << gflops << " GFLOPS"
+      << (memory_bound() ? " (memory bound)" : " (compute bound)") << ".\n";
+    s << "// Apply X.space_time_transform(";
+    for (size_t i = 0; i < space_loops.size(); i++) {
+        s << (i > 0 ? ", " : "") << loop_name(space_loops[i], 3);
+    }
+    s << ")";
+    if (!vector_loop.empty()) {
+        s << ", and X.vectorize(" << loop_name(vector_loop, 3) << ")";
+    }
+    s << ".\n";
+    // Innermost first, as in the existing const-parameters.h
+    for (int level = 3; level >= 2; level--) {
+        for (auto l = loops.rbegin(); l != loops.rend(); ++l) {
+            s << "#define " << std::left << std::setw(12) << upper(loop_name(*l, level))
+              << factor(level == 3 ? inner : middle, *l) << "\n";
+        }
+    }
+    return s.str();
+}
+
+bool SystolicDesign::write_parameters(const string &file_name) const {
+    std::ofstream fp(file_name, std::ios::out);
+    if (!fp) {
+        return false;
+    }
+    fp << parameters();
+    return (bool)fp;
+}
+
+vector<SystolicDesign> explore_systolic_designs(const SystolicProblem &problem, const FPGABudget &budget,
+                                                size_t top) {
+    // The space loops: every loop, and every pair of loops, innermost first.
+    vector<vector<string>> projections;
+    for (size_t i = 0; i < problem.loops.size(); i++) {
+        projections.push_back({problem.loops[i].name});
+        for (size_t j = i + 1; j < problem.loops.size(); j++) {
+            projections.push_back({problem.loops[j].name, problem.loops[i].name});
+        }
+    }
+
+    vector<SystolicDesign> designs;
+    for (const auto &space : projections) {
+        vector<string> vector_loops = {""};
+        for (const auto &l : problem.loops) {
+            if (std::find(space.begin(), space.end(), l.name) == space.end()) {
+                vector_loops.push_back(l.name);
+            }
+        }
+        for (const auto &v : vector_loops) {
+            SystolicDesign design;
+            design.space_loops = space;
+            design.vector_loop = v;
+            if (!legal(problem, design)) {
+                continue;
+            }
+            // Enumerate the PEs along every space loop, and the vector width.
+            vector<map<string, long long>> inners = {{}};
+            vector<string> inner_loops = space;
+            if (!v.empty()) {
+                inner_loops.push_back(v);
+            }
+            for (const auto &l : inner_loops) {
+                vector<map<string, long long>> extended;
+                const long long *begin = (l == v) ? vector_factors : space_factors;
+                const long long *end = (l == v) ? std::end(vector_factors) : std::end(space_factors);
+                for (const auto &in : inners) {
+                    for (const long long *f = begin; f != end; f++) {
+                        if (*f <= find_loop(problem, l)->extent) {
+                            map<string, long long> e = in;
+                            e[l] = *f;
+                            extended.push_back(e);
+                        }
+                    }
+                }
+                inners = extended;
+            }
+            for (const auto &in : inners) {
+                design.inner = in;
+                SystolicDesign d = design;
+                if (climb_middle_tiles(problem, budget, d)) {
+                    designs.push_back(d);
+                }
+            }
+        }
+    }
+
+    std::sort(designs.begin(), designs.end(), better);
+    if (designs.size() > top) {
+        designs.resize(top);
+    }
+    return designs;
+}
+
+}
+}
@@ -0,0 +1,139 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#ifndef T2S_SYSTOLIC_DSE_H
+#define T2S_SYSTOLIC_DSE_H
+
+/* Design-space exploration of systolic arrays, with an analytical model. It runs offline: no FPGA or synthesis is
+ * needed. It is built into the compiler, whose resource estimate uses the same model, and uses no other code of
+ * the compiler, so that a tool exploring designs can also be built from SystolicDSE.cpp alone.
+ *
+ * A problem is a perfect loop nest over some tensors, e.g. GEMM:
+ *     for i, j, k: C(j, i) += A(k, i) * B(j, k)
+ * A design of the systolic array picks 1 or 2 loops as the space loops (arguments of space_time_transform), the PEs
+ * along every space loop, a loop to vectorize in every PE, and the middle tiles of all the loops. Every loop x is
+ * tiled as x = (x_outer * XX + xx) * XXX + xxx, where XXX is the PEs or vector width (1 if x is neither a space loop
+ * nor the vectorized loop), and XX is the middle tile. The middle tiles decide the reuse of the data in the feeders
+ * and the PEs, and thus the memory traffic and the on-chip memory.
+ *
+ * A design is legal if every input tensor can flow through the array, i.e. it does not depend on some space loop,
+ * and every space loop the output does not depend on is a reduction loop, along which partial sums flow.
+ *
+ * The model of a design, given a budget of the FPGA:
+ *   DSPs      = PEs * vector width * DSPs per multiply-add
+ *   M20Ks     = double-buffered feeder tiles of the inputs, banked by the PEs on the edge they feed,
+ *             + the accumulators of the output tile in every PE, if too many for registers
+ *   fmax      = nominal fmax * (1 - 0.3 * utilization^2), where the utilization is the larger of DSPs and M20Ks
+ *   compute   = padded iterations / (PEs * vector width) / fmax
+ *   memory    = (for every input, its size * the outer iterations of the loops it does not depend on
+ *                + the size of the output) * bytes per element / bandwidth
+ *   GFLOPS    = useful operations / max(compute, memory)
+ * A design must fit in the DSPs and M20Ks of the budget.
+ *
+ * Usage:
+ *     using namespace Halide::Internal;
+ *     SystolicProblem gemm;
+ *     gemm.loops   = {{"i", 1024, false}, {"j", 1024, false}, {"k", 1024, true}};
+ *     gemm.tensors = {{"A", {"k", "i"}, false}, {"B", {"j", "k"}, false}, {"C", {"j", "i"}, true}};
+ *     std::vector<SystolicDesign> best = explore_systolic_designs(gemm, FPGABudget::arria10());
+ *     best[0].write_parameters("const-parameters.h");
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Halide {
+namespace Internal {
+
+struct SystolicLoop {
+    std::string name;
+    long long   extent;
+    bool        reduction;
+};
+
+struct SystolicTensor {
+    std::string              name;
+    std::vector<std::string> loops;     // The loops indexing the tensor
+    bool                     is_output;
+};
+
+struct SystolicProblem {
+    std::vector<SystolicLoop>   loops;
+    std::vector<SystolicTensor> tensors;
+    int    bytes_per_element = 4;       // float
+    int    ops_per_iteration = 2;       // A multiply and an add
+    double dsps_per_mac = 1;            // A hardened floating-point DSP does a multiply-add. Set 0.5 for int8 or
+                                        // int16: two 18x19 multipliers are packed into a DSP
+};
+
+struct FPGABudget {
+    std::string name;
+    int    dsps;
+    int    m20ks;
+    double bandwidth_gbps;              // Of the device memory
+    double fmax_mhz;                    // Nominal: the fmax of a small design
+
+    static FPGABudget arria10();        // Arria 10 GX 1150, with 2 banks of DDR4
+    static FPGABudget stratix10();      // Stratix 10 GX 2800, with 4 banks of DDR4
+};
+
+struct SystolicDesign {
+    std::vector<std::string>            loops;        // All the loops of the problem, outermost first
+    std::vector<std::string>            space_loops;  // Innermost first, as for space_time_transform
+    std::string                         vector_loop;  // Empty if nothing is vectorized
+    std::map<std::string, long long>    inner;        // The PEs or vector width along every loop, i.e. XXX
+    std::map<std::string, long long>    middle;       // The middle tile of every loop, i.e. XX
+
+    // Estimates
+    int    dsps = 0;
+    int    m20ks = 0;
+    double fmax_mhz = 0;
+    double compute_time_ms = 0;
+    double memory_time_ms = 0;
+    double gflops = 0;
+
+    bool memory_bound() const { return memory_time_ms > compute_time_ms; }
+
+    // A summary of the design and its estimates, in one line.
+    std::string to_string() const;
+
+    // The schedule in the style of const-parameters.h: a #define of XXX and XX for every loop, after a comment with
+    // the estimates and the space-time transform to apply.
+    std::string parameters() const;
+    bool write_parameters(const std::string &file_name) const;
+};
+
+// The M20Ks of a memory of the given words, each of the given bits. A memory of few words is in registers instead.
+long long m20ks_of_memory(long long words, long long word_bits);
+
+// The fmax of a design using the given DSPs and M20Ks, degraded from the nominal fmax as the device gets full.
+double estimate_fmax(const FPGABudget &budget, int dsps, int m20ks);
+
+// Estimate a design of the problem on the FPGA. Return false if the design is illegal or does not fit in the budget.
+bool estimate_systolic_design(const SystolicProblem &problem, const FPGABudget &budget, SystolicDesign &design);
+
+// Enumerate the legal designs that fit in the budget, and return the best ones by GFLOPS, the best first. Among
+// designs of the same GFLOPS, the one with fewer DSPs and then fewer M20Ks is better.
+std::vector<SystolicDesign> explore_systolic_designs(const SystolicProblem &problem, const FPGABudget &budget,
+                                                     size_t top = 10);
+
+}
+}
+
+#endif
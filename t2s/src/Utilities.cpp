@@ -20,7 +20,9 @@
 #include "../../Halide/src/IREquality.h"
 #include "../../Halide/src/IRMutator.h"
 #include "../../Halide/src/IROperator.h"
+#include <cstdio>
 #include <queue>
+#include <sys/stat.h>
 
 namespace Halide {
 namespace Internal {
@@ -268,5 +270,29 @@ Expr replace_prefix(const string &old_prefix, const string &new_prefix, const Ex
     return new_value;
 }
 
+string hash_to_hex(const string &str) {
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : str) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h);
+    return string(buf);
+}
+
+bool make_dirs(const string &dir) {
+    for (size_t pos = dir.find('/', 1); ; pos = dir.find('/', pos + 1)) {
+        string prefix = dir.substr(0, pos);
+        struct stat st;
+        if (stat(prefix.c_str(), &st) != 0 && mkdir(prefix.c_str(), 0755) != 0) {
+            return false;
+        }
+        if (pos == string::npos) {
+            return true;
+        }
+    }
+}
+
 }
 }
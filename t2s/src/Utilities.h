@@ -99,6 +99,12 @@ bool is_power_of_two(uint32_t n);
 // The power of two closest to n. n is required to be a positive number.
 uint32_t closest_power_of_two(uint32_t n);
 
+// A 64-bit FNV-1a hash of the string, in 16 hex digits.
+std::string hash_to_hex(const std::string &str);
+
+// Create the directory and its missing parents, like "mkdir -p". Return false if failed.
+bool make_dirs(const std::string &dir);
+
 }
 }
 
@@ -34,7 +34,9 @@ using namespace std;
 #define II   4
 #define JJ   4
 #define KK   256
+#ifndef III
 #define III  2
+#endif
 #define JJJ  4
 #define KKK  4
 
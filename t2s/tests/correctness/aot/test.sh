@@ -5,9 +5,10 @@ GREEN='\033[0;32m'
 NOCOLOR='\033[0m'
 
 # In this array, every element contains:
-# Test file
+# Test file, or test file:host program if the host program is not test file-run.cpp
 regression=(
         gemm
+        gemm:gemm-session
         lu
         )
 
@@ -16,8 +17,14 @@ fail=0
 
 function emulate_func {
     eval file="$1"
-    printf "$file emulate"
-    compile1="   g++ $file-generate.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 "
+    host=${file#*:}
+    file=${file%%:*}
+    # Optional: extra environment for running the host program, e.g. HL_ASYNC_TRANSFER=1
+    run_env="$2"
+    # Optional: extra flags for compiling the generator, e.g. -DBURST=512
+    generate_flags="$3"
+    printf "$host emulate $run_env $generate_flags"
+    compile1="   g++ $file-generate.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 $generate_flags "
     rm -rf b b.aoc* b.cl a host.cpp host.h exec_time.txt a.out
     $compile1 >& a
     if [ -f "a.out" ]; then
@@ -25,11 +32,23 @@ function emulate_func {
         rm -f a
         run1="env BITSTREAM=b.aocx AOC_OPTION="\""$EMULATOR_AOC_OPTION -board=$FPGA_BOARD -emulator-channel-depth-model=strict "\"" ./a.out"
         timeout 5m env BITSTREAM=b.aocx AOC_OPTION="$EMULATOR_AOC_OPTION -board=$FPGA_BOARD -emulator-channel-depth-model=strict " ./a.out >& a        
-        compile2="   g++ $file-run.cpp host.cpp ../../../src/AOT-OpenCL-Runtime.cpp ../../../src/SharedUtilsInC.cpp -g -DLINUX -DALTERA_CL -fPIC -I../../../src/ -I ../../../../Halide/include -I$INTELFPGAOCLSDKROOT/examples_aoc/common/inc $INTELFPGAOCLSDKROOT/examples_aoc/common/src/AOCLUtils/opencl.cpp $INTELFPGAOCLSDKROOT/examples_aoc/common/src/AOCLUtils/options.cpp -I$INTELFPGAOCLSDKROOT/host/include -L$INTELFPGAOCLSDKROOT/linux64/lib -L$AOCL_BOARD_PACKAGE_ROOT/linux64/lib -L$INTELFPGAOCLSDKROOT/host/linux64/lib -lOpenCL -L ../../../../Halide/bin -lelf $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 "
+        compile2="   g++ $host-run.cpp host.cpp ../../../src/AOT-OpenCL-Runtime.cpp ../../../src/SharedUtilsInC.cpp -g -DLINUX -DALTERA_CL -fPIC -I../../../src/ -I ../../../../Halide/include -I$INTELFPGAOCLSDKROOT/examples_aoc/common/inc $INTELFPGAOCLSDKROOT/examples_aoc/common/src/AOCLUtils/opencl.cpp $INTELFPGAOCLSDKROOT/examples_aoc/common/src/AOCLUtils/options.cpp -I$INTELFPGAOCLSDKROOT/host/include -L$INTELFPGAOCLSDKROOT/linux64/lib -L$AOCL_BOARD_PACKAGE_ROOT/linux64/lib -L$INTELFPGAOCLSDKROOT/host/linux64/lib -lOpenCL -L ../../../../Halide/bin -lelf $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 -fopenmp "
         $compile2 >& a
         if [ -f "a.out" ]; then
-            run2="env CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=1 INTEL_FPGA_OCL_PLATFORM_NAME="\""$EMULATOR_PLATFORM"\"" BITSTREAM=b.aocx ./a.out"
-            timeout 5m env CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=1 INTEL_FPGA_OCL_PLATFORM_NAME="$EMULATOR_PLATFORM" BITSTREAM=b.aocx ./a.out >& a
+            run2="env $run_env CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=1 INTEL_FPGA_OCL_PLATFORM_NAME="\""$EMULATOR_PLATFORM"\"" BITSTREAM=b.aocx ./a.out"
+            timeout 5m env $run_env CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=1 INTEL_FPGA_OCL_PLATFORM_NAME="$EMULATOR_PLATFORM" BITSTREAM=b.aocx ./a.out >& a
+            # A timeline, if asked for, must have recorded the kernels.
+            timeline=$(echo $run_env | sed -n 's/.*HL_TIMELINE=\([^ ]*\).*/\1/p')
+            if [ -n "$timeline" ]; then
+                grep -q '"cat": "kernel"' $timeline || echo "No kernel in timeline $timeline" >> a
+                rm -f $timeline
+            fi
+            # With split buffers, every load from a part must be guarded by the selection of the part, so that
+            # the parts not selected are not accessed.
+            if echo $run_env | grep -q HL_BUFFER_PART_BYTES; then
+                awk 'BEGIN { guard = -1 } /^ *if \(/ { guard = NR } /^ *[a-z0-9_]+ _[0-9]+ = .*_part_[0-9]/ { if (guard != NR - 2) bad++ } END { exit bad > 0 }' b.cl \
+                    || echo "A load from a part of a split buffer is not guarded in b.cl" >> a
+            fi
             if  tail -n 1 a | grep -q -E "^Success!"; then
                 echo >> success.txt
                 echo "rm -rf b b.aoc* b.cl a host.cpp host.h exec_time.txt a.out" >> success.txt
@@ -84,6 +103,23 @@ while [ "$index" -lt "${#array_to_read[*]}" ]; do
     emulate_func "\${file}"
 done
 
+# Again, with asynchronous host/device transfers in the runtime.
+index=0
+while [ "$index" -lt "${#array_to_read[*]}" ]; do
+    file=${array_to_read[$index]}
+    let index=index+1
+    emulate_func "\${file}" "HL_ASYNC_TRANSFER=1"
+done
+
+# Buffers split into several device allocations. HL_BUFFER_PART_BYTES applies only to the buffers with split_storage.
+emulate_func "gemm-split:gemm" "HL_BUFFER_PART_BYTES=65536"
+
+# Split buffers accessed in bursts. The bursts must stay within the parts.
+emulate_func "gemm-split:gemm" "HL_BUFFER_PART_BYTES=65536" "-DBURST=512"
+
+# A timeline of the kernels and copies.
+emulate_func "gemm" "HL_TIMELINE=timeline.json"
+
 let total=succ+fail
 echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/success.txt and failure.txt for details.
 
@@ -0,0 +1,88 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# Test the bitstream cache with a stub of aoc (./aoc), which records every invocation in aoc.log.
+# The design is the GEMM in the AOT test.
+
+succ=0
+fail=0
+
+compile="   g++ ../aot/gemm-generate.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 "
+clean="rm -rf a a.out b.aocx b.cl b.key aoc.log host.cpp host.h cache"
+
+# Usage: check "description" "option for aoc" expected_number_of_aoc_invocations [text not expected in the bitstream]
+function check {
+    rm -f aoc.log
+    timeout 5m env PATH=$PWD:$PATH BITSTREAM=b.aocx BITSTREAM_CACHE=$PWD/cache AOC_OPTION="$2" ./a.out >& a
+    num=`cat aoc.log 2>/dev/null | wc -l`
+    printf "$1 "
+    if [ -f b.aocx ] && [ "$num" == "$3" ] && ( [ -z "$4" ] || ! grep -q "$4" b.aocx ); then
+        let succ=succ+1
+        echo " Success!"
+    else
+        echo >> failure.txt
+        echo "$1: aoc is invoked $num times, $3 expected" >> failure.txt
+        cat a >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+}
+
+# Usage: modify "description" "option for aoc"
+# Compile with WAIT set, and modify the source by hand before aoc is invoked. The bitstream from the modified source
+# must not be trusted afterwards.
+function modify {
+    rm -f aoc.log b.cl b.aocx
+    (for i in `seq 300`; do [ -s b.cl ] && break; sleep 1; done; sleep 1; echo "// Modified by hand" >> b.cl; echo c) | \
+        timeout 5m env PATH=$PWD:$PATH BITSTREAM=b.aocx BITSTREAM_CACHE=$PWD/cache AOC_OPTION="$2" WAIT=1 ./a.out >& a
+    num=`cat aoc.log 2>/dev/null | wc -l`
+    printf "$1 "
+    if [ -f b.aocx ] && [ "$num" == "1" ] && grep -q "Modified by hand" b.aocx; then
+        let succ=succ+1
+        echo " Success!"
+    else
+        echo >> failure.txt
+        echo "$1: aoc is invoked $num times, 1 expected, with the modified source" >> failure.txt
+        cat a >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+}
+
+rm -f success.txt failure.txt
+echo "Testing bitstream cache for regression."
+
+$clean
+$compile >& a
+if [ -f "a.out" ]; then
+    check "miss"                            "-board=x" 1
+    check "existing bitstream up to date"   "-board=x" 0
+    rm -f b.aocx
+    check "hit"                             "-board=x" 0
+    check "existing bitstream out of date"  "-board=y" 1
+    check "hit after switching back"        "-board=x" 0
+    rm -f b.aocx b.key
+    rm -rf cache
+    check "miss after cleaning the cache"   "-board=x" 1
+    modify "source modified by hand"        "-board=x"
+    check "hit after the modified source"   "-board=x" 0 "Modified by hand"
+else
+    echo >> failure.txt
+    echo $compile >> failure.txt
+    cat a >> failure.txt
+    let fail=fail+1
+    echo " Failure!"
+fi
+$clean
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
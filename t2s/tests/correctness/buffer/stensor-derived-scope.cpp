@@ -0,0 +1,95 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "util.h"
+
+// A GEMM whose SRAM stensors declare no scope. The scope of each feeder, and thus the tile of its double buffer, is
+// derived from its outputs: the smallest tile that contains the outputs and is reused, i.e. below ii for aFeeder,
+// and below kk for bFeeder.
+using namespace Halide;
+
+#define III 4
+#define JJJ 4
+#define KKK 4
+#define II 2
+#define JJ 2
+#define KK 2
+#define I 2
+#define J 2
+#define K 2
+#define TOTAL_I (III * II * I)
+#define TOTAL_J (JJJ * JJ * J)
+#define TOTAL_K (KKK * KK * K)
+
+int main(void) {
+    #define P               kkk,      jjj,  iii,  jj, ii, kk,     k,  j,i
+    #define P_kkk_minus_1   kkk-1,    jjj,  iii,  jj, ii, kk,     k,  j,i
+    #define P_kk_minus_1    kkk+KKK-1,jjj,  iii,  jj, ii, kk-1,   k,  j,i
+    #define P_k_minus_1     kkk+KKK-1,jjj,  iii,  jj, ii, kk+KK-1,k-1,j,i
+    #define P_jjj_minus_1   kkk,      jjj-1,iii,  jj, ii, kk,     k,  j,i
+    #define P_iii_minus_1   kkk,      jjj,  iii-1,jj, ii, kk,     k,  j,i
+    #define P_Out                     jjj,  iii,  jj, ii,             j,i
+    #define total_i         (iii + III * ii + III * II * i)
+    #define total_j         (jjj + JJJ * jj + JJJ * JJ * j)
+    #define total_k         (kkk + KKK * kk + KKK * KK * k)
+
+    ImageParam A("A", Float(32), 2), B("B", Float(32), 2);
+
+    Var kkk("kkk"), jjj("jjj"), iii("iii"), jj("jj"), ii("ii"), kk("kk"), k("k"), j("j"), i("i");
+    URE X("X", Float(32), {P}), Y("Y", Float(32), {P}), Z("Z", Float(32), {P}), Out("Out");
+    X(P) = select(jjj == 0, A(total_k, total_i), X(P_jjj_minus_1));
+    Y(P) = select(iii == 0, B(total_j, total_k), Y(P_iii_minus_1));
+    Z(P) = select(kkk == 0 && kk == 0 && k == 0, 0,
+                select(kkk == 0, select(kk == 0, Z(P_k_minus_1), Z(P_kk_minus_1)), Z(P_kkk_minus_1)))
+                + X(P) * Y(P);
+    Out(P_Out) = select(kkk == KKK-1 && kk == KK-1 && k == K-1, Z(P));
+    X.merge_ures(Y, Z, Out);
+    X.set_bounds(jjj, 0, JJJ, iii, 0, III, kkk, 0, KKK)
+     .set_bounds(jj,  0, JJ,  ii,  0, II,  kk,  0, KK)
+     .set_bounds(j,   0, J,   i,   0, I,   k,   0, K);
+    X.space_time_transform(jjj, iii);
+
+    Stensor DA("aLoader", DRAM), SA("aFeeder", SRAM), DB("bLoader", DRAM), SB("bFeeder", SRAM);
+    Stensor RC2("drainer", REG), RC1("collector", REG), DC("unloader", DRAM), C("deserializer");
+    A >> DA.out(kkk) >> FIFO(128)
+      >> SA.out(kkk, iii) >> FIFO(128);
+    B >> DB.out(kkk) >> FIFO(128)
+      >> SB.out(kkk, jjj) >> FIFO(128);
+    Out >> FIFO(128) >> RC2.scope(jj).out(jjj, iii)
+        >> FIFO(128) >> RC1.scope(iii).out(jjj)
+        >> FIFO(128) >> DC >> C(total_j, total_i);
+
+    Buffer<float> ina = new_data_2d<float, TOTAL_K, TOTAL_I>(RANDOM);
+    Buffer<float> inb = new_data_2d<float, TOTAL_J, TOTAL_K>(RANDOM);
+    A.set(ina);
+    B.set(inb);
+    Buffer<float> result(TOTAL_J, TOTAL_I);
+    C.realize(result, IntelFPGA);
+
+    for (int x = 0; x < TOTAL_I; x++) {
+        for (int y = 0; y < TOTAL_J; y++) {
+            float golden = 0;
+            for (int z = 0; z < TOTAL_K; z++) {
+                golden += ina(z, x) * inb(y, z);
+            }
+            assert(abs(result(y, x) - golden) < 0.005 * abs(golden) + 0.005);
+        }
+    }
+    cout << "Success!\n";
+    return 0;
+}
@@ -22,6 +22,8 @@ array=( "buffer-with-scatter.cpp" yes 1 2 no
             Host Device
         "tmm_small.cpp" yes 1 2 no
             Host Device
+        "stensor-derived-scope.cpp" yes 1 2 no
+            Host Device
       )
 
 succ=0
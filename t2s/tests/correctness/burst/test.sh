@@ -0,0 +1,81 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# In this array, every element contains:
+# Bits of a burst (0 disables coalescing)
+regression=(
+        512
+        256
+        0
+)
+
+succ=0
+fail=0
+
+function emulate_func {
+    eval burst="$1"
+    file=gemm-burst
+    printf "$file.cpp BURST=$burst "
+    compile="g++ $file.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 -DBURST=$burst "
+    clean="rm -rf a a.out $file $file.aoc* $file.cl $file.estimate.txt exec_time.txt"
+    $clean
+    $compile >& a
+    if [ -f "a.out" ]; then
+        # There is an error "Unterminated quoted string" using $run due to AOC_OPTION. To avoid it, explicitly run for every case.
+        run="env PRAGMAUNROLL=1 BITSTREAM="\""$file.aocx"\"" CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=1 INTEL_FPGA_OCL_PLATFORM_NAME="\""$EMULATOR_PLATFORM"\"" AOC_OPTION="\""$EMULATOR_AOC_OPTION -board=$FPGA_BOARD -emulator-channel-depth-model=strict "\"" ./a.out"
+        timeout 5m env PRAGMAUNROLL=1 BITSTREAM="$file.aocx" CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=1 INTEL_FPGA_OCL_PLATFORM_NAME="$EMULATOR_PLATFORM" AOC_OPTION="$EMULATOR_AOC_OPTION -board=${FPGA_BOARD} -emulator-channel-depth-model=strict " ./a.out >& a
+        # The loaders and the unloader must have been given register buffers for their bursts.
+        if [ "$burst" -gt 0 ] && ! grep -q "_burst" $file.cl; then
+            echo "No burst is found in $file.cl" >> a
+        fi
+        if  tail -n 1 a | grep -q -E "^Success!"; then
+            echo >> success.txt
+            echo $clean >> success.txt
+            echo $compile >> success.txt
+            echo $run >> success.txt
+            cat a >> success.txt
+            let succ=succ+1
+            echo " Success!"
+        else
+            echo >> failure.txt
+            echo $clean >> failure.txt
+            echo $compile >> failure.txt
+            echo $run >> failure.txt
+            cat a >> failure.txt
+            let fail=fail+1
+            echo "Failure!"
+        fi
+    else
+        echo >> failure.txt
+        echo $clean >> failure.txt
+        echo $compile >> failure.txt
+        cat a >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+    $clean
+}
+
+rm -f success.txt failure.txt
+
+array_to_read=("${regression[@]}")
+echo "Testing DRAM bursts for regression."
+
+index=0
+while [ "$index" -lt "${#array_to_read[*]}" ]; do
+    burst=${array_to_read[$index]}
+    let index=index+1
+    emulate_func "\${burst}"
+done
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/success.txt and failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
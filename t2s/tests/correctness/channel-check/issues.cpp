@@ -0,0 +1,77 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+// Small channel graphs, each with one issue for the channel check, built directly in IR:
+//    ./a.out mismatch|inversion|cycle|none
+// Every kernel is a loop of a single iteration, named after the kernel, around its channel accesses.
+#include "Halide.h"
+#include <iostream>
+#include <string>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+Stmt write(const std::string &channel) {
+    return Evaluate::make(Call::make(Int(32), Call::write_channel, {StringImm::make(channel + ".channel"), 0}, Call::Intrinsic));
+}
+
+Stmt read(const std::string &channel) {
+    return Evaluate::make(Call::make(Int(32), Call::read_channel, {StringImm::make(channel + ".channel")}, Call::Intrinsic));
+}
+
+Stmt loop(const std::string &kernel, const std::string &var, int extent, Stmt body) {
+    return For::make(kernel + ".s0." + var, 0, extent, ForType::Serial, DeviceAPI::None, body);
+}
+
+Stmt kernel(const std::string &name, const std::vector<Stmt> &body) {
+    return loop(name, "run", 1, Block::make(body));
+}
+
+// Declare a channel with the given depth around the kernels.
+Stmt channel(const std::string &name, int depth, Stmt body) {
+    return Realize::make(name + ".channel", {Int(32)}, MemoryType::Auto, {Range(0, depth)}, const_true(), body);
+}
+
+int main(int argc, char **argv) {
+    std::string design = (argc > 1) ? argv[1] : "none";
+    Stmt s;
+    if (design == "mismatch") {
+        // P writes 8 tokens into X, but C reads only 4.
+        s = Block::make(kernel("P", {loop("P", "i", 8, write("X"))}),
+                        kernel("C", {loop("C", "i", 4, read("X"))}));
+        s = channel("X", 256, s);
+    } else if (design == "inversion") {
+        // P writes 8 tokens into X and then 1 into Y, while C reads Y first. X holds only 2 tokens.
+        s = Block::make(kernel("P", {loop("P", "i", 8, write("X")), write("Y")}),
+                        kernel("C", {read("Y"), loop("C", "i", 8, read("X"))}));
+        s = channel("X", 2, channel("Y", 2, s));
+    } else if (design == "cycle") {
+        // P waits for C, and C waits for P.
+        s = Block::make(kernel("P", {read("Y"), write("X")}),
+                        kernel("C", {read("X"), write("Y")}));
+        s = channel("X", 256, channel("Y", 256, s));
+    } else {
+        // A correct producer-consumer pair.
+        s = Block::make(kernel("P", {loop("P", "i", 8, write("X"))}),
+                        kernel("C", {loop("C", "i", 8, read("X"))}));
+        s = channel("X", 256, s);
+    }
+    check_channels(s);
+    std::cout << "Success!\n";
+    return 0;
+}
@@ -0,0 +1,115 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# Test the check of the channels for deadlocks (HL_CHANNEL_CHECK): a correct design must compile and run with
+# HL_CHANNEL_CHECK=error. The design is the GEMM in the CPU test, which does not need an FPGA emulator.
+# issues.cpp builds small channel graphs with one issue each. The issue must be reported as a warning, and fail the
+# check with HL_CHANNEL_CHECK=error.
+
+succ=0
+fail=0
+
+compile="   g++ ../cpu/gemm-stt.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin -lHalide -lz -lpthread -ldl -std=c++11 -DPLACE0=Place::Host -DPLACE1=Place::Device "
+run="env LD_LIBRARY_PATH=../../../../Halide/bin:$LD_LIBRARY_PATH HL_CHANNEL_CHECK=error ./a.out"
+clean="rm -rf a a.out"
+
+rm -f success.txt failure.txt
+echo "Testing channel deadlock check for regression."
+
+printf "gemm-stt.cpp "
+$clean
+$compile >& a
+if [ -f "a.out" ]; then
+    timeout 5m $run >& a
+    # No issue is reported.
+    if tail -n 1 a | grep -q -E "^Success!" && ! grep -q "Warning" a; then
+        let succ=succ+1
+        echo " Success!"
+    else
+        echo >> failure.txt
+        echo $compile >> failure.txt
+        echo $run >> failure.txt
+        cat a >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+else
+    echo >> failure.txt
+    echo $compile >> failure.txt
+    cat a >> failure.txt
+    let fail=fail+1
+    echo " Failure!"
+fi
+$clean
+
+# Usage: check_issue design "expected message"
+function check_issue {
+    printf "issues.cpp $1 "
+    rm -f errors
+    if [ ! -f "a.out" ]; then
+        cat a > errors
+    else
+        timeout 5m env LD_LIBRARY_PATH=../../../../Halide/bin:$LD_LIBRARY_PATH ./a.out $1 >& b
+        if ! tail -n 1 b | grep -q -E "^Success!" || ! grep -q "$2" b; then
+            echo "Expect \"$2\" in a warning" > errors
+            cat b >> errors
+        fi
+        if timeout 5m env LD_LIBRARY_PATH=../../../../Halide/bin:$LD_LIBRARY_PATH HL_CHANNEL_CHECK=error ./a.out $1 >& b ||
+           ! grep -q "issues with channels (HL_CHANNEL_CHECK=error)" b; then
+            echo "Expect a failure with HL_CHANNEL_CHECK=error" >> errors
+            cat b >> errors
+        fi
+    fi
+    if [ ! -s errors ]; then
+        let succ=succ+1
+        echo " Success!"
+    else
+        echo >> failure.txt
+        echo "issues.cpp $1" >> failure.txt
+        cat errors >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+}
+
+compile="   g++ issues.cpp -g -I ../../../../Halide/include -L ../../../../Halide/bin -lHalide -lz -lpthread -ldl -std=c++11 "
+clean="rm -rf a a.out b errors"
+$clean
+$compile >& a
+check_issue mismatch  "Channel X.channel has 8 tokens written but 4 tokens read"
+check_issue inversion "Potential deadlock: kernel P writes 8 tokens into X.channel before writing Y.channel, but kernel C reads Y.channel before X.channel, and X.channel has depth 2"
+check_issue cycle     "Deadlock: in the cycle of kernels C -> P -> C"
+
+printf "issues.cpp none "
+rm -f errors
+if [ -f "a.out" ]; then
+    timeout 5m env LD_LIBRARY_PATH=../../../../Halide/bin:$LD_LIBRARY_PATH HL_CHANNEL_CHECK=error ./a.out none >& b
+    if ! tail -n 1 b | grep -q -E "^Success!" || grep -q "Warning" b; then
+        cat b > errors
+    fi
+else
+    cat a > errors
+fi
+if [ ! -s errors ]; then
+    let succ=succ+1
+    echo " Success!"
+else
+    echo >> failure.txt
+    echo "issues.cpp none" >> failure.txt
+    cat errors >> failure.txt
+    let fail=fail+1
+    echo " Failure!"
+fi
+$clean
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
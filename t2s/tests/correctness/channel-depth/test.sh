@@ -0,0 +1,85 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# Test the inference of channel depths (HL_CHANNEL_DEPTH_REPORT). The design is the GEMM in the CPU test, which sets
+# no min_depth on its channels, and does not need an FPGA emulator.
+# The GEMM in the AOT test sets min_depth(256) on its loaders, feeders, drainer and collector, which must be kept.
+# aoc is the stub in the bitstream-cache test.
+
+succ=0
+fail=0
+
+compile="   g++ ../cpu/gemm-stt.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin -lHalide -lz -lpthread -ldl -std=c++11 -DPLACE0=Place::Host -DPLACE1=Place::Device "
+run="env LD_LIBRARY_PATH=../../../../Halide/bin:$LD_LIBRARY_PATH HL_CHANNEL_DEPTH_REPORT=depths.txt ./a.out"
+clean="rm -rf a a.out depths.txt"
+
+rm -f success.txt failure.txt
+echo "Testing channel depth inference for regression."
+
+printf "gemm-stt.cpp "
+$clean
+$compile >& a
+if [ -f "a.out" ]; then
+    timeout 5m $run >& a
+    # Every channel of the drainer and collector must have got a depth inferred.
+    if tail -n 1 a | grep -q -E "^Success!" &&
+       grep -q -E "^drainer.channel +drainer .* [0-9]+\s*$" depths.txt &&
+       grep -q -E "^collector.channel +collector .* [0-9]+\s*$" depths.txt; then
+        let succ=succ+1
+        echo " Success!"
+    else
+        echo >> failure.txt
+        echo $compile >> failure.txt
+        echo $run >> failure.txt
+        cat a >> failure.txt
+        cat depths.txt >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+else
+    echo >> failure.txt
+    echo $compile >> failure.txt
+    cat a >> failure.txt
+    let fail=fail+1
+    echo " Failure!"
+fi
+$clean
+
+printf "gemm with min_depth "
+compile="   g++ ../aot/gemm-generate.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 "
+run="env PATH=$PWD/../bitstream-cache:$PATH BITSTREAM=b.aocx HL_CHANNEL_DEPTH_REPORT=depths.txt ./a.out"
+clean="rm -rf a a.out depths.txt b.aocx b.cl aoc.log host.cpp host.h"
+$clean
+$compile >& a
+if [ -f "a.out" ]; then
+    timeout 5m $run >& a
+fi
+ok=1
+for func in aLoader aFeeder bLoader bFeeder drainer collector; do
+    grep -q -E "^$func[^ ]*\.channel .* 256 \(given\)\s*$" depths.txt 2>/dev/null || ok=0
+done
+if [ $ok == 1 ]; then
+    let succ=succ+1
+    echo " Success!"
+else
+    echo >> failure.txt
+    echo $compile >> failure.txt
+    echo $run >> failure.txt
+    cat a >> failure.txt
+    cat depths.txt >> failure.txt
+    let fail=fail+1
+    echo " Failure!"
+fi
+$clean
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
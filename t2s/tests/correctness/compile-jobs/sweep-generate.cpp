@@ -0,0 +1,53 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "Halide.h"
+
+// For printing output
+#include <stdio.h>
+
+#include <fstream>
+#include <string>
+
+using namespace Halide;
+using namespace std;
+
+// Queue the device compiles of a sweep of designs, as the generator of every design does, and wait for them. The
+// designs are stubs, which the stub of aoc in this directory compiles.
+// Usage: ./a.out number_of_designs
+//        ./a.out resume
+int main(int argc, char **argv) {
+    if (argc > 1 && string(argv[1]) == "resume") {
+        vector<shared_future<int>> resumed = resume_device_compiles();
+        int failed = 0;
+        for (auto &r : resumed) {
+            failed += (r.get() != 0);
+        }
+        printf("Resumed %d, failed %d\n", (int)resumed.size(), failed);
+        return 0;
+    }
+
+    int designs = (argc > 1) ? atoi(argv[1]) : 1;
+    for (int d = 0; d < designs; d++) {
+        string design = "d" + to_string(d);
+        ofstream(design + ".cl") << "Design " << d << "\n";
+        Internal::CompileJobs::get().submit("aoc -g " + design + ".cl -o " + design + ".aocx", design + ".aocx");
+    }
+    printf("Failed %d\n", wait_for_device_compiles());
+    return 0;
+}
@@ -0,0 +1,126 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# Test device compiles in the background:
+#  The GEMM in the AOT test, with the stub of aoc in the bitstream-cache test, which records every invocation in
+#  aoc.log.
+#  A sweep of stub designs (sweep-generate.cpp), with the stub of aoc in this directory, which records when every
+#  compile starts and ends in jobs.log.
+
+succ=0
+fail=0
+
+# Usage: result "description" error_file
+function result {
+    printf "$1 "
+    if [ ! -s $2 ]; then
+        let succ=succ+1
+        echo " Success!"
+    else
+        echo >> failure.txt
+        echo "$1" >> failure.txt
+        cat $2 >> failure.txt
+        cat jobs/*.job >> failure.txt 2>&1
+        let fail=fail+1
+        echo " Failure!"
+    fi
+    rm -f errors
+}
+
+# Usage: check "description" expected_number_of_aoc_invocations
+function check {
+    rm -f aoc.log
+    timeout 5m env PATH=$PWD/../bitstream-cache:$PATH BITSTREAM=b.aocx BITSTREAM_CACHE=$PWD/cache \
+                   COMPILE_JOBS=2 COMPILE_JOBS_DIR=$PWD/jobs ./a.out >& a
+    num=`cat aoc.log 2>/dev/null | wc -l`
+    if [ ! -f b.aocx ] || [ ! -f b.aocx.log ] || [ "$num" != "$2" ] || ! grep -q "^status done 0$" jobs/*.job; then
+        echo "aoc is invoked $num times, $2 expected" > errors
+        cat a >> errors
+    fi
+    result "$1" errors
+}
+
+# Usage: sweep extra_environment arguments
+function sweep {
+    timeout 5m env PATH=$PWD:$PATH BITSTREAM_CACHE=off COMPILE_JOBS_DIR=$PWD/jobs $1 ./a.out $2
+}
+
+# The max number of compiles running at the same time, according to jobs.log.
+function max_running {
+    awk '{ if ($1 == "start") n++; else n--; if (n > m) m = n } END { print m + 0 }' jobs.log
+}
+
+rm -f success.txt failure.txt errors
+echo "Testing background device compiles for regression."
+
+compile="   g++ ../aot/gemm-generate.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 "
+clean="rm -rf a a.out b.aocx b.cl b.key b.aocx.log aoc.log host.cpp host.h cache jobs"
+$clean
+$compile >& a
+if [ -f "a.out" ]; then
+    check "compile in the background"             1
+    check "existing bitstream up to date"         0
+    # Pretend that the generator was killed while the compile was running.
+    sed -i "s/^status .*/status running/" jobs/*.job
+    check "existing bitstream interrupted"        1
+else
+    echo $compile > errors
+    cat a >> errors
+    result "gemm" errors
+fi
+$clean
+
+compile="   g++ sweep-generate.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 "
+clean="rm -rf a a.out d*.cl d*.aocx d*.aocx.log aoc.log jobs.log jobs"
+$clean
+$compile >& a
+if [ -f "a.out" ]; then
+    # 4 designs, 2 compiles at a time
+    sweep "COMPILE_JOBS=2 AOC_SLEEP=2" 4 >& a
+    tail -n 1 a | grep -q "^Failed 0$" || cat a > errors
+    [ `ls d*.aocx d*.aocx.log 2>/dev/null | wc -l` == 8 ] || echo "Missing bitstreams or logs" >> errors
+    [ `grep -l "^status done 0$" jobs/*.job 2>/dev/null | wc -l` == 4 ] || echo "Not all the jobs are done" >> errors
+    [ `max_running` == 2 ] || echo "`max_running` compiles ran at the same time, 2 expected" >> errors
+    result "COMPILE_JOBS=2" errors
+    $clean
+
+    # A compile beyond the time limit
+    sweep "COMPILE_JOBS=1 COMPILE_JOB_TIMEOUT=1 AOC_SLEEP=5" 1 >& a
+    tail -n 1 a | grep -q "^Failed 1$" || cat a > errors
+    grep -q "^status done 124$" jobs/*.job 2>/dev/null || echo "The job is not timed out" >> errors
+    result "COMPILE_JOB_TIMEOUT=1" errors
+    $clean
+
+    # A sweep killed in the middle: the jobs of the sweep are not resumed while it is alive, but are afterwards.
+    env PATH=$PWD:$PATH BITSTREAM_CACHE=off COMPILE_JOBS_DIR=$PWD/jobs COMPILE_JOBS=1 AOC_SLEEP=4 ./a.out 2 >& a &
+    pid=$!
+    sleep 2
+    sweep "COMPILE_JOBS=1" resume >& resumed
+    grep -q "^Resumed 0, failed 0$" resumed || (echo "Jobs of a live process are resumed"; cat resumed) >> errors
+    kill -9 $pid
+    wait $pid 2>/dev/null
+    # Let the orphaned compile finish.
+    sleep 4
+    sweep "COMPILE_JOBS=1" resume >& resumed
+    grep -q "^Resumed 2, failed 0$" resumed || (echo "Jobs of a dead process are not resumed"; cat resumed) >> errors
+    [ `grep -l "^status done 0$" jobs/*.job 2>/dev/null | wc -l` == 2 ] || echo "Not all the jobs are done" >> errors
+    result "resume" errors
+    rm -f resumed
+else
+    echo $compile > errors
+    cat a >> errors
+    result "sweep" errors
+fi
+$clean
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
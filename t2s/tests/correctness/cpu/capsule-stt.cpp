@@ -0,0 +1,142 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "util.h"
+
+// A capsule convolution, whose elements are MY x MX pose matrices, with a stride of 2:
+//     v(my, mx, cot, oy, ox) += p(mk, mx, ci, 2 * oy + ky, 2 * ox + kx) * w(my, mk, ci, cot, ky, kx)
+// The systolic array has COOO x YX PEs. p flows along the output channels (cooo), and w along the output positions
+// (yx). The OY x OX output positions are linearized, and split into YX positions in space and the rest in time, so
+// a row of PEs covers parts of two image rows: the bounds of the shift registers and the channel arrays are
+// irregular, i.e. not those of any dimension of the tensors.
+#define MY   2
+#define MX   2
+#define MK   2
+#define KY   3
+#define KX   3
+#define CI   2
+#define COOO 2
+#define CO   2
+#define OY   3
+#define OX   3
+#define YX   4
+#define Y_X  3      // YX * Y_X >= OY * OX. The positions beyond OY * OX are computed, but not checked.
+#define TOTAL_CO (COOO * CO)
+#define IY   (OY * 2 + KY - 2)
+#define IX   (OX * 2 + KX - 2)
+
+int main(void) {
+    // Input parameters: p and w are 5D and 6D tensors.
+    ImageParam p(type_of<int>(), 5);
+    ImageParam w(type_of<int>(), 6);
+
+    Var  cooo, yx, kx, ky, ci, mk, my, mx, y_x, co;
+
+    // Macros for convenience.
+    #define P               cooo,     yx,     kx,          ky,          ci,          mk,     my, mx, y_x, co
+    #define P_cooo_minus_1  cooo - 1, yx,     kx,          ky,          ci,          mk,     my, mx, y_x, co
+    #define P_yx_minus_1    cooo,     yx - 1, kx,          ky,          ci,          mk,     my, mx, y_x, co
+    #define P_kx_minus_1    cooo,     yx,     kx - 1,      ky,          ci,          mk,     my, mx, y_x, co
+    #define P_ky_minus_1    cooo,     yx,     kx + KX - 1, ky - 1,      ci,          mk,     my, mx, y_x, co
+    #define P_ci_minus_1    cooo,     yx,     kx + KX - 1, ky + KY - 1, ci - 1,      mk,     my, mx, y_x, co
+    #define P_mk_minus_1    cooo,     yx,     kx + KX - 1, ky + KY - 1, ci + CI - 1, mk - 1, my, mx, y_x, co
+    #define P_v             cooo,     yx,                                                    my, mx, y_x, co
+    #define oy              ((yx + YX * y_x) % OY)
+    #define ox              ((yx + YX * y_x) / OY)
+    #define cot             (cooo + COOO * co)
+
+    #define compute Int(32), {P}, PLACE1
+
+    Func A(compute), B(compute), C(compute), v(PLACE1);
+    // Positions beyond the image read its last column again, so that the loads stay within the input.
+    A(P) = select(cooo == 0, p(mk, mx, ci, 2 * oy + ky, min(2 * ox, 2 * (OX - 1)) + kx), A(P_cooo_minus_1));
+    B(P) = select(yx == 0, w(my, mk, ci, cot, ky, kx), B(P_yx_minus_1));
+    C(P) = select(kx == 0 && ky == 0 && ci == 0 && mk == 0, 0,
+                  select(kx == 0, select(ky == 0, select(ci == 0, C(P_mk_minus_1), C(P_ci_minus_1)),
+                                                  C(P_ky_minus_1)),
+                                  C(P_kx_minus_1))) + A(P) * B(P);
+    v(P_v) = select(kx == KX - 1 && ky == KY - 1 && ci == CI - 1 && mk == MK - 1, C(P));
+
+    // Merge UREs
+    A.merge_ures(B, C, v)
+     .set_bounds(cooo, 0, COOO,
+                 yx,   0, YX)
+     .set_bounds(kx,   0, KX,
+                 ky,   0, KY,
+                 ci,   0, CI,
+                 mk,   0, MK)
+     .set_bounds(my,   0, MY,
+                 mx,   0, MX)
+     .set_bounds(y_x,  0, Y_X,
+                 co,   0, CO);
+    A.space_time_transform(cooo, yx);
+
+    // The feeders send p into the first PE of every row, and w into the first PE of every column, through channel
+    // arrays. Within a feeder, the data are scattered across its PEs through shift registers.
+    Func pFeeder(PLACE1), wFeeder(PLACE1);
+    A.isolate_producer_chain(p, pFeeder);
+    A.isolate_producer_chain(w, wFeeder);
+    pFeeder.scatter(p, yx);
+    wFeeder.scatter(w, cooo);
+
+    Func drainer(PLACE1), collector(PLACE1), unloader(PLACE0);
+    v.isolate_consumer_chain(drainer);
+    drainer.space_time_transform(cooo, yx);
+    drainer.isolate_consumer_chain(collector, unloader);
+
+    // Generate input and run.
+    Buffer<int> inp = new_data_5D<int, MK, MX, CI, IY, IX>(SEQUENTIAL);
+    Buffer<int> inw = new_data_6D<int, MY, MK, CI, TOTAL_CO, KY, KX>(SEQUENTIAL);
+    p.set(inp);
+    w.set(inw);
+    Target target = get_host_target();
+    target.set_feature(Target::IntelFPGA);
+    target.set_feature(Target::SpatialOnCPU); // Run the systolic array as threads on the host.
+    Buffer<int> result = unloader.realize({COOO, YX, MY, MX, Y_X, CO}, target);
+
+    for (int c = 0; c < CO; c++) {
+        for (int t = 0; t < Y_X; t++) {
+            for (int s = 0; s < YX && s + YX * t < OY * OX; s++) {
+                int y = (s + YX * t) % OY, x = (s + YX * t) / OY;
+                for (int cr = 0; cr < COOO; cr++) {
+                    for (int i = 0; i < MY; i++) {
+                        for (int j = 0; j < MX; j++) {
+                            int golden = 0;
+                            for (int k = 0; k < MK; k++) {
+                                for (int n = 0; n < CI; n++) {
+                                    for (int fy = 0; fy < KY; fy++) {
+                                        for (int fx = 0; fx < KX; fx++) {
+                                            golden += inp(k, j, n, 2 * y + fy, 2 * x + fx) *
+                                                      inw(i, k, n, cr + COOO * c, fy, fx);
+                                        }
+                                    }
+                                }
+                            }
+                            cout << "(" << i << ", " << j << ", " << cr + COOO * c << ", " << y << ", " << x << ") = "
+                                 << golden << " " << result(cr, s, i, j, t, c) << endl;
+                            assert(result(cr, s, i, j, t, c) == golden);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    cout << "Success!\n";
+    return 0;
+}
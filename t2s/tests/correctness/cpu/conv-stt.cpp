@@ -0,0 +1,125 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "util.h"
+
+// A 2-D convolution:
+//     z(cot, oy, ox) += x(ox + kx, oy + ky, ci) * w(kx, ky, ci, cot)
+// The systolic array has COOO x YYY PEs. x flows along the output channels (cooo), and w along the output rows
+// (yyy). The bounds are odd on purpose: a 3x3 filter, and a 3x2 systolic array, so that the shift registers and
+// the channel arrays between the feeders and the systolic array are not powers of 2.
+#define KX   3
+#define KY   3
+#define CI   2
+#define COOO 3
+#define YYY  2
+#define CO   2
+#define YY   2
+#define OX   5
+#define OY   (YYY * YY)
+#define TOTAL_CO (COOO * CO)
+#define IX   (OX + KX - 1)
+#define IY   (OY + KY - 1)
+
+int main(void) {
+    // Input parameters: x is a 3D image, and w is a 4D filter.
+    ImageParam x(type_of<int>(), 3);
+    ImageParam w(type_of<int>(), 4);
+
+    Var  cooo, yyy, kx, ky, ci, ox, yy, co;
+
+    // Macros for convenience.
+    #define P               cooo,     yyy,     kx,          ky,          ci,     ox, yy, co
+    #define P_cooo_minus_1  cooo - 1, yyy,     kx,          ky,          ci,     ox, yy, co
+    #define P_yyy_minus_1   cooo,     yyy - 1, kx,          ky,          ci,     ox, yy, co
+    #define P_kx_minus_1    cooo,     yyy,     kx - 1,      ky,          ci,     ox, yy, co
+    #define P_ky_minus_1    cooo,     yyy,     kx + KX - 1, ky - 1,      ci,     ox, yy, co
+    #define P_ci_minus_1    cooo,     yyy,     kx + KX - 1, ky + KY - 1, ci - 1, ox, yy, co
+    #define P_z             cooo,     yyy,                                       ox, yy, co
+    #define oy              (yyy + YYY * yy)
+    #define cot             (cooo + COOO * co)
+
+    #define compute Int(32), {P}, PLACE1
+
+    Func X(compute), W(compute), Z(compute), z(PLACE1);
+    X(P) = select(cooo == 0, x(ox + kx, oy + ky, ci), X(P_cooo_minus_1));
+    W(P) = select(yyy == 0, w(kx, ky, ci, cot), W(P_yyy_minus_1));
+    Z(P) = select(kx == 0 && ky == 0 && ci == 0, 0,
+                  select(kx == 0, select(ky == 0, Z(P_ci_minus_1), Z(P_ky_minus_1)), Z(P_kx_minus_1))) + X(P) * W(P);
+    z(P_z) = select(kx == KX - 1 && ky == KY - 1 && ci == CI - 1, Z(P));
+
+    // Merge UREs
+    X.merge_ures(W, Z, z)
+     .set_bounds(cooo, 0, COOO,
+                 yyy,  0, YYY)
+     .set_bounds(kx,   0, KX,
+                 ky,   0, KY,
+                 ci,   0, CI)
+     .set_bounds(ox,   0, OX,
+                 yy,   0, YY,
+                 co,   0, CO);
+    X.space_time_transform(cooo, yyy);
+
+    // The feeders send x into the first PE of every row, and w into the first PE of every column, through channel
+    // arrays. Within a feeder, the data are scattered across its PEs through shift registers.
+    Func xFeeder(PLACE1), wFeeder(PLACE1);
+    X.isolate_producer_chain(x, xFeeder);
+    X.isolate_producer_chain(w, wFeeder);
+    xFeeder.scatter(x, yyy);
+    wFeeder.scatter(w, cooo);
+
+    Func drainer(PLACE1), collector(PLACE1), unloader(PLACE0);
+    z.isolate_consumer_chain(drainer);
+    drainer.space_time_transform(cooo, yyy);
+    drainer.isolate_consumer_chain(collector, unloader);
+
+    // Generate input and run.
+    Buffer<int> inx = new_data_3D<int, IX, IY, CI>(SEQUENTIAL);
+    Buffer<int> inw = new_data_4D<int, KX, KY, CI, TOTAL_CO>(SEQUENTIAL);
+    x.set(inx);
+    w.set(inw);
+    Target target = get_host_target();
+    target.set_feature(Target::IntelFPGA);
+    target.set_feature(Target::SpatialOnCPU); // Run the systolic array as threads on the host.
+    Buffer<int> result = unloader.realize({COOO, YYY, OX, YY, CO}, target);
+
+    for (int c = 0; c < CO; c++) {
+        for (int y = 0; y < YY; y++) {
+            for (int i = 0; i < OX; i++) {
+                for (int yr = 0; yr < YYY; yr++) {
+                    for (int cr = 0; cr < COOO; cr++) {
+                        int golden = 0;
+                        for (int k = 0; k < CI; k++) {
+                            for (int fy = 0; fy < KY; fy++) {
+                                for (int fx = 0; fx < KX; fx++) {
+                                    golden += inx(i + fx, yr + YYY * y + fy, k) * inw(fx, fy, k, cr + COOO * c);
+                                }
+                            }
+                        }
+                        cout << "(" << cr + COOO * c << ", " << yr + YYY * y << ", " << i << ") = " << golden << " "
+                             << result(cr, yr, i, y, c) << endl;
+                        assert(result(cr, yr, i, y, c) == golden);
+                    }
+                }
+            }
+        }
+    }
+
+    cout << "Success!\n";
+    return 0;
+}
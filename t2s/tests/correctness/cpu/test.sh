@@ -0,0 +1,82 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# In this array, every element contains:
+# Test file
+# The device funcs run as threads on the host CPU (Target::SpatialOnCPU), so no FPGA emulator is needed.
+regression=(
+        gemm-stt.cpp
+        conv-stt.cpp
+        capsule-stt.cpp
+)
+
+succ=0
+fail=0
+
+function run_func {
+    eval file="$1"
+    # Optional: extra environment for running the program, e.g. HL_CHANNEL_DEPTH=off
+    run_env="$2"
+    printf "$file $run_env "
+    compile="   g++ $file -g -I ../util  -I ../../../../Halide/include -L ../../../../Halide/bin -lHalide -lz -lpthread -ldl -std=c++11 -DPLACE0=Place::Host -DPLACE1=Place::Device "
+    clean="rm -rf a a.out exec_time.txt"
+    $clean
+    $compile >& a
+    if [ -f "a.out" ]; then
+        rm -f a
+        run="env $run_env LD_LIBRARY_PATH=../../../../Halide/bin:$LD_LIBRARY_PATH ./a.out"
+        timeout 5m env $run_env LD_LIBRARY_PATH=../../../../Halide/bin:$LD_LIBRARY_PATH ./a.out >& a
+        if  tail -n 1 a | grep -q -E "^Success!"; then
+            echo >> success.txt
+            echo $clean >> success.txt
+            echo $compile >> success.txt
+            echo $run >> success.txt
+            cat a >> success.txt
+            let succ=succ+1
+            echo " Success!"
+        else
+            echo >> failure.txt
+            echo $clean >> failure.txt
+            echo $compile >> failure.txt
+            echo $run >> failure.txt
+            cat a >> failure.txt
+            let fail=fail+1
+            echo "Failure!"
+        fi
+    else
+        echo >> failure.txt
+        echo $clean >> failure.txt
+        echo $compile >> failure.txt
+        cat a >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+    $clean
+}
+
+rm -f success.txt failure.txt
+
+array_to_read=("${regression[@]}")
+echo "Testing spatial designs on CPU for regression."
+
+index=0
+while [ "$index" -lt "${#array_to_read[*]}" ]; do
+    file=${array_to_read[$index]}
+    let index=index+1
+    run_func "\${file}"
+done
+
+# Again, with the channels of the default depth, i.e. without depth inference.
+run_func "gemm-stt.cpp" "HL_CHANNEL_DEPTH=off"
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/success.txt and failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
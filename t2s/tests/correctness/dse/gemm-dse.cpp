@@ -0,0 +1,78 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+// Explore the systolic designs of GEMM offline, and compare the best with the hand-tuned design in
+// tests/performance/gemm/const-parameters.h.
+#include "SystolicDSE.h"
+#include <algorithm>
+#include <assert.h>
+#include <iostream>
+
+using namespace std;
+using namespace Halide::Internal;
+
+bool has(const vector<string> &v, const string &s) {
+    return std::find(v.begin(), v.end(), s) != v.end();
+}
+
+int main() {
+    // Sizes that the hand-tuned design tiles with no padding
+    SystolicProblem gemm;
+    gemm.loops   = {{"i", 10 * 32 * 4, false}, {"j", 8 * 32 * 4, false}, {"k", 16 * 32 * 4, true}};
+    gemm.tensors = {{"A", {"k", "i"}, false}, {"B", {"j", "k"}, false}, {"C", {"j", "i"}, true}};
+
+    for (FPGABudget budget : {FPGABudget::arria10(), FPGABudget::stratix10()}) {
+        vector<SystolicDesign> designs = explore_systolic_designs(gemm, budget, 5);
+        assert(!designs.empty());
+        cout << budget.name << ":\n";
+        for (auto &d : designs) {
+            cout << "  " << d.to_string() << "\n";
+        }
+        const SystolicDesign &best = designs[0];
+        assert(best.dsps <= budget.dsps && best.m20ks <= budget.m20ks);
+        for (size_t i = 1; i < designs.size(); i++) {
+            assert(designs[i].gflops <= best.gflops);
+        }
+        // A 2-D array of i and j with k vectorized, as in the hand-tuned design, is the only legal 2-D array.
+        assert(best.space_loops.size() == 2 && has(best.space_loops, "i") && has(best.space_loops, "j"));
+        assert(best.vector_loop == "k");
+        assert(!best.memory_bound());
+
+        SystolicDesign hand;
+        hand.space_loops = {"j", "i"};
+        hand.vector_loop = "k";
+        hand.inner = {{"k", 16}, {"j", 8}, {"i", 10}};
+        hand.middle = {{"k", 32}, {"j", 32}, {"i", 32}};
+        assert(estimate_systolic_design(gemm, budget, hand));
+        cout << "  hand-tuned: " << hand.to_string() << "\n";
+        assert(best.gflops >= hand.gflops);
+
+        // An input depending on both space loops cannot flow through the array.
+        SystolicDesign illegal = hand;
+        illegal.space_loops = {"k", "i"};
+        illegal.vector_loop = "j";
+        assert(!estimate_systolic_design(gemm, budget, illegal));
+
+        string params = best.parameters();
+        assert(params.find("space_time_transform(") != string::npos);
+        assert(params.find("#define KKK") != string::npos && params.find("#define II ") != string::npos);
+        cout << params;
+    }
+    cout << "Success!\n";
+    return 0;
+}
@@ -0,0 +1,52 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# Test the design-space exploration of systolic arrays. It runs entirely offline against the analytical model, and
+# needs neither Halide nor an FPGA.
+
+succ=0
+fail=0
+
+compile="   g++ gemm-dse.cpp ../../../src/SystolicDSE.cpp -g -I ../../../src -std=c++11 "
+run="./a.out"
+clean="rm -rf a a.out"
+
+rm -f success.txt failure.txt
+echo "Testing systolic design-space exploration for regression."
+
+printf "gemm-dse.cpp "
+$clean
+$compile >& a
+if [ -f "a.out" ]; then
+    timeout 5m $run >& a
+    if tail -n 1 a | grep -q -E "^Success!"; then
+        let succ=succ+1
+        echo " Success!"
+    else
+        echo >> failure.txt
+        echo $compile >> failure.txt
+        echo $run >> failure.txt
+        cat a >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+else
+    echo >> failure.txt
+    echo $compile >> failure.txt
+    cat a >> failure.txt
+    let fail=fail+1
+    echo " Failure!"
+fi
+$clean
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
@@ -0,0 +1,74 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# Test the default schedule of the host serializers and deserializers:
+#  unbounded-consumer.cpp: a deserializer without bounds is left serial, and runs correctly in the emulator.
+#  The GEMM in the AOT test: the serializers and deserializer are parallelized in the host code, unless
+#  HL_HOST_SERIALIZER_SCHEDULE=off. aoc is the stub in the bitstream-cache test.
+
+succ=0
+fail=0
+
+# Usage: result "description" error_file
+function result {
+    if [ ! -s $2 ]; then
+        let succ=succ+1
+        echo " Success!"
+    else
+        echo >> failure.txt
+        echo "$1" >> failure.txt
+        cat $2 >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+}
+
+rm -f success.txt failure.txt
+echo "Testing host serializer schedules for regression."
+
+# A deserializer without bounds
+printf "unbounded-consumer.cpp "
+compile="   g++ unbounded-consumer.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 "
+clean="rm -rf a a.out errors $HOME/tmp/a.aocx $HOME/tmp/a.aocr $HOME/tmp/a.aoco $HOME/tmp/a.cl $HOME/tmp/a exec_time.txt"
+$clean
+$compile >& a
+if [ -f "a.out" ]; then
+    timeout 5m env CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=1 INTEL_FPGA_OCL_PLATFORM_NAME="$EMULATOR_PLATFORM" AOC_OPTION="$EMULATOR_AOC_OPTION -board=$FPGA_BOARD" ./a.out >& a
+fi
+tail -n 1 a | grep -q -E "^Success!" || cat a > errors
+result "$compile" errors
+$clean
+
+# The serializers and deserializer of the GEMM
+compile="   g++ ../aot/gemm-generate.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 "
+clean="rm -rf a a.out errors b.aocx b.cl aoc.log host.cpp host.h"
+$clean
+$compile >& a
+for schedule in on off; do
+    printf "gemm HL_HOST_SERIALIZER_SCHEDULE=$schedule "
+    rm -f host.cpp errors
+    if [ -f "a.out" ]; then
+        timeout 5m env PATH=$PWD/../bitstream-cache:$PATH BITSTREAM=b.aocx HL_HOST_SERIALIZER_SCHEDULE=$schedule ./a.out >& a
+    fi
+    if [ ! -f host.cpp ]; then
+        cat a > errors
+    elif [ "$schedule" == "on" ] && ! grep -q "#pragma omp parallel for" host.cpp; then
+        echo "No parallel loop is found in host.cpp" > errors
+    elif [ "$schedule" == "off" ] && grep -q "#pragma omp parallel for" host.cpp; then
+        echo "A parallel loop is found in host.cpp" > errors
+    fi
+    result "$compile" errors
+done
+$clean
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
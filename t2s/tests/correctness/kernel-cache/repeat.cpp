@@ -0,0 +1,55 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+// Realize the same pipeline repeatedly. The OpenCL runtime reuses the kernel objects across the runs, and binds only
+// the arguments that changed. Every run changes the scalar argument, and allocates new input and output buffers, some
+// with a different size, so every argument must be rebound correctly.
+#include "util.h"
+
+#define RUNS 4
+
+int main(void) {
+    ImageParam a(Int(32), 1, "a");
+    Param<int> s("s");
+    Func A(Place::Device);
+    Var i;
+    A(i) = a(i) * s;
+
+    Target target = get_host_target();
+    target.set_feature(Target::IntelFPGA);
+    for (int run = 0; run < RUNS; run++) {
+        int size = (run == 2) ? SIZE / 2 : SIZE;
+        Buffer<int> in(size);
+        for (int x = 0; x < size; x++) {
+            in(x) = x + run;
+        }
+        a.set(in);
+        s.set(run + 2);
+        Buffer<int> out(size);
+        A.realize(out, target);
+        out.copy_to_host();
+        for (int x = 0; x < size; x++) {
+            if (out(x) != (x + run) * (run + 2)) {
+                cout << "Run " << run << ": out(" << x << ") = " << out(x) << ", " << (x + run) * (run + 2) << " expected\n";
+                return 1;
+            }
+        }
+    }
+    cout << "Success!\n";
+    return 0;
+}
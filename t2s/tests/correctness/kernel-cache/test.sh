@@ -0,0 +1,49 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# Test the cache of the OpenCL kernel objects in the runtime: repeat.cpp realizes the same pipeline in the emulator
+# a few times, with a new scalar argument and new buffers every time, and checks the results of every run.
+
+succ=0
+fail=0
+
+rm -f success.txt failure.txt
+echo "Testing OpenCL kernel cache for regression."
+
+printf "repeat.cpp "
+compile="   g++ repeat.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 -DSIZE=16 "
+run="env CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=1 INTEL_FPGA_OCL_PLATFORM_NAME="\""$EMULATOR_PLATFORM"\"" AOC_OPTION="\""$EMULATOR_AOC_OPTION -board=$FPGA_BOARD"\"" ./a.out"
+clean="rm -rf a a.out $HOME/tmp/a.aocx $HOME/tmp/a.aocr $HOME/tmp/a.aoco $HOME/tmp/a.cl $HOME/tmp/a exec_time.txt"
+$clean
+$compile >& a
+if [ -f "a.out" ]; then
+    timeout 5m env CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=1 INTEL_FPGA_OCL_PLATFORM_NAME="$EMULATOR_PLATFORM" AOC_OPTION="$EMULATOR_AOC_OPTION -board=$FPGA_BOARD" ./a.out >& a
+fi
+if tail -n 1 a | grep -q -E "^Success!"; then
+    echo >> success.txt
+    echo $compile >> success.txt
+    echo $run >> success.txt
+    cat a >> success.txt
+    let succ=succ+1
+    echo " Success!"
+else
+    echo >> failure.txt
+    echo $compile >> failure.txt
+    echo $run >> failure.txt
+    cat a >> failure.txt
+    let fail=fail+1
+    echo " Failure!"
+fi
+$clean
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/success.txt and failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
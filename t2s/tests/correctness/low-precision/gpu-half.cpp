@@ -0,0 +1,41 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// The low-precision types are lowered only for FPGAs. For a plain OpenCL GPU target, a float16 kernel still needs
+// the CLHalf feature, and a bfloat16 kernel is rejected. This program is expected to fail to compile the kernel.
+int main() {
+#ifdef BFLOAT
+    ImageParam a(BFloat(16), 1);
+#else
+    ImageParam a(Float(16), 1);
+#endif
+    Func f;
+    Var x, xo, xi;
+    f(x) = a(x) * a(x);
+    f.gpu_tile(x, xo, xi, 16);
+
+    Target target = get_host_target().with_feature(Target::OpenCL);
+    f.compile_to_assembly("gpu-half.s", {a}, "f", target);
+    printf("Compiled\n");
+    return 0;
+}
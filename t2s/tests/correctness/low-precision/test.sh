@@ -0,0 +1,183 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# In this array, every element contains:
+# Input type, accumulator type
+# Every design runs twice: as threads on the host CPU (Target::SpatialOnCPU), and in the FPGA emulator.
+regression=(
+        "int8_t int32_t"
+        "uint8_t int32_t"
+        "int16_t int32_t"
+        "float16_t float"
+        "bfloat16_t float"
+)
+
+succ=0
+fail=0
+
+function run_func {
+    eval types=($1)
+    printf "gemm-stt.cpp ${types[0]}->${types[1]} "
+    compile="   g++ gemm-stt.cpp -g -I ../util  -I ../../../../Halide/include -L ../../../../Halide/bin -lHalide -lz -lpthread -ldl -std=c++11 -DPLACE0=Place::Host -DPLACE1=Place::Device -DTIN=${types[0]} -DTACC=${types[1]} "
+    clean="rm -rf a a.out"
+    $clean
+    $compile >& a
+    if [ -f "a.out" ]; then
+        rm -f a
+        run="env LD_LIBRARY_PATH=../../../../Halide/bin:$LD_LIBRARY_PATH ./a.out"
+        timeout 5m env LD_LIBRARY_PATH=../../../../Halide/bin:$LD_LIBRARY_PATH ./a.out >& a
+        if  tail -n 1 a | grep -q -E "^Success!"; then
+            echo >> success.txt
+            echo $clean >> success.txt
+            echo $compile >> success.txt
+            echo $run >> success.txt
+            cat a >> success.txt
+            let succ=succ+1
+            echo " Success!"
+        else
+            echo >> failure.txt
+            echo $clean >> failure.txt
+            echo $compile >> failure.txt
+            echo $run >> failure.txt
+            cat a >> failure.txt
+            let fail=fail+1
+            echo "Failure!"
+        fi
+    else
+        echo >> failure.txt
+        echo $clean >> failure.txt
+        echo $compile >> failure.txt
+        cat a >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+    $clean
+}
+
+rm -f success.txt failure.txt
+
+array_to_read=("${regression[@]}")
+echo "Testing low-precision types on CPU for regression."
+
+index=0
+while [ "$index" -lt "${#array_to_read[*]}" ]; do
+    types=${array_to_read[$index]}
+    let index=index+1
+    run_func "\${types}"
+done
+
+# The same designs in the FPGA emulator. The low-precision types are lowered only for FPGA targets,
+# so check the generated OpenCL as well: the 8-bit products are computed in 16 bits, and the 16-bit
+# floats are stored as ushort and computed in float32, including the abs() on the inputs.
+function run_emulator {
+    eval types=($1)
+    printf "gemm-stt.cpp ${types[0]}->${types[1]} in the emulator "
+    compile="   g++ gemm-stt.cpp -g -I ../util  -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 -DPLACE0=Place::Host -DPLACE1=Place::Device -DTIN=${types[0]} -DTACC=${types[1]} -DEMULATOR "
+    clean="rm -rf a a.out gemm-stt.cl gemm-stt.aocx"
+    $clean
+    $compile >& a
+    if [ -f "a.out" ]; then
+        rm -f a
+        run="env CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=1 INTEL_FPGA_OCL_PLATFORM_NAME="\""$EMULATOR_PLATFORM"\"" AOC_OPTION="\""$EMULATOR_AOC_OPTION -board=$FPGA_BOARD "\"" BITSTREAM=gemm-stt.aocx ./a.out"
+        timeout 5m env CL_CONTEXT_EMULATOR_DEVICE_INTELFPGA=1 INTEL_FPGA_OCL_PLATFORM_NAME="$EMULATOR_PLATFORM" AOC_OPTION="$EMULATOR_AOC_OPTION -board=$FPGA_BOARD " BITSTREAM=gemm-stt.aocx ./a.out >& a
+        ok=1
+        tail -n 1 a | grep -q -E "^Success!" || ok=0
+        case ${types[0]} in
+            int8_t)
+                grep -q "(short)" gemm-stt.cl || ok=0
+                ;;
+            uint8_t)
+                grep -q "(ushort)" gemm-stt.cl || ok=0
+                ;;
+            float16_t|bfloat16_t)
+                grep -q "ushort" gemm-stt.cl || ok=0
+                grep -q "as_float" gemm-stt.cl || ok=0
+                grep -q "abs_f32(" gemm-stt.cl || ok=0
+                grep -q -E "\bhalf\b|abs_f16\(|bfloat" gemm-stt.cl && ok=0
+                ;;
+        esac
+        if [ $ok == 1 ]; then
+            echo >> success.txt
+            echo $clean >> success.txt
+            echo $compile >> success.txt
+            echo $run >> success.txt
+            cat a >> success.txt
+            let succ=succ+1
+            echo " Success!"
+        else
+            echo >> failure.txt
+            echo $clean >> failure.txt
+            echo $compile >> failure.txt
+            echo $run >> failure.txt
+            cat a gemm-stt.cl >> failure.txt
+            let fail=fail+1
+            echo " Failure!"
+        fi
+    else
+        echo >> failure.txt
+        echo $clean >> failure.txt
+        echo $compile >> failure.txt
+        cat a >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+    $clean
+}
+
+echo "Testing low-precision types in the emulator for regression."
+
+index=0
+while [ "$index" -lt "${#array_to_read[*]}" ]; do
+    types=${array_to_read[$index]}
+    let index=index+1
+    run_emulator "\${types}"
+done
+
+# For a plain OpenCL GPU target, the low-precision types are not lowered. A float16 kernel still needs
+# the CLHalf feature, and a bfloat16 kernel is rejected, instead of computing on the raw bits.
+# Usage: check_rejected macro expected_message
+function check_rejected {
+    printf "gpu-half.cpp $1 for a GPU "
+    compile="   g++ gpu-half.cpp -g -I ../util  -I ../../../../Halide/include -L ../../../../Halide/bin -lHalide -lz -lpthread -ldl -std=c++11 $1 "
+    clean="rm -rf a a.out gpu-half.s"
+    $clean
+    $compile >& a
+    if [ -f "a.out" ]; then
+        run="env LD_LIBRARY_PATH=../../../../Halide/bin:$LD_LIBRARY_PATH ./a.out"
+        timeout 5m env LD_LIBRARY_PATH=../../../../Halide/bin:$LD_LIBRARY_PATH ./a.out >& a
+    fi
+    if [ -f "a.out" ] && ! grep -q "^Compiled" a && grep -q "$2" a; then
+        echo >> success.txt
+        echo $clean >> success.txt
+        echo $compile >> success.txt
+        echo $run >> success.txt
+        cat a >> success.txt
+        let succ=succ+1
+        echo " Success!"
+    else
+        echo >> failure.txt
+        echo $clean >> failure.txt
+        echo $compile >> failure.txt
+        echo $run >> failure.txt
+        echo "Expected: $2" >> failure.txt
+        cat a >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+    $clean
+}
+
+check_rejected "" "CLHalf target flag not enabled"
+check_rejected "-DBFLOAT" "bfloat16 type, which is supported only on Intel FPGAs"
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/success.txt and failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
@@ -0,0 +1,59 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# Test the profiler of the lowering passes (HL_LOWER_PROFILE). The design is the GEMM in the CPU test,
+# which does not need an FPGA emulator.
+
+succ=0
+fail=0
+
+compile="   g++ ../cpu/gemm-stt.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin -lHalide -lz -lpthread -ldl -std=c++11 -DPLACE0=Place::Host -DPLACE1=Place::Device "
+run="env LD_LIBRARY_PATH=../../../../Halide/bin:$LD_LIBRARY_PATH HL_LOWER_PROFILE=profile.json ./a.out"
+clean="rm -rf a a.out profile.json"
+
+rm -f success.txt failure.txt
+echo "Testing lowering profiler for regression."
+
+printf "gemm-stt.cpp "
+$clean
+$compile >& a
+if [ -f "a.out" ]; then
+    # A stale profile must be replaced, not appended to.
+    echo "stale" > profile.json
+    timeout 5m $run >& a
+    # Every line of the profile must be a valid JSON record of a pipeline, and the passes specific to T2S must be there.
+    if tail -n 1 a | grep -q -E "^Success!" && [ -s profile.json ] &&
+       python3 -c 'import json, sys; [json.loads(line)["passes"] for line in open(sys.argv[1])]' profile.json >& /dev/null &&
+       grep -q "\"name\": \"Applying space time transformation\"" profile.json &&
+       grep -q "\"name\": \"Replacing references with channels and shift registers\"" profile.json; then
+        let succ=succ+1
+        echo " Success!"
+    else
+        echo >> failure.txt
+        echo $compile >> failure.txt
+        echo $run >> failure.txt
+        cat a >> failure.txt
+        cat profile.json >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+else
+    echo >> failure.txt
+    echo $compile >> failure.txt
+    cat a >> failure.txt
+    let fail=fail+1
+    echo " Failure!"
+fi
+$clean
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
@@ -0,0 +1,79 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# Test the banking of the on-chip buffers with the GEMM in the AOT test, whose feeders buffer float4 vectors and
+# scatter them across III and JJJ (=4) PEs. aoc is the stub in the bitstream-cache test. In the generated OpenCL,
+# every buffer must be declared with at most 32 banks, a power of 2, each 16 bytes wide, and:
+#   III=3:  the unrolled accesses are banked, with the extent of 3 padded to 4: numbanks(4) and [4] innermost.
+#   III=33: padding 33 to 64 needs more than 32 banks, so the buffer of matrix a is left unbanked.
+
+succ=0
+fail=0
+
+# Usage: result "description" error_file
+function result {
+    if [ ! -s $2 ]; then
+        let succ=succ+1
+        echo " Success!"
+    else
+        echo >> failure.txt
+        echo "$1" >> failure.txt
+        cat $2 >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+}
+
+# Usage: check_banks III
+function check_banks {
+    decls=`grep "__attribute__((memory, numbanks(" b.cl`
+    if [ -z "$decls" ]; then
+        echo "No banked buffer is found in b.cl" > errors
+        return
+    fi
+    for banks in `echo "$decls" | sed -E 's/.*numbanks\(([0-9]+)\).*/\1/'`; do
+        if [ $banks -gt 32 ] || [ $(( banks & (banks - 1) )) -ne 0 ]; then
+            echo "Invalid number of banks: $banks" >> errors
+        fi
+    done
+    echo "$decls" | grep -v -q "bankwidth(16)" && echo "A bank is not 16 bytes wide" >> errors
+    if [ "$1" == "3" ]; then
+        echo "$decls" | grep -v -q -E "numbanks\(4\).*\[4\];" && echo "A buffer is not declared with 4 banks innermost" >> errors
+    else
+        echo "$decls" | grep -q "numbanks(1)," || echo "No buffer is left unbanked" >> errors
+    fi
+    [ -s errors ] && echo "$decls" >> errors
+}
+
+rm -f success.txt failure.txt
+echo "Testing memory banking for regression."
+
+for iii in 3 33; do
+    printf "gemm III=$iii "
+    compile="   g++ ../aot/gemm-generate.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 -DIII=$iii "
+    clean="rm -rf a a.out errors b.aocx b.cl aoc.log host.cpp host.h"
+    $clean
+    $compile >& a
+    if [ -f "a.out" ]; then
+        timeout 5m env PATH=$PWD/../bitstream-cache:$PATH BITSTREAM=b.aocx ./a.out >& a
+    fi
+    if [ ! -f b.cl ]; then
+        cat a > errors
+    else
+        check_banks $iii
+    fi
+    result "$compile" errors
+    $clean
+done
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
@@ -0,0 +1,77 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# Test that the OpenCL source is byte-identical whether the kernels are emitted serially or concurrently.
+# With 1 thread, every kernel is emitted when the host code generator adds it, as before the kernels were
+# emitted concurrently, and the source emitted so is the golden output. The concurrent emission names the
+# temporaries with placeholders and renumbers them afterwards, and must reproduce the golden names exactly,
+# leaving no placeholder behind.
+# The design is the GEMM in the AOT test, and aoc is the stub in the bitstream-cache test.
+
+# In this array, every element contains:
+#  Number of threads emitting the kernels ("default" for one per core)
+regression=(
+        2
+        4
+        16
+        default
+)
+
+succ=0
+fail=0
+
+compile="   g++ ../aot/gemm-generate.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 "
+clean="rm -rf a a.out b.aocx b.cl serial.cl aoc.log host.cpp host.h"
+
+# Usage: generate number_of_threads
+function generate {
+    rm -f b.aocx b.cl
+    if [ "$1" == "default" ]; then
+        timeout 5m env -u HL_DEVICE_CODEGEN_THREADS PATH=$PWD/../bitstream-cache:$PATH BITSTREAM=b.aocx ./a.out >& a
+    else
+        timeout 5m env PATH=$PWD/../bitstream-cache:$PATH BITSTREAM=b.aocx HL_DEVICE_CODEGEN_THREADS=$1 ./a.out >& a
+    fi
+}
+
+rm -f success.txt failure.txt
+echo "Testing parallel device code generation for regression."
+
+$clean
+$compile >& a
+if [ -f "a.out" ] && generate 1 && [ -f b.cl ]; then
+    mv b.cl serial.cl
+    for threads in ${regression[@]}; do
+        printf "HL_DEVICE_CODEGEN_THREADS=$threads "
+        generate $threads
+        if [ -f b.cl ] && cmp -s serial.cl b.cl && ! grep -q "999999999[0-9]\{9\}" b.cl; then
+            let succ=succ+1
+            echo " Success!"
+        else
+            echo >> failure.txt
+            echo "HL_DEVICE_CODEGEN_THREADS=$threads: the source differs from that emitted serially, or has placeholders" >> failure.txt
+            diff serial.cl b.cl >> failure.txt 2>&1
+            cat a >> failure.txt
+            let fail=fail+1
+            echo " Failure!"
+        fi
+    done
+else
+    echo >> failure.txt
+    echo $compile >> failure.txt
+    cat a >> failure.txt
+    let fail=fail+1
+    echo " Failure!"
+fi
+$clean
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
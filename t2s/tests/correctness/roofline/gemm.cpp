@@ -161,6 +161,12 @@ int main(void) {
         }
     }
     
+    // The compiler has estimated the design without synthesis: every PE needs at least a DSP for its multiply-add.
+    cout << "Estimated DSPs: " << DSPs_estimated() << ", fmax: " << FMax_estimated()
+         << " MHz, execution time: " << ExecTime_estimated() << " ns\n";
+    assert(DSPs_estimated() >= III * JJJ * KKK);
+    assert(FMax_estimated() > 0 && ExecTime_estimated() > 0);
+
     // We test correctness in emulation, and thus there is not really a quartus report to produce the rooflines.
     // Here we copy an example report to the directory where a quartus report is supposed to be.
     // This is a hack, and NOT necesssary if running on real hardware.  
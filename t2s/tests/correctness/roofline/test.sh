@@ -19,7 +19,7 @@ function emulate_func {
     eval file="$1"
     printf "$file "
     compile="g++ $file.cpp ../../../src/SharedUtilsInC.cpp ../../../src/Roofline.cpp -g -I ../util -I ../../../src -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 "
-    clean="rm -rf a a.out $file $file.aoc* $file.cl exec_time.txt *.png"
+    clean="rm -rf a a.out $file $file.aoc* $file.cl $file.estimate.txt exec_time.txt *.png"
     $clean
     $compile >& a
     if [ -f "a.out" ]; then
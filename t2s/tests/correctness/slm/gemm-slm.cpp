@@ -0,0 +1,85 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "util.h"
+
+// A GEMM on the GPU whose feeders are SRAM stensors, realized with shared local memory. The work-group has JJ x II
+// threads: the III x KKK tile of A is shared by the JJ threads along jj, and the KKK x JJJ tile of B by the II threads
+// along ii. Only the CM source is generated, which can be checked without a GPU.
+#ifndef III
+#define III 32
+#endif
+
+using namespace Halide;
+
+#define KKK 8
+#define JJJ 8
+#define JJ  8
+#define II  2
+#define KK  1
+
+int main()
+{
+    #define P               kkk,      jjj,  iii,  jj, ii, kk,     k,  j,i
+    #define P_kkk_minus_1   kkk-1,    jjj,  iii,  jj, ii, kk,     k,  j,i
+    #define P_kk_minus_1    kkk+KKK-1,jjj,  iii,  jj, ii, kk-1,   k,  j,i
+    #define P_k_minus_1     kkk+KKK-1,jjj,  iii,  jj, ii, kk+KK-1,k-1,j,i
+    #define P_jjj_minus_1   kkk,      jjj-1,iii,  jj, ii, kk,     k,  j,i
+    #define P_iii_minus_1   kkk,      jjj,  iii-1,jj, ii, kk,     k,  j,i
+    #define P_Out                     jjj,  iii,  jj, ii,             j,i
+
+    #define total_i         (iii + III * ii + III * II * i)
+    #define total_j         (jjj + JJJ * jj + JJJ * JJ * j)
+    #define total_k         (kkk + KKK * kk + KKK * KK * k)
+
+    #define I (A.dim(1).extent() / (III * II))
+    #define J (B.dim(0).extent() / (JJJ * JJ))
+    #define K (A.dim(0).extent() / (KKK * KK))
+
+    ImageParam A("A", Float(32), 2), B("B", Float(32), 2);
+
+    Var kkk("kkk"), jjj("jjj"), iii("iii"), jj("jj"), ii("ii"), kk("kk"), k("k"), j("j"), i("i");
+    URE X("X", Float(32), {P}), Y("Y", Float(32), {P}), Z("Z", Float(32), {P}), Out("Out");
+    X(P) = select(jjj == 0, A(total_k, total_i), X(P_jjj_minus_1));
+    Y(P) = select(iii == 0, B(total_j, total_k), Y(P_iii_minus_1));
+    Z(P) = select(kkk == 0 && kk == 0 && k == 0, 0,
+                select(kkk == 0, select(kk == 0, Z(P_k_minus_1), Z(P_kk_minus_1)), Z(P_kkk_minus_1)))
+                + X(P) * Y(P);
+    Out(P_Out) = select(kkk == KKK-1 && kk == KK-1 && k == K-1, Z(P));
+
+    X.merge_ures(Y, Z, Out);
+    X.set_bounds(jjj, 0, JJJ, iii, 0, III, kkk, 0, KKK)
+     .set_bounds(jj,  0, JJ,  ii,  0, II,  kk,  0, KK)
+     .set_bounds(j,   0, J,   i,   0, I,   k,   0, K);
+    X.space_time_transform(jjj, iii);
+    X.gpu_blocks(j, i).gpu_threads(jj, ii);
+
+    Stensor DA("aLoader", DRAM), SA("aFeeder", SRAM), DB("bLoader", DRAM), SB("bFeeder", SRAM);
+    Stensor RC2("drainer", REG), RC1("collector", REG), DC("unloader", DRAM), C("deserializer");
+    A >> DA.out(kkk) >> FIFO(128)
+      >> SA.scope(k).out(kkk, iii) >> FIFO(128);
+    B >> DB.out(kkk) >> FIFO(128)
+      >> SB.scope(k).out(kkk, jjj) >> FIFO(128);
+    Out >> FIFO(1024) >> RC2.scope(jj).out(jjj, iii)
+        >> FIFO(128)  >> RC1.scope(iii).out(jjj)
+        >> FIFO(128)  >> DC >> C(total_j, total_i);
+
+    C.compile_to_host("gemm-interface", { A, B }, "gemm", IntelGPU);
+    printf("Success\n");
+    return 0;
+}
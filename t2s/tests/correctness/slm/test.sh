@@ -0,0 +1,81 @@
+#!/bin/bash
+# ./test.sh
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+NOCOLOR='\033[0m'
+
+# In this array, every element contains:
+# Rows (III) of the tile of A shared in SLM
+regression=(
+        32
+        64
+)
+
+succ=0
+fail=0
+
+function compile_func {
+    eval rows="$1"
+    file=gemm-slm
+    printf "$file.cpp III=$rows "
+    compile="g++ $file.cpp -g -I ../util -I ../../../../Halide/include -L ../../../../Halide/bin $EMULATOR_LIBHALIDE_TO_LINK -lz -lpthread -ldl -std=c++11 -DIII=$rows "
+    clean="rm -rf a a.out gemm_genx.cpp gemm-interface.*"
+    $clean
+    $compile >& a
+    if [ -f "a.out" ]; then
+        run="./a.out"
+        timeout 5m ./a.out >& a
+        # The feeders must have been realized with cooperative loads into SLM, separated by barriers.
+        for keyword in cm_slm_init cm_slm_write cm_slm_read cm_barrier; do
+            if ! grep -q "$keyword" gemm_genx.cpp; then
+                echo "No $keyword is found in gemm_genx.cpp" >> a
+            fi
+        done
+        if  tail -n 1 a | grep -q -E "^Success"; then
+            echo >> success.txt
+            echo $clean >> success.txt
+            echo $compile >> success.txt
+            echo $run >> success.txt
+            cat a >> success.txt
+            let succ=succ+1
+            echo " Success!"
+        else
+            echo >> failure.txt
+            echo $clean >> failure.txt
+            echo $compile >> failure.txt
+            echo $run >> failure.txt
+            cat a >> failure.txt
+            let fail=fail+1
+            echo "Failure!"
+        fi
+    else
+        echo >> failure.txt
+        echo $clean >> failure.txt
+        echo $compile >> failure.txt
+        cat a >> failure.txt
+        let fail=fail+1
+        echo " Failure!"
+    fi
+    $clean
+}
+
+rm -f success.txt failure.txt
+
+array_to_read=("${regression[@]}")
+echo "Testing SRAM stensors in SLM of the GPU for regression."
+
+index=0
+while [ "$index" -lt "${#array_to_read[*]}" ]; do
+    rows=${array_to_read[$index]}
+    let index=index+1
+    compile_func "\${rows}"
+done
+
+let total=succ+fail
+echo -e Total $total, pass ${GREEN}$succ${NOCOLOR}, fail ${RED}$fail${NOCOLOR}. See $PWD/success.txt and failure.txt for details.
+
+# Return values for the parent script
+echo $total > ../total.temp
+echo $succ > ../succ.temp
+echo $fail > ../fail.temp
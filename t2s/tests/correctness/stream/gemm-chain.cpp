@@ -0,0 +1,127 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+#include "util.h"
+
+// Two GEMMs in a chain, E = (A * B) * D, as two layers of stensors. The output of the first layer streams from its
+// collector into the feeder of the second layer, through an on-chip buffer, without a round trip to DRAM.
+using namespace Halide;
+
+#define III 4
+#define JJJ 4
+#define KKK 4
+#define II 2
+#define JJ 2
+#define KK 2
+#define I 2
+#define J 2
+#define K 2
+#define TOTAL_I (III * II * I)
+#define TOTAL_J (JJJ * JJ * J)
+#define TOTAL_K (KKK * KK * K)
+
+int main(void) {
+    #define P               kkk,      jjj,  iii,  jj, ii, kk,     k,  j,i
+    #define P_kkk_minus_1   kkk-1,    jjj,  iii,  jj, ii, kk,     k,  j,i
+    #define P_kk_minus_1    kkk+KKK-1,jjj,  iii,  jj, ii, kk-1,   k,  j,i
+    #define P_k_minus_1     kkk+KKK-1,jjj,  iii,  jj, ii, kk+KK-1,k-1,j,i
+    #define P_jjj_minus_1   kkk,      jjj-1,iii,  jj, ii, kk,     k,  j,i
+    #define P_iii_minus_1   kkk,      jjj,  iii-1,jj, ii, kk,     k,  j,i
+    #define P_Out                     jjj,  iii,  jj, ii,             j,i
+    #define total_i         (iii + III * ii + III * II * i)
+    #define total_j         (jjj + JJJ * jj + JJJ * JJ * j)
+    #define total_k         (kkk + KKK * kk + KKK * KK * k)
+
+    // Inputs. C is the output of the first layer, and the input of the second.
+    ImageParam A("A", Float(32), 2), B("B", Float(32), 2), C("C", Float(32), 2), D("D", Float(32), 2);
+
+    // The first layer: C(j, i) = sum_k A(k, i) * B(j, k)
+    Var kkk("kkk"), jjj("jjj"), iii("iii"), jj("jj"), ii("ii"), kk("kk"), k("k"), j("j"), i("i");
+    URE X("X", Float(32), {P}), Y("Y", Float(32), {P}), Z("Z", Float(32), {P}), Out("Out");
+    X(P) = select(jjj == 0, A(total_k, total_i), X(P_jjj_minus_1));
+    Y(P) = select(iii == 0, B(total_j, total_k), Y(P_iii_minus_1));
+    Z(P) = select(kkk == 0 && kk == 0 && k == 0, 0,
+                select(kkk == 0, select(kk == 0, Z(P_k_minus_1), Z(P_kk_minus_1)), Z(P_kkk_minus_1)))
+                + X(P) * Y(P);
+    Out(P_Out) = select(kkk == KKK-1 && kk == KK-1 && k == K-1, Z(P));
+    X.merge_ures(Y, Z, Out);
+    X.set_bounds(jjj, 0, JJJ, iii, 0, III, kkk, 0, KKK)
+     .set_bounds(jj,  0, JJ,  ii,  0, II,  kk,  0, KK)
+     .set_bounds(j,   0, J,   i,   0, I,   k,   0, K);
+    X.space_time_transform(jjj, iii);
+
+    // The second layer: E(j, i) = sum_k C(k, i) * D(j, k), with the same shape of systolic array
+    URE X2("X2", Float(32), {P}), Y2("Y2", Float(32), {P}), Z2("Z2", Float(32), {P}), Out2("Out2");
+    X2(P) = select(jjj == 0, C(total_k, total_i), X2(P_jjj_minus_1));
+    Y2(P) = select(iii == 0, D(total_j, total_k), Y2(P_iii_minus_1));
+    Z2(P) = select(kkk == 0 && kk == 0 && k == 0, 0,
+                select(kkk == 0, select(kk == 0, Z2(P_k_minus_1), Z2(P_kk_minus_1)), Z2(P_kkk_minus_1)))
+                + X2(P) * Y2(P);
+    Out2(P_Out) = select(kkk == KKK-1 && kk == KK-1 && k == K-1, Z2(P));
+    X2.merge_ures(Y2, Z2, Out2);
+    X2.set_bounds(jjj, 0, JJJ, iii, 0, III, kkk, 0, KKK)
+      .set_bounds(jj,  0, JJ,  ii,  0, II,  kk,  0, KK)
+      .set_bounds(j,   0, J,   i,   0, I,   k,   0, K);
+    X2.space_time_transform(jjj, iii);
+
+    // I/O network of the first layer. The collector streams C in the layout C(total_j, total_i).
+    Stensor DA("aLoader", DRAM), SA("aFeeder", SRAM), DB("bLoader", DRAM), SB("bFeeder", SRAM);
+    Stensor RC2("drainer", REG), RC1("collector", REG);
+    A >> DA.out(kkk) >> FIFO(128)
+      >> SA.scope(k).out(kkk, iii) >> FIFO(128);
+    B >> DB.out(kkk) >> FIFO(128)
+      >> SB.scope(k).out(kkk, jjj) >> FIFO(128);
+    Out >> FIFO(128) >> RC2.scope(jj).out(jjj, iii)
+        >> FIFO(128) >> RC1.scope(iii).out(jjj)(total_j, total_i) >> C;
+
+    // I/O network of the second layer. Its feeder of C reads the stream instead of DRAM.
+    Stensor SC("cFeeder", SRAM), DD("dLoader", DRAM), SD("dFeeder", SRAM);
+    Stensor RE2("drainer2", REG), RE1("collector2", REG), DE("unloader2", DRAM), E("deserializer2");
+    C >> SC.scope(k).out(kkk, iii) >> FIFO(128);
+    D >> DD.out(kkk) >> FIFO(128)
+      >> SD.scope(k).out(kkk, jjj) >> FIFO(128);
+    Out2 >> FIFO(128) >> RE2.scope(jj).out(jjj, iii)
+         >> FIFO(128) >> RE1.scope(iii).out(jjj)
+         >> FIFO(128) >> DE >> E(total_j, total_i);
+
+    Buffer<float> ina = new_data_2d<float, TOTAL_K, TOTAL_I>(RANDOM);
+    Buffer<float> inb = new_data_2d<float, TOTAL_J, TOTAL_K>(RANDOM);
+    Buffer<float> ind = new_data_2d<float, TOTAL_J, TOTAL_J>(RANDOM);
+    A.set(ina);
+    B.set(inb);
+    D.set(ind);
+    Buffer<float> result(TOTAL_J, TOTAL_I);
+    E.realize(result, IntelFPGA);
+
+    // The first layer reduces over TOTAL_K, and the second over TOTAL_J, the columns of C.
+    for (int x = 0; x < TOTAL_I; x++) {
+        for (int y = 0; y < TOTAL_J; y++) {
+            float golden = 0;
+            for (int z = 0; z < TOTAL_J; z++) {
+                float c = 0;
+                for (int w = 0; w < TOTAL_K; w++) {
+                    c += ina(w, x) * inb(z, w);
+                }
+                golden += c * ind(y, z);
+            }
+            assert(abs(result(y, x) - golden) < 0.005 * abs(golden) + 0.005);
+        }
+    }
+    cout << "Success!\n";
+    return 0;
+}
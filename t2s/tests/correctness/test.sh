@@ -22,7 +22,7 @@ RED='\033[0;31m'
 GREEN='\033[0;32m'
 NOCOLOR='\033[0m'
 
-features=(aot buffer FPGA Func gather gemm integrate isolation LU multi-projection overlay qrd roofline scatter space-time-transform vectorize oneapi-integration)
+features=(aot bitstream-cache buffer burst channel-check channel-depth compile-jobs cpu dse FPGA Func gather gemm host-serializer integrate isolation kernel-cache low-precision lower-profile LU memory-banking multi-projection overlay parallel-codegen pipelining qrd roofline scatter slm space-time-transform sparse stream triangular vectorize oneapi-integration)
 echo "**** Testing for regression ****"
 
 index=0
@@ -0,0 +1,78 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+// Multiply a lower-triangular matrix with the vectors of a triangular batch, with a scheduled space-time transform.
+// Every column j of the matrix has a PE, and row i reaches PE j at time i + j. The bounds of j depend on i, so the
+// time loop iterates over exactly the 2 * N - 1 wavefronts of the triangle, instead of those of the N x N bounding
+// box, and the PEs check the domain themselves. The batch loops c and b (b <= c) and the time loop are flattened into
+// a single loop in the device kernel.
+
+#include "util.h"
+
+#define N 8
+#define C 3
+
+int main(void) {
+    ImageParam l(Int(32), 2);   // l(j, i): row i and column j of the matrix, 0 if j > i
+    ImageParam x(Int(32), 3);   // x(j, b, c): element j of vector (b, c)
+
+    // Macros: for convenient use.
+    #define X                      j,     i, b, c
+    #define X_j_minus_1            j - 1, i, b, c
+    #define FUNC_DECL              Int(32), {X}, PLACE1
+
+    Var  X;
+    Func Y(FUNC_DECL), O(PLACE1);
+    Y(X) = select(j == 0, 0, Y(X_j_minus_1)) + l(j, i) * x(j, b, c);
+    O(i, b, c) = select(j == i, Y(X));
+
+    Y.merge_ures(O)
+     .set_bounds(c, 0, C, b, 0, c + 1)
+     .set_bounds(i, 0, N, j, 0, i + 1)
+     .space_time_transform({j}, {1});
+
+    Buffer<int> in_l = new_data_2d<int, N, N>(SEQUENTIAL);
+    Buffer<int> in_x = new_data_3d<int, N, C, C>(SEQUENTIAL);
+    for (int i = 0; i < N; i++) {
+        for (int j = i + 1; j < N; j++) {
+            in_l(j, i) = 0;
+        }
+    }
+    in_l.set_host_dirty();
+    in_x.set_host_dirty();
+    l.set(in_l);
+    x.set(in_x);
+
+    Target target = get_host_target();
+    target.set_feature(Target::IntelFPGA);
+    Buffer<int> results = O.realize({N, C, C}, target);
+
+    for (int c = 0; c < C; c++) {
+        for (int b = 0; b <= c; b++) {
+            for (int i = 0; i < N; i++) {
+                int golden = 0;
+                for (int j = 0; j <= i; j++) {
+                    golden += in_l(j, i) * in_x(j, b, c);
+                }
+                assert(results(i, b, c) == golden);
+            }
+        }
+    }
+    cout << "Success!\n";
+    return 0;
+}
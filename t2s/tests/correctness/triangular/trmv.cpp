@@ -0,0 +1,75 @@
+/*******************************************************************************
+* Copyright 2021 Intel Corporation
+*
+* Licensed under the BSD-2-Clause Plus Patent License (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSDplusPatent
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions
+* and limitations under the License.
+*
+*
+* SPDX-License-Identifier: BSD-2-Clause-Patent
+*******************************************************************************/
+// Multiply a lower-triangular matrix with K vectors. The reduction loop j iterates only over the lower triangle, i.e.
+// from 0 to i, instead of over the whole row with the upper triangle masked. The device kernel flattens the
+// triangular loops i and j into a single loop of N * (N + 1) / 2 iterations.
+
+#include "util.h"
+
+#define N 16
+#define K 4
+
+int main(void) {
+    ImageParam l(Int(32), 2);   // l(j, i): row i and column j of the matrix, 0 if j > i
+    ImageParam x(Int(32), 2);   // x(k, j): element j of vector k
+
+    // Macros: for convenient use.
+    #define X                      k,     j,     i
+    #define X_k_minus_1            k - 1, j,     i
+    #define X_j_minus_1            k,     j - 1, i
+    #define FUNC_DECL              Int(32), {X}, PLACE1
+
+    Var  X;
+    Func L(FUNC_DECL), Y(FUNC_DECL), O(PLACE1);
+    L(X) = select(k == 0, l(j, i), L(X_k_minus_1));
+    Y(X) = select(j == 0, 0, Y(X_j_minus_1)) + L(X) * x(k, j);
+    O(k, i) = select(j == i, Y(X));
+
+    L.merge_ures(Y, O)
+     .set_bounds(i, 0, N, j, 0, i + 1, k, 0, K)
+     .space_time_transform(k);
+
+    Buffer<int> in_l = new_data_2d<int, N, N>(SEQUENTIAL);
+    Buffer<int> in_x = new_data_2d<int, K, N>(SEQUENTIAL);
+    for (int i = 0; i < N; i++) {
+        for (int j = i + 1; j < N; j++) {
+            in_l(j, i) = 0;
+        }
+    }
+    in_l.set_host_dirty();
+    in_x.set_host_dirty();
+    l.set(in_l);
+    x.set(in_x);
+
+    Target target = get_host_target();
+    target.set_feature(Target::IntelFPGA);
+    Buffer<int> results = O.realize({K, N}, target);
+
+    for (int i = 0; i < N; i++) {
+        for (int k = 0; k < K; k++) {
+            int golden = 0;
+            for (int j = 0; j <= i; j++) {
+                golden += in_l(j, i) * in_x(k, j);
+            }
+            assert(results(k, i) == golden);
+        }
+    }
+    cout << "Success!\n";
+    return 0;
+}